@@ -4,9 +4,14 @@
 
 #include "components/url_formatter/elide_url.h"
 
+#include <utility>
+
+#include "base/containers/mru_cache.h"
+#include "base/lazy_instance.h"
 #include "base/logging.h"
 #include "base/strings/string_split.h"
 #include "base/strings/utf_string_conversions.h"
+#include "base/synchronization/lock.h"
 #include "components/url_formatter/url_formatter.h"
 #include "net/base/escape.h"
 #include "net/base/registry_controlled_domains/registry_controlled_domain.h"
@@ -14,6 +19,7 @@
 #include "url/url_constants.h"
 
 #if !defined(OS_ANDROID) || defined(USE_AURA)
+#include "ui/gfx/font_list.h"  // nogncheck
 #include "ui/gfx/text_elider.h"  // nogncheck
 #include "ui/gfx/text_utils.h"  // nogncheck
 #endif  // !defined(OS_ANDROID) || defined(USE_AURA)
@@ -23,6 +29,51 @@ namespace {
 #if !defined(OS_ANDROID) || defined(USE_AURA)
 const base::char16 kDot = '.';
 
+// Number of (font, string) widths remembered by StringWidthCache.
+const size_t kStringWidthCacheSize = 256;
+
+// Remembers the widths of strings that come up again and again when eliding
+// many URLs in a row, such as ellipses and the hosts and domains of the same
+// few sites, so that each is only shaped once per font.
+class StringWidthCache {
+ public:
+  StringWidthCache() : widths_(kStringWidthCacheSize) {}
+
+  float GetStringWidth(const base::string16& text,
+                       const gfx::FontList& font_list) {
+    const Key key(font_list.GetFontDescriptionString(), text);
+    {
+      base::AutoLock lock(lock_);
+      WidthMap::const_iterator it = widths_.Get(key);
+      if (it != widths_.end())
+        return it->second;
+    }
+    const float width = gfx::GetStringWidthF(text, font_list);
+    base::AutoLock lock(lock_);
+    widths_.Put(key, width);
+    return width;
+  }
+
+ private:
+  typedef std::pair<std::string, base::string16> Key;
+  typedef base::MRUCache<Key, float> WidthMap;
+
+  base::Lock lock_;
+  WidthMap widths_;
+
+  DISALLOW_COPY_AND_ASSIGN(StringWidthCache);
+};
+
+base::LazyInstance<StringWidthCache>::Leaky g_string_width_cache =
+    LAZY_INSTANCE_INITIALIZER;
+
+// Returns the width of |text|, using the shared cache. Only use this for
+// strings likely to be measured again.
+float GetCachedStringWidth(const base::string16& text,
+                           const gfx::FontList& font_list) {
+  return g_string_width_cache.Get().GetStringWidth(text, font_list);
+}
+
 // Build a path from the first |num_components| elements in |path_elements|.
 // Prepends |path_prefix|, appends |filename|, inserts ellipsis if appropriate.
 base::string16 BuildPathFromComponents(
@@ -58,15 +109,43 @@ base::string16 ElideComponentizedPath(
   const size_t url_path_number_of_elements = url_path_elements.size();
 
   CHECK(url_path_number_of_elements);
-  for (size_t i = url_path_number_of_elements - 1; i > 0; --i) {
-    base::string16 elided_path = BuildPathFromComponents(
-        url_path_prefix, url_path_elements, url_filename, i);
-    if (available_pixel_width >= gfx::GetStringWidthF(elided_path, font_list))
-      return gfx::ElideText(elided_path + url_query, font_list,
-                       available_pixel_width, gfx::ELIDE_TAIL);
+  if (url_path_number_of_elements < 2)
+    return base::string16();
+
+  // Keeping every directory is tried first and on its own: it is the only
+  // candidate without ".../", so it can be narrower than the next one down.
+  base::string16 elided_path =
+      BuildPathFromComponents(url_path_prefix, url_path_elements, url_filename,
+                              url_path_number_of_elements - 1);
+  if (available_pixel_width >= gfx::GetStringWidthF(elided_path, font_list))
+    return gfx::ElideText(elided_path + url_query, font_list,
+                          available_pixel_width, gfx::ELIDE_TAIL);
+
+  // The other candidates keep the first |i| directories, then ".../" and the
+  // filename. Each one is the previous one with a directory inserted, and
+  // inserting text never makes a string narrower, so the widths grow with
+  // |i|. Binary search for the largest |i| that fits instead of measuring
+  // every candidate; this finds the same |i| as trying them from the top.
+  size_t fitting_components = 0;
+  size_t high = url_path_number_of_elements - 2;
+  while (fitting_components < high) {
+    const size_t mid = fitting_components + (high - fitting_components + 1) / 2;
+    base::string16 candidate = BuildPathFromComponents(
+        url_path_prefix, url_path_elements, url_filename, mid);
+    if (available_pixel_width >= gfx::GetStringWidthF(candidate, font_list)) {
+      fitting_components = mid;
+      elided_path.swap(candidate);
+    } else {
+      high = mid - 1;
+    }
   }
+  if (!fitting_components)
+    return base::string16();
 
-  return base::string16();
+  // |elided_path| was last set by the final successful probe, which is the
+  // one for |fitting_components|.
+  return gfx::ElideText(elided_path + url_query, font_list,
+                        available_pixel_width, gfx::ELIDE_TAIL);
 }
 
 // Splits the hostname in the |url| into sub-strings for the full hostname,
@@ -221,7 +300,7 @@ base::string16 ElideUrl(const GURL& url,
   }
 
   // Second Pass - remove scheme - the rest fits.
-  const float pixel_width_url_host = gfx::GetStringWidthF(url_host, font_list);
+  const float pixel_width_url_host = GetCachedStringWidth(url_host, font_list);
   const float pixel_width_url_path =
       gfx::GetStringWidthF(url_path_query_etc, font_list);
   if (available_pixel_width >= pixel_width_url_host + pixel_width_url_path)
@@ -229,9 +308,9 @@ base::string16 ElideUrl(const GURL& url,
 
   // Third Pass: Subdomain, domain and entire path fits.
   const float pixel_width_url_domain =
-      gfx::GetStringWidthF(url_domain, font_list);
+      GetCachedStringWidth(url_domain, font_list);
   const float pixel_width_url_subdomain =
-      gfx::GetStringWidthF(url_subdomain, font_list);
+      GetCachedStringWidth(url_subdomain, font_list);
   if (available_pixel_width >=
       pixel_width_url_subdomain + pixel_width_url_domain + pixel_width_url_path)
     return url_subdomain + url_domain + url_path_query_etc;
@@ -239,7 +318,7 @@ base::string16 ElideUrl(const GURL& url,
   // Query element.
   base::string16 url_query;
   const float kPixelWidthDotsTrailer =
-      gfx::GetStringWidthF(base::string16(gfx::kEllipsisUTF16), font_list);
+      GetCachedStringWidth(base::string16(gfx::kEllipsisUTF16), font_list);
   if (parsed.query.is_nonempty()) {
     url_query = base::UTF8ToUTF16("?") + url_string.substr(parsed.query.begin);
     if (available_pixel_width >=
@@ -280,7 +359,7 @@ base::string16 ElideUrl(const GURL& url,
   const base::string16 kEllipsisAndSlash =
       base::string16(gfx::kEllipsisUTF16) + gfx::kForwardSlash;
   const float pixel_width_ellipsis_slash =
-      gfx::GetStringWidthF(kEllipsisAndSlash, font_list);
+      GetCachedStringWidth(kEllipsisAndSlash, font_list);
 
   // Check with both subdomain and domain.
   base::string16 elided_path = ElideComponentizedPath(
@@ -312,12 +391,12 @@ base::string16 ElideUrl(const GURL& url,
   // Return elided domain/.../filename anyway.
   base::string16 final_elided_url_string(url_elided_domain);
   const float url_elided_domain_width =
-      gfx::GetStringWidthF(url_elided_domain, font_list);
+      GetCachedStringWidth(url_elided_domain, font_list);
 
   // A hack to prevent trailing ".../...".
   if ((available_pixel_width - url_elided_domain_width) >
       pixel_width_ellipsis_slash + kPixelWidthDotsTrailer +
-          gfx::GetStringWidthF(base::ASCIIToUTF16("UV"), font_list)) {
+          GetCachedStringWidth(base::ASCIIToUTF16("UV"), font_list)) {
     final_elided_url_string += BuildPathFromComponents(
         base::string16(), url_path_elements, url_filename, 1);
   } else {
@@ -336,7 +415,7 @@ base::string16 ElideHost(const GURL& url,
   base::string16 url_subdomain;
   SplitHost(url, &url_host, &url_domain, &url_subdomain);
 
-  const float pixel_width_url_host = gfx::GetStringWidthF(url_host, font_list);
+  const float pixel_width_url_host = GetCachedStringWidth(url_host, font_list);
   if (available_pixel_width >= pixel_width_url_host)
     return url_host;
 
@@ -344,7 +423,7 @@ base::string16 ElideHost(const GURL& url,
     return url_domain;
 
   const float pixel_width_url_domain =
-      gfx::GetStringWidthF(url_domain, font_list);
+      GetCachedStringWidth(url_domain, font_list);
   float subdomain_width = available_pixel_width - pixel_width_url_domain;
   if (subdomain_width <= 0)
     return base::string16(gfx::kEllipsisUTF16) + kDot + url_domain;
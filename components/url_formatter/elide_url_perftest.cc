@@ -0,0 +1,73 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "components/url_formatter/elide_url.h"
+
+#include <string>
+#include <vector>
+
+#include "base/macros.h"
+#include "base/strings/stringprintf.h"
+#include "base/time/time.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_test.h"
+#include "ui/gfx/font_list.h"  // nogncheck
+#include "url/gurl.h"
+
+namespace url_formatter {
+namespace {
+
+const size_t kNumUrls = 5000;
+
+const char* const kHosts[] = {
+    "www.google.com", "mail.subdomain.example.org", "docs.example.co.uk",
+    "news.ycombinator.com", "a.very.long.subdomain.chain.example.net",
+};
+
+// Builds |kNumUrls| URLs of varying depth, as found in a history or downloads
+// list, with many URLs per host.
+std::vector<GURL> BuildUrls() {
+  std::vector<GURL> urls;
+  urls.reserve(kNumUrls);
+  for (size_t i = 0; i < kNumUrls; ++i) {
+    std::string spec = base::StringPrintf(
+        "https://%s/", kHosts[i % arraysize(kHosts)]);
+    const size_t depth = i % 24;
+    for (size_t j = 0; j < depth; ++j)
+      spec += base::StringPrintf("directory%d/", static_cast<int>(j));
+    spec += base::StringPrintf("file%d.html", static_cast<int>(i));
+    if (i % 3 == 0)
+      spec += "?query=some_long_value&other=another_long_value";
+    urls.push_back(GURL(spec));
+  }
+  return urls;
+}
+
+void RunElideUrlBenchmark(const std::string& trace, float available_width) {
+  const gfx::FontList font_list;
+  std::vector<GURL> urls = BuildUrls();
+
+  size_t elided_length = 0;
+  base::TimeTicks start = base::TimeTicks::Now();
+  for (size_t i = 0; i < urls.size(); ++i) {
+    elided_length +=
+        ElideUrl(urls[i], font_list, available_width, std::string()).length();
+  }
+  base::TimeDelta elapsed = base::TimeTicks::Now() - start;
+  EXPECT_GT(elided_length, 0u);
+
+  perf_test::PrintResult("elide_url", "", trace,
+                         urls.size() / elapsed.InSecondsF(), "urls/s", true);
+}
+
+TEST(ElideUrlPerfTest, Narrow) {
+  RunElideUrlBenchmark("narrow", 150);
+}
+
+TEST(ElideUrlPerfTest, Wide) {
+  RunElideUrlBenchmark("wide", 500);
+}
+
+}  // namespace
+}  // namespace url_formatter
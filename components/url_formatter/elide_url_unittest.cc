@@ -5,6 +5,7 @@
 #include "components/url_formatter/elide_url.h"
 
 #include "base/ios/ios_util.h"
+#include "base/strings/stringprintf.h"
 #include "base/strings/utf_string_conversions.h"
 #include "testing/gtest/include/gtest/gtest.h"
 #include "url/gurl.h"
@@ -175,6 +176,26 @@ TEST(TextEliderTest, TestFileURLEliding) {
   RunUrlTest(testcases, arraysize(testcases));
 }
 
+// Test that the longest fitting run of leading directories is kept for deep
+// paths, whatever the available width.
+TEST(TextEliderTest, TestDeepPathEliding) {
+  const std::string kEllipsisStr(gfx::kEllipsis);
+  const int kNumDirectories = 40;
+  std::string url = "http://deep.example.com/";
+  for (int i = 0; i < kNumDirectories; ++i)
+    url += base::StringPrintf("dir%d/", i);
+  url += "file.html";
+
+  std::vector<Testcase> testcases;
+  std::string kept_directories;
+  for (int i = 0; i < kNumDirectories - 1; ++i) {
+    kept_directories += base::StringPrintf("dir%d/", i);
+    testcases.push_back({url, "deep.example.com/" + kept_directories +
+                                  kEllipsisStr + "/file.html"});
+  }
+  RunUrlTest(&testcases[0], testcases.size());
+}
+
 TEST(TextEliderTest, TestHostEliding) {
   const std::string kEllipsisStr(gfx::kEllipsis);
   Testcase testcases[] = {
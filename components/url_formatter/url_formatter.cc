@@ -7,10 +7,14 @@
 #include <algorithm>
 #include <map>
 #include <utility>
+#include <vector>
 
+#include "base/atomicops.h"
+#include "base/containers/mru_cache.h"
 #include "base/lazy_instance.h"
 #include "base/logging.h"
 #include "base/macros.h"
+#include "base/memory/scoped_ptr.h"
 #include "base/memory/singleton.h"
 #include "base/stl_util.h"
 #include "base/strings/string_tokenizer.h"
@@ -18,6 +22,7 @@
 #include "base/strings/utf_offset_string_conversions.h"
 #include "base/strings/utf_string_conversions.h"
 #include "base/synchronization/lock.h"
+#include "base/threading/thread_local_storage.h"
 #include "third_party/icu/source/common/unicode/uidna.h"
 #include "third_party/icu/source/common/unicode/uniset.h"
 #include "third_party/icu/source/common/unicode/uscript.h"
@@ -204,12 +209,11 @@ base::string16 FormatViewSourceUrl(
 //
 // We may want to skip this step in the case of file URLs to allow unicode
 // UNC hostnames regardless of encodings.
-base::string16 IDNToUnicodeWithAdjustments(
+base::string16 IDNToUnicodeWithAdjustmentsUncached(
     const std::string& host,
     const std::string& languages,
     base::OffsetAdjuster::Adjustments* adjustments) {
-  if (adjustments)
-    adjustments->clear();
+  adjustments->clear();
   // Convert the ASCII input to a base::string16 for ICU.
   base::string16 input16;
   input16.reserve(host.length());
@@ -236,7 +240,7 @@ base::string16 IDNToUnicodeWithAdjustments(
     }
     size_t new_component_length = out16.length() - new_component_start;
 
-    if (converted_idn && adjustments) {
+    if (converted_idn) {
       adjustments->push_back(base::OffsetAdjuster::Adjustment(
           component_start, component_length, new_component_length));
     }
@@ -248,6 +252,93 @@ base::string16 IDNToUnicodeWithAdjustments(
   return out16;
 }
 
+// Maximum number of hosts remembered by each thread's HostDisplayCache.
+const size_t kHostDisplayCacheSize = 512;
+
+// Remembers the display form of recently formatted IDN hosts on the calling
+// thread, so formatting the same host again skips the ICU conversion and the
+// safety checks without any locking. Entries are only valid for the
+// |languages| they were computed with; a different list clears the cache.
+class HostDisplayCache {
+ public:
+  struct Entry {
+    base::string16 display_host;
+    base::OffsetAdjuster::Adjustments adjustments;
+  };
+
+  HostDisplayCache() : entries_(kHostDisplayCacheSize) {}
+
+  static HostDisplayCache* GetForCurrentThread();
+
+  // Returns the cached entry for |host|, computing it if necessary.
+  const Entry& Get(const std::string& host, const std::string& languages) {
+    if (languages != languages_) {
+      entries_.Clear();
+      languages_ = languages;
+    }
+    EntryMap::iterator it = entries_.Get(host);
+    if (it == entries_.end()) {
+      Entry entry;
+      entry.display_host = IDNToUnicodeWithAdjustmentsUncached(
+          host, languages, &entry.adjustments);
+      it = entries_.Put(host, entry);
+    }
+    return it->second;
+  }
+
+ private:
+  typedef base::HashingMRUCache<std::string, Entry> EntryMap;
+
+  std::string languages_;
+  EntryMap entries_;
+
+  DISALLOW_COPY_AND_ASSIGN(HostDisplayCache);
+};
+
+void DeleteHostDisplayCache(void* cache) {
+  delete static_cast<HostDisplayCache*>(cache);
+}
+
+// Owns the thread-local slot holding each thread's HostDisplayCache.
+struct HostDisplayCacheSlot {
+  HostDisplayCacheSlot() : slot(&DeleteHostDisplayCache) {}
+
+  base::ThreadLocalStorage::Slot slot;
+};
+
+static base::LazyInstance<HostDisplayCacheSlot>::Leaky
+    g_host_display_cache_slot = LAZY_INSTANCE_INITIALIZER;
+
+// static
+HostDisplayCache* HostDisplayCache::GetForCurrentThread() {
+  base::ThreadLocalStorage::Slot& slot = g_host_display_cache_slot.Get().slot;
+  HostDisplayCache* cache = static_cast<HostDisplayCache*>(slot.Get());
+  if (!cache) {
+    cache = new HostDisplayCache;
+    slot.Set(cache);
+  }
+  return cache;
+}
+
+base::string16 IDNToUnicodeWithAdjustments(
+    const std::string& host,
+    const std::string& languages,
+    base::OffsetAdjuster::Adjustments* adjustments) {
+  if (adjustments)
+    adjustments->clear();
+
+  // Only components starting with "xn--" are ever converted. Other hosts come
+  // back unchanged, which is cheaper to produce than a cache lookup.
+  if (host.find("xn--") == std::string::npos)
+    return base::string16(host.begin(), host.end());
+
+  const HostDisplayCache::Entry& entry =
+      HostDisplayCache::GetForCurrentThread()->Get(host, languages);
+  if (adjustments)
+    *adjustments = entry.adjustments;
+  return entry.display_host;
+}
+
 // Does some simple normalization of scripts so we can allow certain scripts
 // to exist together.
 // TODO(brettw) bug 880223: we should allow some other languages to be
@@ -302,162 +393,212 @@ bool IsCompatibleWithASCIILetters(const std::string& lang) {
          !lang.substr(0, 2).compare("ko");
 }
 
-typedef std::map<std::string, icu::UnicodeSet*> LangToExemplarSetMap;
+// Builds the exemplar set for |lang|. The returned set is frozen, so it can be
+// read from any thread.
+icu::UnicodeSet* CreateExemplarSetForLang(const std::string& lang) {
+  CR_DEFINE_STATIC_LOCAL(const icu::UnicodeSet, kASCIILetters, ('a', 'z'));
+  icu::UnicodeSet* lang_set = nullptr;
+  UErrorCode status = U_ZERO_ERROR;
+  ULocaleData* uld = ulocdata_open(lang.c_str(), &status);
+  // TODO(jungshik) Turn this check on when the ICU data file is
+  // rebuilt with the minimal subset of locale data for languages
+  // to which Chrome is not localized but which we offer in the list
+  // of languages selectable for Accept-Languages. With the rebuilt ICU
+  // data, ulocdata_open never should fall back to the default locale.
+  // (issue 2078)
+  // DCHECK(U_SUCCESS(status) && status != U_USING_DEFAULT_WARNING);
+  if (U_SUCCESS(status) && status != U_USING_DEFAULT_WARNING) {
+    lang_set = reinterpret_cast<icu::UnicodeSet*>(ulocdata_getExemplarSet(
+        uld, nullptr, 0, ULOCDATA_ES_STANDARD, &status));
+    // On success, if |lang| is compatible with ASCII Latin letters, add
+    // them.
+    if (lang_set && IsCompatibleWithASCIILetters(lang))
+      lang_set->addAll(kASCIILetters);
+  }
+
+  if (!lang_set)
+    lang_set = new icu::UnicodeSet(1, 0);
 
+  lang_set->freeze();
+  ulocdata_close(uld);
+  return lang_set;
+}
+
+typedef std::map<std::string, const icu::UnicodeSet*> LangToExemplarSetMap;
+
+// Exemplar sets keyed by language. We're called from both the UI thread and
+// the history thread, so lookups must not contend: the map is never modified
+// once published, and adding a language publishes a new copy of it. Replaced
+// copies stay alive until shutdown because a reader may still be using one.
 class LangToExemplarSet {
  public:
   static LangToExemplarSet* GetInstance() {
     return base::Singleton<LangToExemplarSet>::get();
   }
 
+  // Returns the exemplar set for |lang|, building it on first use.
+  const icu::UnicodeSet* Get(const std::string& lang) {
+    const LangToExemplarSetMap* map =
+        reinterpret_cast<const LangToExemplarSetMap*>(
+            base::subtle::Acquire_Load(&current_map_));
+    LangToExemplarSetMap::const_iterator pos = map->find(lang);
+    if (pos != map->end())
+      return pos->second;
+
+    base::AutoLock lock(lock_);
+    // Another thread may have added |lang| while we waited for the lock.
+    map = maps_.back();
+    pos = map->find(lang);
+    if (pos != map->end())
+      return pos->second;
+
+    const icu::UnicodeSet* lang_set = CreateExemplarSetForLang(lang);
+    sets_.push_back(lang_set);
+    LangToExemplarSetMap* new_map = new LangToExemplarSetMap(*map);
+    new_map->insert(std::make_pair(lang, lang_set));
+    maps_.push_back(new_map);
+    base::subtle::Release_Store(
+        &current_map_, reinterpret_cast<base::subtle::AtomicWord>(new_map));
+    return lang_set;
+  }
+
  private:
-  LangToExemplarSetMap map;
-  LangToExemplarSet() {}
+  LangToExemplarSet() {
+    maps_.push_back(new LangToExemplarSetMap);
+    current_map_ = reinterpret_cast<base::subtle::AtomicWord>(maps_.back());
+  }
+
   ~LangToExemplarSet() {
-    STLDeleteContainerPairSecondPointers(map.begin(), map.end());
+    STLDeleteElements(&maps_);
+    STLDeleteElements(&sets_);
   }
 
   friend class base::Singleton<LangToExemplarSet>;
   friend struct base::DefaultSingletonTraits<LangToExemplarSet>;
-  friend bool GetExemplarSetForLang(const std::string&, icu::UnicodeSet**);
-  friend void SetExemplarSetForLang(const std::string&, icu::UnicodeSet*);
 
-  DISALLOW_COPY_AND_ASSIGN(LangToExemplarSet);
-};
+  // The most recently published element of |maps_|.
+  base::subtle::AtomicWord current_map_;
 
-bool GetExemplarSetForLang(const std::string& lang,
-                           icu::UnicodeSet** lang_set) {
-  const LangToExemplarSetMap& map = LangToExemplarSet::GetInstance()->map;
-  LangToExemplarSetMap::const_iterator pos = map.find(lang);
-  if (pos != map.end()) {
-    *lang_set = pos->second;
-    return true;
-  }
-  return false;
-}
+  // Serializes additions. Readers never take it.
+  base::Lock lock_;
 
-void SetExemplarSetForLang(const std::string& lang, icu::UnicodeSet* lang_set) {
-  LangToExemplarSetMap& map = LangToExemplarSet::GetInstance()->map;
-  map.insert(std::make_pair(lang, lang_set));
-}
+  // Every map ever published, oldest first, and the sets they point to.
+  std::vector<const LangToExemplarSetMap*> maps_;
+  std::vector<const icu::UnicodeSet*> sets_;
 
-static base::LazyInstance<base::Lock>::Leaky g_lang_set_lock =
-    LAZY_INSTANCE_INITIALIZER;
+  DISALLOW_COPY_AND_ASSIGN(LangToExemplarSet);
+};
 
 // Returns true if all the characters in component_characters are used by
 // the language |lang|.
 bool IsComponentCoveredByLang(const icu::UnicodeSet& component_characters,
                               const std::string& lang) {
-  CR_DEFINE_STATIC_LOCAL(const icu::UnicodeSet, kASCIILetters, ('a', 'z'));
-  icu::UnicodeSet* lang_set = nullptr;
-  // We're called from both the UI thread and the history thread.
-  {
-    base::AutoLock lock(g_lang_set_lock.Get());
-    if (!GetExemplarSetForLang(lang, &lang_set)) {
-      UErrorCode status = U_ZERO_ERROR;
-      ULocaleData* uld = ulocdata_open(lang.c_str(), &status);
-      // TODO(jungshik) Turn this check on when the ICU data file is
-      // rebuilt with the minimal subset of locale data for languages
-      // to which Chrome is not localized but which we offer in the list
-      // of languages selectable for Accept-Languages. With the rebuilt ICU
-      // data, ulocdata_open never should fall back to the default locale.
-      // (issue 2078)
-      // DCHECK(U_SUCCESS(status) && status != U_USING_DEFAULT_WARNING);
-      if (U_SUCCESS(status) && status != U_USING_DEFAULT_WARNING) {
-        lang_set = reinterpret_cast<icu::UnicodeSet*>(ulocdata_getExemplarSet(
-            uld, nullptr, 0, ULOCDATA_ES_STANDARD, &status));
-        // On success, if |lang| is compatible with ASCII Latin letters, add
-        // them.
-        if (lang_set && IsCompatibleWithASCIILetters(lang))
-          lang_set->addAll(kASCIILetters);
-      }
-
-      if (!lang_set)
-        lang_set = new icu::UnicodeSet(1, 0);
-
-      lang_set->freeze();
-      SetExemplarSetForLang(lang, lang_set);
-      ulocdata_close(uld);
-    }
-  }
+  const icu::UnicodeSet* lang_set =
+      LangToExemplarSet::GetInstance()->Get(lang);
   return !lang_set->isEmpty() && lang_set->containsAll(component_characters);
 }
 
+// The character sets and patterns IsIDNComponentSafe() checks against. Built
+// once; frozen sets and compiled patterns can be shared across threads.
+struct IDNSafetyData {
+  IDNSafetyData() {
+    UErrorCode status = U_ZERO_ERROR;
+    // Most common cases (non-IDN) do not reach here so that we don't
+    // need a fast return path.
+    // TODO(jungshik) : Check if there's any character inappropriate
+    // (although allowed) for domain names.
+    // See http://www.unicode.org/reports/tr39/#IDN_Security_Profiles and
+    // http://www.unicode.org/reports/tr39/data/xidmodifications.txt
+    // For now, we borrow the list from Mozilla and tweaked it slightly.
+    // (e.g. Characters like U+00A0, U+3000, U+3002 are omitted because
+    //  they're gonna be canonicalized to U+0020 and full stop before
+    //  reaching here.)
+    // The original list is available at
+    // http://kb.mozillazine.org/Network.IDN.blacklist_chars and
+    // at
+    // http://mxr.mozilla.org/seamonkey/source/modules/libpref/src/init/all.js#703
+#ifdef U_WCHAR_IS_UTF16
+    dangerous_characters.applyPattern(
+        icu::UnicodeString(
+            L"[[\\ \u00ad\u00bc\u00bd\u01c3\u0337\u0338"
+            L"\u05c3\u05f4\u06d4\u0702\u115f\u1160][\u2000-\u200b]"
+            L"[\u2024\u2027\u2028\u2029\u2039\u203a\u2044\u205f]"
+            L"[\u2154-\u2156][\u2159-\u215b][\u215f\u2215\u23ae"
+            L"\u29f6\u29f8\u2afb\u2afd][\u2ff0-\u2ffb][\u3014"
+            L"\u3015\u3033\u3164\u321d\u321e\u33ae\u33af\u33c6\u33df\ufe14"
+            L"\ufe15\ufe3f\ufe5d\ufe5e\ufeff\uff0e\uff06\uff61\uffa0\ufff9]"
+            L"[\ufffa-\ufffd]\U0001f50f\U0001f510\U0001f512\U0001f513]"),
+        status);
+    DCHECK(U_SUCCESS(status));
+    dangerous_patterns.reset(icu::RegexPattern::compile(
+        icu::UnicodeString(
+            // Lone katakana no, so, or n
+            L"[^\\p{Katakana}][\u30ce\u30f3\u30bd][^\\p{Katakana}]"
+            // Repeating Japanese accent characters
+            L"|[\u3099\u309a\u309b\u309c][\u3099\u309a\u309b\u309c]"),
+        0, status));
+#else
+    dangerous_characters.applyPattern(
+        icu::UnicodeString(
+            "[[\\u0020\\u00ad\\u00bc\\u00bd\\u01c3\\u0337\\u0338"
+            "\\u05c3\\u05f4\\u06d4\\u0702\\u115f\\u1160][\\u2000-\\u200b]"
+            "[\\u2024\\u2027\\u2028\\u2029\\u2039\\u203a\\u2044\\u205f]"
+            "[\\u2154-\\u2156][\\u2159-\\u215b][\\u215f\\u2215\\u23ae"
+            "\\u29f6\\u29f8\\u2afb\\u2afd][\\u2ff0-\\u2ffb][\\u3014"
+            "\\u3015\\u3033\\u3164\\u321d\\u321e\\u33ae\\u33af\\u33c6\\u33df\\ufe"
+            "14"
+            "\\ufe15\\ufe3f\\ufe5d\\ufe5e\\ufeff\\uff0e\\uff06\\uff61\\uffa0\\uff"
+            "f9]"
+            "[\\ufffa-\\ufffd]\\U0001f50f\\U0001f510\\U0001f512\\U0001f513]",
+            -1, US_INV),
+        status);
+    DCHECK(U_SUCCESS(status));
+    dangerous_patterns.reset(icu::RegexPattern::compile(
+        icu::UnicodeString(
+            // Lone katakana no, so, or n
+            "[^\\p{Katakana}][\\u30ce\\u30f3\\u30bd][^\\p{Katakana}]"
+            // Repeating Japanese accent characters
+            "|[\\u3099\\u309a\\u309b\\u309c][\\u3099\\u309a\\u309b\\u309c]"),
+        0, status));
+#endif
+    DCHECK(U_SUCCESS(status));
+    dangerous_characters.freeze();
+
+    // |common_characters| is made up of  ASCII numbers, hyphen, plus and
+    // underscore that are used across scripts and allowed in domain names.
+    // (sync'd with characters allowed in url_canon_host with square
+    // brackets excluded.) See kHostCharLookup[] array in url_canon_host.cc.
+    common_characters.applyPattern(UNICODE_STRING_SIMPLE("[[0-9]\\-_+\\ ]"),
+                                   status);
+    DCHECK(U_SUCCESS(status));
+    common_characters.freeze();
+  }
+
+  icu::UnicodeSet dangerous_characters;
+  scoped_ptr<icu::RegexPattern> dangerous_patterns;
+  icu::UnicodeSet common_characters;
+};
+
+static base::LazyInstance<IDNSafetyData>::Leaky g_idn_safety_data =
+    LAZY_INSTANCE_INITIALIZER;
+
 // Returns true if the given Unicode host component is safe to display to the
 // user.
 bool IsIDNComponentSafe(const base::char16* str,
                         int str_len,
                         const std::string& languages) {
-  // Most common cases (non-IDN) do not reach here so that we don't
-  // need a fast return path.
-  // TODO(jungshik) : Check if there's any character inappropriate
-  // (although allowed) for domain names.
-  // See http://www.unicode.org/reports/tr39/#IDN_Security_Profiles and
-  // http://www.unicode.org/reports/tr39/data/xidmodifications.txt
-  // For now, we borrow the list from Mozilla and tweaked it slightly.
-  // (e.g. Characters like U+00A0, U+3000, U+3002 are omitted because
-  //  they're gonna be canonicalized to U+0020 and full stop before
-  //  reaching here.)
-  // The original list is available at
-  // http://kb.mozillazine.org/Network.IDN.blacklist_chars and
-  // at
-  // http://mxr.mozilla.org/seamonkey/source/modules/libpref/src/init/all.js#703
-
-  UErrorCode status = U_ZERO_ERROR;
-#ifdef U_WCHAR_IS_UTF16
-  icu::UnicodeSet dangerous_characters(
-      icu::UnicodeString(
-          L"[[\\ \u00ad\u00bc\u00bd\u01c3\u0337\u0338"
-          L"\u05c3\u05f4\u06d4\u0702\u115f\u1160][\u2000-\u200b]"
-          L"[\u2024\u2027\u2028\u2029\u2039\u203a\u2044\u205f]"
-          L"[\u2154-\u2156][\u2159-\u215b][\u215f\u2215\u23ae"
-          L"\u29f6\u29f8\u2afb\u2afd][\u2ff0-\u2ffb][\u3014"
-          L"\u3015\u3033\u3164\u321d\u321e\u33ae\u33af\u33c6\u33df\ufe14"
-          L"\ufe15\ufe3f\ufe5d\ufe5e\ufeff\uff0e\uff06\uff61\uffa0\ufff9]"
-          L"[\ufffa-\ufffd]\U0001f50f\U0001f510\U0001f512\U0001f513]"),
-      status);
-  DCHECK(U_SUCCESS(status));
-  icu::RegexMatcher dangerous_patterns(
-      icu::UnicodeString(
-          // Lone katakana no, so, or n
-          L"[^\\p{Katakana}][\u30ce\u30f3\u30bd][^\\p{Katakana}]"
-          // Repeating Japanese accent characters
-          L"|[\u3099\u309a\u309b\u309c][\u3099\u309a\u309b\u309c]"),
-      0, status);
-#else
-  icu::UnicodeSet dangerous_characters(
-      icu::UnicodeString(
-          "[[\\u0020\\u00ad\\u00bc\\u00bd\\u01c3\\u0337\\u0338"
-          "\\u05c3\\u05f4\\u06d4\\u0702\\u115f\\u1160][\\u2000-\\u200b]"
-          "[\\u2024\\u2027\\u2028\\u2029\\u2039\\u203a\\u2044\\u205f]"
-          "[\\u2154-\\u2156][\\u2159-\\u215b][\\u215f\\u2215\\u23ae"
-          "\\u29f6\\u29f8\\u2afb\\u2afd][\\u2ff0-\\u2ffb][\\u3014"
-          "\\u3015\\u3033\\u3164\\u321d\\u321e\\u33ae\\u33af\\u33c6\\u33df\\ufe"
-          "14"
-          "\\ufe15\\ufe3f\\ufe5d\\ufe5e\\ufeff\\uff0e\\uff06\\uff61\\uffa0\\uff"
-          "f9]"
-          "[\\ufffa-\\ufffd]\\U0001f50f\\U0001f510\\U0001f512\\U0001f513]",
-          -1, US_INV),
-      status);
-  DCHECK(U_SUCCESS(status));
-  icu::RegexMatcher dangerous_patterns(
-      icu::UnicodeString(
-          // Lone katakana no, so, or n
-          "[^\\p{Katakana}][\\u30ce\\u30f3\\u30bd][^\\p{Katakana}]"
-          // Repeating Japanese accent characters
-          "|[\\u3099\\u309a\\u309b\\u309c][\\u3099\\u309a\\u309b\\u309c]"),
-      0, status);
-#endif
-  DCHECK(U_SUCCESS(status));
+  const IDNSafetyData& safety_data = g_idn_safety_data.Get();
   icu::UnicodeSet component_characters;
   icu::UnicodeString component_string(str, str_len);
   component_characters.addAll(component_string);
-  if (dangerous_characters.containsSome(component_characters))
+  if (safety_data.dangerous_characters.containsSome(component_characters))
     return false;
 
+  UErrorCode status = U_ZERO_ERROR;
+  scoped_ptr<icu::RegexMatcher> dangerous_patterns(
+      safety_data.dangerous_patterns->matcher(component_string, status));
   DCHECK(U_SUCCESS(status));
-  dangerous_patterns.reset(component_string);
-  if (dangerous_patterns.find())
+  if (dangerous_patterns->find())
     return false;
 
   // If the language list is empty, the result is completely determined
@@ -469,17 +610,10 @@ bool IsIDNComponentSafe(const base::char16* str,
   if (languages.empty())
     return IsIDNComponentInSingleScript(str, str_len);
 
-  // |common_characters| is made up of  ASCII numbers, hyphen, plus and
-  // underscore that are used across scripts and allowed in domain names.
-  // (sync'd with characters allowed in url_canon_host with square
-  // brackets excluded.) See kHostCharLookup[] array in url_canon_host.cc.
-  icu::UnicodeSet common_characters(UNICODE_STRING_SIMPLE("[[0-9]\\-_+\\ ]"),
-                                    status);
-  DCHECK(U_SUCCESS(status));
   // Subtract common characters because they're always allowed so that
   // we just have to check if a language-specific set contains
   // the remainder.
-  component_characters.removeAll(common_characters);
+  component_characters.removeAll(safety_data.common_characters);
 
   base::StringTokenizer t(languages, ",");
   while (t.GetNext()) {
@@ -0,0 +1,119 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "components/url_formatter/url_formatter.h"
+
+#include <vector>
+
+#include "base/macros.h"
+#include "base/memory/scoped_vector.h"
+#include "base/strings/stringprintf.h"
+#include "base/threading/simple_thread.h"
+#include "base/time/time.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_test.h"
+#include "url/gurl.h"
+
+namespace url_formatter {
+namespace {
+
+const size_t kNumUrls = 100000;
+const char kLanguages[] = "ja,en,ru";
+
+// A mix of ASCII hosts and IDN hosts in Latin, Cyrillic, Han, Arabic and
+// Greek, some of which are unsafe to display for |kLanguages|.
+const char* const kHosts[] = {
+    "www.google.com",         "xn--fiqs8s.xn--fiqs8s",
+    "xn--80akhbyknj4f.com",   "mail.example.org",
+    "xn--mgbh0fb.xn--kgbechtv", "xn--bcher-kva.de",
+    "xn--hxajbheg2az3al.gr",  "docs.xn--p1ai",
+    "news.ycombinator.com",   "xn--wgv71a119e.jp",
+};
+
+const char* const kPaths[] = {
+    "/",
+    "/search?q=%E6%97%A5%E6%9C%AC",
+    "/wiki/%D0%A0%D0%BE%D1%81%D1%81%D0%B8%D1%8F",
+    "/a/b/c.html#section",
+    "/%E4%B8%AD%E6%96%87/index.php?lang=zh",
+};
+
+// Builds |kNumUrls| URLs, each host showing up many times with varying paths
+// and subdomains, as in a history or downloads list.
+std::vector<GURL> BuildUrls() {
+  std::vector<GURL> urls;
+  urls.reserve(kNumUrls);
+  for (size_t i = 0; i < kNumUrls; ++i) {
+    const char* host = kHosts[i % arraysize(kHosts)];
+    const char* path = kPaths[(i / arraysize(kHosts)) % arraysize(kPaths)];
+    std::string spec =
+        (i % 7 == 0)
+            ? base::StringPrintf("http://s%d.%s%s",
+                                 static_cast<int>(i % 50), host, path)
+            : base::StringPrintf("https://%s%s", host, path);
+    urls.push_back(GURL(spec));
+  }
+  return urls;
+}
+
+class FormatUrlsDelegate : public base::DelegateSimpleThread::Delegate {
+ public:
+  explicit FormatUrlsDelegate(const std::vector<GURL>* urls)
+      : urls_(urls), formatted_length_(0) {}
+  ~FormatUrlsDelegate() override {}
+
+  void Run() override {
+    for (size_t i = 0; i < urls_->size(); ++i)
+      formatted_length_ += FormatUrl((*urls_)[i], kLanguages).length();
+  }
+
+  size_t formatted_length() const { return formatted_length_; }
+
+ private:
+  const std::vector<GURL>* urls_;
+  size_t formatted_length_;
+
+  DISALLOW_COPY_AND_ASSIGN(FormatUrlsDelegate);
+};
+
+TEST(UrlFormatterPerfTest, FormatMixedScriptUrls) {
+  std::vector<GURL> urls = BuildUrls();
+
+  FormatUrlsDelegate delegate(&urls);
+  base::TimeTicks start = base::TimeTicks::Now();
+  delegate.Run();
+  base::TimeDelta elapsed = base::TimeTicks::Now() - start;
+  EXPECT_GT(delegate.formatted_length(), 0u);
+
+  perf_test::PrintResult("format_url", "", "mixed_script_100k",
+                         urls.size() / elapsed.InSecondsF(), "urls/s", true);
+}
+
+// The history thread formats URLs while the UI thread does; make sure the
+// threads don't serialize against each other.
+TEST(UrlFormatterPerfTest, FormatMixedScriptUrlsConcurrently) {
+  const int kNumThreads = 4;
+  std::vector<GURL> urls = BuildUrls();
+
+  ScopedVector<FormatUrlsDelegate> delegates;
+  base::DelegateSimpleThreadPool pool("format_url", kNumThreads);
+  pool.Start();
+  base::TimeTicks start = base::TimeTicks::Now();
+  for (int i = 0; i < kNumThreads; ++i) {
+    delegates.push_back(new FormatUrlsDelegate(&urls));
+    pool.AddWork(delegates.back());
+  }
+  pool.JoinAll();
+  base::TimeDelta elapsed = base::TimeTicks::Now() - start;
+  for (int i = 0; i < kNumThreads; ++i)
+    EXPECT_EQ(delegates[0]->formatted_length(),
+              delegates[i]->formatted_length());
+
+  perf_test::PrintResult("format_url", "", "mixed_script_100k_4_threads",
+                         kNumThreads * urls.size() / elapsed.InSecondsF(),
+                         "urls/s", true);
+}
+
+}  // namespace
+}  // namespace url_formatter
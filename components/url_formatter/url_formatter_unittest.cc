@@ -12,6 +12,7 @@
 #include "base/strings/string_number_conversions.h"
 #include "base/strings/stringprintf.h"
 #include "base/strings/utf_string_conversions.h"
+#include "base/threading/simple_thread.h"
 #include "testing/gtest/include/gtest/gtest.h"
 #include "url/gurl.h"
 
@@ -390,6 +391,28 @@ void AppendLanguagesToOutputs(const char* languages,
   actual->append(to_append);
 }
 
+// Runs IDNToUnicode() over every IDN test case and language list, so that
+// several threads can convert the same hosts concurrently.
+class IDNToUnicodeDelegate : public base::DelegateSimpleThread::Delegate {
+ public:
+  IDNToUnicodeDelegate() {}
+  ~IDNToUnicodeDelegate() override {}
+
+  void Run() override {
+    for (size_t i = 0; i < arraysize(idn_cases); i++) {
+      for (size_t j = 0; j < arraysize(kLanguages); j++)
+        outputs_.push_back(IDNToUnicode(idn_cases[i].input, kLanguages[j]));
+    }
+  }
+
+  const std::vector<base::string16>& outputs() const { return outputs_; }
+
+ private:
+  std::vector<base::string16> outputs_;
+
+  DISALLOW_COPY_AND_ASSIGN(IDNToUnicodeDelegate);
+};
+
 // A pair of helpers for the FormatUrlWithOffsets() test.
 void VerboseExpect(size_t expected,
                    size_t actual,
@@ -472,6 +495,26 @@ TEST(UrlFormatterTest, IDNToUnicodeNeverCrashes) {
   }
 }
 
+// Repeated and concurrent conversions must agree with a first, uncached one.
+TEST(UrlFormatterTest, IDNToUnicodeCachedAndThreaded) {
+  IDNToUnicodeDelegate expected;
+  expected.Run();
+
+  IDNToUnicodeDelegate repeated;
+  repeated.Run();
+  EXPECT_EQ(expected.outputs(), repeated.outputs());
+
+  const int kNumThreads = 4;
+  IDNToUnicodeDelegate delegates[kNumThreads];
+  base::DelegateSimpleThreadPool pool("idn_to_unicode", kNumThreads);
+  pool.Start();
+  for (int i = 0; i < kNumThreads; ++i)
+    pool.AddWork(&delegates[i]);
+  pool.JoinAll();
+  for (int i = 0; i < kNumThreads; ++i)
+    EXPECT_EQ(expected.outputs(), delegates[i].outputs());
+}
+
 TEST(UrlFormatterTest, FormatUrl) {
   FormatUrlTypes default_format_type = kFormatUrlOmitUsernamePassword;
   const UrlTestData tests[] = {
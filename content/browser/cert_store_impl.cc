@@ -4,6 +4,8 @@
 
 #include "content/browser/cert_store_impl.h"
 
+#include <cstring>
+
 namespace content {
 
 // static
@@ -29,4 +31,15 @@ bool CertStoreImpl::RetrieveCert(int cert_id,
   return store_.Retrieve(cert_id, cert);
 }
 
+size_t CertStoreImpl::CertHash::operator()(
+    const net::X509Certificate& cert) const {
+  // Certificates which X509Certificate::LessThan considers equal have the same
+  // leaf fingerprint, which is a SHA-1 hash already.
+  size_t hash;
+  static_assert(sizeof(hash) <= sizeof(cert.fingerprint().data),
+                "fingerprint too short");
+  memcpy(&hash, cert.fingerprint().data, sizeof(hash));
+  return hash;
+}
+
 }  // namespace content
@@ -30,7 +30,11 @@ class CertStoreImpl : public CertStore {
  private:
   friend struct base::DefaultSingletonTraits<CertStoreImpl>;
 
-  RendererDataMemoizingStore<net::X509Certificate> store_;
+  struct CertHash {
+    size_t operator()(const net::X509Certificate& cert) const;
+  };
+
+  RendererDataMemoizingStore<net::X509Certificate, CertHash> store_;
 
   DISALLOW_COPY_AND_ASSIGN(CertStoreImpl);
 };
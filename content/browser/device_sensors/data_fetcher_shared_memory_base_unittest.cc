@@ -562,6 +562,27 @@ TEST(DataFetcherSharedMemoryBaseTest, DoesNotPollZeroDelay) {
 }
 
 
+TEST(DataFetcherSharedMemoryBaseTest, UnchangedSamplesAreCoalesced) {
+  DeviceLightHardwareBuffer buffer;
+  buffer.data.value = 0;
+  base::subtle::Atomic32 version = buffer.seqlock.ReadBegin();
+
+  DeviceLightData data;
+  data.value = 100;
+  EXPECT_TRUE(buffer.WriteIfChanged(data));
+  EXPECT_TRUE(buffer.seqlock.ReadRetry(version));
+  EXPECT_EQ(100, buffer.data.value);
+
+  // Readers see the same sequence number until the value changes.
+  version = buffer.seqlock.ReadBegin();
+  EXPECT_FALSE(buffer.WriteIfChanged(data));
+  EXPECT_FALSE(buffer.seqlock.ReadRetry(version));
+
+  data.value = 200;
+  EXPECT_TRUE(buffer.WriteIfChanged(data));
+  EXPECT_TRUE(buffer.seqlock.ReadRetry(version));
+}
+
 }  // namespace
 
 }  // namespace content
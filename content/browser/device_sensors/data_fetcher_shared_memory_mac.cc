@@ -45,10 +45,9 @@ void FetchLight(content::AmbientLightSensor* sensor,
   if (!sensor->ReadSensorValue(lux_value))
     return;
   uint64_t mean = (lux_value[0] + lux_value[1]) / 2;
-  double lux = LMUvalueToLux(mean);
-  buffer->seqlock.WriteBegin();
-  buffer->data.value = lux;
-  buffer->seqlock.WriteEnd();
+  content::DeviceLightData data = buffer->data;
+  data.value = LMUvalueToLux(mean);
+  buffer->WriteIfChanged(data);
 }
 
 void FetchMotion(SuddenMotionSensor* sensor,
@@ -60,15 +59,15 @@ void FetchMotion(SuddenMotionSensor* sensor,
   if (!sensor->ReadSensorValues(axis_value))
     return;
 
-  buffer->seqlock.WriteBegin();
-  buffer->data.accelerationIncludingGravityX = axis_value[0] * kMeanGravity;
-  buffer->data.hasAccelerationIncludingGravityX = true;
-  buffer->data.accelerationIncludingGravityY = axis_value[1] * kMeanGravity;
-  buffer->data.hasAccelerationIncludingGravityY = true;
-  buffer->data.accelerationIncludingGravityZ = axis_value[2] * kMeanGravity;
-  buffer->data.hasAccelerationIncludingGravityZ = true;
-  buffer->data.allAvailableSensorsAreActive = true;
-  buffer->seqlock.WriteEnd();
+  blink::WebDeviceMotionData data = buffer->data;
+  data.accelerationIncludingGravityX = axis_value[0] * kMeanGravity;
+  data.hasAccelerationIncludingGravityX = true;
+  data.accelerationIncludingGravityY = axis_value[1] * kMeanGravity;
+  data.hasAccelerationIncludingGravityY = true;
+  data.accelerationIncludingGravityZ = axis_value[2] * kMeanGravity;
+  data.hasAccelerationIncludingGravityZ = true;
+  data.allAvailableSensorsAreActive = true;
+  buffer->WriteIfChanged(data);
 }
 
 void FetchOrientation(SuddenMotionSensor* sensor,
@@ -119,13 +118,13 @@ void FetchOrientation(SuddenMotionSensor* sensor,
   DCHECK_GE(gamma, -90.0);
   DCHECK_LT(gamma,  90.0);
 
-  buffer->seqlock.WriteBegin();
-  buffer->data.beta = beta;
-  buffer->data.hasBeta = true;
-  buffer->data.gamma = gamma;
-  buffer->data.hasGamma = true;
-  buffer->data.allAvailableSensorsAreActive = true;
-  buffer->seqlock.WriteEnd();
+  blink::WebDeviceOrientationData data = buffer->data;
+  data.beta = beta;
+  data.hasBeta = true;
+  data.gamma = gamma;
+  data.hasGamma = true;
+  data.allAvailableSensorsAreActive = true;
+  buffer->WriteIfChanged(data);
 }
 
 }  // namespace
@@ -16,6 +16,7 @@
 #include "content/common/generic_shared_memory_id_generator.h"
 #include "content/common/gpu/client/gpu_memory_buffer_impl.h"
 #include "content/common/gpu/client/gpu_memory_buffer_impl_shared_memory.h"
+#include "content/common/gpu/client/shared_memory_gpu_memory_buffer_pool.h"
 #include "content/common/gpu/gpu_memory_buffer_factory.h"
 #include "content/public/browser/browser_thread.h"
 #include "content/public/common/content_switches.h"
@@ -72,6 +73,18 @@ void GpuMemoryBufferDeleted(
       FROM_HERE, base::Bind(destruction_callback, sync_token));
 }
 
+void PooledGpuMemoryBufferDeleted(
+    scoped_refptr<base::SingleThreadTaskRunner> destruction_task_runner,
+    const base::Callback<void(gfx::GpuMemoryBufferId,
+                              int,
+                              const gpu::SyncToken&)>& destruction_callback,
+    int client_id,
+    gfx::GpuMemoryBufferId id,
+    const gpu::SyncToken& sync_token) {
+  destruction_task_runner->PostTask(
+      FROM_HERE, base::Bind(destruction_callback, id, client_id, sync_token));
+}
+
 bool IsNativeGpuMemoryBufferFactoryConfigurationSupported(
     gfx::BufferFormat format,
     gfx::BufferUsage usage) {
@@ -194,12 +207,28 @@ BrowserGpuMemoryBufferManager::BrowserGpuMemoryBufferManager(
     : native_configurations_(GetNativeGpuMemoryBufferConfigurations()),
       gpu_client_id_(gpu_client_id),
       gpu_client_tracing_id_(gpu_client_tracing_id),
-      gpu_host_id_(0) {
+      gpu_host_id_(0),
+      memory_pressure_listener_(
+          base::Bind(&BrowserGpuMemoryBufferManager::OnMemoryPressure,
+                     base::Unretained(this))) {
   DCHECK(!g_gpu_memory_buffer_manager);
   g_gpu_memory_buffer_manager = this;
+
+  // Note: Unretained is safe as IO thread is stopped before manager is
+  // destroyed.
+  scoped_refptr<base::SingleThreadTaskRunner> io_task_runner =
+      BrowserThread::GetMessageLoopProxyForThread(BrowserThread::IO);
+  pool_ = new SharedMemoryGpuMemoryBufferPool(
+      base::Bind(
+          &PooledGpuMemoryBufferDeleted, io_task_runner,
+          base::Bind(&BrowserGpuMemoryBufferManager::DestroyGpuMemoryBufferOnIO,
+                     base::Unretained(this)),
+          gpu_client_id_),
+      io_task_runner);
 }
 
 BrowserGpuMemoryBufferManager::~BrowserGpuMemoryBufferManager() {
+  pool_->ReleaseFreeMemory();
   g_gpu_memory_buffer_manager = nullptr;
 }
 
@@ -443,6 +472,14 @@ BrowserGpuMemoryBufferManager::AllocateGpuMemoryBufferForSurface(
     int32 surface_id) {
   DCHECK(!BrowserThread::CurrentlyOn(BrowserThread::IO));
 
+  // Shared memory buffers which were deleted can be reused right away.
+  if (!IsNativeGpuMemoryBufferConfiguration(format, usage)) {
+    scoped_ptr<gfx::GpuMemoryBuffer> buffer =
+        pool_->Allocate(size, format, usage);
+    if (buffer)
+      return buffer.Pass();
+  }
+
   CreateGpuMemoryBufferRequest request(size, format, usage, gpu_client_id_,
                                        surface_id);
   BrowserThread::PostTask(
@@ -492,15 +529,10 @@ void BrowserGpuMemoryBufferManager::HandleCreateGpuMemoryBufferOnIO(
                          request->format, request->usage, 0)));
   DCHECK(insert_result.second);
 
-  // Note: Unretained is safe as IO thread is stopped before manager is
-  // destroyed.
-  request->result = GpuMemoryBufferImplSharedMemory::Create(
-      new_id, request->size, request->format,
-      base::Bind(
-          &GpuMemoryBufferDeleted,
-          BrowserThread::GetMessageLoopProxyForThread(BrowserThread::IO),
-          base::Bind(&BrowserGpuMemoryBufferManager::DestroyGpuMemoryBufferOnIO,
-                     base::Unretained(this), new_id, request->client_id)));
+  // The buffer returns to |pool_| when it is deleted.
+  DCHECK_EQ(gpu_client_id_, request->client_id);
+  request->result =
+      pool_->Create(new_id, request->size, request->format, request->usage);
   request->event.Signal();
 }
 
@@ -736,6 +768,11 @@ void BrowserGpuMemoryBufferManager::DestroyGpuMemoryBufferOnIO(
   buffers.erase(buffer_it);
 }
 
+void BrowserGpuMemoryBufferManager::OnMemoryPressure(
+    base::MemoryPressureListener::MemoryPressureLevel memory_pressure_level) {
+  pool_->ReleaseFreeMemory();
+}
+
 uint64_t BrowserGpuMemoryBufferManager::ClientIdToTracingProcessId(
     int client_id) const {
   if (client_id == gpu_client_id_) {
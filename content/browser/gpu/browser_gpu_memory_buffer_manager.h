@@ -9,6 +9,8 @@
 
 #include "base/callback.h"
 #include "base/containers/hash_tables.h"
+#include "base/memory/memory_pressure_listener.h"
+#include "base/memory/ref_counted.h"
 #include "base/trace_event/memory_dump_provider.h"
 #include "content/common/content_export.h"
 #include "gpu/command_buffer/client/gpu_memory_buffer_manager.h"
@@ -36,6 +38,7 @@ struct hash<content::GpuMemoryBufferConfigurationKey> {
 
 namespace content {
 class GpuProcessHost;
+class SharedMemoryGpuMemoryBufferPool;
 
 class CONTENT_EXPORT BrowserGpuMemoryBufferManager
     : public gpu::GpuMemoryBufferManager,
@@ -170,6 +173,9 @@ class CONTENT_EXPORT BrowserGpuMemoryBufferManager
 
   uint64_t ClientIdToTracingProcessId(int client_id) const;
 
+  void OnMemoryPressure(
+      base::MemoryPressureListener::MemoryPressureLevel memory_pressure_level);
+
   const GpuMemoryBufferConfigurationSet native_configurations_;
   const int gpu_client_id_;
   const uint64_t gpu_client_tracing_id_;
@@ -183,6 +189,11 @@ class CONTENT_EXPORT BrowserGpuMemoryBufferManager
   using ClientMap = base::hash_map<int, BufferMap>;
   ClientMap clients_;
 
+  // Keeps the shared memory buffers of the GPU client for reuse, so that most
+  // allocations don't have to wait for the IO thread.
+  scoped_refptr<SharedMemoryGpuMemoryBufferPool> pool_;
+  base::MemoryPressureListener memory_pressure_listener_;
+
   DISALLOW_COPY_AND_ASSIGN(BrowserGpuMemoryBufferManager);
 };
 
@@ -7,6 +7,7 @@
 #include <algorithm>
 #include <cmath>
 
+#include "base/bind.h"
 #include "base/strings/string_piece.h"
 #include "base/strings/utf_string_conversions.h"
 #include "base/values.h"
@@ -115,8 +116,66 @@ void HostZoomMap::SendErrorPageZoomLevelRefresh(
   host_zoom_map->SendErrorPageZoomLevelRefresh();
 }
 
+HostZoomMapImpl::ZoomLevels::ZoomLevels() : default_zoom_level(0.0) {}
+
+HostZoomMapImpl::ZoomLevels::~ZoomLevels() {}
+
+scoped_ptr<HostZoomMapImpl::ZoomLevels>
+HostZoomMapImpl::ZoomLevels::Clone() const {
+  scoped_ptr<ZoomLevels> clone(new ZoomLevels);
+  clone->host_zoom_levels = host_zoom_levels;
+  clone->scheme_host_zoom_levels = scheme_host_zoom_levels;
+  clone->default_zoom_level = default_zoom_level;
+  return clone.Pass();
+}
+
+double HostZoomMapImpl::ZoomLevels::GetForHost(const std::string& host) const {
+  HostZoomLevels::const_iterator i(host_zoom_levels.find(host));
+  return (i == host_zoom_levels.end()) ? default_zoom_level : i->second;
+}
+
+double HostZoomMapImpl::ZoomLevels::GetForHostAndScheme(
+    const std::string& scheme,
+    const std::string& host) const {
+  SchemeHostZoomLevels::const_iterator scheme_iterator(
+      scheme_host_zoom_levels.find(scheme));
+  if (scheme_iterator != scheme_host_zoom_levels.end()) {
+    HostZoomLevels::const_iterator i(scheme_iterator->second.find(host));
+    if (i != scheme_iterator->second.end())
+      return i->second;
+  }
+
+  return GetForHost(host);
+}
+
+HostZoomMapImpl::ZoomLevelsReader::ZoomLevelsReader(
+    const HostZoomMapImpl* map) {
+  if (base::PlatformThread::CurrentRef() == map->ui_thread_) {
+    map_ = nullptr;
+    levels_ = map->GetZoomLevelsOnUIThread();
+    return;
+  }
+
+  // Announce the read before loading the pointer, so that PublishZoomLevels()
+  // either sees this reader or this reader sees the newer copy.
+  map_ = map;
+  base::subtle::Barrier_AtomicIncrement(&map->active_readers_, 1);
+  levels_ = reinterpret_cast<const ZoomLevels*>(
+      base::subtle::Acquire_Load(&map->published_levels_));
+}
+
+HostZoomMapImpl::ZoomLevelsReader::~ZoomLevelsReader() {
+  if (map_)
+    base::subtle::Barrier_AtomicIncrement(&map_->active_readers_, -1);
+}
+
 HostZoomMapImpl::HostZoomMapImpl()
-    : default_zoom_level_(0.0) {
+    : levels_(new ZoomLevels),
+      published_levels_(reinterpret_cast<base::subtle::AtomicWord>(
+          levels_.get())),
+      active_readers_(0),
+      ui_thread_(base::PlatformThread::CurrentRef()),
+      weak_factory_(this) {
   registrar_.Add(
       this, NOTIFICATION_RENDER_VIEW_HOST_WILL_CLOSE_RENDER_VIEW,
       NotificationService::AllSources());
@@ -129,75 +188,89 @@ void HostZoomMapImpl::CopyFrom(HostZoomMap* copy_interface) {
   // can deadlock.
   DCHECK_CURRENTLY_ON(BrowserThread::UI);
   HostZoomMapImpl* copy = static_cast<HostZoomMapImpl*>(copy_interface);
-  base::AutoLock auto_lock(lock_);
-  base::AutoLock copy_auto_lock(copy->lock_);
-  host_zoom_levels_.
-      insert(copy->host_zoom_levels_.begin(), copy->host_zoom_levels_.end());
-  for (SchemeHostZoomLevels::const_iterator i(copy->
-           scheme_host_zoom_levels_.begin());
-       i != copy->scheme_host_zoom_levels_.end(); ++i) {
-    scheme_host_zoom_levels_[i->first] = HostZoomLevels();
-    scheme_host_zoom_levels_[i->first].
-        insert(i->second.begin(), i->second.end());
+  const ZoomLevels* copy_levels = copy->GetZoomLevelsOnUIThread();
+  ZoomLevels* levels = GetMutableZoomLevels();
+  levels->host_zoom_levels.insert(copy_levels->host_zoom_levels.begin(),
+                                  copy_levels->host_zoom_levels.end());
+  for (SchemeHostZoomLevels::const_iterator i(
+           copy_levels->scheme_host_zoom_levels.begin());
+       i != copy_levels->scheme_host_zoom_levels.end(); ++i) {
+    levels->scheme_host_zoom_levels[i->first] = i->second;
   }
-  default_zoom_level_ = copy->default_zoom_level_;
+  levels->default_zoom_level = copy_levels->default_zoom_level;
 }
 
-double HostZoomMapImpl::GetZoomLevelForHost(const std::string& host) const {
-  base::AutoLock auto_lock(lock_);
-  return GetZoomLevelForHostInternal(host);
+const HostZoomMapImpl::ZoomLevels*
+HostZoomMapImpl::GetZoomLevelsOnUIThread() const {
+  DCHECK_CURRENTLY_ON(BrowserThread::UI);
+  return pending_levels_ ? pending_levels_.get() : levels_.get();
 }
 
-double HostZoomMapImpl::GetZoomLevelForHostInternal(
-    const std::string& host) const {
-  HostZoomLevels::const_iterator i(host_zoom_levels_.find(host));
-  return (i == host_zoom_levels_.end()) ? default_zoom_level_ : i->second;
+HostZoomMapImpl::ZoomLevels* HostZoomMapImpl::GetMutableZoomLevels() {
+  DCHECK_CURRENTLY_ON(BrowserThread::UI);
+  if (!pending_levels_) {
+    pending_levels_ = levels_->Clone();
+    BrowserThread::PostTask(
+        BrowserThread::UI, FROM_HERE,
+        base::Bind(&HostZoomMapImpl::PublishZoomLevels,
+                   weak_factory_.GetWeakPtr()));
+  }
+  return pending_levels_.get();
+}
+
+void HostZoomMapImpl::PublishZoomLevels() {
+  DCHECK_CURRENTLY_ON(BrowserThread::UI);
+  if (!pending_levels_)
+    return;
+
+  retired_levels_.push_back(levels_.release());
+  levels_ = pending_levels_.Pass();
+  base::subtle::Release_Store(
+      &published_levels_,
+      reinterpret_cast<base::subtle::AtomicWord>(levels_.get()));
+
+  // Readers that start from here on only see |levels_|. If none is active
+  // right now, nobody can be using the retired copies any more. Otherwise
+  // they are freed by a later publication.
+  base::subtle::MemoryBarrier();
+  if (base::subtle::Acquire_Load(&active_readers_) == 0)
+    retired_levels_.clear();
+}
+
+double HostZoomMapImpl::GetZoomLevelForHost(const std::string& host) const {
+  return ZoomLevelsReader(this)->GetForHost(host);
 }
 
 bool HostZoomMapImpl::HasZoomLevel(const std::string& scheme,
                                    const std::string& host) const {
-  base::AutoLock auto_lock(lock_);
+  ZoomLevelsReader levels(this);
 
   SchemeHostZoomLevels::const_iterator scheme_iterator(
-      scheme_host_zoom_levels_.find(scheme));
+      levels->scheme_host_zoom_levels.find(scheme));
 
   const HostZoomLevels& zoom_levels =
-      (scheme_iterator != scheme_host_zoom_levels_.end())
+      (scheme_iterator != levels->scheme_host_zoom_levels.end())
           ? scheme_iterator->second
-          : host_zoom_levels_;
+          : levels->host_zoom_levels;
 
   HostZoomLevels::const_iterator i(zoom_levels.find(host));
   return i != zoom_levels.end();
 }
 
-double HostZoomMapImpl::GetZoomLevelForHostAndSchemeInternal(
-    const std::string& scheme,
-    const std::string& host) const {
-  SchemeHostZoomLevels::const_iterator scheme_iterator(
-      scheme_host_zoom_levels_.find(scheme));
-  if (scheme_iterator != scheme_host_zoom_levels_.end()) {
-    HostZoomLevels::const_iterator i(scheme_iterator->second.find(host));
-    if (i != scheme_iterator->second.end())
-      return i->second;
-  }
-
-  return GetZoomLevelForHostInternal(host);
-}
-
 double HostZoomMapImpl::GetZoomLevelForHostAndScheme(
     const std::string& scheme,
     const std::string& host) const {
-  base::AutoLock auto_lock(lock_);
-  return GetZoomLevelForHostAndSchemeInternal(scheme, host);
+  return ZoomLevelsReader(this)->GetForHostAndScheme(scheme, host);
 }
 
 HostZoomMap::ZoomLevelVector HostZoomMapImpl::GetAllZoomLevels() const {
   HostZoomMap::ZoomLevelVector result;
   {
-    base::AutoLock auto_lock(lock_);
-    result.reserve(host_zoom_levels_.size() + scheme_host_zoom_levels_.size());
-    for (HostZoomLevels::const_iterator i = host_zoom_levels_.begin();
-         i != host_zoom_levels_.end();
+    ZoomLevelsReader levels(this);
+    result.reserve(levels->host_zoom_levels.size() +
+                   levels->scheme_host_zoom_levels.size());
+    for (HostZoomLevels::const_iterator i = levels->host_zoom_levels.begin();
+         i != levels->host_zoom_levels.end();
          ++i) {
       ZoomLevelChange change = {HostZoomMap::ZOOM_CHANGED_FOR_HOST,
                                 i->first,       // host
@@ -207,8 +280,8 @@ HostZoomMap::ZoomLevelVector HostZoomMapImpl::GetAllZoomLevels() const {
       result.push_back(change);
     }
     for (SchemeHostZoomLevels::const_iterator i =
-             scheme_host_zoom_levels_.begin();
-         i != scheme_host_zoom_levels_.end();
+             levels->scheme_host_zoom_levels.begin();
+         i != levels->scheme_host_zoom_levels.end();
          ++i) {
       const std::string& scheme = i->first;
       const HostZoomLevels& host_zoom_levels = i->second;
@@ -232,12 +305,11 @@ void HostZoomMapImpl::SetZoomLevelForHost(const std::string& host,
   DCHECK_CURRENTLY_ON(BrowserThread::UI);
 
   {
-    base::AutoLock auto_lock(lock_);
-
-    if (ZoomValuesEqual(level, default_zoom_level_))
-      host_zoom_levels_.erase(host);
+    ZoomLevels* levels = GetMutableZoomLevels();
+    if (ZoomValuesEqual(level, levels->default_zoom_level))
+      levels->host_zoom_levels.erase(host);
     else
-      host_zoom_levels_[host] = level;
+      levels->host_zoom_levels[host] = level;
   }
 
   // TODO(wjmaclean) Should we use a GURL here? crbug.com/384486
@@ -255,10 +327,7 @@ void HostZoomMapImpl::SetZoomLevelForHostAndScheme(const std::string& scheme,
                                                    const std::string& host,
                                                    double level) {
   DCHECK_CURRENTLY_ON(BrowserThread::UI);
-  {
-    base::AutoLock auto_lock(lock_);
-    scheme_host_zoom_levels_[scheme][host] = level;
-  }
+  GetMutableZoomLevels()->scheme_host_zoom_levels[scheme][host] = level;
 
   SendZoomLevelChange(scheme, host, level);
 
@@ -273,12 +342,12 @@ void HostZoomMapImpl::SetZoomLevelForHostAndScheme(const std::string& scheme,
 
 double HostZoomMapImpl::GetDefaultZoomLevel() const {
   DCHECK_CURRENTLY_ON(BrowserThread::UI);
-  return default_zoom_level_;
+  return GetZoomLevelsOnUIThread()->default_zoom_level;
 }
 
 void HostZoomMapImpl::SetDefaultZoomLevel(double level) {
   DCHECK_CURRENTLY_ON(BrowserThread::UI);
-  default_zoom_level_ = level;
+  GetMutableZoomLevels()->default_zoom_level = level;
 }
 
 scoped_ptr<HostZoomMap::Subscription>
@@ -421,13 +490,48 @@ double HostZoomMapImpl::GetZoomLevelForView(const GURL& url,
                                             int render_process_id,
                                             int render_view_id) const {
   RenderViewKey key(render_process_id, render_view_id);
-  base::AutoLock auto_lock(lock_);
+  {
+    base::AutoLock auto_lock(lock_);
+    TemporaryZoomLevels::const_iterator it = temporary_zoom_levels_.find(key);
+    if (it != temporary_zoom_levels_.end())
+      return it->second;
+  }
 
-  if (ContainsKey(temporary_zoom_levels_, key))
-    return temporary_zoom_levels_.find(key)->second;
+  return GetZoomLevelForHostAndScheme(url.scheme(),
+                                      net::GetHostOrSpecFromURL(url));
+}
+
+void HostZoomMapImpl::DidCommitMainFrameNavigation(int render_process_id,
+                                                   int render_view_id,
+                                                   const GURL& url) {
+  DCHECK_CURRENTLY_ON(BrowserThread::UI);
+  std::string host = net::GetHostOrSpecFromURL(url);
+  RenderViewKey key(render_process_id, render_view_id);
+  ViewCommittedHosts::iterator it = view_committed_hosts_.find(key);
+  if (it != view_committed_hosts_.end() && it->second == host)
+    return;
 
-  return GetZoomLevelForHostAndSchemeInternal(url.scheme(),
-                                              net::GetHostOrSpecFromURL(url));
+  ClearCommittedHostForView(render_process_id, render_view_id);
+  view_committed_hosts_[key] = host;
+  ++host_processes_[host][render_process_id];
+}
+
+void HostZoomMapImpl::ClearCommittedHostForView(int render_process_id,
+                                                int render_view_id) {
+  ViewCommittedHosts::iterator it = view_committed_hosts_.find(
+      RenderViewKey(render_process_id, render_view_id));
+  if (it == view_committed_hosts_.end())
+    return;
+
+  HostProcesses::iterator host_it = host_processes_.find(it->second);
+  DCHECK(host_it != host_processes_.end());
+  ProcessViewCounts& processes = host_it->second;
+  if (--processes[render_process_id] == 0) {
+    processes.erase(render_process_id);
+    if (processes.empty())
+      host_processes_.erase(host_it);
+  }
+  view_committed_hosts_.erase(it);
 }
 
 void HostZoomMapImpl::Observe(int type,
@@ -440,6 +544,7 @@ void HostZoomMapImpl::Observe(int type,
           Source<RenderViewHost>(source)->GetProcess()->GetID();
       ClearTemporaryZoomLevel(render_process_id, render_view_id);
       ClearPageScaleFactorIsOneForView(render_process_id, render_view_id);
+      ClearCommittedHostForView(render_process_id, render_view_id);
       break;
     }
     default:
@@ -471,13 +576,16 @@ void HostZoomMapImpl::ClearTemporaryZoomLevel(int render_process_id,
 void HostZoomMapImpl::SendZoomLevelChange(const std::string& scheme,
                                           const std::string& host,
                                           double level) {
-  for (RenderProcessHost::iterator i(RenderProcessHost::AllHostsIterator());
-       !i.IsAtEnd(); i.Advance()) {
-    RenderProcessHost* render_process_host = i.GetCurrentValue();
-    // TODO(wjmaclean) This will need to be cleaned up when
-    // RenderProcessHost::GetStoragePartition() goes away. Perhaps have
-    // RenderProcessHost expose a GetHostZoomMap() function?
-    if (render_process_host->GetStoragePartition()->GetHostZoomMap() == this) {
+  // Only views which have committed |host| can be showing it, and those all
+  // belong to this map, so there's no need to visit every render process.
+  HostProcesses::const_iterator it = host_processes_.find(host);
+  if (it == host_processes_.end())
+    return;
+
+  for (const auto& process : it->second) {
+    RenderProcessHost* render_process_host =
+        RenderProcessHost::FromID(process.first);
+    if (render_process_host) {
       render_process_host->Send(
           new ViewMsg_SetZoomLevelForCurrentURL(scheme, host, level));
     }
@@ -10,9 +10,14 @@
 #include <tuple>
 #include <vector>
 
+#include "base/atomicops.h"
 #include "base/compiler_specific.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/memory/scoped_vector.h"
+#include "base/memory/weak_ptr.h"
 #include "base/sequenced_task_runner_helpers.h"
 #include "base/synchronization/lock.h"
+#include "base/threading/platform_thread.h"
 #include "content/public/browser/host_zoom_map.h"
 #include "content/public/browser/notification_observer.h"
 #include "content/public/browser/notification_registrar.h"
@@ -95,6 +100,13 @@ class CONTENT_EXPORT HostZoomMapImpl : public NON_EXPORTED_BASE(HostZoomMap),
                              int render_process_id,
                              int render_view_id) const;
 
+  // Records that the main frame of the given view committed a document from
+  // |url|. Host and scheme zoom changes are only sent to processes with a
+  // view whose last committed main frame document is on the changed host.
+  void DidCommitMainFrameNavigation(int render_process_id,
+                                    int render_view_id,
+                                    const GURL& url);
+
   // NotificationObserver implementation.
   void Observe(int type,
                const NotificationSource& source,
@@ -121,16 +133,73 @@ class CONTENT_EXPORT HostZoomMapImpl : public NON_EXPORTED_BASE(HostZoomMap),
   typedef std::map<RenderViewKey, double> TemporaryZoomLevels;
   typedef std::map<RenderViewKey, bool> ViewPageScaleFactorsAreOne;
 
+  // Number of views in each render process, keyed by process id.
+  typedef std::map<int, int> ProcessViewCounts;
+  typedef std::map<std::string, ProcessViewCounts> HostProcesses;
+  typedef std::map<RenderViewKey, std::string> ViewCommittedHosts;
+
+  // A copy of the host-keyed and scheme+host-keyed zoom levels. Once
+  // published a copy is never modified again, so readers on any thread can
+  // search it without holding a lock. The UI thread makes its changes to an
+  // unpublished copy and publishes it at the end of the current task, so a
+  // batch of changes, e.g. while loading prefs, costs a single copy.
+  class ZoomLevels {
+   public:
+    ZoomLevels();
+    ~ZoomLevels();
+
+    scoped_ptr<ZoomLevels> Clone() const;
+
+    double GetForHost(const std::string& host) const;
+    double GetForHostAndScheme(const std::string& scheme,
+                               const std::string& host) const;
+
+    HostZoomLevels host_zoom_levels;
+    SchemeHostZoomLevels scheme_host_zoom_levels;
+    double default_zoom_level;
+
+   private:
+    DISALLOW_COPY_AND_ASSIGN(ZoomLevels);
+  };
+
+  // Gives the current thread access to the zoom levels for the lifetime of
+  // the reader. The UI thread sees its unpublished changes; other threads
+  // see the last published copy, which isn't freed while they read it.
+  class ZoomLevelsReader {
+   public:
+    explicit ZoomLevelsReader(const HostZoomMapImpl* map);
+    ~ZoomLevelsReader();
+
+    const ZoomLevels* operator->() const { return levels_; }
+
+   private:
+    // NULL when reading on the UI thread, which needs no bookkeeping.
+    const HostZoomMapImpl* map_;
+    const ZoomLevels* levels_;
+
+    DISALLOW_COPY_AND_ASSIGN(ZoomLevelsReader);
+  };
+
   double GetZoomLevelForHost(const std::string& host) const;
 
-  // Non-locked versions for internal use. These should only be called within
-  // a scope where a lock has been acquired.
-  double GetZoomLevelForHostInternal(const std::string& host) const;
-  double GetZoomLevelForHostAndSchemeInternal(const std::string& scheme,
-                                              const std::string& host) const;
+  // Returns the zoom levels as seen by the UI thread, including changes that
+  // haven't been published yet. Must be called on the UI thread.
+  const ZoomLevels* GetZoomLevelsOnUIThread() const;
+
+  // Returns an unpublished copy of the zoom levels for the UI thread to
+  // modify, making one and scheduling its publication if needed.
+  ZoomLevels* GetMutableZoomLevels();
+
+  // Makes the changes made through GetMutableZoomLevels() visible to other
+  // threads, and frees the copies that no reader can still be using.
+  void PublishZoomLevels();
+
+  // Forgets the committed host of the given view, if any.
+  void ClearCommittedHostForView(int render_process_id, int render_view_id);
 
-  // Notifies the renderers from this browser context to change the zoom level
-  // for the specified host and scheme.
+  // Notifies the renderers which have committed |host| in a main frame of
+  // this browser context to change the zoom level for the specified host and
+  // scheme.
   // TODO(wjmaclean) Should we use a GURL here? crbug.com/384486
   void SendZoomLevelChange(const std::string& scheme,
                            const std::string& host,
@@ -140,10 +209,31 @@ class CONTENT_EXPORT HostZoomMapImpl : public NON_EXPORTED_BASE(HostZoomMap),
   base::CallbackList<void(const ZoomLevelChange&)>
       zoom_level_changed_callbacks_;
 
-  // Copy of the pref data, so that we can read it on the IO thread.
-  HostZoomLevels host_zoom_levels_;
-  SchemeHostZoomLevels scheme_host_zoom_levels_;
-  double default_zoom_level_;
+  // Copy of the pref data, so that we can read it on the IO thread. Only
+  // replaced on the UI thread, which also owns the copy.
+  scoped_ptr<ZoomLevels> levels_;
+
+  // |levels_| as seen by readers on other threads, which load it without a
+  // lock. |active_readers_| counts those readers, so that replaced copies
+  // are only freed once nobody can still be reading them; until then they
+  // wait in |retired_levels_|.
+  base::subtle::AtomicWord published_levels_;
+  mutable base::subtle::Atomic32 active_readers_;
+  ScopedVector<ZoomLevels> retired_levels_;
+
+  // Changes made on the UI thread during the current task, published when
+  // the task ends. NULL if there are none.
+  scoped_ptr<ZoomLevels> pending_levels_;
+
+  // The thread the map was created on, i.e. the UI thread. Compared against
+  // directly because BrowserThread::CurrentlyOn() takes a lock.
+  base::PlatformThreadRef ui_thread_;
+
+  // The host of the last main frame document committed by each view, and the
+  // reverse index used to find the processes a zoom change must reach. Both
+  // are only used on the UI thread.
+  ViewCommittedHosts view_committed_hosts_;
+  HostProcesses host_processes_;
 
   // Page scale factor data for each renderer.
   ViewPageScaleFactorsAreOne view_page_scale_factors_are_one_;
@@ -152,13 +242,14 @@ class CONTENT_EXPORT HostZoomMapImpl : public NON_EXPORTED_BASE(HostZoomMap),
   // level, so vector is fine for now.
   TemporaryZoomLevels temporary_zoom_levels_;
 
-  // Used around accesses to |host_zoom_levels_|, |default_zoom_level_|,
-  // |temporary_zoom_levels_|, and |view_page_scale_factors_are_one_| to
-  // guarantee thread safety.
+  // Used around accesses to |temporary_zoom_levels_| and
+  // |view_page_scale_factors_are_one_| to guarantee thread safety.
   mutable base::Lock lock_;
 
   NotificationRegistrar registrar_;
 
+  base::WeakPtrFactory<HostZoomMapImpl> weak_factory_;
+
   DISALLOW_COPY_AND_ASSIGN(HostZoomMapImpl);
 };
 
@@ -0,0 +1,96 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "content/browser/host_zoom_map_impl.h"
+
+#include <string>
+#include <vector>
+
+#include "base/memory/scoped_vector.h"
+#include "base/message_loop/message_loop.h"
+#include "base/strings/stringprintf.h"
+#include "base/time/time.h"
+#include "content/public/browser/browser_thread.h"
+#include "content/public/test/mock_render_process_host.h"
+#include "content/public/test/test_browser_context.h"
+#include "content/public/test/test_browser_thread.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_test.h"
+#include "url/gurl.h"
+
+namespace content {
+namespace {
+
+const int kRenderProcesses = 300;
+const int kHosts = 5000;
+const int kTimeLimitMs = 2000;
+
+std::string GetHost(int i) {
+  return base::StringPrintf("host%d.example.com", i);
+}
+
+class HostZoomMapPerfTest : public testing::Test {
+ public:
+  HostZoomMapPerfTest() : ui_thread_(BrowserThread::UI, &message_loop_) {}
+
+ protected:
+  void SetUp() override {
+    // Every host has its own zoom level, and every process shows one host.
+    for (int i = 0; i < kHosts; ++i)
+      host_zoom_map_.SetZoomLevelForHost(GetHost(i), 1.0 + i % 5);
+    for (int i = 0; i < kRenderProcesses; ++i) {
+      processes_.push_back(new MockRenderProcessHost(&browser_context_));
+      host_zoom_map_.DidCommitMainFrameNavigation(
+          processes_.back()->GetID(), 1,
+          GURL("http://" + GetHost(i) + "/"));
+    }
+  }
+
+  base::MessageLoop message_loop_;
+  TestBrowserThread ui_thread_;
+  TestBrowserContext browser_context_;
+  ScopedVector<MockRenderProcessHost> processes_;
+  HostZoomMapImpl host_zoom_map_;
+};
+
+TEST_F(HostZoomMapPerfTest, SetZoomLevelForHost) {
+  int changes = 0;
+  base::TimeTicks start = base::TimeTicks::Now();
+  base::TimeDelta elapsed;
+  do {
+    host_zoom_map_.SetZoomLevelForHost(GetHost(changes % kHosts),
+                                       1.0 + changes % 3);
+    ++changes;
+    elapsed = base::TimeTicks::Now() - start;
+  } while (elapsed.InMilliseconds() < kTimeLimitMs);
+
+  perf_test::PrintResult("host_zoom_map_set_zoom_level", "",
+                         "300_processes_5000_hosts",
+                         elapsed.InMicroseconds() / static_cast<double>(changes),
+                         "us/change", true);
+}
+
+TEST_F(HostZoomMapPerfTest, GetZoomLevelForView) {
+  std::vector<GURL> urls;
+  for (int i = 0; i < kHosts; ++i)
+    urls.push_back(GURL("http://" + GetHost(i) + "/"));
+
+  int lookups = 0;
+  double total = 0;
+  base::TimeTicks start = base::TimeTicks::Now();
+  base::TimeDelta elapsed;
+  do {
+    for (int i = 0; i < 1000; ++i, ++lookups)
+      total += host_zoom_map_.GetZoomLevelForView(urls[lookups % kHosts], 1, 1);
+    elapsed = base::TimeTicks::Now() - start;
+  } while (elapsed.InMilliseconds() < kTimeLimitMs);
+  EXPECT_LT(0, total);
+
+  perf_test::PrintResult("host_zoom_map_get_zoom_level", "", "5000_hosts",
+                         elapsed.InMicroseconds() / static_cast<double>(lookups),
+                         "us/lookup", true);
+}
+
+}  // namespace
+}  // namespace content
@@ -4,14 +4,31 @@
 
 #include "content/browser/host_zoom_map_impl.h"
 
+#include "base/bind.h"
 #include "base/memory/ref_counted.h"
+#include "base/memory/scoped_ptr.h"
 #include "base/message_loop/message_loop.h"
+#include "base/run_loop.h"
+#include "base/threading/thread.h"
+#include "content/common/view_messages.h"
 #include "content/public/browser/browser_thread.h"
+#include "content/public/test/mock_render_process_host.h"
+#include "content/public/test/test_browser_context.h"
 #include "content/public/test/test_browser_thread.h"
 #include "testing/gtest/include/gtest/gtest.h"
 
 namespace content {
 
+namespace {
+
+void GetZoomLevelForHost(const HostZoomMapImpl* host_zoom_map,
+                         const std::string& host,
+                         double* level) {
+  *level = host_zoom_map->GetZoomLevelForHostAndScheme("http", host);
+}
+
+}  // namespace
+
 class HostZoomMapTest : public testing::Test {
  public:
   HostZoomMapTest() : ui_thread_(BrowserThread::UI, &message_loop_) {
@@ -82,4 +99,107 @@ TEST_F(HostZoomMapTest, GetAllZoomLevels) {
   }
 }
 
+TEST_F(HostZoomMapTest, DefaultZoomLevelAppliesToUnzoomedHosts) {
+  HostZoomMapImpl host_zoom_map;
+
+  double zoomed = 2.5;
+  host_zoom_map.SetZoomLevelForHost("zoomed.com", zoomed);
+  host_zoom_map.SetDefaultZoomLevel(1.5);
+
+  EXPECT_DOUBLE_EQ(1.5, host_zoom_map.GetDefaultZoomLevel());
+  EXPECT_DOUBLE_EQ(1.5,
+      host_zoom_map.GetZoomLevelForHostAndScheme("http", "normal.com"));
+  EXPECT_DOUBLE_EQ(zoomed,
+      host_zoom_map.GetZoomLevelForHostAndScheme("http", "zoomed.com"));
+  EXPECT_DOUBLE_EQ(zoomed,
+      host_zoom_map.GetZoomLevelForView(GURL("http://zoomed.com/"), 1, 1));
+}
+
+TEST_F(HostZoomMapTest, CopyFrom) {
+  HostZoomMapImpl source;
+  source.SetZoomLevelForHost("zoomed.com", 2.5);
+  source.SetZoomLevelForHostAndScheme("chrome", "login", 1.0);
+  source.SetDefaultZoomLevel(0.5);
+
+  HostZoomMapImpl host_zoom_map;
+  host_zoom_map.SetZoomLevelForHost("other.com", 3.0);
+  host_zoom_map.CopyFrom(&source);
+
+  EXPECT_DOUBLE_EQ(0.5, host_zoom_map.GetDefaultZoomLevel());
+  EXPECT_DOUBLE_EQ(2.5,
+      host_zoom_map.GetZoomLevelForHostAndScheme("http", "zoomed.com"));
+  EXPECT_DOUBLE_EQ(3.0,
+      host_zoom_map.GetZoomLevelForHostAndScheme("http", "other.com"));
+  EXPECT_DOUBLE_EQ(1.0,
+      host_zoom_map.GetZoomLevelForHostAndScheme("chrome", "login"));
+
+  // Later changes to the source aren't visible in the copy.
+  source.SetZoomLevelForHost("zoomed.com", 1.0);
+  EXPECT_DOUBLE_EQ(2.5,
+      host_zoom_map.GetZoomLevelForHostAndScheme("http", "zoomed.com"));
+}
+
+// Other threads only see the changes made during a UI thread task once that
+// task has finished.
+TEST_F(HostZoomMapTest, ChangesPublishedToOtherThreadsAfterTask) {
+  HostZoomMapImpl host_zoom_map;
+  host_zoom_map.SetZoomLevelForHost("zoomed.com", 2.5);
+  host_zoom_map.SetZoomLevelForHost("other.com", 3.0);
+  EXPECT_DOUBLE_EQ(2.5,
+      host_zoom_map.GetZoomLevelForHostAndScheme("http", "zoomed.com"));
+
+  base::Thread reader("HostZoomMapReader");
+  double level = -1;
+  ASSERT_TRUE(reader.Start());
+  reader.task_runner()->PostTask(
+      FROM_HERE, base::Bind(&GetZoomLevelForHost, &host_zoom_map,
+                            std::string("zoomed.com"), &level));
+  reader.Stop();
+  EXPECT_DOUBLE_EQ(0, level);
+
+  base::RunLoop().RunUntilIdle();
+  ASSERT_TRUE(reader.Start());
+  reader.task_runner()->PostTask(
+      FROM_HERE, base::Bind(&GetZoomLevelForHost, &host_zoom_map,
+                            std::string("zoomed.com"), &level));
+  reader.Stop();
+  EXPECT_DOUBLE_EQ(2.5, level);
+}
+
+// Zoom changes should only be sent to the processes that have committed a
+// main frame document on the changed host.
+TEST_F(HostZoomMapTest, ZoomChangesOnlySentToProcessesShowingHost) {
+  TestBrowserContext browser_context;
+  scoped_ptr<MockRenderProcessHost> zoomed_process(
+      new MockRenderProcessHost(&browser_context));
+  scoped_ptr<MockRenderProcessHost> other_process(
+      new MockRenderProcessHost(&browser_context));
+  HostZoomMapImpl host_zoom_map;
+
+  host_zoom_map.DidCommitMainFrameNavigation(
+      zoomed_process->GetID(), 1, GURL("http://zoomed.com/a"));
+  host_zoom_map.DidCommitMainFrameNavigation(
+      other_process->GetID(), 1, GURL("http://other.com/"));
+
+  host_zoom_map.SetZoomLevelForHost("zoomed.com", 2.5);
+  EXPECT_TRUE(zoomed_process->sink().GetUniqueMessageMatching(
+      ViewMsg_SetZoomLevelForCurrentURL::ID));
+  EXPECT_FALSE(other_process->sink().GetUniqueMessageMatching(
+      ViewMsg_SetZoomLevelForCurrentURL::ID));
+
+  // Once the view navigates away, the process no longer cares about the host.
+  zoomed_process->sink().ClearMessages();
+  host_zoom_map.DidCommitMainFrameNavigation(
+      zoomed_process->GetID(), 1, GURL("http://other.com/"));
+  host_zoom_map.SetZoomLevelForHostAndScheme("http", "zoomed.com", 1.0);
+  EXPECT_FALSE(zoomed_process->sink().GetUniqueMessageMatching(
+      ViewMsg_SetZoomLevelForCurrentURL::ID));
+
+  host_zoom_map.SetZoomLevelForHost("other.com", 1.0);
+  EXPECT_TRUE(zoomed_process->sink().GetUniqueMessageMatching(
+      ViewMsg_SetZoomLevelForCurrentURL::ID));
+  EXPECT_TRUE(other_process->sink().GetUniqueMessageMatching(
+      ViewMsg_SetZoomLevelForCurrentURL::ID));
+}
+
 }  // namespace content
@@ -12,6 +12,7 @@
 #include "content/browser/browser_main_loop.h"
 #include "content/browser/child_process_security_policy_impl.h"
 #include "content/browser/media/media_internals.h"
+#include "content/common/media/midi_message_ring.h"
 #include "content/common/media/midi_messages.h"
 #include "content/public/browser/content_browser_client.h"
 #include "content/public/browser/media_observer.h"
@@ -53,8 +54,11 @@ MidiHost::MidiHost(int renderer_process_id,
       has_sys_ex_permission_(false),
       is_session_requested_(false),
       midi_manager_(midi_manager),
+      pending_received_bytes_(0),
+      large_send_bytes_(0),
       sent_bytes_in_flight_(0),
       bytes_sent_since_last_acknowledgement_(0),
+      send_ring_stalled_(false),
       output_port_count_(0) {
   DCHECK(midi_manager_);
 }
@@ -76,6 +80,10 @@ bool MidiHost::OnMessageReceived(const IPC::Message& message) {
     IPC_MESSAGE_HANDLER(MidiHostMsg_StartSession, OnStartSession)
     IPC_MESSAGE_HANDLER(MidiHostMsg_SendData, OnSendData)
     IPC_MESSAGE_HANDLER(MidiHostMsg_EndSession, OnEndSession)
+    IPC_MESSAGE_HANDLER(MidiHostMsg_SendRingDoorbell, OnSendRingDoorbell)
+    IPC_MESSAGE_HANDLER(MidiHostMsg_SendLargeData, OnSendLargeData)
+    IPC_MESSAGE_HANDLER(MidiHostMsg_RecvRingSpaceAvailable,
+                        OnRecvRingSpaceAvailable)
     IPC_MESSAGE_UNHANDLED(handled = false)
   IPC_END_MESSAGE_MAP()
 
@@ -84,6 +92,8 @@ bool MidiHost::OnMessageReceived(const IPC::Message& message) {
 
 void MidiHost::OnStartSession() {
   is_session_requested_ = true;
+  // The rings must reach the renderer before MidiMsg_SessionStarted does.
+  CreateSessionRings();
   if (midi_manager_)
     midi_manager_->StartSession(this);
 }
@@ -91,46 +101,52 @@ void MidiHost::OnStartSession() {
 void MidiHost::OnSendData(uint32 port,
                           const std::vector<uint8>& data,
                           double timestamp) {
-  {
-    base::AutoLock auto_lock(output_port_count_lock_);
-    if (output_port_count_ <= port) {
-      bad_message::ReceivedBadMessage(this, bad_message::MH_INVALID_MIDI_PORT);
-      return;
-    }
-  }
+  SendToMidiManager(port, data, timestamp);
+}
 
-  if (data.empty())
-    return;
+void MidiHost::OnEndSession() {
+  is_session_requested_ = false;
+  if (midi_manager_)
+    midi_manager_->EndSession(this);
+}
 
-  // Blink running in a renderer checks permission to raise a SecurityError
-  // in JavaScript. The actual permission check for security purposes
-  // happens here in the browser process.
-  if (!has_sys_ex_permission_ &&
-      std::find(data.begin(), data.end(), kSysExByte) != data.end()) {
-    bad_message::ReceivedBadMessage(this, bad_message::MH_SYS_EX_PERMISSION);
-    return;
-  }
+void MidiHost::OnSendRingDoorbell() {
+  DCHECK_CURRENTLY_ON(BrowserThread::IO);
+  DrainSendRing();
+}
 
-  if (!IsValidWebMIDIData(data))
+void MidiHost::OnSendLargeData(uint32 port,
+                               const std::vector<uint8>& data,
+                               double timestamp) {
+  DCHECK_CURRENTLY_ON(BrowserThread::IO);
+  if (!send_ring_) {
+    SendToMidiManager(port, data, timestamp);
     return;
+  }
 
-  {
-    base::AutoLock auto_lock(in_flight_lock_);
-    // Sanity check that we won't send too much data.
-    // TODO(yukawa): Consider to send an error event back to the renderer
-    // after some future discussion in W3C.
-    if (data.size() + sent_bytes_in_flight_ > kMaxInFlightBytes)
-      return;
-    sent_bytes_in_flight_ += data.size();
+  // The message must still fill its place in the ring. If the renderer has
+  // sent more than could ever be in flight, drop the data, as
+  // SendToMidiManager() would.
+  if (data.size() + large_send_bytes_ > kMaxInFlightBytes) {
+    large_send_messages_.push_back(
+        PendingMessage(port, std::vector<uint8>(), timestamp));
+  } else {
+    large_send_messages_.push_back(PendingMessage(port, data, timestamp));
+    large_send_bytes_ += data.size();
   }
-  if (midi_manager_)
-    midi_manager_->DispatchSendMidiData(this, port, data, timestamp);
+  DrainSendRing();
 }
 
-void MidiHost::OnEndSession() {
-  is_session_requested_ = false;
-  if (midi_manager_)
-    midi_manager_->EndSession(this);
+void MidiHost::OnRecvRingSpaceAvailable() {
+  DCHECK_CURRENTLY_ON(BrowserThread::IO);
+  base::AutoLock auto_lock(messages_queues_lock_);
+  while (!pending_received_messages_.empty()) {
+    const PendingMessage& message = pending_received_messages_.front();
+    if (!PushToRecvRingLocked(message.port, message.data, message.timestamp))
+      break;
+    pending_received_bytes_ -= message.data.size();
+    pending_received_messages_.pop_front();
+  }
 }
 
 void MidiHost::CompleteStartSession(media::midi::Result result) {
@@ -195,16 +211,22 @@ void MidiHost::ReceiveMidiData(
     if (message[0] == kSysExByte && !has_sys_ex_permission_)
       continue;
 
-    // Send to the renderer.
-    Send(new MidiMsg_DataReceived(port, message, timestamp));
+    SendReceivedDataLocked(port, message, timestamp);
   }
 }
 
 void MidiHost::AccumulateMidiBytesSent(size_t n) {
+  bool resume_send_ring = false;
   {
     base::AutoLock auto_lock(in_flight_lock_);
     if (n <= sent_bytes_in_flight_)
       sent_bytes_in_flight_ -= n;
+    resume_send_ring = send_ring_stalled_;
+    send_ring_stalled_ = false;
+  }
+  if (resume_send_ring) {
+    BrowserThread::PostTask(BrowserThread::IO, FROM_HERE,
+                            base::Bind(&MidiHost::DrainSendRing, this));
   }
 
   if (bytes_sent_since_last_acknowledgement_ + n >=
@@ -223,6 +245,190 @@ void MidiHost::Detach() {
   midi_manager_ = nullptr;
 }
 
+MidiHost::PendingMessage::PendingMessage(uint32 port,
+                                         const std::vector<uint8>& data,
+                                         double timestamp)
+    : port(port), data(data), timestamp(timestamp) {
+}
+
+MidiHost::PendingMessage::~PendingMessage() {
+}
+
+void MidiHost::CreateSessionRings() {
+  DCHECK_CURRENTLY_ON(BrowserThread::IO);
+  if (send_ring_)
+    return;
+
+  scoped_ptr<MidiMessageRing> send_ring(new MidiMessageRing);
+  scoped_ptr<MidiMessageRing> recv_ring(new MidiMessageRing);
+  base::SharedMemoryHandle send_handle;
+  base::SharedMemoryHandle recv_handle;
+  const size_t size = MidiMessageRing::GetSharedMemorySize();
+  scoped_ptr<base::SharedMemory> send_shm(new base::SharedMemory);
+  scoped_ptr<base::SharedMemory> recv_shm(new base::SharedMemory);
+  if (!send_shm->CreateAndMapAnonymous(size) ||
+      !recv_shm->CreateAndMapAnonymous(size) ||
+      !send_ring->Init(send_shm.Pass(), true) ||
+      !recv_ring->Init(recv_shm.Pass(), true) ||
+      !send_ring->shm()->ShareToProcess(PeerHandle(), &send_handle) ||
+      !recv_ring->shm()->ShareToProcess(PeerHandle(), &recv_handle)) {
+    LOG(ERROR) << "Failed to set up MIDI message rings.";
+    return;
+  }
+
+  Send(new MidiMsg_SessionRings(send_handle, recv_handle));
+  send_ring_ = send_ring.Pass();
+  send_ring_buffer_.resize(MidiMessageRing::kMaxMessageSize);
+  base::AutoLock auto_lock(messages_queues_lock_);
+  recv_ring_ = recv_ring.Pass();
+}
+
+bool MidiHost::SendToMidiManager(uint32 port,
+                                 const std::vector<uint8>& data,
+                                 double timestamp) {
+  {
+    base::AutoLock auto_lock(output_port_count_lock_);
+    if (output_port_count_ <= port) {
+      bad_message::ReceivedBadMessage(this, bad_message::MH_INVALID_MIDI_PORT);
+      return false;
+    }
+  }
+
+  if (data.empty())
+    return true;
+
+  // Blink running in a renderer checks permission to raise a SecurityError
+  // in JavaScript. The actual permission check for security purposes
+  // happens here in the browser process.
+  if (!has_sys_ex_permission_ &&
+      std::find(data.begin(), data.end(), kSysExByte) != data.end()) {
+    bad_message::ReceivedBadMessage(this, bad_message::MH_SYS_EX_PERMISSION);
+    return false;
+  }
+
+  if (!IsValidWebMIDIData(data))
+    return true;
+
+  {
+    base::AutoLock auto_lock(in_flight_lock_);
+    // Sanity check that we won't send too much data.
+    // TODO(yukawa): Consider to send an error event back to the renderer
+    // after some future discussion in W3C.
+    if (data.size() + sent_bytes_in_flight_ > kMaxInFlightBytes)
+      return true;
+    sent_bytes_in_flight_ += data.size();
+  }
+  if (midi_manager_)
+    midi_manager_->DispatchSendMidiData(this, port, data, timestamp);
+  return true;
+}
+
+void MidiHost::DrainSendRing() {
+  DCHECK_CURRENTLY_ON(BrowserThread::IO);
+  TRACE_EVENT0("midi", "MidiHost::DrainSendRing");
+  if (!send_ring_)
+    return;
+
+  bool wake_renderer = false;
+  for (;;) {
+    uint32 size = 0;
+    MidiMessageRing::Status status = send_ring_->Peek(&size);
+    if (status == MidiMessageRing::STATUS_CORRUPT) {
+      // Only the renderer could have done this, and it only hurts itself.
+      send_ring_.reset();
+      large_send_messages_.clear();
+      large_send_bytes_ = 0;
+      return;
+    }
+    if (status != MidiMessageRing::STATUS_OK)
+      break;
+    // An empty message stands in for a MidiHostMsg_SendLargeData which may
+    // not have arrived yet.
+    if (!size && large_send_messages_.empty())
+      break;
+
+    size_t bytes = size ? size : large_send_messages_.front().data.size();
+    {
+      // Leave the messages in the ring rather than dropping them, so that the
+      // renderer is held back by the ring filling up. A message which could
+      // never fit is dropped by SendToMidiManager().
+      base::AutoLock auto_lock(in_flight_lock_);
+      if (bytes <= kMaxInFlightBytes &&
+          bytes + sent_bytes_in_flight_ > kMaxInFlightBytes) {
+        send_ring_stalled_ = true;
+        break;
+      }
+    }
+
+    uint32 port;
+    double timestamp;
+    bool wake_producer;
+    status = send_ring_->Pop(&send_ring_buffer_[0], send_ring_buffer_.size(),
+                             &port, &size, &timestamp, &wake_producer);
+    DCHECK_EQ(MidiMessageRing::STATUS_OK, status);
+    wake_renderer |= wake_producer;
+
+    bool renderer_alive;
+    if (size) {
+      std::vector<uint8> data(send_ring_buffer_.begin(),
+                              send_ring_buffer_.begin() + size);
+      renderer_alive = SendToMidiManager(port, data, timestamp);
+    } else {
+      PendingMessage message = large_send_messages_.front();
+      large_send_messages_.pop_front();
+      large_send_bytes_ -= message.data.size();
+      renderer_alive =
+          SendToMidiManager(message.port, message.data, message.timestamp);
+    }
+    if (!renderer_alive)
+      return;
+  }
+
+  // One wakeup covers all the space made above.
+  if (wake_renderer)
+    Send(new MidiMsg_SendRingSpaceAvailable());
+}
+
+void MidiHost::SendReceivedDataLocked(uint32 port,
+                                      const std::vector<uint8>& data,
+                                      double timestamp) {
+  messages_queues_lock_.AssertAcquired();
+  if (!recv_ring_) {
+    Send(new MidiMsg_DataReceived(port, data, timestamp));
+    return;
+  }
+
+  if (pending_received_messages_.empty() &&
+      PushToRecvRingLocked(port, data, timestamp)) {
+    return;
+  }
+  // The renderer isn't keeping up. Hold on to as much as could be in flight
+  // towards the hardware, and drop the rest.
+  if (data.size() + pending_received_bytes_ > kMaxInFlightBytes)
+    return;
+  pending_received_messages_.push_back(PendingMessage(port, data, timestamp));
+  pending_received_bytes_ += data.size();
+}
+
+bool MidiHost::PushToRecvRingLocked(uint32 port,
+                                    const std::vector<uint8>& data,
+                                    double timestamp) {
+  messages_queues_lock_.AssertAcquired();
+  DCHECK(!data.empty());
+  const bool large = data.size() > MidiMessageRing::kMaxMessageSize;
+  bool wake_consumer;
+  if (!recv_ring_->Push(port, large ? nullptr : &data[0],
+                        large ? 0 : static_cast<uint32>(data.size()), timestamp,
+                        &wake_consumer)) {
+    return false;
+  }
+  if (large)
+    Send(new MidiMsg_LargeDataReceived(port, data, timestamp));
+  if (wake_consumer)
+    Send(new MidiMsg_DataReceivedDoorbell());
+  return true;
+}
+
 // static
 bool MidiHost::IsValidWebMIDIData(const std::vector<uint8>& data) {
   bool in_sysex = false;
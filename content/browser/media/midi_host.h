@@ -5,6 +5,7 @@
 #ifndef CONTENT_BROWSER_MEDIA_MIDI_HOST_H_
 #define CONTENT_BROWSER_MEDIA_MIDI_HOST_H_
 
+#include <deque>
 #include <vector>
 
 #include "base/gtest_prod_util.h"
@@ -27,6 +28,8 @@ class MidiMessageQueue;
 
 namespace content {
 
+class MidiMessageRing;
+
 class CONTENT_EXPORT MidiHost : public BrowserMessageFilter,
                                 public media::midi::MidiManagerClient {
  public:
@@ -62,6 +65,18 @@ class CONTENT_EXPORT MidiHost : public BrowserMessageFilter,
 
   void OnEndSession();
 
+  // The renderer has put data into the send ring.
+  void OnSendRingDoorbell();
+
+  // Data too large for the send ring, which stands in for an empty message in
+  // the ring.
+  void OnSendLargeData(uint32 port,
+                       const std::vector<uint8>& data,
+                       double timestamp);
+
+  // The renderer has made room in the receive ring.
+  void OnRecvRingSpaceAvailable();
+
  protected:
   ~MidiHost() override;
 
@@ -70,6 +85,44 @@ class CONTENT_EXPORT MidiHost : public BrowserMessageFilter,
   friend class base::DeleteHelper<MidiHost>;
   friend class BrowserThread;
 
+  // A message waiting for its turn in one of the rings.
+  struct PendingMessage {
+    PendingMessage(uint32 port,
+                   const std::vector<uint8>& data,
+                   double timestamp);
+    ~PendingMessage();
+
+    uint32 port;
+    std::vector<uint8> data;
+    double timestamp;
+  };
+
+  // Creates the rings, and shares them with the renderer. Does nothing if
+  // they already exist. The renderer keeps using IPC messages if this fails.
+  void CreateSessionRings();
+
+  // Passes data from the renderer to |midi_manager_|, after checking that the
+  // renderer may send it. Returns false if the renderer was killed.
+  bool SendToMidiManager(uint32 port,
+                         const std::vector<uint8>& data,
+                         double timestamp);
+
+  // Sends the messages in |send_ring_| to |midi_manager_|, until the ring is
+  // empty or too many bytes are in flight.
+  void DrainSendRing();
+
+  // Sends a received message to the renderer, through |recv_ring_| if there
+  // is one. Must be called with |messages_queues_lock_| held.
+  void SendReceivedDataLocked(uint32 port,
+                              const std::vector<uint8>& data,
+                              double timestamp);
+
+  // Appends a message to |recv_ring_|. Returns false if the ring is full. Must
+  // be called with |messages_queues_lock_| held.
+  bool PushToRecvRingLocked(uint32 port,
+                            const std::vector<uint8>& data,
+                            double timestamp);
+
   // Returns true if |data| fulfills the requirements of MidiOutput.send API
   // defined in the Web MIDI spec.
   // - |data| must be any number of complete MIDI messages (data abbreviation
@@ -96,9 +149,25 @@ class CONTENT_EXPORT MidiHost : public BrowserMessageFilter,
   // Buffers where data sent from each MIDI input port is stored.
   ScopedVector<media::midi::MidiMessageQueue> received_messages_queues_;
 
-  // Protects access to |received_messages_queues_|;
+  // Carries received messages to the renderer. Messages wait in
+  // |pending_received_messages_| while it's full.
+  scoped_ptr<MidiMessageRing> recv_ring_;
+  std::deque<PendingMessage> pending_received_messages_;
+  size_t pending_received_bytes_;
+
+  // Protects access to |received_messages_queues_|, |recv_ring_| and
+  // |pending_received_messages_|.
   base::Lock messages_queues_lock_;
 
+  // Carries the messages the renderer sends. Only used on the IO thread.
+  scoped_ptr<MidiMessageRing> send_ring_;
+  std::vector<uint8> send_ring_buffer_;
+
+  // Messages from MidiHostMsg_SendLargeData whose place in |send_ring_| hasn't
+  // been reached yet. Only used on the IO thread.
+  std::deque<PendingMessage> large_send_messages_;
+  size_t large_send_bytes_;
+
   // The number of bytes sent to the platform-specific MIDI sending
   // system, but not yet completed.
   size_t sent_bytes_in_flight_;
@@ -107,7 +176,11 @@ class CONTENT_EXPORT MidiHost : public BrowserMessageFilter,
   // we've acknowledged back to the renderer.
   size_t bytes_sent_since_last_acknowledgement_;
 
-  // Protects access to |sent_bytes_in_flight_|.
+  // True if DrainSendRing() stopped because too many bytes were in flight. It
+  // resumes once the MIDI manager reports that bytes were sent.
+  bool send_ring_stalled_;
+
+  // Protects access to |sent_bytes_in_flight_| and |send_ring_stalled_|.
   base::Lock in_flight_lock_;
 
   // How many output port exists.
@@ -4,9 +4,13 @@
 
 #include "content/browser/media/midi_host.h"
 
+#include "base/memory/scoped_vector.h"
+#include "base/memory/shared_memory.h"
 #include "base/message_loop/message_loop.h"
+#include "base/process/process.h"
 #include "base/run_loop.h"
 #include "base/strings/stringprintf.h"
+#include "content/common/media/midi_message_ring.h"
 #include "content/common/media/midi_messages.h"
 #include "content/public/test/test_browser_thread.h"
 #include "media/midi/midi_manager.h"
@@ -85,7 +89,21 @@ class MidiHostForTesting : public MidiHost {
  public:
   MidiHostForTesting(int renderer_process_id,
                      media::midi::MidiManager* midi_manager)
-      : MidiHost(renderer_process_id, midi_manager) {}
+      : MidiHost(renderer_process_id, midi_manager) {
+    set_peer_process_for_testing(base::Process::Current());
+  }
+
+  // Returns the messages sent to the renderer since the last call.
+  void TakeSentMessages(ScopedVector<IPC::Message>* messages) {
+    messages->swap(sent_messages_);
+    sent_messages_.clear();
+  }
+
+  // BrowserMessageFilter implementation.
+  bool Send(IPC::Message* message) override {
+    sent_messages_.push_back(message);
+    return true;
+  }
 
  private:
   ~MidiHostForTesting() override {}
@@ -121,16 +139,64 @@ class MidiHostTest : public testing::Test {
     host_->AddOutputPort(info);
   }
 
+  void AddInputPort() {
+    media::midi::MidiPortInfo info("input", "yukatan", "doki-doki-pi-pine",
+                                   "3.14159265359",
+                                   media::midi::MIDI_PORT_CONNECTED);
+    host_->AddInputPort(info);
+  }
+
   void OnSendData(uint32 port) {
     scoped_ptr<IPC::Message> message(
         new MidiHostMsg_SendData(port, data_, 0.0));
     host_->OnMessageReceived(*message.get());
   }
 
+  // Starts a session, and maps the rings the host shares, as the renderer
+  // would.
+  void StartSessionWithRings() {
+    host_->OnMessageReceived(MidiHostMsg_StartSession());
+    RunLoopUntilIdle();
+
+    ScopedVector<IPC::Message> messages;
+    host_->TakeSentMessages(&messages);
+    const IPC::Message* rings = nullptr;
+    for (const IPC::Message* message : messages) {
+      if (message->type() == MidiMsg_SessionRings::ID) {
+        rings = message;
+        break;
+      }
+    }
+    ASSERT_TRUE(rings);
+    MidiMsg_SessionRings::Schema::Param param;
+    ASSERT_TRUE(MidiMsg_SessionRings::Read(rings, &param));
+    ASSERT_TRUE(send_ring_.Init(
+        make_scoped_ptr(new base::SharedMemory(base::get<0>(param), false)),
+        false));
+    ASSERT_TRUE(recv_ring_.Init(
+        make_scoped_ptr(new base::SharedMemory(base::get<1>(param), false)),
+        false));
+  }
+
+  // Returns how many messages of type |id| were sent to the renderer since the
+  // last call.
+  size_t CountSentMessages(uint32 id) {
+    ScopedVector<IPC::Message> messages;
+    host_->TakeSentMessages(&messages);
+    size_t count = 0;
+    for (const IPC::Message* message : messages) {
+      if (message->type() == id)
+        ++count;
+    }
+    return count;
+  }
+
   size_t GetEventSize() const {
     return manager_.events_.size();
   }
 
+  const MidiEvent& EventAt(size_t at) const { return manager_.events_[at]; }
+
   void CheckSendEventAt(size_t at, uint32 port) {
     EXPECT_EQ(DISPATCH_SEND_MIDI_DATA, manager_.events_[at].type);
     EXPECT_EQ(port, manager_.events_[at].port_index);
@@ -143,6 +209,12 @@ class MidiHostTest : public testing::Test {
     run_loop.RunUntilIdle();
   }
 
+  MidiHostForTesting* host() { return host_.get(); }
+
+  // The renderer's ends of the rings.
+  MidiMessageRing send_ring_;
+  MidiMessageRing recv_ring_;
+
  private:
   base::MessageLoop message_loop_;
   TestBrowserThread io_browser_thread_;
@@ -234,4 +306,93 @@ TEST_F(MidiHostTest, OutputPortCheck) {
   CheckSendEventAt(2, port1);
 }
 
+// Test that a burst of messages through the send ring costs one doorbell, and
+// reaches the MIDI manager in order with exact timestamps.
+TEST_F(MidiHostTest, SendThroughRing) {
+  AddOutputPort();
+  StartSessionWithRings();
+
+  const int kMessages = 1000;
+  int doorbells = 0;
+  for (int i = 0; i < kMessages; ++i) {
+    bool wake_consumer;
+    ASSERT_TRUE(send_ring_.Push(0, kNoteOn, sizeof(kNoteOn), i / 1000.0,
+                                &wake_consumer));
+    if (wake_consumer)
+      ++doorbells;
+  }
+  EXPECT_EQ(1, doorbells);
+  host()->OnMessageReceived(MidiHostMsg_SendRingDoorbell());
+
+  ASSERT_EQ(static_cast<size_t>(kMessages), GetEventSize());
+  for (int i = 0; i < kMessages; ++i) {
+    EXPECT_EQ(AsVector(kNoteOn), EventAt(i).data);
+    EXPECT_EQ(i / 1000.0, EventAt(i).timestamp);
+  }
+  // Nothing was waiting for space, so there's nothing to wake up.
+  EXPECT_EQ(0u, CountSentMessages(MidiMsg_SendRingSpaceAvailable::ID));
+}
+
+// Test that a message too large for the send ring keeps its place.
+TEST_F(MidiHostTest, LargeMessageKeepsItsPlace) {
+  AddOutputPort();
+  StartSessionWithRings();
+
+  std::vector<uint8> large;
+  while (large.size() <= MidiMessageRing::kMaxMessageSize)
+    PushToVector(kNoteOn, &large);
+
+  bool wake_consumer;
+  ASSERT_TRUE(send_ring_.Push(0, kNoteOn, sizeof(kNoteOn), 1.0,
+                              &wake_consumer));
+  ASSERT_TRUE(send_ring_.Push(0, NULL, 0, 2.0, &wake_consumer));
+  ASSERT_TRUE(send_ring_.Push(0, kChannelPressure, sizeof(kChannelPressure),
+                              3.0, &wake_consumer));
+
+  // The host waits for the large message before going on.
+  host()->OnMessageReceived(MidiHostMsg_SendRingDoorbell());
+  ASSERT_EQ(1U, GetEventSize());
+  host()->OnMessageReceived(MidiHostMsg_SendLargeData(0, large, 2.0));
+
+  ASSERT_EQ(3U, GetEventSize());
+  EXPECT_EQ(AsVector(kNoteOn), EventAt(0).data);
+  EXPECT_EQ(large, EventAt(1).data);
+  EXPECT_EQ(2.0, EventAt(1).timestamp);
+  EXPECT_EQ(AsVector(kChannelPressure), EventAt(2).data);
+}
+
+// Test that received data waits for space in the receive ring instead of
+// being dropped, and that the renderer is woken up once per burst.
+TEST_F(MidiHostTest, ReceiveThroughRing) {
+  AddInputPort();
+  StartSessionWithRings();
+
+  // Far more than fits into the ring at once.
+  const int kMessages = 50000;
+  for (int i = 0; i < kMessages; ++i)
+    host()->ReceiveMidiData(0, kNoteOn, sizeof(kNoteOn), i);
+  EXPECT_EQ(1u, CountSentMessages(MidiMsg_DataReceivedDoorbell::ID));
+
+  int received = 0;
+  uint8 buffer[sizeof(kNoteOn)];
+  for (;;) {
+    const int received_before = received;
+    uint32 port;
+    uint32 size;
+    double timestamp;
+    bool wake_producer = false;
+    while (recv_ring_.Pop(buffer, sizeof(buffer), &port, &size, &timestamp,
+                          &wake_producer) == MidiMessageRing::STATUS_OK) {
+      EXPECT_EQ(static_cast<double>(received), timestamp);
+      ++received;
+    }
+    if (received == kMessages)
+      break;
+    // The renderer tells the host about the space it made.
+    ASSERT_LT(received_before, received);
+    host()->OnMessageReceived(MidiHostMsg_RecvRingSpaceAvailable());
+  }
+  EXPECT_EQ(kMessages, received);
+}
+
 }  // namespace conent
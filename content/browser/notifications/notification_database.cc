@@ -31,13 +31,24 @@
 //
 // key: "NEXT_NOTIFICATION_ID"
 // value: Decimal string which fits into an int64_t.
+//
+// key: "REGISTRATION:" <origin identifier> '\x00'
+//          <service_worker_registration_id> '\x00' <notification_id>
+// value: Empty. Indexes the notifications of a Service Worker registration,
+//        and is always written and deleted together with the "DATA:" entry.
+//
+// key: "SCHEMA_VERSION"
+// value: Decimal string of the schema version. Databases without it predate
+//        the "REGISTRATION:" index, which is built when they are opened.
 
 namespace content {
 namespace {
 
 // Keys of the fields defined in the database.
 const char kNextNotificationIdKey[] = "NEXT_NOTIFICATION_ID";
+const char kSchemaVersionKey[] = "SCHEMA_VERSION";
 const char kDataKeyPrefix[] = "DATA:";
+const char kRegistrationIndexKeyPrefix[] = "REGISTRATION:";
 
 // Separates the components of compound keys.
 const char kKeySeparator = '\x00';
@@ -45,6 +56,10 @@ const char kKeySeparator = '\x00';
 // The first notification id which to be handed out by the database.
 const int64_t kFirstNotificationId = 1;
 
+// The current version of the database schema. Version 1 introduced the
+// "REGISTRATION:" index.
+const int64_t kCurrentSchemaVersion = 1;
+
 // Converts the LevelDB |status| to one of the notification database's values.
 NotificationDatabase::Status LevelDBStatusToStatus(
     const leveldb::Status& status) {
@@ -79,6 +94,45 @@ std::string CreateDataKey(const GURL& origin, int64_t notification_id) {
   return CreateDataPrefix(origin) + base::Int64ToString(notification_id);
 }
 
+// Creates a prefix for the registration index entries of |origin|.
+std::string CreateRegistrationIndexPrefix(const GURL& origin) {
+  DCHECK(origin.is_valid());
+  return base::StringPrintf("%s%s%c", kRegistrationIndexKeyPrefix,
+                            storage::GetIdentifierFromOrigin(origin).c_str(),
+                            kKeySeparator);
+}
+
+// Creates a prefix for the registration index entries of the Service Worker
+// registration identified by |service_worker_registration_id|.
+std::string CreateRegistrationIndexPrefix(
+    const GURL& origin,
+    int64_t service_worker_registration_id) {
+  return base::StringPrintf(
+      "%s%s%c", CreateRegistrationIndexPrefix(origin).c_str(),
+      base::Int64ToString(service_worker_registration_id).c_str(),
+      kKeySeparator);
+}
+
+// Creates the registration index key for |notification_id|.
+std::string CreateRegistrationIndexKey(const GURL& origin,
+                                       int64_t service_worker_registration_id,
+                                       int64_t notification_id) {
+  return CreateRegistrationIndexPrefix(origin,
+                                       service_worker_registration_id) +
+         base::Int64ToString(notification_id);
+}
+
+// Parses the notification id at the end of |key|, following |prefix|.
+bool ParseNotificationIdFromKey(const leveldb::Slice& key,
+                                const leveldb::Slice& prefix,
+                                int64_t* notification_id) {
+  DCHECK(key.starts_with(prefix));
+  leveldb::Slice notification_id_slice = key;
+  notification_id_slice.remove_prefix(prefix.size());
+  return base::StringToInt64(notification_id_slice.ToString(),
+                             notification_id);
+}
+
 // Deserializes data in |serialized_data| to |notification_database_data|.
 // Will return if the deserialization was successful.
 NotificationDatabase::Status DeserializedNotificationData(
@@ -136,7 +190,11 @@ NotificationDatabase::Status NotificationDatabase::Open(
   state_ = STATE_INITIALIZED;
   db_.reset(db);
 
-  return ReadNextNotificationId();
+  status = ReadNextNotificationId();
+  if (status != STATUS_OK)
+    return status;
+
+  return MigrateSchemaIfNeeded();
 }
 
 NotificationDatabase::Status NotificationDatabase::ReadNotificationData(
@@ -164,7 +222,6 @@ NotificationDatabase::Status NotificationDatabase::ReadNotificationData(
 NotificationDatabase::Status NotificationDatabase::ReadAllNotificationData(
     std::vector<NotificationDatabaseData>* notification_data_vector) const {
   return ReadAllNotificationDataInternal(GURL() /* origin */,
-                                         kInvalidServiceWorkerRegistrationId,
                                          notification_data_vector);
 }
 
@@ -172,8 +229,7 @@ NotificationDatabase::Status
 NotificationDatabase::ReadAllNotificationDataForOrigin(
     const GURL& origin,
     std::vector<NotificationDatabaseData>* notification_data_vector) const {
-  return ReadAllNotificationDataInternal(
-      origin, kInvalidServiceWorkerRegistrationId, notification_data_vector);
+  return ReadAllNotificationDataInternal(origin, notification_data_vector);
 }
 
 NotificationDatabase::Status
@@ -181,8 +237,49 @@ NotificationDatabase::ReadAllNotificationDataForServiceWorkerRegistration(
     const GURL& origin,
     int64_t service_worker_registration_id,
     std::vector<NotificationDatabaseData>* notification_data_vector) const {
-  return ReadAllNotificationDataInternal(origin, service_worker_registration_id,
-                                         notification_data_vector);
+  DCHECK(sequence_checker_.CalledOnValidSequencedThread());
+  DCHECK(notification_data_vector);
+  DCHECK(origin.is_valid());
+
+  // Only the notifications listed in the registration index are read and
+  // deserialized, rather than everything stored for |origin|.
+  const std::string prefix =
+      CreateRegistrationIndexPrefix(origin, service_worker_registration_id);
+
+  leveldb::Slice prefix_slice(prefix);
+
+  std::string serialized_data;
+  NotificationDatabaseData notification_database_data;
+  scoped_ptr<leveldb::Iterator> iter(db_->NewIterator(leveldb::ReadOptions()));
+  for (iter->Seek(prefix_slice); iter->Valid(); iter->Next()) {
+    if (!iter->key().starts_with(prefix_slice))
+      break;
+
+    int64_t notification_id = 0;
+    if (!ParseNotificationIdFromKey(iter->key(), prefix_slice,
+                                    &notification_id)) {
+      return STATUS_ERROR_CORRUPTED;
+    }
+
+    Status status = LevelDBStatusToStatus(
+        db_->Get(leveldb::ReadOptions(), CreateDataKey(origin, notification_id),
+                 &serialized_data));
+    if (status == STATUS_ERROR_NOT_FOUND) {
+      // The index and the data are always written together.
+      return STATUS_ERROR_CORRUPTED;
+    }
+    if (status != STATUS_OK)
+      return status;
+
+    status = DeserializedNotificationData(serialized_data,
+                                          &notification_database_data);
+    if (status != STATUS_OK)
+      return status;
+
+    notification_data_vector->push_back(notification_database_data);
+  }
+
+  return LevelDBStatusToStatus(iter->status());
 }
 
 NotificationDatabase::Status NotificationDatabase::WriteNotificationData(
@@ -208,6 +305,10 @@ NotificationDatabase::Status NotificationDatabase::WriteNotificationData(
 
   leveldb::WriteBatch batch;
   batch.Put(CreateDataKey(origin, next_notification_id_), serialized_data);
+  batch.Put(CreateRegistrationIndexKey(
+                origin, storage_data.service_worker_registration_id,
+                next_notification_id_),
+            leveldb::Slice());
   batch.Put(kNextNotificationIdKey,
             base::Int64ToString(next_notification_id_ + 1));
 
@@ -229,7 +330,29 @@ NotificationDatabase::Status NotificationDatabase::DeleteNotificationData(
   DCHECK(origin.is_valid());
 
   std::string key = CreateDataKey(origin, notification_id);
-  return LevelDBStatusToStatus(db_->Delete(leveldb::WriteOptions(), key));
+
+  // The registration id, needed to find the index entry, is only stored in
+  // the notification's data.
+  std::string serialized_data;
+  Status status = LevelDBStatusToStatus(
+      db_->Get(leveldb::ReadOptions(), key, &serialized_data));
+  if (status == STATUS_ERROR_NOT_FOUND)
+    return STATUS_OK;
+  if (status != STATUS_OK)
+    return status;
+
+  leveldb::WriteBatch batch;
+  batch.Delete(key);
+
+  NotificationDatabaseData notification_database_data;
+  if (DeserializedNotificationData(serialized_data,
+                                   &notification_database_data) == STATUS_OK) {
+    batch.Delete(CreateRegistrationIndexKey(
+        origin, notification_database_data.service_worker_registration_id,
+        notification_id));
+  }
+
+  return LevelDBStatusToStatus(db_->Write(leveldb::WriteOptions(), &batch));
 }
 
 NotificationDatabase::Status
@@ -267,6 +390,66 @@ NotificationDatabase::Status NotificationDatabase::Destroy() {
       leveldb::DestroyDB(path_.AsUTF8Unsafe(), options));
 }
 
+NotificationDatabase::Status NotificationDatabase::MigrateSchemaIfNeeded() {
+  std::string value;
+  Status status = LevelDBStatusToStatus(
+      db_->Get(leveldb::ReadOptions(), kSchemaVersionKey, &value));
+
+  int64_t schema_version = 0;
+  if (status == STATUS_OK) {
+    if (!base::StringToInt64(value, &schema_version) || schema_version < 1)
+      return STATUS_ERROR_CORRUPTED;
+  } else if (status != STATUS_ERROR_NOT_FOUND) {
+    return status;
+  }
+
+  if (schema_version >= kCurrentSchemaVersion)
+    return STATUS_OK;
+
+  // Build the registration index for the existing notifications. The index
+  // and the new schema version are written in a single batch, so an
+  // interrupted migration will simply be redone on the next Open().
+  const leveldb::Slice data_prefix_slice(kDataKeyPrefix);
+  const leveldb::Slice index_prefix_slice(kRegistrationIndexKeyPrefix);
+
+  leveldb::WriteBatch batch;
+  NotificationDatabaseData notification_database_data;
+  scoped_ptr<leveldb::Iterator> iter(db_->NewIterator(leveldb::ReadOptions()));
+  for (iter->Seek(data_prefix_slice); iter->Valid(); iter->Next()) {
+    if (!iter->key().starts_with(data_prefix_slice))
+      break;
+
+    status = DeserializedNotificationData(iter->value().ToString(),
+                                          &notification_database_data);
+    if (status != STATUS_OK)
+      return status;
+
+    // Data keys are "DATA:" <origin identifier> '\x00' <notification_id>, so
+    // the index key can be derived without parsing the origin.
+    std::string key = iter->key().ToString();
+    size_t separator = key.rfind(kKeySeparator);
+    if (separator == std::string::npos)
+      return STATUS_ERROR_CORRUPTED;
+
+    std::string index_key = index_prefix_slice.ToString();
+    index_key.append(key, data_prefix_slice.size(),
+                     separator + 1 - data_prefix_slice.size());
+    index_key.append(base::Int64ToString(
+        notification_database_data.service_worker_registration_id));
+    index_key.push_back(kKeySeparator);
+    index_key.append(key, separator + 1, std::string::npos);
+
+    batch.Put(index_key, leveldb::Slice());
+  }
+
+  status = LevelDBStatusToStatus(iter->status());
+  if (status != STATUS_OK)
+    return status;
+
+  batch.Put(kSchemaVersionKey, base::Int64ToString(kCurrentSchemaVersion));
+  return LevelDBStatusToStatus(db_->Write(leveldb::WriteOptions(), &batch));
+}
+
 NotificationDatabase::Status NotificationDatabase::ReadNextNotificationId() {
   std::string value;
   Status status = LevelDBStatusToStatus(
@@ -291,7 +474,6 @@ NotificationDatabase::Status NotificationDatabase::ReadNextNotificationId() {
 NotificationDatabase::Status
 NotificationDatabase::ReadAllNotificationDataInternal(
     const GURL& origin,
-    int64_t service_worker_registration_id,
     std::vector<NotificationDatabaseData>* notification_data_vector) const {
   DCHECK(sequence_checker_.CalledOnValidSequencedThread());
   DCHECK(notification_data_vector);
@@ -311,12 +493,6 @@ NotificationDatabase::ReadAllNotificationDataInternal(
     if (status != STATUS_OK)
       return status;
 
-    if (service_worker_registration_id != kInvalidServiceWorkerRegistrationId &&
-        notification_database_data.service_worker_registration_id !=
-            service_worker_registration_id) {
-      continue;
-    }
-
     notification_data_vector->push_back(notification_database_data);
   }
 
@@ -332,42 +508,62 @@ NotificationDatabase::DeleteAllNotificationDataInternal(
   DCHECK(deleted_notification_set);
   DCHECK(origin.is_valid());
 
-  const std::string prefix = CreateDataPrefix(origin);
-
-  leveldb::Slice prefix_slice(prefix);
   leveldb::WriteBatch batch;
-
-  NotificationDatabaseData notification_database_data;
   scoped_ptr<leveldb::Iterator> iter(db_->NewIterator(leveldb::ReadOptions()));
-  for (iter->Seek(prefix_slice); iter->Valid(); iter->Next()) {
-    if (!iter->key().starts_with(prefix_slice))
-      break;
 
-    if (service_worker_registration_id != kInvalidServiceWorkerRegistrationId) {
-      Status status = DeserializedNotificationData(iter->value().ToString(),
-                                                   &notification_database_data);
-      if (status != STATUS_OK)
-        return status;
+  if (service_worker_registration_id != kInvalidServiceWorkerRegistrationId) {
+    // The registration index lists exactly the notifications to delete, so
+    // none of their data has to be read.
+    const std::string prefix =
+        CreateRegistrationIndexPrefix(origin, service_worker_registration_id);
+
+    leveldb::Slice prefix_slice(prefix);
+    for (iter->Seek(prefix_slice); iter->Valid(); iter->Next()) {
+      if (!iter->key().starts_with(prefix_slice))
+        break;
+
+      int64_t notification_id = 0;
+      if (!ParseNotificationIdFromKey(iter->key(), prefix_slice,
+                                      &notification_id)) {
+        return STATUS_ERROR_CORRUPTED;
+      }
 
-      if (notification_database_data.service_worker_registration_id !=
-          service_worker_registration_id) {
-        continue;
+      deleted_notification_set->insert(notification_id);
+      batch.Delete(CreateDataKey(origin, notification_id));
+      batch.Delete(iter->key());
+    }
+  } else {
+    const std::string data_prefix = CreateDataPrefix(origin);
+    const std::string index_prefix = CreateRegistrationIndexPrefix(origin);
+
+    leveldb::Slice data_prefix_slice(data_prefix);
+    for (iter->Seek(data_prefix_slice); iter->Valid(); iter->Next()) {
+      if (!iter->key().starts_with(data_prefix_slice))
+        break;
+
+      int64_t notification_id = 0;
+      if (!ParseNotificationIdFromKey(iter->key(), data_prefix_slice,
+                                      &notification_id)) {
+        return STATUS_ERROR_CORRUPTED;
       }
+
+      deleted_notification_set->insert(notification_id);
+      batch.Delete(iter->key());
     }
 
-    leveldb::Slice notification_id_slice = iter->key();
-    notification_id_slice.remove_prefix(prefix_slice.size());
+    leveldb::Slice index_prefix_slice(index_prefix);
+    for (iter->Seek(index_prefix_slice); iter->Valid(); iter->Next()) {
+      if (!iter->key().starts_with(index_prefix_slice))
+        break;
 
-    int64_t notification_id = 0;
-    if (!base::StringToInt64(notification_id_slice.ToString(),
-                             &notification_id)) {
-      return STATUS_ERROR_CORRUPTED;
+      batch.Delete(iter->key());
     }
-
-    deleted_notification_set->insert(notification_id);
-    batch.Delete(iter->key());
   }
 
+  Status status = LevelDBStatusToStatus(iter->status());
+  if (status != STATUS_OK)
+    return status;
+
   if (deleted_notification_set->empty())
     return STATUS_OK;
 
@@ -148,14 +148,17 @@ class CONTENT_EXPORT NotificationDatabase {
   // the |next_notification_id_| member.
   Status ReadNextNotificationId();
 
+  // Brings a database written by an older version up to the current schema,
+  // building the Service Worker registration index when it is missing.
+  // Returns the status code of the migration.
+  Status MigrateSchemaIfNeeded();
+
   // Reads all notification data with the given constraints. |origin| may be
-  // empty to read all notification data from all origins. If |origin| is
-  // set, but |service_worker_registration_id| is invalid, then all notification
-  // data for |origin| will be read. If both are set, then all notification data
-  // for the given |service_worker_registration_id| will be read.
+  // empty to read all notification data from all origins. Reading the data for
+  // a single Service Worker registration goes through the registration index
+  // instead, see ReadAllNotificationDataForServiceWorkerRegistration().
   Status ReadAllNotificationDataInternal(
       const GURL& origin,
-      int64_t service_worker_registration_id,
       std::vector<NotificationDatabaseData>* notification_data_vector) const;
 
   // Deletes all notification data with the given constraints. |origin| must
@@ -0,0 +1,117 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "content/browser/notifications/notification_database.h"
+
+#include <set>
+#include <vector>
+
+#include "base/files/file_path.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/time/time.h"
+#include "content/public/browser/notification_database_data.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_test.h"
+#include "url/gurl.h"
+
+namespace content {
+namespace {
+
+const int kServiceWorkerRegistrations = 100;
+const int kNotificationsPerRegistration = 50;
+const int kTimeLimitMs = 2000;
+
+class NotificationDatabasePerfTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    database_.reset(new NotificationDatabase(base::FilePath()));
+    ASSERT_EQ(NotificationDatabase::STATUS_OK,
+              database_->Open(true /* create_if_missing */));
+
+    // All notifications belong to a single origin, interleaved across its
+    // Service Worker registrations.
+    NotificationDatabaseData database_data;
+    database_data.origin = origin_;
+    int64_t notification_id = 0;
+    for (int i = 0; i < kNotificationsPerRegistration; ++i) {
+      for (int registration = 0; registration < kServiceWorkerRegistrations;
+           ++registration) {
+        database_data.service_worker_registration_id = registration;
+        ASSERT_EQ(NotificationDatabase::STATUS_OK,
+                  database_->WriteNotificationData(origin_, database_data,
+                                                   &notification_id));
+      }
+    }
+  }
+
+  GURL origin_ = GURL("https://example.com");
+  scoped_ptr<NotificationDatabase> database_;
+};
+
+TEST_F(NotificationDatabasePerfTest, ReadAllForServiceWorkerRegistration) {
+  std::vector<NotificationDatabaseData> notifications;
+  int reads = 0;
+  base::TimeTicks start = base::TimeTicks::Now();
+  base::TimeDelta elapsed;
+  do {
+    notifications.clear();
+    ASSERT_EQ(NotificationDatabase::STATUS_OK,
+              database_->ReadAllNotificationDataForServiceWorkerRegistration(
+                  origin_, reads % kServiceWorkerRegistrations,
+                  &notifications));
+    ASSERT_EQ(static_cast<size_t>(kNotificationsPerRegistration),
+              notifications.size());
+    ++reads;
+    elapsed = base::TimeTicks::Now() - start;
+  } while (elapsed.InMilliseconds() < kTimeLimitMs);
+
+  perf_test::PrintResult("notification_database_read_registration", "",
+                         "5000_notifications",
+                         elapsed.InMicroseconds() / static_cast<double>(reads),
+                         "us/read", true);
+}
+
+TEST_F(NotificationDatabasePerfTest, ReadAllForOrigin) {
+  std::vector<NotificationDatabaseData> notifications;
+  int reads = 0;
+  base::TimeTicks start = base::TimeTicks::Now();
+  base::TimeDelta elapsed;
+  do {
+    notifications.clear();
+    ASSERT_EQ(NotificationDatabase::STATUS_OK,
+              database_->ReadAllNotificationDataForOrigin(origin_,
+                                                          &notifications));
+    ++reads;
+    elapsed = base::TimeTicks::Now() - start;
+  } while (elapsed.InMilliseconds() < kTimeLimitMs);
+
+  perf_test::PrintResult("notification_database_read_origin", "",
+                         "5000_notifications",
+                         elapsed.InMicroseconds() / static_cast<double>(reads),
+                         "us/read", true);
+}
+
+TEST_F(NotificationDatabasePerfTest, DeleteAllForServiceWorkerRegistration) {
+  std::set<int64_t> deleted_notification_set;
+  base::TimeTicks start = base::TimeTicks::Now();
+  for (int registration = 0; registration < kServiceWorkerRegistrations;
+       ++registration) {
+    deleted_notification_set.clear();
+    ASSERT_EQ(NotificationDatabase::STATUS_OK,
+              database_->DeleteAllNotificationDataForServiceWorkerRegistration(
+                  origin_, registration, &deleted_notification_set));
+    ASSERT_EQ(static_cast<size_t>(kNotificationsPerRegistration),
+              deleted_notification_set.size());
+  }
+  base::TimeDelta elapsed = base::TimeTicks::Now() - start;
+
+  perf_test::PrintResult(
+      "notification_database_delete_registration", "", "5000_notifications",
+      elapsed.InMicroseconds() /
+          static_cast<double>(kServiceWorkerRegistrations),
+      "us/delete", true);
+}
+
+}  // namespace
+}  // namespace content
@@ -90,6 +90,22 @@ class NotificationDatabaseTest : public ::testing::Test {
         database->GetDBForTesting()->Put(leveldb::WriteOptions(), key, value);
     ASSERT_TRUE(status.ok());
   }
+
+  // Deletes all LevelDB keys starting with |prefix| directly from the LevelDB
+  // backing the notification database in |database|.
+  void DeleteLevelDBKeysWithPrefix(NotificationDatabase* database,
+                                   const std::string& prefix) {
+    leveldb::DB* db = database->GetDBForTesting();
+    leveldb::WriteBatch batch;
+    scoped_ptr<leveldb::Iterator> iter(db->NewIterator(leveldb::ReadOptions()));
+    for (iter->Seek(prefix); iter->Valid(); iter->Next()) {
+      if (!iter->key().starts_with(prefix))
+        break;
+      batch.Delete(iter->key());
+    }
+    ASSERT_TRUE(iter->status().ok());
+    ASSERT_TRUE(db->Write(leveldb::WriteOptions(), &batch).ok());
+  }
 };
 
 TEST_F(NotificationDatabaseTest, OpenCloseMemory) {
@@ -568,4 +584,109 @@ TEST_F(NotificationDatabaseTest,
   EXPECT_EQ(0u, notifications.size());
 }
 
+TEST_F(NotificationDatabaseTest,
+       DeleteNotificationDataRemovesRegistrationIndexEntry) {
+  scoped_ptr<NotificationDatabase> database(CreateDatabaseInMemory());
+  ASSERT_EQ(NotificationDatabase::STATUS_OK,
+            database->Open(true /* create_if_missing */));
+
+  GURL origin("https://example.com");
+
+  int64_t notification_id = 0;
+  ASSERT_NO_FATAL_FAILURE(CreateAndWriteNotification(
+      database.get(), origin, kExampleServiceWorkerRegistrationId,
+      &notification_id));
+
+  ASSERT_EQ(NotificationDatabase::STATUS_OK,
+            database->DeleteNotificationData(notification_id, origin));
+
+  // A stale index entry would point at the deleted data, and make the read
+  // fail as corrupted.
+  std::vector<NotificationDatabaseData> notifications;
+  ASSERT_EQ(NotificationDatabase::STATUS_OK,
+            database->ReadAllNotificationDataForServiceWorkerRegistration(
+                origin, kExampleServiceWorkerRegistrationId, &notifications));
+
+  EXPECT_EQ(0u, notifications.size());
+}
+
+TEST_F(NotificationDatabaseTest,
+       DeleteAllNotificationDataForOriginRemovesRegistrationIndex) {
+  scoped_ptr<NotificationDatabase> database(CreateDatabaseInMemory());
+  ASSERT_EQ(NotificationDatabase::STATUS_OK,
+            database->Open(true /* create_if_missing */));
+
+  ASSERT_NO_FATAL_FAILURE(PopulateDatabaseWithExampleData(database.get()));
+
+  GURL origin("https://example.com:443");
+
+  std::set<int64_t> deleted_notification_set;
+  ASSERT_EQ(NotificationDatabase::STATUS_OK,
+            database->DeleteAllNotificationDataForOrigin(
+                origin, &deleted_notification_set));
+
+  std::vector<NotificationDatabaseData> notifications;
+  ASSERT_EQ(NotificationDatabase::STATUS_OK,
+            database->ReadAllNotificationDataForServiceWorkerRegistration(
+                origin, kExampleServiceWorkerRegistrationId, &notifications));
+
+  EXPECT_EQ(0u, notifications.size());
+
+  // Notifications for the registration in other origins are not affected.
+  ASSERT_EQ(NotificationDatabase::STATUS_OK,
+            database->ReadAllNotificationDataForServiceWorkerRegistration(
+                GURL("https://chrome.com"), kExampleServiceWorkerRegistrationId,
+                &notifications));
+
+  EXPECT_EQ(1u, notifications.size());
+}
+
+TEST_F(NotificationDatabaseTest, MigrateRegistrationIndex) {
+  base::ScopedTempDir database_dir;
+  ASSERT_TRUE(database_dir.CreateUniqueTempDir());
+
+  scoped_ptr<NotificationDatabase> database(
+      CreateDatabaseOnFileSystem(database_dir.path()));
+
+  ASSERT_EQ(NotificationDatabase::STATUS_OK,
+            database->Open(true /* create_if_missing */));
+
+  ASSERT_NO_FATAL_FAILURE(PopulateDatabaseWithExampleData(database.get()));
+
+  // Turn the database into one written before the registration index existed.
+  ASSERT_NO_FATAL_FAILURE(
+      DeleteLevelDBKeysWithPrefix(database.get(), "REGISTRATION:"));
+  ASSERT_NO_FATAL_FAILURE(
+      DeleteLevelDBKeysWithPrefix(database.get(), "SCHEMA_VERSION"));
+
+  GURL origin("https://example.com:443");
+
+  std::vector<NotificationDatabaseData> notifications;
+  ASSERT_EQ(NotificationDatabase::STATUS_OK,
+            database->ReadAllNotificationDataForServiceWorkerRegistration(
+                origin, kExampleServiceWorkerRegistrationId, &notifications));
+  EXPECT_EQ(0u, notifications.size());
+
+  // Re-opening the database builds the index for the existing notifications.
+  database.reset(CreateDatabaseOnFileSystem(database_dir.path()));
+  ASSERT_EQ(NotificationDatabase::STATUS_OK,
+            database->Open(false /* create_if_missing */));
+
+  ASSERT_EQ(NotificationDatabase::STATUS_OK,
+            database->ReadAllNotificationDataForServiceWorkerRegistration(
+                origin, kExampleServiceWorkerRegistrationId, &notifications));
+  EXPECT_EQ(2u, notifications.size());
+  for (const NotificationDatabaseData& notification : notifications) {
+    EXPECT_EQ(kExampleServiceWorkerRegistrationId,
+              notification.service_worker_registration_id);
+  }
+
+  std::set<int64_t> deleted_notification_set;
+  ASSERT_EQ(NotificationDatabase::STATUS_OK,
+            database->DeleteAllNotificationDataForServiceWorkerRegistration(
+                origin, kExampleServiceWorkerRegistrationId,
+                &deleted_notification_set));
+  EXPECT_EQ(2u, deleted_notification_set.size());
+}
+
 }  // namespace content
@@ -4,11 +4,14 @@
 
 #include "content/browser/plugin_loader_posix.h"
 
+#include <algorithm>
+
 #include "base/bind.h"
 #include "base/location.h"
 #include "base/metrics/histogram.h"
 #include "base/single_thread_task_runner.h"
 #include "base/thread_task_runner_handle.h"
+#include "content/browser/plugin_scan_cache_posix.h"
 #include "content/browser/utility_process_host_impl.h"
 #include "content/common/child_process_host_impl.h"
 #include "content/common/plugin_list.h"
@@ -20,7 +23,15 @@
 namespace content {
 
 PluginLoaderPosix::PluginLoaderPosix()
-    : next_load_index_(0), loading_plugins_(false) {
+    : next_load_index_(0),
+      scan_cache_(new PluginScanCache(base::FilePath())),
+      loading_plugins_(false) {
+}
+
+PluginLoaderPosix::PluginLoaderPosix(const base::FilePath& scan_cache_file)
+    : next_load_index_(0),
+      scan_cache_(new PluginScanCache(scan_cache_file)),
+      loading_plugins_(false) {
 }
 
 void PluginLoaderPosix::GetPlugins(
@@ -104,13 +115,36 @@ void PluginLoaderPosix::GetPluginsToLoad() {
   base::TimeTicks start_time(base::TimeTicks::Now());
 
   loaded_plugins_.clear();
+  scanned_plugins_.clear();
+  failed_paths_.clear();
   next_load_index_ = 0;
 
-  canonical_list_.clear();
+  plugin_paths_.clear();
   PluginList::Singleton()->GetPluginPathsToLoad(
-      &canonical_list_,
+      &plugin_paths_,
       PluginService::GetInstance()->NPAPIPluginsSupported());
 
+  // Only the libraries which are new or have changed since they were last
+  // loaded need the child process.
+  canonical_list_.clear();
+  cached_plugins_.clear();
+  scan_cache_->RemoveOtherEntries(plugin_paths_);
+  for (const base::FilePath& path : plugin_paths_) {
+    WebPluginInfo plugin;
+    switch (scan_cache_->Lookup(path, &plugin)) {
+      case PluginScanCache::NOT_CACHED:
+        canonical_list_.push_back(path);
+        break;
+      case PluginScanCache::LOADED:
+        cached_plugins_[path] = plugin;
+        break;
+      case PluginScanCache::FAILED:
+        cached_plugins_[path] = WebPluginInfo();
+        break;
+    }
+  }
+  scan_cache_->SaveIfNecessary();
+
   internal_plugins_.clear();
   PluginList::Singleton()->GetInternalPlugins(&internal_plugins_);
 
@@ -123,6 +157,45 @@ void PluginLoaderPosix::GetPluginsToLoad() {
                             base::Time::kMicrosecondsPerMillisecond);
 }
 
+void PluginLoaderPosix::UpdateScanCache(
+    const std::vector<WebPluginInfo>& scanned_plugins,
+    const std::vector<base::FilePath>& failed_paths) {
+  DCHECK_CURRENTLY_ON(BrowserThread::FILE);
+
+  for (const WebPluginInfo& plugin : scanned_plugins)
+    scan_cache_->AddLoaded(plugin);
+  for (const base::FilePath& path : failed_paths)
+    scan_cache_->AddFailed(path);
+  scan_cache_->SaveIfNecessary();
+}
+
+std::vector<WebPluginInfo> PluginLoaderPosix::MergeCachedPlugins() {
+  std::map<base::FilePath, const WebPluginInfo*> loaded;
+  for (const WebPluginInfo& plugin : loaded_plugins_)
+    loaded[plugin.path] = &plugin;
+
+  std::vector<WebPluginInfo> plugins;
+  for (const base::FilePath& path : plugin_paths_) {
+    auto cached = cached_plugins_.find(path);
+    if (cached == cached_plugins_.end()) {
+      auto it = loaded.find(path);
+      if (it != loaded.end())
+        plugins.push_back(*it->second);
+      continue;
+    }
+
+    // As in OnPluginLoaded(), registered internal plugins take precedence.
+    auto internal = FindInternalPlugin(path);
+    if (internal != internal_plugins_.end()) {
+      plugins.push_back(*internal);
+      internal_plugins_.erase(internal);
+    } else if (!cached->second.path.empty()) {
+      plugins.push_back(cached->second);
+    }
+  }
+  return plugins;
+}
+
 void PluginLoaderPosix::LoadPluginsInternal() {
   DCHECK_CURRENTLY_ON(BrowserThread::IO);
 
@@ -169,6 +242,8 @@ void PluginLoaderPosix::OnPluginLoaded(uint32 index,
     return;
   }
 
+  scanned_plugins_.push_back(plugin);
+
   auto it = FindInternalPlugin(plugin.path);
   if (it != internal_plugins_.end()) {
     loaded_plugins_.push_back(*it);
@@ -192,6 +267,7 @@ void PluginLoaderPosix::OnPluginLoadFailed(uint32 index,
   }
 
   ++next_load_index_;
+  failed_paths_.push_back(plugin_path);
 
   auto it = FindInternalPlugin(plugin_path);
   if (it != internal_plugins_.end()) {
@@ -221,8 +297,21 @@ bool PluginLoaderPosix::IsFinishedLoadingPlugins() {
 
 void PluginLoaderPosix::FinishedLoadingPlugins() {
   loading_plugins_ = false;
+  if (!cached_plugins_.empty()) {
+    loaded_plugins_ = MergeCachedPlugins();
+    cached_plugins_.clear();
+  }
   PluginList::Singleton()->SetPlugins(loaded_plugins_);
 
+  if (!scanned_plugins_.empty() || !failed_paths_.empty()) {
+    BrowserThread::PostTask(
+        BrowserThread::FILE, FROM_HERE,
+        base::Bind(&PluginLoaderPosix::UpdateScanCache,
+                   make_scoped_refptr(this), scanned_plugins_, failed_paths_));
+    scanned_plugins_.clear();
+    failed_paths_.clear();
+  }
+
   for (auto& callback : callbacks_) {
     base::ThreadTaskRunnerHandle::Get()->PostTask(
         FROM_HERE, base::Bind(callback, loaded_plugins_));
@@ -5,11 +5,13 @@
 #ifndef CONTENT_BROWSER_PLUGIN_LOADER_POSIX_H_
 #define CONTENT_BROWSER_PLUGIN_LOADER_POSIX_H_
 
+#include <map>
 #include <vector>
 
 #include "base/basictypes.h"
 #include "base/compiler_specific.h"
 #include "base/memory/ref_counted.h"
+#include "base/memory/scoped_ptr.h"
 #include "base/time/time.h"
 #include "content/browser/plugin_service_impl.h"
 #include "content/public/browser/utility_process_host_client.h"
@@ -17,6 +19,7 @@
 #include "ipc/ipc_sender.h"
 
 namespace content {
+class PluginScanCache;
 class UtilityProcessHost;
 
 // This class is responsible for managing the out-of-process plugin loading on
@@ -26,7 +29,10 @@ class UtilityProcessHost;
 //
 // The following is the algorithm used to load plugins:
 // 1. This asks the PluginList for the list of all potential plugins to attempt
-//    to load. This is referred to as the canonical list.
+//    to load. Libraries which the PluginScanCache knows haven't changed since
+//    they were last loaded are taken from the cache; the rest are referred to
+//    as the canonical list. If the canonical list is empty, no child process
+//    is needed.
 // 2. The child process this hosts is forked and the canonical list is sent to
 //    it.
 // 3. The child process iterates over the canonical list, attempting to load
@@ -38,13 +44,16 @@ class UtilityProcessHost;
 //    resumes loading at the position past the plugin that it just attempted to
 //    load, bypassing the problematic plugin.
 // 5. This algorithm continues until the canonical list has been walked to the
-//    end, after which the list of loaded plugins is set on the PluginList and
-//    the completion callback is run.
+//    end, after which the loaded and cached plugins are set on the PluginList
+//    and the completion callback is run. The results are added to the cache.
 class CONTENT_EXPORT PluginLoaderPosix
     : public NON_EXPORTED_BASE(UtilityProcessHostClient),
       public IPC::Sender {
  public:
   PluginLoaderPosix();
+  // |scan_cache_file| is where the plugin scan cache is persisted. It may be
+  // empty, in which case the cache is only kept in memory.
+  explicit PluginLoaderPosix(const base::FilePath& scan_cache_file);
 
   // Must be called from the IO thread. The |callback| will be called on the IO
   // thread too.
@@ -64,6 +73,13 @@ class CONTENT_EXPORT PluginLoaderPosix
   // Called on the FILE thread to get the list of plugin paths to probe.
   void GetPluginsToLoad();
 
+  // Called on the FILE thread with the results of the child process.
+  void UpdateScanCache(const std::vector<WebPluginInfo>& scanned_plugins,
+                       const std::vector<base::FilePath>& failed_paths);
+
+  // Returns the cached and loaded plugins, in the order of |plugin_paths_|.
+  std::vector<WebPluginInfo> MergeCachedPlugins();
+
   // Must be called on the IO thread.
   virtual void LoadPluginsInternal();
 
@@ -115,6 +131,22 @@ class CONTENT_EXPORT PluginLoaderPosix
   // A vector of plugins that have been loaded successfully.
   std::vector<WebPluginInfo> loaded_plugins_;
 
+  // All the plugin paths to load, in order. |canonical_list_| is the subset
+  // of these that |scan_cache_| didn't have.
+  std::vector<base::FilePath> plugin_paths_;
+
+  // The plugins taken from |scan_cache_| instead of being loaded; failed
+  // libraries are included too, as an empty path.
+  std::map<base::FilePath, WebPluginInfo> cached_plugins_;
+
+  // What the child process reported, before internal plugins were swapped
+  // in, to be added to |scan_cache_|.
+  std::vector<WebPluginInfo> scanned_plugins_;
+  std::vector<base::FilePath> failed_paths_;
+
+  // Only used on the FILE thread.
+  scoped_ptr<PluginScanCache> scan_cache_;
+
   // The callback and message loop on which the callback will be run when the
   // plugin loading process has been completed.
   std::vector<PluginService::GetPluginsCallback> callbacks_;
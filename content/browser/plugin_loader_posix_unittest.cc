@@ -4,9 +4,13 @@
 
 #include "content/browser/plugin_loader_posix.h"
 
+#include <algorithm>
+
 #include "base/at_exit.h"
 #include "base/bind.h"
 #include "base/files/file_path.h"
+#include "base/files/file_util.h"
+#include "base/files/scoped_temp_dir.h"
 #include "base/memory/ref_counted.h"
 #include "base/message_loop/message_loop.h"
 #include "base/strings/utf_string_conversions.h"
@@ -70,6 +74,11 @@ void VerifyCallback(int* run_count, const std::vector<WebPluginInfo>&) {
   ++(*run_count);
 }
 
+void SavePlugins(std::vector<WebPluginInfo>* out,
+                 const std::vector<WebPluginInfo>& plugins) {
+  *out = plugins;
+}
+
 class PluginLoaderPosixTest : public testing::Test {
  public:
   PluginLoaderPosixTest()
@@ -420,4 +429,60 @@ TEST_F(PluginLoaderPosixTest, PluginLaunchFailed) {
   testing::Mock::AllowLeak(plugin_loader());
 }
 
+TEST_F(PluginLoaderPosixTest, UnchangedPluginsAreServedFromCache) {
+  base::ScopedTempDir plugin_dir;
+  ASSERT_TRUE(plugin_dir.CreateUniqueTempDir());
+  base::FilePath plugin_path = plugin_dir.path().AppendASCII("libfake.so");
+  ASSERT_EQ(4, base::WriteFile(plugin_path, "fake", 4));
+  PluginList::Singleton()->AddExtraPluginPath(plugin_path);
+  plugin1_.path = plugin_path;
+
+  int did_callback = 0;
+  plugin_loader()->GetPlugins(
+      base::Bind(&VerifyCallback, base::Unretained(&did_callback)));
+
+  EXPECT_CALL(*plugin_loader(), LoadPluginsInternal()).Times(1);
+  message_loop()->RunUntilIdle();
+  ::testing::Mock::VerifyAndClearExpectations(plugin_loader());
+
+  // The first scan loads every library. Report any real plugins installed on
+  // the machine as failures.
+  std::vector<base::FilePath> canonical_list(*plugin_loader()->canonical_list());
+  ASSERT_NE(canonical_list.end(), std::find(canonical_list.begin(),
+                                            canonical_list.end(), plugin_path));
+  for (size_t i = 0; i < canonical_list.size(); ++i) {
+    if (canonical_list[i] == plugin_path)
+      plugin_loader()->TestOnPluginLoaded(i, plugin1_);
+    else
+      plugin_loader()->TestOnPluginLoadFailed(i, canonical_list[i]);
+  }
+  message_loop()->RunUntilIdle();
+  EXPECT_EQ(1, did_callback);
+
+  // Nothing has changed on disk, so a refresh doesn't need the utility
+  // process.
+  PluginList::Singleton()->RefreshPlugins();
+  std::vector<WebPluginInfo> plugins;
+  EXPECT_CALL(*plugin_loader(), LoadPluginsInternal())
+      .WillOnce(testing::Invoke(
+          plugin_loader(), &MockPluginLoaderPosix::RealLoadPluginsInternal));
+  plugin_loader()->GetPlugins(base::Bind(&SavePlugins, &plugins));
+  message_loop()->RunUntilIdle();
+
+  EXPECT_TRUE(plugin_loader()->canonical_list()->empty());
+  ASSERT_EQ(1u, plugins.size());
+  EXPECT_EQ(plugin1_.name, plugins[0].name);
+  EXPECT_EQ(plugin_path, plugins[0].path);
+
+  // Once the library changes, it's loaded again.
+  ASSERT_EQ(8, base::WriteFile(plugin_path, "fake 2.0", 8));
+  PluginList::Singleton()->RefreshPlugins();
+  EXPECT_CALL(*plugin_loader(), LoadPluginsInternal()).Times(1);
+  plugin_loader()->GetPlugins(base::Bind(&SavePlugins, &plugins));
+  message_loop()->RunUntilIdle();
+
+  ASSERT_EQ(1u, plugin_loader()->canonical_list()->size());
+  EXPECT_EQ(plugin_path, plugin_loader()->canonical_list()->at(0));
+}
+
 }  // namespace content
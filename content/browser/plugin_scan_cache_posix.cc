@@ -0,0 +1,186 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "content/browser/plugin_scan_cache_posix.h"
+
+#include <set>
+#include <string>
+
+#include "base/files/file.h"
+#include "base/files/file_util.h"
+#include "base/files/important_file_writer.h"
+#include "base/logging.h"
+#include "base/pickle.h"
+#include "content/common/utility_messages.h"
+#include "content/public/browser/browser_thread.h"
+#include "ipc/ipc_message.h"
+
+namespace content {
+
+namespace {
+
+// Bump this whenever the format of the cache file, or of WebPluginInfo,
+// changes. Files with another version are ignored.
+const int kCacheVersion = 1;
+
+// Anything bigger than this isn't a cache file we wrote.
+const int64 kMaxCacheFileSize = 4 * 1024 * 1024;
+
+}  // namespace
+
+PluginScanCache::FileStamp::FileStamp() : size(0) {
+}
+
+PluginScanCache::Entry::Entry() : loaded(false) {
+}
+
+PluginScanCache::Entry::~Entry() {
+}
+
+PluginScanCache::PluginScanCache(const base::FilePath& cache_file)
+    : cache_file_(cache_file), read_(false), dirty_(false) {
+}
+
+PluginScanCache::~PluginScanCache() {
+}
+
+PluginScanCache::Result PluginScanCache::Lookup(const base::FilePath& path,
+                                                WebPluginInfo* plugin) {
+  DCHECK_CURRENTLY_ON(BrowserThread::FILE);
+  ReadIfNecessary();
+
+  base::File::Info info;
+  if (!base::GetFileInfo(path, &info)) {
+    // Let the utility process report the failure; don't cache it, since the
+    // library may show up later with any modification time.
+    pending_stamps_.erase(path);
+    return NOT_CACHED;
+  }
+  FileStamp stamp;
+  stamp.size = info.size;
+  stamp.last_modified = info.last_modified;
+
+  EntryMap::const_iterator it = entries_.find(path);
+  if (it == entries_.end() || !(it->second.stamp == stamp)) {
+    pending_stamps_[path] = stamp;
+    return NOT_CACHED;
+  }
+
+  if (!it->second.loaded)
+    return FAILED;
+  *plugin = it->second.plugin;
+  return LOADED;
+}
+
+void PluginScanCache::AddLoaded(const WebPluginInfo& plugin) {
+  Add(plugin.path, true, plugin);
+}
+
+void PluginScanCache::AddFailed(const base::FilePath& path) {
+  Add(path, false, WebPluginInfo());
+}
+
+void PluginScanCache::RemoveOtherEntries(
+    const std::vector<base::FilePath>& paths) {
+  DCHECK_CURRENTLY_ON(BrowserThread::FILE);
+  ReadIfNecessary();
+
+  std::set<base::FilePath> keep(paths.begin(), paths.end());
+  for (EntryMap::iterator it = entries_.begin(); it != entries_.end();) {
+    if (keep.count(it->first)) {
+      ++it;
+    } else {
+      entries_.erase(it++);
+      dirty_ = true;
+    }
+  }
+}
+
+void PluginScanCache::SaveIfNecessary() {
+  DCHECK_CURRENTLY_ON(BrowserThread::FILE);
+  if (!dirty_ || cache_file_.empty())
+    return;
+
+  // The IPC serialization of WebPluginInfo is reused, so that the file format
+  // can't fall out of sync with the struct.
+  IPC::Message pickle;
+  pickle.WriteInt(kCacheVersion);
+  pickle.WriteInt(static_cast<int>(entries_.size()));
+  for (const auto& entry : entries_) {
+    IPC::WriteParam(&pickle, entry.first);
+    pickle.WriteInt64(entry.second.stamp.size);
+    pickle.WriteInt64(entry.second.stamp.last_modified.ToInternalValue());
+    pickle.WriteBool(entry.second.loaded);
+    if (entry.second.loaded)
+      IPC::WriteParam(&pickle, entry.second.plugin);
+  }
+
+  std::string data(static_cast<const char*>(pickle.data()), pickle.size());
+  if (base::ImportantFileWriter::WriteFileAtomically(cache_file_, data))
+    dirty_ = false;
+  else
+    LOG(WARNING) << "Failed to write plugin scan cache " << cache_file_.value();
+}
+
+void PluginScanCache::ReadIfNecessary() {
+  if (read_)
+    return;
+  read_ = true;
+  if (cache_file_.empty())
+    return;
+
+  int64 file_size = 0;
+  if (!base::GetFileSize(cache_file_, &file_size) || file_size <= 0 ||
+      file_size > kMaxCacheFileSize) {
+    return;
+  }
+  std::string data;
+  if (!base::ReadFileToString(cache_file_, &data))
+    return;
+
+  IPC::Message pickle(data.data(), static_cast<int>(data.size()));
+  base::PickleIterator iter(pickle);
+  int version = 0;
+  int count = 0;
+  if (!iter.ReadInt(&version) || version != kCacheVersion ||
+      !iter.ReadInt(&count) || count < 0) {
+    return;
+  }
+
+  // A truncated or corrupt file is discarded as a whole.
+  EntryMap entries;
+  for (int i = 0; i < count; ++i) {
+    base::FilePath path;
+    Entry entry;
+    int64 last_modified = 0;
+    if (!IPC::ReadParam(&pickle, &iter, &path) ||
+        !iter.ReadInt64(&entry.stamp.size) ||
+        !iter.ReadInt64(&last_modified) || !iter.ReadBool(&entry.loaded) ||
+        (entry.loaded && !IPC::ReadParam(&pickle, &iter, &entry.plugin)) ||
+        (entry.loaded && entry.plugin.path != path)) {
+      return;
+    }
+    entry.stamp.last_modified = base::Time::FromInternalValue(last_modified);
+    entries[path] = entry;
+  }
+  entries_.swap(entries);
+}
+
+void PluginScanCache::Add(const base::FilePath& path,
+                          bool loaded,
+                          const WebPluginInfo& plugin) {
+  DCHECK_CURRENTLY_ON(BrowserThread::FILE);
+  auto it = pending_stamps_.find(path);
+  if (it == pending_stamps_.end())
+    return;
+
+  Entry& entry = entries_[path];
+  entry.stamp = it->second;
+  entry.loaded = loaded;
+  entry.plugin = plugin;
+  pending_stamps_.erase(it);
+  dirty_ = true;
+}
+
+}  // namespace content
@@ -0,0 +1,107 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CONTENT_BROWSER_PLUGIN_SCAN_CACHE_POSIX_H_
+#define CONTENT_BROWSER_PLUGIN_SCAN_CACHE_POSIX_H_
+
+#include <map>
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/files/file_path.h"
+#include "base/time/time.h"
+#include "content/common/content_export.h"
+#include "content/public/common/webplugininfo.h"
+
+namespace content {
+
+// Remembers what the utility process found in each plugin library, keyed by
+// the library's path, size and modification time, so that PluginLoaderPosix
+// only has to load the libraries which are new or have changed. Libraries
+// which failed to load are remembered too.
+//
+// If a cache file is given, the cache is read from it on first use and
+// written back whenever it changes, so that the results survive restarts.
+//
+// Must only be used on the FILE thread.
+class CONTENT_EXPORT PluginScanCache {
+ public:
+  enum Result {
+    // The library hasn't been loaded, or has changed since it was.
+    NOT_CACHED,
+    // The library was loaded; the plugin it contains is returned.
+    LOADED,
+    // The library failed to load.
+    FAILED,
+  };
+
+  // |cache_file| may be empty, in which case nothing is persisted.
+  explicit PluginScanCache(const base::FilePath& cache_file);
+  ~PluginScanCache();
+
+  // Looks up the library at |path|, which is stat'ed to check that it hasn't
+  // changed. The results of loading the library are expected to be passed to
+  // AddLoaded() or AddFailed() if NOT_CACHED is returned.
+  Result Lookup(const base::FilePath& path, WebPluginInfo* plugin);
+
+  // Record the result of loading a library which was last passed to
+  // Lookup(). Results for other libraries are ignored, since the size and
+  // modification time they were loaded with are unknown.
+  void AddLoaded(const WebPluginInfo& plugin);
+  void AddFailed(const base::FilePath& path);
+
+  // Forgets the libraries which aren't in |paths|, e.g. because they were
+  // removed or their directory is no longer searched.
+  void RemoveOtherEntries(const std::vector<base::FilePath>& paths);
+
+  // Writes the cache file if anything has changed since it was read.
+  void SaveIfNecessary();
+
+ private:
+  // Identifies a version of a library on disk.
+  struct FileStamp {
+    FileStamp();
+
+    bool operator==(const FileStamp& other) const {
+      return size == other.size && last_modified == other.last_modified;
+    }
+
+    int64 size;
+    base::Time last_modified;
+  };
+
+  struct Entry {
+    Entry();
+    ~Entry();
+
+    FileStamp stamp;
+    bool loaded;
+    // Only valid if |loaded| is true.
+    WebPluginInfo plugin;
+  };
+
+  typedef std::map<base::FilePath, Entry> EntryMap;
+
+  // Reads |cache_file_| the first time it's called.
+  void ReadIfNecessary();
+
+  void Add(const base::FilePath& path, bool loaded,
+           const WebPluginInfo& plugin);
+
+  const base::FilePath cache_file_;
+  bool read_;
+  // True if |entries_| differs from what |cache_file_| holds.
+  bool dirty_;
+
+  EntryMap entries_;
+
+  // The stamps seen by Lookup() for libraries which weren't cached.
+  std::map<base::FilePath, FileStamp> pending_stamps_;
+
+  DISALLOW_COPY_AND_ASSIGN(PluginScanCache);
+};
+
+}  // namespace content
+
+#endif  // CONTENT_BROWSER_PLUGIN_SCAN_CACHE_POSIX_H_
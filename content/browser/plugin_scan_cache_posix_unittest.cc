@@ -0,0 +1,162 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "content/browser/plugin_scan_cache_posix.h"
+
+#include <string>
+#include <vector>
+
+#include "base/files/file_path.h"
+#include "base/files/file_util.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/strings/utf_string_conversions.h"
+#include "base/time/time.h"
+#include "content/public/test/test_browser_thread_bundle.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+using base::ASCIIToUTF16;
+
+namespace content {
+
+class PluginScanCacheTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    // Stands in for a plugin directory.
+    ASSERT_TRUE(plugin_dir_.CreateUniqueTempDir());
+    plugin1_path_ = plugin_dir_.path().AppendASCII("libone.so");
+    plugin2_path_ = plugin_dir_.path().AppendASCII("libtwo.so");
+    WriteLibrary(plugin1_path_, "one");
+    WriteLibrary(plugin2_path_, "two");
+    cache_file_ = plugin_dir_.path().AppendASCII("plugin_scan_cache");
+  }
+
+  void WriteLibrary(const base::FilePath& path, const std::string& contents) {
+    ASSERT_EQ(static_cast<int>(contents.size()),
+              base::WriteFile(path, contents.data(), contents.size()));
+  }
+
+  WebPluginInfo MakePlugin(const base::FilePath& path,
+                           const std::string& name) {
+    WebPluginInfo plugin(ASCIIToUTF16(name), path, ASCIIToUTF16("1.0"),
+                         ASCIIToUTF16("A plugin"));
+    plugin.mime_types.push_back(
+        WebPluginMimeType("application/x-" + name, name, name));
+    return plugin;
+  }
+
+  TestBrowserThreadBundle thread_bundle_;
+  base::ScopedTempDir plugin_dir_;
+  base::FilePath plugin1_path_;
+  base::FilePath plugin2_path_;
+  base::FilePath cache_file_;
+};
+
+TEST_F(PluginScanCacheTest, LookupAfterAdd) {
+  PluginScanCache cache(base::FilePath());
+  WebPluginInfo plugin;
+  EXPECT_EQ(PluginScanCache::NOT_CACHED, cache.Lookup(plugin1_path_, &plugin));
+  EXPECT_EQ(PluginScanCache::NOT_CACHED, cache.Lookup(plugin2_path_, &plugin));
+
+  cache.AddLoaded(MakePlugin(plugin1_path_, "one"));
+  cache.AddFailed(plugin2_path_);
+
+  ASSERT_EQ(PluginScanCache::LOADED, cache.Lookup(plugin1_path_, &plugin));
+  EXPECT_EQ(ASCIIToUTF16("one"), plugin.name);
+  EXPECT_EQ(plugin1_path_, plugin.path);
+  ASSERT_EQ(1u, plugin.mime_types.size());
+  EXPECT_EQ("application/x-one", plugin.mime_types[0].mime_type);
+  EXPECT_EQ(PluginScanCache::FAILED, cache.Lookup(plugin2_path_, &plugin));
+}
+
+TEST_F(PluginScanCacheTest, ResultsForUnknownLibrariesAreIgnored) {
+  PluginScanCache cache(base::FilePath());
+  // Without a Lookup(), the cache doesn't know which version was loaded.
+  cache.AddLoaded(MakePlugin(plugin1_path_, "one"));
+  WebPluginInfo plugin;
+  EXPECT_EQ(PluginScanCache::NOT_CACHED, cache.Lookup(plugin1_path_, &plugin));
+}
+
+TEST_F(PluginScanCacheTest, ChangedLibraryIsReloaded) {
+  PluginScanCache cache(base::FilePath());
+  WebPluginInfo plugin;
+  EXPECT_EQ(PluginScanCache::NOT_CACHED, cache.Lookup(plugin1_path_, &plugin));
+  EXPECT_EQ(PluginScanCache::NOT_CACHED, cache.Lookup(plugin2_path_, &plugin));
+  cache.AddLoaded(MakePlugin(plugin1_path_, "one"));
+  cache.AddLoaded(MakePlugin(plugin2_path_, "two"));
+
+  // A new size invalidates the entry...
+  WriteLibrary(plugin1_path_, "a newer version");
+  EXPECT_EQ(PluginScanCache::NOT_CACHED, cache.Lookup(plugin1_path_, &plugin));
+
+  // ...and so does a new modification time.
+  base::Time later = base::Time::Now() + base::TimeDelta::FromHours(1);
+  ASSERT_TRUE(base::TouchFile(plugin2_path_, later, later));
+  EXPECT_EQ(PluginScanCache::NOT_CACHED, cache.Lookup(plugin2_path_, &plugin));
+
+  // A library which is gone isn't served from the cache either.
+  ASSERT_TRUE(base::DeleteFile(plugin1_path_, false));
+  EXPECT_EQ(PluginScanCache::NOT_CACHED, cache.Lookup(plugin1_path_, &plugin));
+}
+
+TEST_F(PluginScanCacheTest, PersistsToFile) {
+  {
+    PluginScanCache cache(cache_file_);
+    WebPluginInfo plugin;
+    EXPECT_EQ(PluginScanCache::NOT_CACHED,
+              cache.Lookup(plugin1_path_, &plugin));
+    EXPECT_EQ(PluginScanCache::NOT_CACHED,
+              cache.Lookup(plugin2_path_, &plugin));
+    cache.AddLoaded(MakePlugin(plugin1_path_, "one"));
+    cache.AddFailed(plugin2_path_);
+    cache.SaveIfNecessary();
+  }
+  ASSERT_TRUE(base::PathExists(cache_file_));
+
+  PluginScanCache cache(cache_file_);
+  WebPluginInfo plugin;
+  ASSERT_EQ(PluginScanCache::LOADED, cache.Lookup(plugin1_path_, &plugin));
+  EXPECT_EQ(ASCIIToUTF16("one"), plugin.name);
+  ASSERT_EQ(1u, plugin.mime_types.size());
+  EXPECT_EQ("application/x-one", plugin.mime_types[0].mime_type);
+  EXPECT_EQ(PluginScanCache::FAILED, cache.Lookup(plugin2_path_, &plugin));
+}
+
+TEST_F(PluginScanCacheTest, RemoveOtherEntries) {
+  {
+    PluginScanCache cache(cache_file_);
+    WebPluginInfo plugin;
+    cache.Lookup(plugin1_path_, &plugin);
+    cache.Lookup(plugin2_path_, &plugin);
+    cache.AddLoaded(MakePlugin(plugin1_path_, "one"));
+    cache.AddLoaded(MakePlugin(plugin2_path_, "two"));
+
+    cache.RemoveOtherEntries(std::vector<base::FilePath>(1, plugin2_path_));
+    EXPECT_EQ(PluginScanCache::NOT_CACHED,
+              cache.Lookup(plugin1_path_, &plugin));
+    cache.SaveIfNecessary();
+  }
+
+  PluginScanCache cache(cache_file_);
+  WebPluginInfo plugin;
+  EXPECT_EQ(PluginScanCache::NOT_CACHED, cache.Lookup(plugin1_path_, &plugin));
+  EXPECT_EQ(PluginScanCache::LOADED, cache.Lookup(plugin2_path_, &plugin));
+}
+
+TEST_F(PluginScanCacheTest, CorruptFileIsIgnored) {
+  const std::string kGarbage("this is not a plugin scan cache");
+  ASSERT_EQ(static_cast<int>(kGarbage.size()),
+            base::WriteFile(cache_file_, kGarbage.data(), kGarbage.size()));
+
+  PluginScanCache cache(cache_file_);
+  WebPluginInfo plugin;
+  EXPECT_EQ(PluginScanCache::NOT_CACHED, cache.Lookup(plugin1_path_, &plugin));
+  cache.AddLoaded(MakePlugin(plugin1_path_, "one"));
+  cache.SaveIfNecessary();
+
+  // The bad file is replaced.
+  PluginScanCache reread(cache_file_);
+  EXPECT_EQ(PluginScanCache::LOADED, reread.Lookup(plugin1_path_, &plugin));
+}
+
+}  // namespace content
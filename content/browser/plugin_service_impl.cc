@@ -636,7 +636,8 @@ void PluginServiceImpl::GetPluginsOnIOThread(
   // sure g_thread_init() gets called since plugins may call glib at load.
 
   if (!plugin_loader_.get())
-    plugin_loader_ = new PluginLoaderPosix;
+    plugin_loader_ = new PluginLoaderPosix(
+        GetContentClient()->browser()->GetPluginScanCacheFile());
 
   plugin_loader_->GetPlugins(base::Bind(
       &ForwardCallback, make_scoped_refptr(target_task_runner), callback));
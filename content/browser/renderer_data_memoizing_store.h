@@ -5,9 +5,10 @@
 #ifndef CONTENT_BROWSER_RENDERER_DATA_MEMOIZING_STORE_H_
 #define CONTENT_BROWSER_RENDERER_DATA_MEMOIZING_STORE_H_
 
-#include <map>
+#include <utility>
 
 #include "base/bind.h"
+#include "base/containers/hash_tables.h"
 #include "base/synchronization/lock.h"
 #include "content/public/browser/browser_thread.h"
 #include "content/public/browser/render_process_host.h"
@@ -22,11 +23,16 @@ namespace content {
 // termination and releases objects that are no longer associated with any
 // render process.
 //
+// Objects are looked up by a hash computed by |Hasher|, a functor taking a
+// const T& and returning a size_t, and compared with T::LessThan only when
+// their hashes match. Objects which T::LessThan considers equal must have the
+// same hash.
+//
 // TODO(jcampan): Rather than watching for render process termination, we should
 //                instead be listening to events such as resource cached/
 //                removed from cache, and remove the items when we know they
 //                are not used anymore.
-template <typename T>
+template <typename T, typename Hasher>
 class RendererDataMemoizingStore : public RenderProcessHostObserver {
  public:
   RendererDataMemoizingStore() : next_item_id_(1) {
@@ -41,40 +47,32 @@ class RendererDataMemoizingStore : public RenderProcessHostObserver {
   // known, the same identifier will be returned.
   int Store(T* item, int process_id) {
     DCHECK(item);
+    const size_t hash = Hasher()(*item);
     base::AutoLock auto_lock(lock_);
 
-    int item_id;
-
     // Do we already know this item?
-    typename ReverseItemMap::iterator item_iter = item_to_id_.find(item);
-    if (item_iter == item_to_id_.end()) {
-      item_id = next_item_id_++;
-      // We use 0 as an invalid item_id value.  In the unlikely event that
-      // next_item_id_ wraps around, we reset it to 1.
-      if (next_item_id_ == 0)
-        next_item_id_ = 1;
-      id_to_item_[item_id] = item;
-      item_to_id_[item] = item_id;
-    } else {
-      item_id = item_iter->second;
-    }
-
-    // Let's update process_id_to_item_id_.
-    std::pair<IDMap::iterator, IDMap::iterator> process_ids =
-        process_id_to_item_id_.equal_range(process_id);
-    bool already_watching_process = (process_ids.first != process_ids.second);
-    if (std::find_if(process_ids.first, process_ids.second,
-                     MatchSecond<int>(item_id)) == process_ids.second) {
-      process_id_to_item_id_.insert(std::make_pair(process_id, item_id));
+    int item_id = FindItem(item, hash);
+    if (!item_id) {
+      do {
+        item_id = next_item_id_++;
+        // We use 0 as an invalid item_id value.  In the unlikely event that
+        // next_item_id_ wraps around, we reset it to 1, and skip the ids
+        // which are still in use.
+        if (next_item_id_ == 0)
+          next_item_id_ = 1;
+      } while (id_to_item_.find(item_id) != id_to_item_.end());
+      Entry& entry = id_to_item_[item_id];
+      entry.item = item;
+      entry.hash = hash;
+      hash_to_id_.insert(std::make_pair(hash, item_id));
     }
 
-    // And item_id_to_process_id_.
-    std::pair<IDMap::iterator, IDMap::iterator> item_ids =
-        item_id_to_process_id_.equal_range(item_id);
-    if (std::find_if(item_ids.first, item_ids.second,
-                     MatchSecond<int>(process_id)) == item_ids.second) {
-      item_id_to_process_id_.insert(std::make_pair(item_id, process_id));
-    }
+    // Let's update the items of the process, and the number of processes
+    // referring to the item.
+    ItemIdSet& process_items = process_id_to_item_ids_[process_id];
+    bool already_watching_process = !process_items.empty();
+    if (process_items.insert(item_id).second)
+      ++id_to_item_[item_id].process_count;
 
     // If we're not doing so already, keep an eye for the process host deletion.
     if (!already_watching_process) {
@@ -104,26 +102,49 @@ class RendererDataMemoizingStore : public RenderProcessHostObserver {
     if (iter == id_to_item_.end())
       return false;
     if (item)
-      *item = iter->second;
+      *item = iter->second.item;
     return true;
   }
 
+  // Makes |next_item_id| the id tried for the next new item, so tests can
+  // make the id counter wrap around.
+  void SetNextItemIdForTesting(int next_item_id) {
+    base::AutoLock auto_lock(lock_);
+    next_item_id_ = next_item_id;
+  }
+
  private:
-  typedef std::multimap<int, int> IDMap;
-  typedef std::map<int, scoped_refptr<T> > ItemMap;
-  typedef std::map<T*, int, typename T::LessThan> ReverseItemMap;
+  struct Entry {
+    Entry() : hash(0), process_count(0) {}
 
-  template <typename M>
-  struct MatchSecond {
-    explicit MatchSecond(const M& t) : value(t) {}
+    scoped_refptr<T> item;
+    size_t hash;
+    // The number of processes whose ItemIdSet holds this item.
+    int process_count;
+  };
 
-    template <typename Pair>
-    bool operator()(const Pair& p) const {
-      return (value == p.second);
+  typedef base::hash_set<int> ItemIdSet;
+  typedef base::hash_map<int, ItemIdSet> ProcessMap;
+  typedef base::hash_map<int, Entry> ItemMap;
+  typedef base::hash_multimap<size_t, int> HashMap;
+
+  // Returns the id of the stored item equal to |item|, or 0 if there's none.
+  // NOTE: the caller must hold lock_.
+  int FindItem(T* item, size_t hash) {
+    lock_.AssertAcquired();
+    std::pair<typename HashMap::iterator, typename HashMap::iterator> range =
+        hash_to_id_.equal_range(hash);
+    typename T::LessThan less_than;
+    for (typename HashMap::iterator it = range.first; it != range.second;
+         ++it) {
+      T* candidate = id_to_item_[it->second].item.get();
+      if (candidate == item ||
+          (!less_than(candidate, item) && !less_than(item, candidate))) {
+        return it->second;
+      }
     }
-
-    M value;
-  };
+    return 0;
+  }
 
   void StartObservingProcess(int process_id) {
     DCHECK_CURRENTLY_ON(BrowserThread::UI);
@@ -139,16 +160,16 @@ class RendererDataMemoizingStore : public RenderProcessHostObserver {
     host->AddObserver(this);
   }
 
-  // Remove the item specified by |item_id| from id_to_item_ and item_to_id_.
+  // Remove the item specified by |item_id| from id_to_item_ and hash_to_id_.
   // NOTE: the caller (RemoveRenderProcessItems) must hold lock_.
-  void RemoveInternal(int item_id) {
-    typename ItemMap::iterator item_iter = id_to_item_.find(item_id);
-    DCHECK(item_iter != id_to_item_.end());
-
-    typename ReverseItemMap::iterator id_iter =
-        item_to_id_.find(item_iter->second.get());
-    DCHECK(id_iter != item_to_id_.end());
-    item_to_id_.erase(id_iter);
+  void RemoveInternal(typename ItemMap::iterator item_iter) {
+    std::pair<typename HashMap::iterator, typename HashMap::iterator> range =
+        hash_to_id_.equal_range(item_iter->second.hash);
+    typename HashMap::iterator id_iter = range.first;
+    while (id_iter != range.second && id_iter->second != item_iter->first)
+      ++id_iter;
+    DCHECK(id_iter != range.second);
+    hash_to_id_.erase(id_iter);
 
     id_to_item_.erase(item_iter);
   }
@@ -162,51 +183,32 @@ class RendererDataMemoizingStore : public RenderProcessHostObserver {
   void RemoveRenderProcessItems(int process_id) {
     base::AutoLock auto_lock(lock_);
 
-    // We iterate through all the item ids for that process.
-    std::pair<IDMap::iterator, IDMap::iterator> process_ids =
-        process_id_to_item_id_.equal_range(process_id);
-    for (IDMap::iterator ids_iter = process_ids.first;
-         ids_iter != process_ids.second; ++ids_iter) {
-      int item_id = ids_iter->second;
-      // Find all the processes referring to this item id in
-      // item_id_to_process_id_, then locate the process being removed within
-      // that range.
-      std::pair<IDMap::iterator, IDMap::iterator> item_ids =
-          item_id_to_process_id_.equal_range(item_id);
-      IDMap::iterator proc_iter = std::find_if(
-          item_ids.first, item_ids.second, MatchSecond<int>(process_id));
-      DCHECK(proc_iter != item_ids.second);
-
-      // Before removing, determine if no other processes refer to the current
-      // item id. If |proc_iter| (the current process) is the lower bound of
-      // processes containing the current item id and if |next_proc_iter| is the
-      // upper bound (the first process that does not), then only one process,
-      // the one being removed, refers to the item id.
-      IDMap::iterator next_proc_iter = proc_iter;
-      ++next_proc_iter;
-      bool last_process_for_item_id =
-          (proc_iter == item_ids.first && next_proc_iter == item_ids.second);
-      item_id_to_process_id_.erase(proc_iter);
-
-      if (last_process_for_item_id) {
+    typename ProcessMap::iterator process_iter =
+        process_id_to_item_ids_.find(process_id);
+    if (process_iter == process_id_to_item_ids_.end())
+      return;
+
+    // Only the items of that process need to be visited.
+    for (int item_id : process_iter->second) {
+      typename ItemMap::iterator item_iter = id_to_item_.find(item_id);
+      DCHECK(item_iter != id_to_item_.end());
+      DCHECK_GT(item_iter->second.process_count, 0);
+      if (--item_iter->second.process_count == 0) {
         // The current item id is not referenced by any other processes, so
-        // remove it from id_to_item_ and item_to_id_.
-        RemoveInternal(item_id);
+        // remove it from id_to_item_ and hash_to_id_.
+        RemoveInternal(item_iter);
       }
     }
-    if (process_ids.first != process_ids.second)
-      process_id_to_item_id_.erase(process_ids.first, process_ids.second);
+    process_id_to_item_ids_.erase(process_iter);
   }
 
-  IDMap process_id_to_item_id_;
-  IDMap item_id_to_process_id_;
+  ProcessMap process_id_to_item_ids_;
   ItemMap id_to_item_;
-  ReverseItemMap item_to_id_;
+  HashMap hash_to_id_;
 
   int next_item_id_;
 
-  // This lock protects: process_id_to_item_id_, item_id_to_process_id_,
-  //                     id_to_item_, and item_to_id_.
+  // This lock protects: process_id_to_item_ids_, id_to_item_, and hash_to_id_.
   base::Lock lock_;
 };
 
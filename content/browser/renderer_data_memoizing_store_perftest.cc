@@ -0,0 +1,126 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "content/browser/renderer_data_memoizing_store.h"
+
+#include <string>
+#include <vector>
+
+#include "base/containers/hash_tables.h"
+#include "base/memory/ref_counted.h"
+#include "base/memory/scoped_vector.h"
+#include "base/message_loop/message_loop.h"
+#include "base/strings/stringprintf.h"
+#include "base/time/time.h"
+#include "content/public/test/mock_render_process_host.h"
+#include "content/public/test/test_browser_context.h"
+#include "content/public/test/test_browser_thread.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_test.h"
+
+namespace content {
+namespace {
+
+const int kRenderProcesses = 200;
+const int kChains = 1000;
+const int kTimeLimitMs = 2000;
+
+// Stands in for a net::X509Certificate: a new, equal object is created for
+// every response carrying the same chain.
+class FakeCertChain : public base::RefCountedThreadSafe<FakeCertChain> {
+ public:
+  explicit FakeCertChain(int i)
+      : der_(base::StringPrintf("%04d", i) + std::string(3000, 'x')) {}
+
+  const std::string& der() const { return der_; }
+
+  struct LessThan {
+    bool operator()(const scoped_refptr<FakeCertChain>& lhs,
+                    const scoped_refptr<FakeCertChain>& rhs) const {
+      return lhs->der_ < rhs->der_;
+    }
+  };
+
+ private:
+  friend class base::RefCountedThreadSafe<FakeCertChain>;
+  ~FakeCertChain() {}
+
+  const std::string der_;
+};
+
+struct FakeCertChainHash {
+  size_t operator()(const FakeCertChain& chain) const {
+    return BASE_HASH_NAMESPACE::hash<std::string>()(chain.der());
+  }
+};
+
+class RendererDataMemoizingStorePerfTest : public testing::Test {
+ public:
+  RendererDataMemoizingStorePerfTest()
+      : ui_thread_(BrowserThread::UI, &message_loop_) {}
+
+ protected:
+  void SetUp() override {
+    for (int i = 0; i < kRenderProcesses; ++i)
+      processes_.push_back(new MockRenderProcessHost(&browser_context_));
+    for (int i = 0; i < kChains; ++i)
+      chains_.push_back(make_scoped_refptr(new FakeCertChain(i)));
+  }
+
+  base::MessageLoop message_loop_;
+  TestBrowserThread ui_thread_;
+  TestBrowserContext browser_context_;
+  RendererDataMemoizingStore<FakeCertChain, FakeCertChainHash> store_;
+  // Destroyed before |store_|, so that it's empty by then.
+  ScopedVector<MockRenderProcessHost> processes_;
+  std::vector<scoped_refptr<FakeCertChain>> chains_;
+};
+
+// Every renderer stores responses from many sites, most of which share their
+// certificate chains with other renderers.
+TEST_F(RendererDataMemoizingStorePerfTest, Store) {
+  int stores = 0;
+  base::TimeTicks start = base::TimeTicks::Now();
+  base::TimeDelta elapsed;
+  do {
+    for (int i = 0; i < 1000; ++i, ++stores) {
+      // A copy of the chain, as a new response would carry.
+      scoped_refptr<FakeCertChain> chain(
+          new FakeCertChain(stores * 7 % kChains));
+      int process_id = processes_[stores % kRenderProcesses]->GetID();
+      EXPECT_NE(0, store_.Store(chain.get(), process_id));
+    }
+    elapsed = base::TimeTicks::Now() - start;
+  } while (elapsed.InMilliseconds() < kTimeLimitMs);
+
+  perf_test::PrintResult("renderer_data_memoizing_store_store", "",
+                         "200_processes_1000_chains",
+                         elapsed.InMicroseconds() / static_cast<double>(stores),
+                         "us/store", true);
+}
+
+// Renderers exit while the others keep using the same chains.
+TEST_F(RendererDataMemoizingStorePerfTest, RenderProcessExit) {
+  std::vector<int> item_ids;
+  for (int i = 0; i < kChains * 20; ++i) {
+    item_ids.push_back(store_.Store(chains_[i % kChains].get(),
+                                    processes_[i % kRenderProcesses]->GetID()));
+  }
+
+  base::TimeTicks start = base::TimeTicks::Now();
+  processes_.clear();
+  base::TimeDelta elapsed = base::TimeTicks::Now() - start;
+
+  for (int item_id : item_ids)
+    EXPECT_FALSE(store_.Retrieve(item_id, NULL));
+
+  perf_test::PrintResult("renderer_data_memoizing_store_process_exit", "",
+                         "200_processes_1000_chains",
+                         elapsed.InMicroseconds() /
+                             static_cast<double>(kRenderProcesses),
+                         "us/process", true);
+}
+
+}  // namespace
+}  // namespace content
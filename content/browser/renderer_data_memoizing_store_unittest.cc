@@ -0,0 +1,144 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "content/browser/renderer_data_memoizing_store.h"
+
+#include "base/memory/ref_counted.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/message_loop/message_loop.h"
+#include "content/public/test/mock_render_process_host.h"
+#include "content/public/test/test_browser_context.h"
+#include "content/public/test/test_browser_thread.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace content {
+namespace {
+
+class TestItem : public base::RefCountedThreadSafe<TestItem> {
+ public:
+  explicit TestItem(int value) : value_(value) {}
+
+  int value() const { return value_; }
+
+  struct LessThan {
+    bool operator()(const scoped_refptr<TestItem>& lhs,
+                    const scoped_refptr<TestItem>& rhs) const {
+      return lhs->value_ < rhs->value_;
+    }
+  };
+
+ private:
+  friend class base::RefCountedThreadSafe<TestItem>;
+  ~TestItem() {}
+
+  const int value_;
+};
+
+struct TestItemHash {
+  size_t operator()(const TestItem& item) const { return item.value(); }
+};
+
+// Gives every item the same hash, so that they can only be told apart with
+// TestItem::LessThan.
+struct CollidingHash {
+  size_t operator()(const TestItem& item) const { return 42; }
+};
+
+class RendererDataMemoizingStoreTest : public testing::Test {
+ public:
+  RendererDataMemoizingStoreTest()
+      : ui_thread_(BrowserThread::UI, &message_loop_) {}
+
+ protected:
+  scoped_ptr<MockRenderProcessHost> CreateProcess() {
+    return make_scoped_ptr(new MockRenderProcessHost(&browser_context_));
+  }
+
+  base::MessageLoop message_loop_;
+  TestBrowserThread ui_thread_;
+  TestBrowserContext browser_context_;
+};
+
+TEST_F(RendererDataMemoizingStoreTest, ReleasedWhenProcessesGoAway) {
+  RendererDataMemoizingStore<TestItem, TestItemHash> store;
+  scoped_ptr<MockRenderProcessHost> process1 = CreateProcess();
+  scoped_ptr<MockRenderProcessHost> process2 = CreateProcess();
+  scoped_refptr<TestItem> item(new TestItem(1));
+
+  // An equal item gets the same id, and storing it twice for one process
+  // only counts that process once.
+  int item_id = store.Store(item.get(), process1->GetID());
+  scoped_refptr<TestItem> copy(new TestItem(1));
+  EXPECT_EQ(item_id, store.Store(copy.get(), process1->GetID()));
+  EXPECT_EQ(item_id, store.Store(copy.get(), process2->GetID()));
+  EXPECT_FALSE(item->HasOneRef());
+  EXPECT_TRUE(copy->HasOneRef());
+
+  scoped_refptr<TestItem> retrieved;
+  ASSERT_TRUE(store.Retrieve(item_id, &retrieved));
+  EXPECT_EQ(item.get(), retrieved.get());
+  retrieved = NULL;
+
+  // The item is kept while any process that stored it is alive.
+  process1.reset();
+  EXPECT_TRUE(store.Retrieve(item_id, NULL));
+  EXPECT_FALSE(item->HasOneRef());
+
+  process2.reset();
+  EXPECT_FALSE(store.Retrieve(item_id, NULL));
+  EXPECT_TRUE(item->HasOneRef());
+}
+
+TEST_F(RendererDataMemoizingStoreTest, HashCollisions) {
+  RendererDataMemoizingStore<TestItem, CollidingHash> store;
+  scoped_ptr<MockRenderProcessHost> process1 = CreateProcess();
+  scoped_ptr<MockRenderProcessHost> process2 = CreateProcess();
+  scoped_refptr<TestItem> item1(new TestItem(1));
+  scoped_refptr<TestItem> item2(new TestItem(2));
+
+  int item1_id = store.Store(item1.get(), process1->GetID());
+  int item2_id = store.Store(item2.get(), process2->GetID());
+  EXPECT_NE(item1_id, item2_id);
+  scoped_refptr<TestItem> copy(new TestItem(2));
+  EXPECT_EQ(item2_id, store.Store(copy.get(), process1->GetID()));
+
+  scoped_refptr<TestItem> retrieved;
+  ASSERT_TRUE(store.Retrieve(item1_id, &retrieved));
+  EXPECT_EQ(item1.get(), retrieved.get());
+  ASSERT_TRUE(store.Retrieve(item2_id, &retrieved));
+  EXPECT_EQ(item2.get(), retrieved.get());
+  retrieved = NULL;
+
+  // Dropping one item leaves the other findable under the shared hash.
+  process1.reset();
+  EXPECT_FALSE(store.Retrieve(item1_id, NULL));
+  EXPECT_EQ(item2_id, store.Store(copy.get(), process2->GetID()));
+  process2.reset();
+  EXPECT_FALSE(store.Retrieve(item2_id, NULL));
+}
+
+TEST_F(RendererDataMemoizingStoreTest, WrappedIdsSkipLiveItems) {
+  RendererDataMemoizingStore<TestItem, TestItemHash> store;
+  scoped_ptr<MockRenderProcessHost> process = CreateProcess();
+  scoped_refptr<TestItem> item1(new TestItem(1));
+  scoped_refptr<TestItem> item2(new TestItem(2));
+  scoped_refptr<TestItem> item3(new TestItem(3));
+
+  EXPECT_EQ(1, store.Store(item1.get(), process->GetID()));
+
+  // The counter wraps after handing out -1. Id 0 is never used, and id 1
+  // still belongs to |item1|.
+  store.SetNextItemIdForTesting(-1);
+  EXPECT_EQ(-1, store.Store(item2.get(), process->GetID()));
+  EXPECT_EQ(2, store.Store(item3.get(), process->GetID()));
+
+  scoped_refptr<TestItem> retrieved;
+  ASSERT_TRUE(store.Retrieve(1, &retrieved));
+  EXPECT_EQ(item1.get(), retrieved.get());
+  retrieved = NULL;
+  process.reset();
+}
+
+}  // namespace
+}  // namespace content
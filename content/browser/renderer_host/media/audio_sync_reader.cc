@@ -33,6 +33,17 @@ void LogAudioGlitchResult(AudioGlitchResult result) {
                             AUDIO_RENDERER_AUDIO_GLITCHES_MAX + 1);
 }
 
+// Most buffers the renderer is asked to fill ahead of the audio device.
+const size_t kMaxRingDepth = 4;
+
+// The ring gives a buffer of latency back after the renderer kept up for this
+// long.
+const int kSecondsBeforeShrinkingRing = 10;
+
+// AudioOutputController sends this instead of a delay when it pauses the
+// stream. The renderer doesn't fill a buffer for it.
+const uint32_t kPauseMark = kuint32max;
+
 }  // namespace
 
 namespace content {
@@ -51,7 +62,24 @@ AudioSyncReader::AudioSyncReader(base::SharedMemory* shared_memory,
       // TODO(dalecurtis): Investigate if we can reduce this on all platforms.
       maximum_wait_time_(base::TimeDelta::FromMilliseconds(20)),
 #endif
-      buffer_index_(0) {
+      top_up_wait_(params.GetBufferDuration() / 4),
+      bytes_per_buffer_(params.GetBytesPerBuffer()),
+      buffer_index_(0),
+      request_pending_(false),
+      pending_buffer_index_(0),
+      discard_pending_buffer_(false),
+      pending_bytes_(0),
+      stream_starting_(true),
+      skip_top_up_wait_(false),
+      ring_start_(0),
+      ring_size_(0),
+      ring_depth_(1),
+      max_ring_depth_(1),
+      played_buffer_index_(0),
+      callbacks_since_late_(0),
+      callbacks_before_shrinking_(std::max<int64>(
+          1, base::TimeDelta::FromSeconds(kSecondsBeforeShrinkingRing) /
+                 params.GetBufferDuration())) {
   DCHECK_EQ(static_cast<size_t>(packet_size_),
             sizeof(media::AudioOutputBufferParameters) +
                 AudioBus::CalculateMemorySize(params));
@@ -59,6 +87,10 @@ AudioSyncReader::AudioSyncReader(base::SharedMemory* shared_memory,
       reinterpret_cast<AudioOutputBuffer*>(shared_memory_->memory());
   output_bus_ = AudioBus::WrapMemory(params, buffer->audio);
   output_bus_->Zero();
+
+  for (size_t i = 0; i < kMaxRingDepth; ++i)
+    ring_.push_back(AudioBus::Create(params).release());
+  ring_buffer_indices_.resize(kMaxRingDepth);
 }
 
 AudioSyncReader::~AudioSyncReader() {
@@ -78,9 +110,10 @@ AudioSyncReader::~AudioSyncReader() {
   renderer_missed_callback_count_ > 0 ?
       LogAudioGlitchResult(AUDIO_RENDERER_AUDIO_GLITCHES) :
       LogAudioGlitchResult(AUDIO_RENDERER_NO_AUDIO_GLITCHES);
-  std::string log_string =
-      base::StringPrintf("ASR: number of detected audio glitches=%d",
-                         static_cast<int>(renderer_missed_callback_count_));
+  std::string log_string = base::StringPrintf(
+      "ASR: number of detected audio glitches=%d, maximum ring depth=%d",
+      static_cast<int>(renderer_missed_callback_count_),
+      static_cast<int>(max_ring_depth_));
   MediaStreamManager::SendMessageToNativeLog(log_string);
   DVLOG(1) << log_string;
 }
@@ -95,32 +128,103 @@ void AudioSyncReader::UpdatePendingBytes(uint32_t bytes,
       reinterpret_cast<AudioOutputBuffer*>(shared_memory_->memory());
   buffer->params.frames_skipped += frames_skipped;
 
-  // Zero out the entire output buffer to avoid stuttering/repeating-buffers
-  // in the anomalous case if the renderer is unable to keep up with real-time.
-  output_bus_->Zero();
+  if (bytes == kPauseMark) {
+    // Let the renderer know right away. Whatever it filled ahead is stale by
+    // the time the stream plays again.
+    socket_->Send(&bytes, sizeof(bytes));
+    ++buffer_index_;
+    ring_size_ = 0;
+    discard_pending_buffer_ = request_pending_;
+    stream_starting_ = true;
+    skip_top_up_wait_ = false;
+    return;
+  }
 
-  socket_->Send(&bytes, sizeof(bytes));
-  ++buffer_index_;
+  pending_bytes_ = bytes;
+  RequestBuffer();
 }
 
 void AudioSyncReader::Read(AudioBus* dest) {
   ++renderer_callback_count_;
-  if (!WaitUntilDataIsReady()) {
-    ++renderer_missed_callback_count_;
-    if (renderer_missed_callback_count_ <= 100) {
-      LOG(WARNING) << "AudioSyncReader::Read timed out, audio glitch count="
-                   << renderer_missed_callback_count_;
-      if (renderer_missed_callback_count_ == 100)
-        LOG(WARNING) << "(log cap reached, suppressing further logs)";
+  const uint32 last_request = buffer_index_;
+
+  // Take what the renderer filled since the last callback.
+  while (ReceiveBuffer(base::TimeDelta()))
+    RequestBuffer();
+
+  // The renderer had a whole buffer's time to fill what plays now, except on
+  // the first callback after the stream starts.
+  const bool late = !ring_size_ && !stream_starting_;
+  stream_starting_ = false;
+  if (late)
+    skip_top_up_wait_ = false;
+
+  if (!ring_size_) {
+    // Wait a reasonable amount of time for the renderer.
+    RequestBuffer();
+    const base::TimeTicks start_time = base::TimeTicks::Now();
+    const base::TimeTicks finish_time = start_time + maximum_wait_time_;
+    while (!ring_size_) {
+      // The buffer which arrives may be one to discard, in which case the
+      // renderer is asked again.
+      if (!ReceiveBuffer(finish_time - base::TimeTicks::Now()))
+        break;
+      RequestBuffer();
+    }
+
+    if (!ring_size_) {
+      // Receive timed out or another error occurred.  Receive can timeout if
+      // the renderer is unable to deliver audio data within the allotted time.
+      DVLOG(2) << "AudioSyncReader::Read() timed out.";
+      UMA_HISTOGRAM_CUSTOM_TIMES("Media.AudioOutputControllerDataNotReady",
+                                 base::TimeTicks::Now() - start_time,
+                                 base::TimeDelta::FromMilliseconds(1),
+                                 base::TimeDelta::FromMilliseconds(1000),
+                                 50);
+
+      ++renderer_missed_callback_count_;
+      if (renderer_missed_callback_count_ <= 100) {
+        LOG(WARNING) << "AudioSyncReader::Read timed out, audio glitch count="
+                     << renderer_missed_callback_count_;
+        if (renderer_missed_callback_count_ == 100)
+          LOG(WARNING) << "(log cap reached, suppressing further logs)";
+      }
+      dest->Zero();
+      AdaptRingDepth(late);
+      return;
     }
-    dest->Zero();
-    return;
   }
 
+  const size_t slot = ring_start_;
+  ring_start_ = (ring_start_ + 1) % kMaxRingDepth;
+  --ring_size_;
+  DCHECK_GT(
+      static_cast<int32>(ring_buffer_indices_[slot] - played_buffer_index_), 0);
+  played_buffer_index_ = ring_buffer_indices_[slot];
+
   if (mute_audio_)
     dest->Zero();
   else
-    output_bus_->CopyTo(dest);
+    ring_[slot]->CopyTo(dest);
+
+  AdaptRingDepth(late);
+
+  // Next, UpdatePendingBytes() asks for one more buffer. If that won't be
+  // enough to fill the ring, give the renderer a moment to fill another.
+  if (ring_size_ + 1 < ring_depth_) {
+    RequestBuffer();
+    if (skip_top_up_wait_)
+      return;
+    if (ReceiveBuffer(top_up_wait_)) {
+      RequestBuffer();
+    } else if (request_pending_ &&
+               static_cast<int32>(pending_buffer_index_ - last_request) > 0) {
+      // The renderer couldn't fill a buffer asked for during this callback
+      // in time, so it would miss the wait on every callback from now on.
+      // Don't wait again until it is late.
+      skip_top_up_wait_ = true;
+    }
+  }
 }
 
 void AudioSyncReader::Close() {
@@ -140,56 +244,86 @@ bool AudioSyncReader::PrepareForeignSocket(
   return foreign_socket_->PrepareTransitDescriptor(process_handle, descriptor);
 }
 
-bool AudioSyncReader::WaitUntilDataIsReady() {
-  base::TimeDelta timeout = maximum_wait_time_;
-  const base::TimeTicks start_time = base::TimeTicks::Now();
-  const base::TimeTicks finish_time = start_time + timeout;
+void AudioSyncReader::RequestBuffer() {
+  if (request_pending_ || ring_size_ >= ring_depth_)
+    return;
+
+  // Zero out the entire output buffer to avoid stuttering/repeating-buffers
+  // in the anomalous case if the renderer is unable to keep up with real-time.
+  output_bus_->Zero();
+
+  // The buffer plays after those in the ring.
+  uint32_t bytes =
+      pending_bytes_ + static_cast<uint32_t>(ring_size_) * bytes_per_buffer_;
+  socket_->Send(&bytes, sizeof(bytes));
+  pending_buffer_index_ = ++buffer_index_;
+  request_pending_ = true;
+}
+
+bool AudioSyncReader::ReceiveBuffer(base::TimeDelta timeout) {
+  const bool blocking = timeout > base::TimeDelta();
+  const base::TimeTicks finish_time = base::TimeTicks::Now() + timeout;
 
-  // Check if data is ready and if not, wait a reasonable amount of time for it.
-  //
   // Data readiness is achieved via parallel counters, one on the renderer side
-  // and one here.  Every time a buffer is requested via UpdatePendingBytes(),
-  // |buffer_index_| is incremented.  Subsequently every time the renderer has a
-  // buffer ready it increments its counter and sends the counter value over the
-  // SyncSocket.  Data is ready when |buffer_index_| matches the counter value
-  // received from the renderer.
+  // and one here.  Every time a buffer is requested, |buffer_index_| is
+  // incremented.  Subsequently every time the renderer has a buffer ready it
+  // increments its counter and sends the counter value over the SyncSocket.
+  // The buffer asked for is ready when |pending_buffer_index_| matches the
+  // counter value received from the renderer.
   //
-  // The counter values may temporarily become out of sync if the renderer is
-  // unable to deliver audio fast enough.  It's assumed that the renderer will
-  // catch up at some point, which means discarding counter values read from the
-  // SyncSocket which don't match our current buffer index.
-  size_t bytes_received = 0;
-  uint32 renderer_buffer_index = 0;
-  while (timeout.InMicroseconds() > 0) {
-    bytes_received = socket_->ReceiveWithTimeout(
-        &renderer_buffer_index, sizeof(renderer_buffer_index), timeout);
-    if (bytes_received != sizeof(renderer_buffer_index)) {
-      bytes_received = 0;
-      break;
+  // Other counter values answer requests which didn't ask for data, like the
+  // pause mark, and are discarded.
+  while (request_pending_) {
+    uint32 renderer_buffer_index = 0;
+    size_t bytes_received = 0;
+    if (blocking) {
+      if (timeout <= base::TimeDelta())
+        return false;
+      bytes_received = socket_->ReceiveWithTimeout(
+          &renderer_buffer_index, sizeof(renderer_buffer_index), timeout);
+    } else if (socket_->Peek() >= sizeof(renderer_buffer_index)) {
+      bytes_received = socket_->Receive(&renderer_buffer_index,
+                                        sizeof(renderer_buffer_index));
     }
+    if (bytes_received != sizeof(renderer_buffer_index))
+      return false;
 
-    if (renderer_buffer_index == buffer_index_)
-      break;
+    if (renderer_buffer_index == pending_buffer_index_) {
+      request_pending_ = false;
+      if (discard_pending_buffer_) {
+        discard_pending_buffer_ = false;
+        return true;
+      }
+
+      const size_t slot = (ring_start_ + ring_size_) % kMaxRingDepth;
+      output_bus_->CopyTo(ring_[slot]);
+      ring_buffer_indices_[slot] = renderer_buffer_index;
+      ++ring_size_;
+      return true;
+    }
 
     // Reduce the timeout value as receives succeed, but aren't the right index.
     timeout = finish_time - base::TimeTicks::Now();
   }
+  return false;
+}
 
-  // Receive timed out or another error occurred.  Receive can timeout if the
-  // renderer is unable to deliver audio data within the allotted time.
-  if (!bytes_received || renderer_buffer_index != buffer_index_) {
-    DVLOG(2) << "AudioSyncReader::WaitUntilDataIsReady() timed out.";
-
-    base::TimeDelta time_since_start = base::TimeTicks::Now() - start_time;
-    UMA_HISTOGRAM_CUSTOM_TIMES("Media.AudioOutputControllerDataNotReady",
-                               time_since_start,
-                               base::TimeDelta::FromMilliseconds(1),
-                               base::TimeDelta::FromMilliseconds(1000),
-                               50);
-    return false;
+void AudioSyncReader::AdaptRingDepth(bool late) {
+  if (late) {
+    callbacks_since_late_ = 0;
+    if (ring_depth_ < kMaxRingDepth) {
+      ++ring_depth_;
+      max_ring_depth_ = std::max(max_ring_depth_, ring_depth_);
+    }
+    return;
   }
 
-  return true;
+  if (++callbacks_since_late_ < callbacks_before_shrinking_ ||
+      ring_depth_ == 1) {
+    return;
+  }
+  --ring_depth_;
+  callbacks_since_late_ = 0;
 }
 
 }  // namespace content
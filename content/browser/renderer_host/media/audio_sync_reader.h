@@ -5,6 +5,9 @@
 #ifndef CONTENT_BROWSER_RENDERER_HOST_MEDIA_AUDIO_SYNC_READER_H_
 #define CONTENT_BROWSER_RENDERER_HOST_MEDIA_AUDIO_SYNC_READER_H_
 
+#include <vector>
+
+#include "base/memory/scoped_vector.h"
 #include "base/process/process.h"
 #include "base/sync_socket.h"
 #include "base/synchronization/lock.h"
@@ -26,6 +29,23 @@ namespace content {
 // is used by AudioOutputController to provide a low latency data source for
 // transmitting audio packets between the browser process and the renderer
 // process.
+//
+// The renderer fills the shared memory one buffer at a time, when asked over
+// the socket. Filled buffers are moved into a ring, so the renderer can fill
+// ahead of the audio device and a late renderer doesn't immediately become a
+// glitch. The ring starts one buffer deep, which is what the device plays
+// next, grows whenever the renderer runs late, and shrinks again after the
+// renderer has kept up for a while.
+//
+// Read() still blocks the audio device thread for a bounded time in two cases.
+// When the ring is empty, it waits up to |maximum_wait_time_| for the renderer
+// rather than play silence right away. While the ring is below its depth, it
+// waits up to |top_up_wait_|, a quarter of a buffer, for one more buffer after
+// playing one. The renderer is only asked for one buffer at a time, since the
+// next would overwrite the shared memory, so without that wait the ring would
+// never grow. If the renderer can't fill a buffer within |top_up_wait_|, the
+// wait stops after the first one that times out, until the renderer is late
+// again.
 class AudioSyncReader : public media::AudioOutputController::SyncReader {
  public:
   AudioSyncReader(base::SharedMemory* shared_memory,
@@ -42,10 +62,26 @@ class AudioSyncReader : public media::AudioOutputController::SyncReader {
   bool PrepareForeignSocket(base::ProcessHandle process_handle,
                             base::SyncSocket::TransitDescriptor* descriptor);
 
+  // The number of buffers the renderer is asked to keep filled.
+  size_t ring_depth() const { return ring_depth_; }
+
+ protected:
+  // Socket for transmitting audio data.
+  scoped_ptr<base::CancelableSyncSocket> socket_;
+
  private:
-  // Blocks until data is ready for reading or a timeout expires.  Returns false
-  // if an error or timeout occurs.
-  bool WaitUntilDataIsReady();
+  // Asks the renderer to fill the shared memory, unless it is filling it
+  // already or the ring is full.
+  void RequestBuffer();
+
+  // Waits up to |timeout| for the renderer to fill the buffer last asked for,
+  // and moves it into the ring. Returns false if it didn't arrive in time, or
+  // if an error occurs. Doesn't block if |timeout| is zero.
+  bool ReceiveBuffer(base::TimeDelta timeout);
+
+  // Grows the ring if the renderer was |late| for this callback, or shrinks it
+  // once it has kept up for long enough.
+  void AdaptRingDepth(bool late);
 
   const base::SharedMemory* const shared_memory_;
 
@@ -53,9 +89,6 @@ class AudioSyncReader : public media::AudioOutputController::SyncReader {
   // during automated testing.
   const bool mute_audio_;
 
-  // Socket for transmitting audio data.
-  scoped_ptr<base::CancelableSyncSocket> socket_;
-
   // Socket to be used by the renderer. The reference is released after
   // PrepareForeignSocketHandle() is called and ran successfully.
   scoped_ptr<base::CancelableSyncSocket> foreign_socket_;
@@ -75,10 +108,54 @@ class AudioSyncReader : public media::AudioOutputController::SyncReader {
   // from the parameters given at construction.
   const base::TimeDelta maximum_wait_time_;
 
-  // The index of the audio buffer we're expecting to be sent from the renderer;
-  // used to block with timeout for audio data.
+  // How long a callback waits for the renderer to fill the ring while it grows.
+  const base::TimeDelta top_up_wait_;
+
+  // Size of one buffer of audio data, to report the delay of buffers which
+  // play after those in the ring.
+  const uint32_t bytes_per_buffer_;
+
+  // The index of the last request sent to the renderer. The renderer counts
+  // the requests it handled, and sends that count back when it is done.
   uint32 buffer_index_;
 
+  // Whether the renderer is filling the shared memory, for the request with
+  // |pending_buffer_index_|. It is only ever asked to fill one buffer at a
+  // time, since the next one would overwrite it.
+  bool request_pending_;
+  uint32 pending_buffer_index_;
+
+  // Whether the buffer being filled is dropped once it arrives, because the
+  // stream was paused in the meantime.
+  bool discard_pending_buffer_;
+
+  // The delay reported by the last UpdatePendingBytes() call.
+  uint32_t pending_bytes_;
+
+  // Whether no Read() happened since the stream started playing.
+  bool stream_starting_;
+
+  // Whether Read() stops waiting to top up the ring, because the renderer
+  // didn't fill a buffer within |top_up_wait_| since it was last late.
+  bool skip_top_up_wait_;
+
+  // Buffers filled by the renderer, oldest first, and the index of the request
+  // each one answered. The ring holds up to |ring_depth_| buffers.
+  ScopedVector<media::AudioBus> ring_;
+  std::vector<uint32> ring_buffer_indices_;
+  size_t ring_start_;
+  size_t ring_size_;
+  size_t ring_depth_;
+  size_t max_ring_depth_;
+
+  // The index of the buffer Read() played last.
+  uint32 played_buffer_index_;
+
+  // Number of callbacks since the renderer was last late, and after how many
+  // the ring shrinks by a buffer.
+  int64 callbacks_since_late_;
+  const int64 callbacks_before_shrinking_;
+
   DISALLOW_COPY_AND_ASSIGN(AudioSyncReader);
 };
 
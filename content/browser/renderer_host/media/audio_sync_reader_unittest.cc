@@ -0,0 +1,277 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "content/browser/renderer_host/media/audio_sync_reader.h"
+
+#include <algorithm>
+#include <deque>
+#include <map>
+
+#include "base/memory/scoped_ptr.h"
+#include "base/memory/shared_memory.h"
+#include "base/sync_socket.h"
+#include "base/time/time.h"
+#include "content/public/test/test_browser_thread_bundle.h"
+#include "media/audio/audio_parameters.h"
+#include "media/base/audio_bus.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+using base::TimeDelta;
+using media::AudioBus;
+using media::AudioParameters;
+
+namespace content {
+
+namespace {
+
+const int kSampleRate = 48000;
+const int kBitsPerSample = 16;
+const int kFramesPerBuffer = 480;  // 10 ms
+
+const uint32_t kPauseMark = kuint32max;
+
+// How long the renderer takes to fill a buffer, unless told otherwise.
+const int kRenderTimeMs = 1;
+
+}  // namespace
+
+// Plays the renderer at the other end of the socket, on a clock of its own.
+// Each request is answered once the renderer filled the buffer, which takes
+// its render time or the delay injected for that request, after the previous
+// request is answered. Waiting for an answer moves the clock forward.
+class FakeRendererSocket : public base::CancelableSyncSocket {
+ public:
+  explicit FakeRendererSocket(AudioBus* renderer_bus)
+      : renderer_bus_(renderer_bus),
+        render_time_(TimeDelta::FromMilliseconds(kRenderTimeMs)),
+        requests_(0),
+        timeouts_(0) {}
+
+  size_t Send(const void* buffer, size_t length) override {
+    EXPECT_EQ(sizeof(uint32_t), length);
+    uint32_t bytes = *static_cast<const uint32_t*>(buffer);
+
+    Answer answer;
+    answer.buffer_index = ++requests_;
+    answer.fills = bytes != kPauseMark;
+    if (answer.fills) {
+      EXPECT_TRUE(answers_.empty() || !answers_.back().fills)
+          << "Asked to fill a buffer before the last one arrived.";
+    }
+    TimeDelta start = std::max(now_, answers_.empty()
+                                         ? TimeDelta()
+                                         : answers_.back().ready_time);
+    answer.ready_time = start;
+    if (answer.fills) {
+      std::map<uint32_t, TimeDelta>::const_iterator it =
+          delays_.find(answer.buffer_index);
+      answer.ready_time += it == delays_.end() ? render_time_ : it->second;
+    }
+    answers_.push_back(answer);
+    return length;
+  }
+
+  size_t Receive(void* buffer, size_t length) override {
+    EXPECT_EQ(sizeof(uint32_t), length);
+    if (!Peek())
+      return 0;
+
+    Answer answer = answers_.front();
+    answers_.pop_front();
+    // Stamp the buffer with its index, so that tests can tell which one
+    // played.
+    if (answer.fills) {
+      std::fill(renderer_bus_->channel(0),
+                renderer_bus_->channel(0) + renderer_bus_->frames(),
+                static_cast<float>(answer.buffer_index));
+    }
+    *static_cast<uint32_t*>(buffer) = answer.buffer_index;
+    return length;
+  }
+
+  size_t ReceiveWithTimeout(void* buffer,
+                            size_t length,
+                            TimeDelta timeout) override {
+    if (answers_.empty() || answers_.front().ready_time > now_ + timeout) {
+      now_ += timeout;
+      ++timeouts_;
+      return 0;
+    }
+    now_ = std::max(now_, answers_.front().ready_time);
+    return Receive(buffer, length);
+  }
+
+  size_t Peek() override {
+    return !answers_.empty() && answers_.front().ready_time <= now_
+               ? sizeof(uint32_t)
+               : 0;
+  }
+
+  // Makes the renderer take |delay| to fill the buffer for the |request|th
+  // request, counting from the next one.
+  void DelayRequest(uint32_t request, TimeDelta delay) {
+    delays_[requests_ + request] = delay;
+  }
+
+  // Makes the renderer take |render_time| to fill each buffer from now on.
+  void set_render_time(TimeDelta render_time) { render_time_ = render_time; }
+
+  void AdvanceTo(TimeDelta now) { now_ = std::max(now_, now); }
+
+  uint32_t requests() const { return requests_; }
+
+  // How many times waiting for an answer timed out.
+  int timeouts() const { return timeouts_; }
+
+ private:
+  struct Answer {
+    uint32_t buffer_index;
+    bool fills;
+    TimeDelta ready_time;
+  };
+
+  AudioBus* const renderer_bus_;
+  TimeDelta now_;
+  TimeDelta render_time_;
+  uint32_t requests_;
+  int timeouts_;
+  std::deque<Answer> answers_;
+  std::map<uint32_t, TimeDelta> delays_;
+
+  DISALLOW_COPY_AND_ASSIGN(FakeRendererSocket);
+};
+
+class AudioSyncReaderUnderTest : public AudioSyncReader {
+ public:
+  AudioSyncReaderUnderTest(base::SharedMemory* shared_memory,
+                           const AudioParameters& params,
+                           base::CancelableSyncSocket* socket)
+      : AudioSyncReader(shared_memory, params) {
+    socket_.reset(socket);
+  }
+};
+
+class AudioSyncReaderTest : public testing::Test {
+ public:
+  AudioSyncReaderTest()
+      : params_(AudioParameters::AUDIO_FAKE, media::CHANNEL_LAYOUT_MONO,
+                kSampleRate, kBitsPerSample, kFramesPerBuffer),
+        callbacks_(0),
+        last_played_(0) {
+    EXPECT_TRUE(shared_memory_.CreateAndMapAnonymous(
+        sizeof(media::AudioOutputBufferParameters) +
+        AudioBus::CalculateMemorySize(params_)));
+    media::AudioOutputBuffer* buffer =
+        static_cast<media::AudioOutputBuffer*>(shared_memory_.memory());
+    renderer_bus_ = AudioBus::WrapMemory(params_, buffer->audio);
+    socket_ = new FakeRendererSocket(renderer_bus_.get());
+    reader_.reset(
+        new AudioSyncReaderUnderTest(&shared_memory_, params_, socket_));
+    dest_ = AudioBus::Create(params_);
+  }
+
+ protected:
+  // Starts playing, like AudioOutputController::DoPlay().
+  void Start() { reader_->UpdatePendingBytes(0, 0); }
+
+  // Plays |count| buffers the way AudioOutputController::OnMoreData() does,
+  // one every buffer duration. Returns how many of them were glitches.
+  int Play(int count) {
+    int glitches = 0;
+    for (int i = 0; i < count; ++i) {
+      socket_->AdvanceTo(params_.GetBufferDuration() * callbacks_++);
+      reader_->Read(dest_.get());
+      float played = dest_->channel(0)[0];
+      if (played == 0) {
+        ++glitches;
+      } else {
+        // Buffers play in order, and each one only once.
+        EXPECT_GT(played, last_played_);
+        last_played_ = played;
+      }
+      reader_->UpdatePendingBytes(0, 0);
+    }
+    return glitches;
+  }
+
+  TestBrowserThreadBundle thread_bundle_;
+  const AudioParameters params_;
+  base::SharedMemory shared_memory_;
+  scoped_ptr<AudioBus> renderer_bus_;
+  FakeRendererSocket* socket_;
+  scoped_ptr<AudioSyncReaderUnderTest> reader_;
+  scoped_ptr<AudioBus> dest_;
+  int64 callbacks_;
+  float last_played_;
+};
+
+TEST_F(AudioSyncReaderTest, RendererKeepsUp) {
+  Start();
+  EXPECT_EQ(0, Play(100));
+  EXPECT_EQ(1u, reader_->ring_depth());
+}
+
+TEST_F(AudioSyncReaderTest, RingAbsorbsLateRenderer) {
+  const TimeDelta kHiccup = TimeDelta::FromMilliseconds(35);
+  Start();
+
+  // Longer than a buffer and the time the device waits, so the first one
+  // is heard.
+  socket_->DelayRequest(20, kHiccup);
+  EXPECT_LT(0, Play(100));
+  EXPECT_LT(1u, reader_->ring_depth());
+
+  // The renderer fills ahead from now on, and the same hiccups go unheard.
+  for (int i = 0; i < 5; ++i) {
+    socket_->DelayRequest(20, kHiccup);
+    EXPECT_EQ(0, Play(100)) << i;
+  }
+}
+
+TEST_F(AudioSyncReaderTest, RingShrinksWhileRendererKeepsUp) {
+  Start();
+  socket_->DelayRequest(20, TimeDelta::FromMilliseconds(35));
+  Play(100);
+  size_t depth = reader_->ring_depth();
+  ASSERT_LT(1u, depth);
+
+  // A buffer of latency is given back every 10 seconds.
+  EXPECT_EQ(0, Play(1000));
+  EXPECT_EQ(depth - 1, reader_->ring_depth());
+  EXPECT_EQ(0, Play(1000 * (depth - 2)));
+  EXPECT_EQ(1u, reader_->ring_depth());
+}
+
+TEST_F(AudioSyncReaderTest, PauseDropsBuffersFilledAhead) {
+  Start();
+  socket_->DelayRequest(20, TimeDelta::FromMilliseconds(35));
+  Play(100);
+  ASSERT_LT(1u, reader_->ring_depth());
+
+  // The stream resumes with buffers asked for after the pause.
+  uint32_t pause_request = socket_->requests() + 1;
+  reader_->UpdatePendingBytes(kPauseMark, 0);
+  Start();
+  EXPECT_EQ(0, Play(1));
+  EXPECT_GT(last_played_, pause_request);
+  EXPECT_EQ(0, Play(100));
+}
+
+TEST_F(AudioSyncReaderTest, SlowRendererIsWaitedOnOnce) {
+  Start();
+  socket_->DelayRequest(20, TimeDelta::FromMilliseconds(35));
+  Play(100);
+  ASSERT_LT(1u, reader_->ring_depth());
+
+  // Restart with an empty ring, and a renderer which keeps up but can't fill
+  // a buffer within the wait to top up the ring.
+  reader_->UpdatePendingBytes(kPauseMark, 0);
+  socket_->set_render_time(TimeDelta::FromMilliseconds(5));
+  Start();
+  int timeouts = socket_->timeouts();
+  EXPECT_EQ(0, Play(200));
+  EXPECT_EQ(timeouts + 1, socket_->timeouts());
+}
+
+}  // namespace content
@@ -4,7 +4,9 @@
 #include "content/browser/renderer_host/media/peer_connection_tracker_host.h"
 
 #include "base/power_monitor/power_monitor.h"
+#include "base/values.h"
 #include "content/browser/media/webrtc_internals.h"
+#include "content/common/media/peer_connection_stats_encoding.h"
 #include "content/common/media/peer_connection_tracker_messages.h"
 #include "content/public/browser/render_process_host.h"
 
@@ -23,9 +25,8 @@ bool PeerConnectionTrackerHost::OnMessageReceived(const IPC::Message& message) {
                         OnAddPeerConnection)
     IPC_MESSAGE_HANDLER(PeerConnectionTrackerHost_RemovePeerConnection,
                         OnRemovePeerConnection)
-    IPC_MESSAGE_HANDLER(PeerConnectionTrackerHost_UpdatePeerConnection,
-                        OnUpdatePeerConnection)
-    IPC_MESSAGE_HANDLER(PeerConnectionTrackerHost_AddStats, OnAddStats)
+    IPC_MESSAGE_HANDLER(PeerConnectionTrackerHost_UpdatePeerConnections,
+                        OnUpdatePeerConnections)
     IPC_MESSAGE_HANDLER(PeerConnectionTrackerHost_GetUserMedia, OnGetUserMedia)
     IPC_MESSAGE_UNHANDLED(handled = false)
   IPC_END_MESSAGE_MAP()
@@ -64,6 +65,8 @@ void PeerConnectionTrackerHost::OnChannelClosing() {
 
 void PeerConnectionTrackerHost::OnAddPeerConnection(
     const PeerConnectionInfo& info) {
+  stats_decoders_.set(info.lid,
+                      make_scoped_ptr(new PeerConnectionStatsDecoder()));
   WebRTCInternals::GetInstance()->OnAddPeerConnection(
       render_process_id_,
       peer_pid(),
@@ -74,21 +77,31 @@ void PeerConnectionTrackerHost::OnAddPeerConnection(
 }
 
 void PeerConnectionTrackerHost::OnRemovePeerConnection(int lid) {
+  stats_decoders_.erase(lid);
   WebRTCInternals::GetInstance()->OnRemovePeerConnection(peer_pid(), lid);
 }
 
-void PeerConnectionTrackerHost::OnUpdatePeerConnection(
-    int lid, const std::string& type, const std::string& value) {
-  WebRTCInternals::GetInstance()->OnUpdatePeerConnection(
-      peer_pid(),
-      lid,
-      type,
-      value);
-}
-
-void PeerConnectionTrackerHost::OnAddStats(int lid,
-                                           const base::ListValue& value) {
-  WebRTCInternals::GetInstance()->OnAddStats(peer_pid(), lid, value);
+void PeerConnectionTrackerHost::OnUpdatePeerConnections(
+    const std::vector<PeerConnectionUpdate>& updates) {
+  WebRTCInternals* webrtc_internals = WebRTCInternals::GetInstance();
+  for (const auto& update : updates) {
+    if (update.stats.empty()) {
+      webrtc_internals->OnUpdatePeerConnection(
+          peer_pid(), update.lid, update.type, update.value);
+      continue;
+    }
+
+    PeerConnectionStatsDecoder* decoder = stats_decoders_.get(update.lid);
+    if (!decoder)
+      continue;
+    base::ListValue reports;
+    if (!decoder->Decode(update.stats, &reports)) {
+      // The decoder picks up again once the renderer's encoder starts over.
+      DLOG(ERROR) << "Invalid stats for peer connection " << update.lid;
+      continue;
+    }
+    webrtc_internals->OnAddStats(peer_pid(), update.lid, reports);
+  }
 }
 
 void PeerConnectionTrackerHost::OnGetUserMedia(
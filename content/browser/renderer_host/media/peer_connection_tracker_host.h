@@ -5,17 +5,19 @@
 #ifndef CONTENT_BROWSER_RENDERER_HOST_MEDIA_PEER_CONNECTION_TRACKER_HOST_H_
 #define CONTENT_BROWSER_RENDERER_HOST_MEDIA_PEER_CONNECTION_TRACKER_HOST_H_
 
+#include <vector>
+
+#include "base/containers/scoped_ptr_hash_map.h"
 #include "base/power_monitor/power_observer.h"
 #include "content/public/browser/browser_message_filter.h"
 
 struct PeerConnectionInfo;
-
-namespace base {
-class ListValue;
-}  // namespace base
+struct PeerConnectionUpdate;
 
 namespace content {
 
+class PeerConnectionStatsDecoder;
+
 // This class is the host for PeerConnectionTracker in the browser process
 // managed by RenderProcessHostImpl. It receives PeerConnection events from
 // PeerConnectionTracker as IPC messages that it forwards to WebRTCInternals.
@@ -42,9 +44,8 @@ class PeerConnectionTrackerHost : public BrowserMessageFilter,
   // Handlers for peer connection messages coming from the renderer.
   void OnAddPeerConnection(const PeerConnectionInfo& info);
   void OnRemovePeerConnection(int lid);
-  void OnUpdatePeerConnection(
-      int lid, const std::string& type, const std::string& value);
-  void OnAddStats(int lid, const base::ListValue& value);
+  void OnUpdatePeerConnections(
+      const std::vector<PeerConnectionUpdate>& updates);
   void OnGetUserMedia(const std::string& origin,
                       bool audio,
                       bool video,
@@ -54,6 +55,12 @@ class PeerConnectionTrackerHost : public BrowserMessageFilter,
 
   int render_process_id_;
 
+  // Decodes the stats of each peer connection, by local ID. Only used on the
+  // UI thread.
+  typedef base::ScopedPtrHashMap<int, scoped_ptr<PeerConnectionStatsDecoder>>
+      StatsDecoderMap;
+  StatsDecoderMap stats_decoders_;
+
   DISALLOW_COPY_AND_ASSIGN(PeerConnectionTrackerHost);
 };
 
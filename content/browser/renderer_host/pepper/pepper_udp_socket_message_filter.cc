@@ -4,10 +4,12 @@
 
 #include "content/browser/renderer_host/pepper/pepper_udp_socket_message_filter.h"
 
+#include <algorithm>
 #include <cstring>
 
 #include "base/compiler_specific.h"
 #include "base/logging.h"
+#include "base/memory/shared_memory.h"
 #include "base/metrics/histogram_macros.h"
 #include "content/browser/renderer_host/pepper/browser_ppapi_host_impl.h"
 #include "content/browser/renderer_host/pepper/pepper_socket_utils.h"
@@ -28,16 +30,19 @@
 #include "ppapi/host/ppapi_host.h"
 #include "ppapi/host/resource_host.h"
 #include "ppapi/proxy/ppapi_messages.h"
+#include "ppapi/proxy/serialized_handle.h"
 #include "ppapi/proxy/udp_socket_filter.h"
 #include "ppapi/proxy/udp_socket_resource_base.h"
 #include "ppapi/shared_impl/private/net_address_private_impl.h"
 #include "ppapi/shared_impl/socket_option_data.h"
+#include "ppapi/shared_impl/udp_packet_ring.h"
 
 #if defined(OS_CHROMEOS)
 #include "chromeos/network/firewall_hole.h"
 #endif  // defined(OS_CHROMEOS)
 
 using ppapi::NetAddressPrivateImpl;
+using ppapi::UDPPacketRing;
 using ppapi::host::NetErrorToPepperError;
 using ppapi::proxy::UDPSocketFilter;
 using ppapi::proxy::UDPSocketResourceBase;
@@ -46,6 +51,11 @@ namespace {
 
 size_t g_num_instances = 0;
 
+std::string GetAddressKey(const PP_NetAddress_Private& addr) {
+  return std::string(addr.data,
+                     std::min(static_cast<size_t>(addr.size), sizeof(addr.data)));
+}
+
 }  // namespace
 
 namespace content {
@@ -54,8 +64,13 @@ PepperUDPSocketMessageFilter::PendingSend::PendingSend(
     const net::IPAddressNumber& address,
     int port,
     const scoped_refptr<net::IOBufferWithSize>& buffer,
-    const ppapi::host::ReplyMessageContext& context)
-    : address(address), port(port), buffer(buffer), context(context) {
+    const ppapi::host::ReplyMessageContext& context,
+    bool from_ring)
+    : address(address),
+      port(port),
+      buffer(buffer),
+      context(context),
+      from_ring(from_ring) {
 }
 
 PepperUDPSocketMessageFilter::PendingSend::~PendingSend() {
@@ -72,6 +87,10 @@ PepperUDPSocketMessageFilter::PepperUDPSocketMessageFilter(
       multicast_ttl_(0),
       can_use_multicast_(PP_ERROR_FAILED),
       closed_(false),
+      ring_sends_in_flight_(0),
+      recv_ring_full_(false),
+      held_recv_result_(PP_OK),
+      held_recv_addr_(NetAddressPrivateImpl::kInvalidNetAddress),
       remaining_recv_slots_(UDPSocketFilter::kPluginReceiveBufferSlots),
       external_plugin_(host->external_plugin()),
       private_api_(private_api),
@@ -105,6 +124,7 @@ PepperUDPSocketMessageFilter::OverrideTaskRunnerForMessage(
     case PpapiHostMsg_UDPSocket_SetOption::ID:
     case PpapiHostMsg_UDPSocket_Close::ID:
     case PpapiHostMsg_UDPSocket_RecvSlotAvailable::ID:
+    case PpapiHostMsg_UDPSocket_SendRingDoorbell::ID:
       return BrowserThread::GetMessageLoopProxyForThread(BrowserThread::IO);
     case PpapiHostMsg_UDPSocket_Bind::ID:
     case PpapiHostMsg_UDPSocket_SendTo::ID:
@@ -128,6 +148,8 @@ int32_t PepperUDPSocketMessageFilter::OnResourceMessageReceived(
                                         OnMsgClose)
     PPAPI_DISPATCH_HOST_RESOURCE_CALL_0(
         PpapiHostMsg_UDPSocket_RecvSlotAvailable, OnMsgRecvSlotAvailable)
+    PPAPI_DISPATCH_HOST_RESOURCE_CALL_0(
+        PpapiHostMsg_UDPSocket_SendRingDoorbell, OnMsgSendRingDoorbell)
     PPAPI_DISPATCH_HOST_RESOURCE_CALL(PpapiHostMsg_UDPSocket_JoinGroup,
                                       OnMsgJoinGroup)
     PPAPI_DISPATCH_HOST_RESOURCE_CALL(PpapiHostMsg_UDPSocket_LeaveGroup,
@@ -336,6 +358,19 @@ int32_t PepperUDPSocketMessageFilter::OnMsgRecvSlotAvailable(
     const ppapi::host::HostMessageContext* context) {
   DCHECK_CURRENTLY_ON(BrowserThread::IO);
 
+  if (recv_ring_) {
+    // The plugin has made room in |recv_ring_|.
+    if (!recv_ring_full_ ||
+        !PushToRecvRing(held_recv_result_, held_recv_data_, held_recv_addr_)) {
+      return PP_OK;
+    }
+    recv_ring_full_ = false;
+    held_recv_data_.clear();
+    if (!recvfrom_buffer_.get() && !closed_ && socket_.get())
+      DoRecvFrom();
+    return PP_OK;
+  }
+
   if (remaining_recv_slots_ < UDPSocketFilter::kPluginReceiveBufferSlots) {
     remaining_recv_slots_++;
   }
@@ -348,6 +383,17 @@ int32_t PepperUDPSocketMessageFilter::OnMsgRecvSlotAvailable(
   return PP_OK;
 }
 
+int32_t PepperUDPSocketMessageFilter::OnMsgSendRingDoorbell(
+    const ppapi::host::HostMessageContext* context) {
+  DCHECK_CURRENTLY_ON(BrowserThread::IO);
+
+  bool was_idle = pending_sends_.empty();
+  DrainSendRing();
+  if (was_idle)
+    StartPendingSends();
+  return PP_OK;
+}
+
 int32_t PepperUDPSocketMessageFilter::OnMsgJoinGroup(
     const ppapi::host::HostMessageContext* context,
     const PP_NetAddress_Private& addr) {
@@ -512,7 +558,9 @@ void PepperUDPSocketMessageFilter::OnBindComplete(
     const PP_NetAddress_Private& net_address) {
   DCHECK_CURRENTLY_ON(BrowserThread::IO);
   socket_.swap(socket);
-  SendBindReply(context, PP_OK, net_address);
+  ppapi::host::ReplyMessageContext reply_context(context);
+  CreateRings(&reply_context);
+  SendBindReply(reply_context, PP_OK, net_address);
 
   DoRecvFrom();
 }
@@ -591,24 +639,28 @@ void PepperUDPSocketMessageFilter::DoSendTo(
     return;
   }
 
+  // The permission check for |addr| has passed, so the plugin may now send
+  // to it through |send_ring_|.
+  if (send_ring_)
+    permitted_send_addresses_.insert(GetAddressKey(addr));
+
   scoped_refptr<net::IOBufferWithSize> buffer(
       new net::IOBufferWithSize(num_bytes));
   memcpy(buffer->data(), data.data(), num_bytes);
 
   // Make sure a malicious plugin can't queue up an unlimited number of buffers.
   size_t num_pending_sends = pending_sends_.size();
-  if (num_pending_sends == UDPSocketResourceBase::kPluginSendBufferSlots) {
+  if (num_pending_sends - ring_sends_in_flight_ ==
+      UDPSocketResourceBase::kPluginSendBufferSlots) {
     SendSendToError(context, PP_ERROR_FAILED);
     return;
   }
 
-  pending_sends_.push(PendingSend(address, port, buffer, context));
+  pending_sends_.push(PendingSend(address, port, buffer, context, false));
   // If there are other sends pending, we can't start yet.
   if (num_pending_sends)
     return;
-  int net_result = StartPendingSend();
-  if (net_result != net::ERR_IO_PENDING)
-    FinishPendingSend(net_result);
+  StartPendingSends();
 }
 
 int PepperUDPSocketMessageFilter::StartPendingSend() {
@@ -625,11 +677,136 @@ int PepperUDPSocketMessageFilter::StartPendingSend() {
   return net_result;
 }
 
+void PepperUDPSocketMessageFilter::StartPendingSends() {
+  while (!pending_sends_.empty()) {
+    int net_result = StartPendingSend();
+    if (net_result == net::ERR_IO_PENDING)
+      break;
+    FinishPendingSend(net_result);
+  }
+}
+
 void PepperUDPSocketMessageFilter::Close() {
   DCHECK_CURRENTLY_ON(BrowserThread::IO);
   if (socket_.get() && !closed_)
     socket_->Close();
   closed_ = true;
+  recv_ring_.reset();
+  send_ring_.reset();
+}
+
+void PepperUDPSocketMessageFilter::CreateRings(
+    ppapi::host::ReplyMessageContext* context) {
+  DCHECK_CURRENTLY_ON(BrowserThread::IO);
+  if (!resource_host())
+    return;
+
+  scoped_ptr<UDPPacketRing> recv_ring = CreateRing();
+  scoped_ptr<UDPPacketRing> send_ring = CreateRing();
+  if (!recv_ring || !send_ring)
+    return;
+
+  const base::Process& plugin_process = host_->GetPluginProcess();
+  base::SharedMemoryHandle recv_handle;
+  base::SharedMemoryHandle send_handle;
+  if (!recv_ring->shm()->ShareToProcess(plugin_process.Handle(),
+                                        &recv_handle) ||
+      !send_ring->shm()->ShareToProcess(plugin_process.Handle(),
+                                        &send_handle)) {
+    return;
+  }
+
+  // The plugin expects the receive ring first.
+  size_t size = UDPPacketRing::GetSharedMemorySize();
+  context->params.AppendHandle(
+      ppapi::proxy::SerializedHandle(recv_handle, size));
+  context->params.AppendHandle(
+      ppapi::proxy::SerializedHandle(send_handle, size));
+  recv_ring_ = recv_ring.Pass();
+  send_ring_ = send_ring.Pass();
+}
+
+scoped_ptr<UDPPacketRing> PepperUDPSocketMessageFilter::CreateRing() {
+  scoped_ptr<base::SharedMemory> shm(new base::SharedMemory);
+  if (!shm->CreateAndMapAnonymous(UDPPacketRing::GetSharedMemorySize()))
+    return scoped_ptr<UDPPacketRing>();
+  scoped_ptr<UDPPacketRing> ring(new UDPPacketRing);
+  if (!ring->Init(shm.Pass(), true))
+    return scoped_ptr<UDPPacketRing>();
+  return ring.Pass();
+}
+
+void PepperUDPSocketMessageFilter::DrainSendRing() {
+  DCHECK_CURRENTLY_ON(BrowserThread::IO);
+  if (!send_ring_ || closed_ || !socket_.get())
+    return;
+
+  bool wake_plugin = false;
+  int32_t first_error = PP_OK;
+  while (ring_sends_in_flight_ < UDPSocketResourceBase::kPluginSendBufferSlots) {
+    uint32_t size = 0;
+    UDPPacketRing::Status status = send_ring_->Peek(&size);
+    if (status == UDPPacketRing::STATUS_EMPTY)
+      break;
+
+    scoped_refptr<net::IOBufferWithSize> buffer;
+    int32_t result = PP_OK;
+    PP_NetAddress_Private addr = NetAddressPrivateImpl::kInvalidNetAddress;
+    uint32_t popped_size = 0;
+    bool wake_producer = false;
+    if (status == UDPPacketRing::STATUS_OK && size > 0 &&
+        size <= static_cast<uint32_t>(UDPSocketResourceBase::kMaxWriteSize)) {
+      buffer = new net::IOBufferWithSize(size);
+      status = send_ring_->Pop(buffer->data(), size, &result, &addr,
+                               &popped_size, &wake_producer);
+    }
+    if (!buffer.get() || status != UDPPacketRing::STATUS_OK ||
+        popped_size != size) {
+      // The plugin has written something it could never have sent through
+      // SendTo. Stop reading its ring.
+      LOG(ERROR) << "Invalid packet in UDP send ring.";
+      send_ring_.reset();
+      first_error = PP_ERROR_FAILED;
+      break;
+    }
+    wake_plugin |= wake_producer;
+
+    net::IPAddressNumber address;
+    uint16 port;
+    int32_t error = PP_OK;
+    if (!permitted_send_addresses_.count(GetAddressKey(addr)))
+      error = PP_ERROR_NOACCESS;
+    else if (!NetAddressPrivateImpl::NetAddressToIPEndPoint(addr, &address,
+                                                            &port))
+      error = PP_ERROR_ADDRESS_INVALID;
+    if (error != PP_OK) {
+      if (first_error == PP_OK)
+        first_error = error;
+      continue;
+    }
+
+    pending_sends_.push(PendingSend(address, port, buffer,
+                                    ppapi::host::ReplyMessageContext(), true));
+    ++ring_sends_in_flight_;
+  }
+
+  if (wake_plugin || first_error != PP_OK)
+    SendSendRingSpaceAvailable(first_error);
+}
+
+bool PepperUDPSocketMessageFilter::PushToRecvRing(
+    int32_t result,
+    const std::string& data,
+    const PP_NetAddress_Private& addr) {
+  DCHECK(recv_ring_);
+  bool wake_consumer = false;
+  if (!recv_ring_->Push(result, addr, data.data(),
+                        static_cast<uint32_t>(data.size()), &wake_consumer)) {
+    return false;
+  }
+  if (wake_consumer)
+    SendRecvRingDoorbell();
+  return true;
 }
 
 void PepperUDPSocketMessageFilter::OnRecvFromCompleted(int net_result) {
@@ -647,6 +824,26 @@ void PepperUDPSocketMessageFilter::OnRecvFromCompleted(int net_result) {
     pp_result = PP_ERROR_ADDRESS_INVALID;
   }
 
+  if (recv_ring_) {
+    std::string data;
+    if (pp_result >= 0)
+      data.assign(recvfrom_buffer_->data(), pp_result);
+    int32_t result = pp_result >= 0 ? PP_OK : pp_result;
+    recvfrom_buffer_ = NULL;
+    if (!PushToRecvRing(result, data, addr)) {
+      // Hold on to the packet, and stop receiving until the plugin tells us
+      // it has made room.
+      recv_ring_full_ = true;
+      held_recv_result_ = result;
+      held_recv_data_.swap(data);
+      held_recv_addr_ = addr;
+      return;
+    }
+    if (!closed_ && socket_.get())
+      DoRecvFrom();
+    return;
+  }
+
   if (pp_result >= 0) {
     SendRecvFromResult(PP_OK, std::string(recvfrom_buffer_->data(), pp_result),
                        addr);
@@ -666,26 +863,30 @@ void PepperUDPSocketMessageFilter::OnRecvFromCompleted(int net_result) {
 void PepperUDPSocketMessageFilter::OnSendToCompleted(int net_result) {
   DCHECK_CURRENTLY_ON(BrowserThread::IO);
   FinishPendingSend(net_result);
-
-  // Start pending sends until none are left or a send doesn't complete.
-  while (!pending_sends_.empty()) {
-    net_result = StartPendingSend();
-    if (net_result == net::ERR_IO_PENDING)
-      break;
-    FinishPendingSend(net_result);
-  }
+  StartPendingSends();
 }
 
 void PepperUDPSocketMessageFilter::FinishPendingSend(int net_result) {
   DCHECK(!pending_sends_.empty());
   const PendingSend& pending_send = pending_sends_.front();
   int32_t pp_result = NetErrorToPepperError(net_result);
-  if (pp_result < 0)
+  if (pending_send.from_ring) {
+    // The plugin completed this send when it wrote the packet to the ring, so
+    // only errors are reported.
+    DCHECK_GT(ring_sends_in_flight_, 0u);
+    --ring_sends_in_flight_;
+    if (pp_result < 0)
+      SendSendRingSpaceAvailable(pp_result);
+  } else if (pp_result < 0) {
     SendSendToError(pending_send.context, pp_result);
-  else
+  } else {
     SendSendToReply(pending_send.context, PP_OK, pp_result);
+  }
 
   pending_sends_.pop();
+
+  // Refill the slot this send used.
+  DrainSendRing();
 }
 
 void PepperUDPSocketMessageFilter::SendBindReply(
@@ -720,6 +921,22 @@ void PepperUDPSocketMessageFilter::SendSendToReply(
   SendReply(reply_context, PpapiPluginMsg_UDPSocket_SendToReply(bytes_written));
 }
 
+void PepperUDPSocketMessageFilter::SendRecvRingDoorbell() {
+  if (resource_host()) {
+    resource_host()->host()->SendUnsolicitedReply(
+        resource_host()->pp_resource(),
+        PpapiPluginMsg_UDPSocket_RecvRingDoorbell());
+  }
+}
+
+void PepperUDPSocketMessageFilter::SendSendRingSpaceAvailable(int32_t result) {
+  if (resource_host()) {
+    resource_host()->host()->SendUnsolicitedReply(
+        resource_host()->pp_resource(),
+        PpapiPluginMsg_UDPSocket_SendRingSpaceAvailable(result));
+  }
+}
+
 void PepperUDPSocketMessageFilter::SendBindError(
     const ppapi::host::ReplyMessageContext& context,
     int32_t result) {
@@ -6,6 +6,7 @@
 #define CONTENT_BROWSER_RENDERER_HOST_PEPPER_PEPPER_UDP_SOCKET_MESSAGE_FILTER_H_
 
 #include <queue>
+#include <set>
 #include <string>
 
 #include "base/basictypes.h"
@@ -21,10 +22,9 @@
 #include "ppapi/c/pp_instance.h"
 #include "ppapi/c/pp_stdint.h"
 #include "ppapi/c/ppb_udp_socket.h"
+#include "ppapi/c/private/ppb_net_address_private.h"
 #include "ppapi/host/resource_message_filter.h"
 
-struct PP_NetAddress_Private;
-
 #if defined(OS_CHROMEOS)
 #include "chromeos/network/firewall_hole.h"
 #include "content/public/browser/browser_thread.h"
@@ -38,6 +38,7 @@ class IOBufferWithSize;
 namespace ppapi {
 
 class SocketOptionData;
+class UDPPacketRing;
 
 namespace host {
 struct ReplyMessageContext;
@@ -75,13 +76,17 @@ class CONTENT_EXPORT PepperUDPSocketMessageFilter
     PendingSend(const net::IPAddressNumber& address,
                 int port,
                 const scoped_refptr<net::IOBufferWithSize>& buffer,
-                const ppapi::host::ReplyMessageContext& context);
+                const ppapi::host::ReplyMessageContext& context,
+                bool from_ring);
     ~PendingSend();
 
     net::IPAddressNumber address;
     int port;
     scoped_refptr<net::IOBufferWithSize> buffer;
     ppapi::host::ReplyMessageContext context;
+    // True if the packet was read from |send_ring_|. There's no message to
+    // reply to in that case.
+    bool from_ring;
   };
 
   // ppapi::host::ResourceMessageFilter overrides.
@@ -102,6 +107,8 @@ class CONTENT_EXPORT PepperUDPSocketMessageFilter
   int32_t OnMsgClose(const ppapi::host::HostMessageContext* context);
   int32_t OnMsgRecvSlotAvailable(
       const ppapi::host::HostMessageContext* context);
+  int32_t OnMsgSendRingDoorbell(
+      const ppapi::host::HostMessageContext* context);
   int32_t OnMsgJoinGroup(const ppapi::host::HostMessageContext* context,
                          const PP_NetAddress_Private& addr);
   int32_t OnMsgLeaveGroup(const ppapi::host::HostMessageContext* context,
@@ -123,8 +130,22 @@ class CONTENT_EXPORT PepperUDPSocketMessageFilter
                 const std::string& data,
                 const PP_NetAddress_Private& addr);
   int StartPendingSend();
+  // Starts pending sends until none are left or a send doesn't complete.
+  void StartPendingSends();
   void Close();
 
+  // Creates the packet rings shared with the plugin, and attaches their
+  // handles to the bind reply. The plugin falls back to a message per packet
+  // if this fails.
+  void CreateRings(ppapi::host::ReplyMessageContext* context);
+  scoped_ptr<ppapi::UDPPacketRing> CreateRing();
+  // Moves packets from |send_ring_| to |pending_sends_|.
+  void DrainSendRing();
+  // Returns false if |recv_ring_| is full.
+  bool PushToRecvRing(int32_t result,
+                      const std::string& data,
+                      const PP_NetAddress_Private& addr);
+
   void OnRecvFromCompleted(int net_result);
   void OnSendToCompleted(int net_result);
   void FinishPendingSend(int net_result);
@@ -138,6 +159,8 @@ class CONTENT_EXPORT PepperUDPSocketMessageFilter
   void SendSendToReply(const ppapi::host::ReplyMessageContext& context,
                        int32_t result,
                        int32_t bytes_written);
+  void SendRecvRingDoorbell();
+  void SendSendRingSpaceAvailable(int32_t result);
 
   void SendBindError(const ppapi::host::ReplyMessageContext& context,
                      int32_t result);
@@ -172,6 +195,24 @@ class CONTENT_EXPORT PepperUDPSocketMessageFilter
 
   std::queue<PendingSend> pending_sends_;
 
+  // Packet rings shared with the plugin, if it could be given them. Received
+  // packets are written to |recv_ring_|, and packets the plugin sends to
+  // |permitted_send_addresses_| are read from |send_ring_|. An address is
+  // only permitted once a SendTo message for it has passed the permission
+  // check on the UI thread.
+  scoped_ptr<ppapi::UDPPacketRing> recv_ring_;
+  scoped_ptr<ppapi::UDPPacketRing> send_ring_;
+  std::set<std::string> permitted_send_addresses_;
+  // The number of entries in |pending_sends_| read from |send_ring_|.
+  size_t ring_sends_in_flight_;
+
+  // A received packet which didn't fit in |recv_ring_|. Receiving is paused
+  // until the plugin makes room for it.
+  bool recv_ring_full_;
+  int32_t held_recv_result_;
+  std::string held_recv_data_;
+  PP_NetAddress_Private held_recv_addr_;
+
   net::IPEndPoint recvfrom_address_;
 
   size_t remaining_recv_slots_;
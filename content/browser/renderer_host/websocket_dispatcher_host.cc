@@ -4,16 +4,20 @@
 
 #include "content/browser/renderer_host/websocket_dispatcher_host.h"
 
+#include <string.h>
+
 #include <string>
 #include <vector>
 
 #include "base/callback.h"
 #include "base/logging.h"
+#include "base/memory/shared_memory.h"
 #include "base/numerics/safe_conversions.h"
 #include "base/rand_util.h"
 #include "base/stl_util.h"
 #include "content/browser/child_process_security_policy_impl.h"
 #include "content/browser/renderer_host/websocket_host.h"
+#include "content/common/websocket_frame_buffers.h"
 #include "content/common/websocket_messages.h"
 
 namespace content {
@@ -71,6 +75,9 @@ bool WebSocketDispatcherHost::OnMessageReceived(const IPC::Message& message) {
   switch (message.type()) {
     case WebSocketHostMsg_AddChannelRequest::ID:
     case WebSocketMsg_SendFrame::ID:
+    case WebSocketMsg_AddFrameBuffer::ID:
+    case WebSocketMsg_SendFrameInBuffer::ID:
+    case WebSocketMsg_FrameBufferAck::ID:
     case WebSocketMsg_FlowControl::ID:
     case WebSocketMsg_DropChannel::ID:
       break;
@@ -164,6 +171,34 @@ WebSocketHostState WebSocketDispatcherHost::SendFrame(
     bool fin,
     WebSocketMessageType type,
     const std::vector<char>& data) {
+  WebSocketHost* host = GetHost(routing_id);
+  if (host && data.size() >= WebSocketFrameBufferPool::kMinFrameSize) {
+    WebSocketFrameBufferPool* buffers = host->outgoing_frame_buffers();
+    int buffer_id = buffers->TakeFreeBuffer(data.size());
+    size_t buffer_size = 0;
+    if (buffer_id < 0)
+      buffer_size = buffers->GetNewBufferSize(data.size());
+    if (buffer_size) {
+      scoped_ptr<base::SharedMemory> memory(new base::SharedMemory);
+      base::SharedMemoryHandle handle;
+      if (memory->CreateAndMapAnonymous(buffer_size) &&
+          memory->ShareToProcess(PeerHandle(), &handle)) {
+        buffer_id = buffers->AddBuffer(memory.Pass());
+        if (SendOrDrop(new WebSocketMsg_AddFrameBuffer(
+                routing_id, buffer_id, handle,
+                base::checked_cast<uint32>(buffer_size))) ==
+            WEBSOCKET_HOST_DELETED) {
+          return WEBSOCKET_HOST_DELETED;
+        }
+      }
+    }
+    if (buffer_id >= 0) {
+      memcpy(buffers->GetFrameMemory(buffer_id), &data[0], data.size());
+      return SendOrDrop(new WebSocketMsg_SendFrameInBuffer(
+          routing_id, fin, type, buffer_id,
+          base::checked_cast<uint32>(data.size())));
+    }
+  }
   return SendOrDrop(new WebSocketMsg_SendFrame(routing_id, fin, type, data));
 }
 
@@ -66,7 +66,8 @@ class CONTENT_EXPORT WebSocketDispatcherHost : public BrowserMessageFilter {
       const std::string& selected_protocol,
       const std::string& extensions) WARN_UNUSED_RESULT;
 
-  // Sends a WebSocketMsg_SendFrame IPC.
+  // Sends a WebSocketMsg_SendFrame IPC, or a WebSocketMsg_SendFrameInBuffer
+  // IPC for a large frame.
   WebSocketHostState SendFrame(int routing_id,
                                bool fin,
                                WebSocketMessageType type,
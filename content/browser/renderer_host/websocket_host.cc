@@ -335,6 +335,9 @@ bool WebSocketHost::OnMessageReceived(const IPC::Message& message) {
   IPC_BEGIN_MESSAGE_MAP(WebSocketHost, message)
     IPC_MESSAGE_HANDLER(WebSocketHostMsg_AddChannelRequest, OnAddChannelRequest)
     IPC_MESSAGE_HANDLER(WebSocketMsg_SendFrame, OnSendFrame)
+    IPC_MESSAGE_HANDLER(WebSocketMsg_AddFrameBuffer, OnAddFrameBuffer)
+    IPC_MESSAGE_HANDLER(WebSocketMsg_SendFrameInBuffer, OnSendFrameInBuffer)
+    IPC_MESSAGE_HANDLER(WebSocketMsg_FrameBufferAck, OnFrameBufferAck)
     IPC_MESSAGE_HANDLER(WebSocketMsg_FlowControl, OnFlowControl)
     IPC_MESSAGE_HANDLER(WebSocketMsg_DropChannel, OnDropChannel)
     IPC_MESSAGE_UNHANDLED(handled = false)
@@ -412,6 +415,64 @@ void WebSocketHost::OnSendFrame(bool fin,
   channel_->SendFrame(fin, MessageTypeToOpCode(type), data);
 }
 
+void WebSocketHost::OnAddFrameBuffer(int buffer_id,
+                                     base::SharedMemoryHandle handle,
+                                     uint32 size) {
+  DVLOG(3) << "WebSocketHost::OnAddFrameBuffer"
+           << " routing_id=" << routing_id_ << " buffer_id=" << buffer_id
+           << " size=" << size;
+
+#if defined(OS_WIN)
+  scoped_ptr<base::SharedMemory> memory(
+      new base::SharedMemory(handle, true, dispatcher_->PeerHandle()));
+#else
+  scoped_ptr<base::SharedMemory> memory(new base::SharedMemory(handle, true));
+#endif
+  if (!incoming_frame_buffers_.AddBuffer(buffer_id, memory.Pass(), size))
+    OnInvalidFrameBuffer();
+  // |this| may have been deleted here.
+}
+
+void WebSocketHost::OnSendFrameInBuffer(bool fin,
+                                        WebSocketMessageType type,
+                                        int buffer_id,
+                                        uint32 size) {
+  DVLOG(3) << "WebSocketHost::OnSendFrameInBuffer"
+           << " routing_id=" << routing_id_ << " fin=" << fin
+           << " type=" << type << " buffer_id=" << buffer_id
+           << " data is " << size << " bytes";
+
+  const char* data = incoming_frame_buffers_.GetFrameData(buffer_id, size);
+  if (!data || !channel_) {
+    OnInvalidFrameBuffer();
+    return;
+  }
+  // WebSocketChannel takes a vector, so this is the one copy the frame needs.
+  std::vector<char> data_to_pass(data, data + size);
+  if (!dispatcher_->Send(new WebSocketMsg_FrameBufferAck(routing_id_,
+                                                         buffer_id))) {
+    return;
+  }
+  channel_->SendFrame(fin, MessageTypeToOpCode(type), data_to_pass);
+}
+
+void WebSocketHost::OnFrameBufferAck(int buffer_id) {
+  DVLOG(3) << "WebSocketHost::OnFrameBufferAck"
+           << " routing_id=" << routing_id_ << " buffer_id=" << buffer_id;
+
+  if (!outgoing_frame_buffers_.ReleaseBuffer(buffer_id))
+    OnInvalidFrameBuffer();
+  // |this| may have been deleted here.
+}
+
+void WebSocketHost::OnInvalidFrameBuffer() {
+  DVLOG(1) << "Invalid frame buffer message from renderer, routing_id="
+           << routing_id_;
+  ignore_result(dispatcher_->NotifyFailure(
+      routing_id_, "Invalid shared memory frame from renderer"));
+  // |this| has been deleted here.
+}
+
 void WebSocketHost::OnFlowControl(int64 quota) {
   DVLOG(3) << "WebSocketHost::OnFlowControl"
            << " routing_id=" << routing_id_ << " quota=" << quota;
@@ -9,10 +9,12 @@
 #include <vector>
 
 #include "base/memory/scoped_ptr.h"
+#include "base/memory/shared_memory.h"
 #include "base/memory/weak_ptr.h"
 #include "base/time/time.h"
 #include "content/common/content_export.h"
 #include "content/common/websocket.h"
+#include "content/common/websocket_frame_buffers.h"
 
 class GURL;
 
@@ -56,6 +58,12 @@ class CONTENT_EXPORT WebSocketHost {
   bool handshake_succeeded() const { return handshake_succeeded_; }
   void OnHandshakeSucceeded() { handshake_succeeded_ = true; }
 
+  // The buffers WebSocketDispatcherHost::SendFrame() sends large frames to the
+  // renderer in.
+  WebSocketFrameBufferPool* outgoing_frame_buffers() {
+    return &outgoing_frame_buffers_;
+  }
+
  private:
   // Handlers for each message type, dispatched by OnMessageReceived(), as
   // defined in content/common/websocket_messages.h
@@ -74,8 +82,22 @@ class CONTENT_EXPORT WebSocketHost {
                    WebSocketMessageType type,
                    const std::vector<char>& data);
 
+  void OnAddFrameBuffer(int buffer_id,
+                        base::SharedMemoryHandle handle,
+                        uint32 size);
+
+  void OnSendFrameInBuffer(bool fin,
+                           WebSocketMessageType type,
+                           int buffer_id,
+                           uint32 size);
+
+  void OnFrameBufferAck(int buffer_id);
+
   void OnFlowControl(int64 quota);
 
+  // Fails the channel because the renderer misused a frame buffer.
+  void OnInvalidFrameBuffer();
+
   void OnDropChannel(bool was_clean, uint16 code, const std::string& reason);
 
   // The channel we use to send events to the network.
@@ -98,6 +120,11 @@ class CONTENT_EXPORT WebSocketHost {
   // Zero indicates there is no pending SendFlowControl().
   int64_t pending_flow_control_quota_;
 
+  // The buffers the renderer sends large frames in, and the ones we send large
+  // frames to the renderer in.
+  WebSocketReceivedFrameBuffers incoming_frame_buffers_;
+  WebSocketFrameBufferPool outgoing_frame_buffers_;
+
   // handshake_succeeded_ is set and used by WebSocketDispatcherHost
   // to manage counters for per-renderer WebSocket throttling.
   bool handshake_succeeded_;
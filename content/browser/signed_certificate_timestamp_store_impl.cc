@@ -36,4 +36,11 @@ bool SignedCertificateTimestampStoreImpl::Retrieve(
   return store_.Retrieve(sct_id, sct);
 }
 
+size_t SignedCertificateTimestampStoreImpl::SCTHash::operator()(
+    const net::ct::SignedCertificateTimestamp& sct) const {
+  // SignedCertificateTimestamp::LessThan compares the signatures first, and
+  // they're unique in practice.
+  return BASE_HASH_NAMESPACE::hash<std::string>()(sct.signature.signature_data);
+}
+
 }  // namespace content
@@ -35,7 +35,12 @@ class SignedCertificateTimestampStoreImpl
   SignedCertificateTimestampStoreImpl();
   ~SignedCertificateTimestampStoreImpl() override;
 
-  RendererDataMemoizingStore<net::ct::SignedCertificateTimestamp> store_;
+  struct SCTHash {
+    size_t operator()(const net::ct::SignedCertificateTimestamp& sct) const;
+  };
+
+  RendererDataMemoizingStore<net::ct::SignedCertificateTimestamp, SCTHash>
+      store_;
 
   DISALLOW_COPY_AND_ASSIGN(SignedCertificateTimestampStoreImpl);
 };
@@ -3063,6 +3063,17 @@ void WebContentsImpl::DidNavigateMainFramePostCommit(
         GetController().GetBrowserContext());
   }
 
+  // Let the zoom map know which host this view is now showing, so later zoom
+  // changes for that host reach its renderer.
+  HostZoomMapImpl* host_zoom_map =
+      static_cast<HostZoomMapImpl*>(HostZoomMap::GetForWebContents(this));
+  if (host_zoom_map && details.entry) {
+    host_zoom_map->DidCommitMainFrameNavigation(
+        render_frame_host->GetProcess()->GetID(),
+        render_frame_host->GetRenderViewHost()->GetRoutingID(),
+        HostZoomMap::GetURLFromEntry(details.entry));
+  }
+
   // Notify observers about navigation.
   FOR_EACH_OBSERVER(WebContentsObserver, observers_,
                     DidNavigateMainFrame(details, params));
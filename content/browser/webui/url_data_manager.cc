@@ -117,6 +117,7 @@ void URLDataManager::AddDataSource(BrowserContext* browser_context,
 void URLDataManager::AddWebUIDataSource(BrowserContext* browser_context,
                                         WebUIDataSource* source) {
   WebUIDataSourceImpl* impl = static_cast<WebUIDataSourceImpl*>(source);
+  impl->CreateResponseCache();
   GetFromBrowserContext(browser_context)->AddDataSource(impl);
 }
 
@@ -19,6 +19,7 @@
 #include "base/profiler/scoped_tracker.h"
 #include "base/single_thread_task_runner.h"
 #include "base/strings/string_number_conversions.h"
+#include "base/strings/string_split.h"
 #include "base/strings/string_util.h"
 #include "base/strings/stringprintf.h"
 #include "base/trace_event/trace_event.h"
@@ -105,6 +106,24 @@ std::string GetOriginHeaderValue(const net::URLRequest* request) {
   return result;
 }
 
+// Returns true if the "If-None-Match:" header of |request| lists |etag|.
+bool RequestMatchesETag(const net::URLRequest* request,
+                        const std::string& etag) {
+  std::string if_none_match;
+  if (etag.empty() ||
+      !request->extra_request_headers().GetHeader(
+          net::HttpRequestHeaders::kIfNoneMatch, &if_none_match)) {
+    return false;
+  }
+  std::vector<std::string> candidates = base::SplitString(
+      if_none_match, ",", base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY);
+  for (size_t i = 0; i < candidates.size(); ++i) {
+    if (candidates[i] == "*" || candidates[i] == etag)
+      return true;
+  }
+  return false;
+}
+
 }  // namespace
 
 // URLRequestChromeJob is a net::URLRequestJob that manages running
@@ -171,6 +190,14 @@ class URLRequestChromeJob : public net::URLRequestJob {
     access_control_allow_origin_ = value;
   }
 
+  void set_etag(const std::string& etag) {
+    etag_ = etag;
+  }
+
+  void set_not_modified(bool not_modified) {
+    not_modified_ = not_modified;
+  }
+
   // Returns true when job was generated from an incognito profile.
   bool is_incognito() const {
     return is_incognito_;
@@ -229,6 +256,13 @@ class URLRequestChromeJob : public net::URLRequestJob {
   // string.
   std::string access_control_allow_origin_;
 
+  // If not empty, sent as the "ETag:" header.
+  std::string etag_;
+
+  // If true, the request was conditional on |etag_| and it matched, so a 304
+  // with an empty body is sent.
+  bool not_modified_;
+
   // True when job is generated from an incognito profile.
   const bool is_incognito_;
 
@@ -253,6 +287,7 @@ URLRequestChromeJob::URLRequestChromeJob(net::URLRequest* request,
       content_security_policy_frame_source_("frame-src 'none';"),
       deny_xframe_options_(true),
       send_content_type_header_(false),
+      not_modified_(false),
       is_incognito_(is_incognito),
       backend_(backend),
       weak_factory_(this) {
@@ -291,7 +326,7 @@ bool URLRequestChromeJob::GetMimeType(std::string* mime_type) const {
 }
 
 int URLRequestChromeJob::GetResponseCode() const {
-  return net::HTTP_OK;
+  return not_modified_ ? net::HTTP_NOT_MODIFIED : net::HTTP_OK;
 }
 
 void URLRequestChromeJob::GetResponseInfo(net::HttpResponseInfo* info) {
@@ -299,7 +334,8 @@ void URLRequestChromeJob::GetResponseInfo(net::HttpResponseInfo* info) {
   // Set the headers so that requests serviced by ChromeURLDataManager return a
   // status code of 200. Without this they return a 0, which makes the status
   // indistiguishable from other error types. Instant relies on getting a 200.
-  info->headers = new net::HttpResponseHeaders("HTTP/1.1 200 OK");
+  info->headers = new net::HttpResponseHeaders(
+      not_modified_ ? "HTTP/1.1 304 Not Modified" : "HTTP/1.1 200 OK");
 
   // Determine the least-privileged content security policy header, if any,
   // that is compatible with a given WebUI URL, and append it to the existing
@@ -330,6 +366,9 @@ void URLRequestChromeJob::GetResponseInfo(net::HttpResponseInfo* info) {
                              access_control_allow_origin_);
     info->headers->AddHeader("Vary: Origin");
   }
+
+  if (!etag_.empty())
+    info->headers->AddHeader("ETag: " + etag_);
 }
 
 void URLRequestChromeJob::MimeTypeAvailable(const std::string& mime_type) {
@@ -626,10 +665,6 @@ bool URLDataManagerBackend::StartRequest(const net::URLRequest* request,
   URLToRequestPath(request->url(), &path);
   source->source()->WillServiceRequest(request, &path);
 
-  // Save this request so we know where to send the data.
-  RequestID request_id = next_request_id_++;
-  pending_requests_.insert(std::make_pair(request_id, job));
-
   job->set_allow_caching(source->source()->AllowCaching());
   job->set_add_content_security_policy(
       source->source()->ShouldAddContentSecurityPolicy());
@@ -651,6 +686,27 @@ bool URLDataManagerBackend::StartRequest(const net::URLRequest* request,
     job->set_access_control_allow_origin(header);
   }
 
+  // Responses that were computed ahead of time are served right here on the
+  // IO thread, without a hop to the thread the source answers requests on.
+  scoped_refptr<base::RefCountedMemory> precomputed_bytes;
+  std::string etag;
+  if (source->GetPrecomputedResponse(path, &precomputed_bytes, &etag)) {
+    job->set_etag(etag);
+    if (RequestMatchesETag(request, etag)) {
+      job->set_not_modified(true);
+      precomputed_bytes = new base::RefCountedStaticMemory();
+    }
+    // Hand over the data first so that reads issued while the headers are
+    // being delivered complete synchronously.
+    job->DataAvailable(precomputed_bytes.get());
+    job->MimeTypeAvailable(source->source()->GetMimeType(path));
+    return true;
+  }
+
+  // Save this request so we know where to send the data.
+  RequestID request_id = next_request_id_++;
+  pending_requests_.insert(std::make_pair(request_id, job));
+
   // Look up additional request info to pass down.
   int render_process_id = -1;
   int render_frame_id = -1;
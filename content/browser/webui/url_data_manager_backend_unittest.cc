@@ -4,7 +4,10 @@
 
 #include "base/memory/scoped_ptr.h"
 #include "base/run_loop.h"
+#include "base/strings/utf_string_conversions.h"
+#include "content/browser/resource_context_impl.h"
 #include "content/browser/webui/url_data_manager_backend.h"
+#include "content/browser/webui/web_ui_data_source_impl.h"
 #include "content/public/test/mock_resource_context.h"
 #include "content/public/test/test_browser_thread_bundle.h"
 #include "net/http/http_response_headers.h"
@@ -129,4 +132,47 @@ TEST_F(UrlDataManagerBackendTest, ChromeNetworkErrorPageRequestFailed) {
   EXPECT_EQ(net::ERR_INVALID_URL, error_request->status().error());
 }
 
+// Check that cached responses carry an ETag and answer a matching
+// conditional request with a 304 and no body.
+TEST_F(UrlDataManagerBackendTest, CachedResponseETag) {
+  WebUIDataSourceImpl* source =
+      static_cast<WebUIDataSourceImpl*>(WebUIDataSource::Create("test"));
+  source->SetJsonPath("strings.js");
+  source->AddString("planet", base::ASCIIToUTF16("pluto"));
+  source->CreateResponseCache();
+  GetURLDataManagerForResourceContext(&resource_context_)
+      ->AddDataSource(source);
+
+  // The first request builds the strings on the UI thread and caches them.
+  const GURL url("chrome://test/strings.js");
+  net::TestDelegate first_delegate;
+  scoped_ptr<net::URLRequest> first_request =
+      url_request_context_.CreateRequest(url, net::HIGHEST, &first_delegate);
+  first_request->Start();
+  base::RunLoop().Run();
+  EXPECT_EQ(200, first_request->GetResponseCode());
+
+  scoped_ptr<net::URLRequest> request =
+      url_request_context_.CreateRequest(url, net::HIGHEST, &delegate_);
+  request->Start();
+  base::RunLoop().Run();
+  EXPECT_EQ(200, request->GetResponseCode());
+  EXPECT_NE(delegate_.data_received().find("\"planet\":\"pluto\""),
+            std::string::npos);
+  std::string etag;
+  ASSERT_TRUE(request->response_headers()->EnumerateHeader(nullptr, "ETag",
+                                                           &etag));
+
+  net::TestDelegate conditional_delegate;
+  scoped_ptr<net::URLRequest> conditional_request =
+      url_request_context_.CreateRequest(url, net::HIGHEST,
+                                         &conditional_delegate);
+  conditional_request->SetExtraRequestHeaderByName("If-None-Match", etag,
+                                                   true);
+  conditional_request->Start();
+  base::RunLoop().Run();
+  EXPECT_EQ(304, conditional_request->GetResponseCode());
+  EXPECT_EQ("", conditional_delegate.data_received());
+}
+
 }  // namespace content
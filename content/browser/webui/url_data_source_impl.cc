@@ -48,6 +48,13 @@ void URLDataSourceImpl::SendResponse(
                  bytes_ptr));
 }
 
+bool URLDataSourceImpl::GetPrecomputedResponse(
+    const std::string& path,
+    scoped_refptr<base::RefCountedMemory>* bytes,
+    std::string* etag) const {
+  return false;
+}
+
 void URLDataSourceImpl::SendResponseOnIOThread(
     int request_id,
     scoped_refptr<base::RefCountedMemory> bytes) {
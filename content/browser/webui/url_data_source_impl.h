@@ -5,6 +5,8 @@
 #ifndef CONTENT_BROWSER_WEBUI_URL_DATA_SOURCE_IMPL_H_
 #define CONTENT_BROWSER_WEBUI_URL_DATA_SOURCE_IMPL_H_
 
+#include <string>
+
 #include "base/memory/ref_counted.h"
 #include "base/memory/scoped_ptr.h"
 #include "base/sequenced_task_runner_helpers.h"
@@ -58,6 +60,16 @@ class URLDataSourceImpl : public base::RefCountedThreadSafe<
   // the request is over.
   virtual void SendResponse(int request_id, base::RefCountedMemory* bytes);
 
+  // Called on the IO thread before the request for |path| is forwarded to
+  // the source. If the response for |path| was computed ahead of time and
+  // can't change, fills |bytes| and |etag| and returns true; the backend then
+  // serves it without calling StartDataRequest. |etag| is left empty when
+  // the response can't be validated. The default returns false.
+  virtual bool GetPrecomputedResponse(
+      const std::string& path,
+      scoped_refptr<base::RefCountedMemory>* bytes,
+      std::string* etag) const;
+
   const std::string& source_name() const { return source_name_; }
   URLDataSource* source() const { return source_.get(); }
 
@@ -7,8 +7,11 @@
 #include <string>
 
 #include "base/bind.h"
+#include "base/format_macros.h"
+#include "base/hash.h"
 #include "base/memory/ref_counted_memory.h"
 #include "base/strings/string_util.h"
+#include "base/strings/stringprintf.h"
 #include "content/grit/content_resources.h"
 #include "content/public/browser/content_browser_client.h"
 #include "content/public/common/content_client.h"
@@ -18,6 +21,118 @@
 
 namespace content {
 
+namespace {
+
+// Returns a strong validator for |bytes|. It only needs to be unique among
+// the responses served by one browser session, so a fast hash plus the length
+// is enough.
+std::string ComputeETag(const base::RefCountedMemory* bytes) {
+  return base::StringPrintf(
+      "\"%08x-%" PRIuS "\"",
+      base::Hash(bytes->front_as<char>(), bytes->size()), bytes->size());
+}
+
+}  // namespace
+
+// Responses that WebUIDataSourceImpl can serve on the IO thread without
+// calling StartDataRequest. The routing is copied from the source when the
+// cache is created, which is cheap; resource bytes are only loaded and hashed
+// the first time they are requested, and the localized strings JSON once it
+// has been built on the UI thread.
+class WebUIDataSourceImpl::ResponseCache
+    : public base::RefCountedThreadSafe<ResponseCache> {
+ public:
+  ResponseCache(const std::map<std::string, int>& path_to_idr_map,
+                const std::string& json_path,
+                int default_resource)
+      : path_to_idr_map_(path_to_idr_map),
+        json_path_(json_path),
+        default_resource_(default_resource) {}
+
+  // Returns the response for |path|, loading its resource if this is the
+  // first request for it. Returns false if |path| has no resource or is the
+  // JSON path and the strings haven't been built yet. May be called on any
+  // thread.
+  bool Get(const std::string& path,
+           scoped_refptr<base::RefCountedMemory>* bytes,
+           std::string* etag) {
+    if (!json_path_.empty() && path == json_path_) {
+      base::AutoLock lock(lock_);
+      if (!json_response_.bytes.get())
+        return false;
+      *bytes = json_response_.bytes;
+      *etag = json_response_.etag;
+      return true;
+    }
+
+    int resource_id = default_resource_;
+    std::map<std::string, int>::const_iterator it =
+        path_to_idr_map_.find(path);
+    if (it != path_to_idr_map_.end())
+      resource_id = it->second;
+    if (resource_id == -1)
+      return false;
+
+    {
+      base::AutoLock lock(lock_);
+      std::map<int, Response>::const_iterator cached =
+          resources_.find(resource_id);
+      if (cached != resources_.end()) {
+        *bytes = cached->second.bytes;
+        *etag = cached->second.etag;
+        return true;
+      }
+    }
+
+    // Load outside the lock. Two threads racing on the same resource load
+    // identical bytes, so whichever stores first wins.
+    scoped_refptr<base::RefCountedMemory> loaded(
+        GetContentClient()->GetDataResourceBytes(resource_id));
+    if (!loaded.get())
+      return false;
+    std::string loaded_etag = ComputeETag(loaded.get());
+
+    base::AutoLock lock(lock_);
+    Response& response = resources_[resource_id];
+    if (!response.bytes.get()) {
+      response.bytes = loaded;
+      response.etag = loaded_etag;
+    }
+    *bytes = response.bytes;
+    *etag = response.etag;
+    return true;
+  }
+
+  // Stores the localized strings JSON built by StartDataRequest.
+  void SetJSON(base::RefCountedMemory* bytes) {
+    std::string etag = ComputeETag(bytes);
+    base::AutoLock lock(lock_);
+    json_response_.bytes = bytes;
+    json_response_.etag = etag;
+  }
+
+ private:
+  friend class base::RefCountedThreadSafe<ResponseCache>;
+
+  struct Response {
+    scoped_refptr<base::RefCountedMemory> bytes;
+    std::string etag;
+  };
+
+  ~ResponseCache() {}
+
+  const std::map<std::string, int> path_to_idr_map_;
+  const std::string json_path_;
+  const int default_resource_;
+
+  // Guards the responses below, which are filled in as they are requested.
+  base::Lock lock_;
+  std::map<int, Response> resources_;
+  Response json_response_;
+
+  DISALLOW_COPY_AND_ASSIGN(ResponseCache);
+};
+
 // static
 WebUIDataSource* WebUIDataSource::Create(const std::string& source_name) {
   return new WebUIDataSourceImpl(source_name);
@@ -95,44 +210,53 @@ WebUIDataSourceImpl::~WebUIDataSourceImpl() {
 
 void WebUIDataSourceImpl::AddString(const std::string& name,
                                     const base::string16& value) {
+  InvalidateResponseCache();
   localized_strings_.SetString(name, value);
 }
 
 void WebUIDataSourceImpl::AddString(const std::string& name,
                                     const std::string& value) {
+  InvalidateResponseCache();
   localized_strings_.SetString(name, value);
 }
 
 void WebUIDataSourceImpl::AddLocalizedString(const std::string& name,
                                              int ids) {
+  InvalidateResponseCache();
   localized_strings_.SetString(
       name, GetContentClient()->GetLocalizedString(ids));
 }
 
 void WebUIDataSourceImpl::AddLocalizedStrings(
     const base::DictionaryValue& localized_strings) {
+  InvalidateResponseCache();
   localized_strings_.MergeDictionary(&localized_strings);
 }
 
 void WebUIDataSourceImpl::AddBoolean(const std::string& name, bool value) {
+  InvalidateResponseCache();
   localized_strings_.SetBoolean(name, value);
 }
 
 void WebUIDataSourceImpl::SetJsonPath(const std::string& path) {
+  InvalidateResponseCache();
   json_path_ = path;
 }
 
 void WebUIDataSourceImpl::AddResourcePath(const std::string &path,
                                           int resource_id) {
+  InvalidateResponseCache();
   path_to_idr_map_[path] = resource_id;
 }
 
 void WebUIDataSourceImpl::SetDefaultResource(int resource_id) {
+  InvalidateResponseCache();
   default_resource_ = resource_id;
 }
 
 void WebUIDataSourceImpl::SetRequestFilter(
     const WebUIDataSource::HandleRequestCallback& callback) {
+  InvalidateResponseCache();
   filter_callback_ = callback;
 }
 
@@ -178,6 +302,35 @@ void WebUIDataSourceImpl::DisableDenyXFrameOptions() {
   deny_xframe_options_ = false;
 }
 
+bool WebUIDataSourceImpl::GetPrecomputedResponse(
+    const std::string& path,
+    scoped_refptr<base::RefCountedMemory>* bytes,
+    std::string* etag) const {
+  scoped_refptr<ResponseCache> cache;
+  {
+    base::AutoLock lock(response_cache_lock_);
+    cache = response_cache_;
+  }
+  return cache.get() && cache->Get(path, bytes, etag);
+}
+
+void WebUIDataSourceImpl::CreateResponseCache() {
+  // A filter may claim any path at request time, so nothing can be served
+  // without asking it first.
+  if (!filter_callback_.is_null())
+    return;
+
+  scoped_refptr<ResponseCache> cache(
+      new ResponseCache(path_to_idr_map_, json_path_, default_resource_));
+  base::AutoLock lock(response_cache_lock_);
+  response_cache_ = cache;
+}
+
+void WebUIDataSourceImpl::InvalidateResponseCache() {
+  base::AutoLock lock(response_cache_lock_);
+  response_cache_ = nullptr;
+}
+
 std::string WebUIDataSourceImpl::GetSource() const {
   return source_name_;
 }
@@ -211,6 +364,17 @@ void WebUIDataSourceImpl::StartDataRequest(
     return;
   }
 
+  // Requests get here while the response cache is missing, e.g. after the
+  // source was modified, or for strings that haven't been built yet.
+  // Recreate the cache so later requests are answered on the IO thread.
+  bool needs_cache;
+  {
+    base::AutoLock lock(response_cache_lock_);
+    needs_cache = !response_cache_.get();
+  }
+  if (needs_cache)
+    CreateResponseCache();
+
   if (!json_path_.empty() && path == json_path_) {
     SendLocalizedStringsAsJSON(callback);
     return;
@@ -227,6 +391,18 @@ void WebUIDataSourceImpl::StartDataRequest(
 
 void WebUIDataSourceImpl::SendLocalizedStringsAsJSON(
     const URLDataSource::GotDataCallback& callback) {
+  std::string template_data = GetLocalizedStringsAsJSON();
+  scoped_refptr<base::RefCountedMemory> bytes(
+      base::RefCountedString::TakeString(&template_data));
+  {
+    base::AutoLock lock(response_cache_lock_);
+    if (response_cache_.get())
+      response_cache_->SetJSON(bytes.get());
+  }
+  callback.Run(bytes.get());
+}
+
+std::string WebUIDataSourceImpl::GetLocalizedStringsAsJSON() {
   std::string template_data;
   if (!disable_set_font_strings_) {
     std::string locale = GetContentClient()->browser()->GetApplicationLocale();
@@ -234,7 +410,7 @@ void WebUIDataSourceImpl::SendLocalizedStringsAsJSON(
   }
 
   webui::AppendJsonJS(&localized_strings_, &template_data);
-  callback.Run(base::RefCountedString::TakeString(&template_data));
+  return template_data;
 }
 
 void WebUIDataSourceImpl::SendFromResourceBundle(
@@ -11,6 +11,8 @@
 #include "base/basictypes.h"
 #include "base/callback.h"
 #include "base/compiler_specific.h"
+#include "base/memory/ref_counted.h"
+#include "base/synchronization/lock.h"
 #include "base/values.h"
 #include "content/browser/webui/url_data_manager.h"
 #include "content/browser/webui/url_data_source_impl.h"
@@ -45,6 +47,18 @@ class CONTENT_EXPORT WebUIDataSourceImpl
   void OverrideContentSecurityPolicyFrameSrc(const std::string& data) override;
   void DisableDenyXFrameOptions() override;
 
+  // URLDataSourceImpl implementation:
+  bool GetPrecomputedResponse(const std::string& path,
+                              scoped_refptr<base::RefCountedMemory>* bytes,
+                              std::string* etag) const override;
+
+  // Creates the cache that lets the IO thread answer requests without
+  // calling StartDataRequest. Only the routing is copied here; responses are
+  // loaded on first use. Must be called on the UI thread. Any later change
+  // to the source drops the cache; it is recreated on the next request that
+  // reaches StartDataRequest.
+  void CreateResponseCache();
+
  protected:
   ~WebUIDataSourceImpl() override;
 
@@ -58,6 +72,7 @@ class CONTENT_EXPORT WebUIDataSourceImpl
 
  private:
   class InternalDataSource;
+  class ResponseCache;
   friend class InternalDataSource;
   friend class WebUIDataSource;
   friend class WebUIDataSourceTest;
@@ -74,6 +89,12 @@ class CONTENT_EXPORT WebUIDataSourceImpl
       int render_frame_id,
       const URLDataSource::GotDataCallback& callback);
 
+  // Returns the localized strings dictionary serialized as JavaScript.
+  std::string GetLocalizedStringsAsJSON();
+
+  // Called whenever the source is modified after it may have been published.
+  void InvalidateResponseCache();
+
   void disable_set_font_strings_for_testing() {
     disable_set_font_strings_ = true;
   }
@@ -96,6 +117,12 @@ class CONTENT_EXPORT WebUIDataSourceImpl
   bool disable_set_font_strings_;
   bool replace_existing_source_;
 
+  // Created by CreateResponseCache() on the UI thread and read on the IO
+  // thread. NULL when the source has a request filter or has changed since
+  // the cache was created.
+  mutable base::Lock response_cache_lock_;
+  scoped_refptr<ResponseCache> response_cache_;
+
   DISALLOW_COPY_AND_ASSIGN(WebUIDataSourceImpl);
 };
 
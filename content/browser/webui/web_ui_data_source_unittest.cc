@@ -47,6 +47,11 @@ class TestClient : public TestContentClient {
   }
 };
 
+bool IgnoreRequest(const std::string& path,
+                   const WebUIDataSource::GotDataCallback& callback) {
+  return false;
+}
+
 }
 
 class WebUIDataSourceTest : public testing::Test {
@@ -67,6 +72,16 @@ class WebUIDataSourceTest : public testing::Test {
     return source_->GetMimeType(path);
   }
 
+  // Returns the cached body for |path|, or an empty string if |path| can't
+  // be served without calling StartDataRequest.
+  std::string GetPrecomputedResponse(const std::string& path,
+                                     std::string* etag) const {
+    scoped_refptr<base::RefCountedMemory> bytes;
+    if (!source_->GetPrecomputedResponse(path, &bytes, etag))
+      return std::string();
+    return std::string(bytes->front_as<char>(), bytes->size());
+  }
+
   scoped_refptr<base::RefCountedMemory> result_data_;
 
  private:
@@ -128,6 +143,59 @@ TEST_F(WebUIDataSourceTest, NamedResource) {
   EXPECT_NE(result.find(kDummyDefaultResource), std::string::npos);
 }
 
+TEST_F(WebUIDataSourceTest, CachedStrings) {
+  source()->SetJsonPath("strings.js");
+  source()->AddString("planet", base::ASCIIToUTF16("pluto"));
+  source()->CreateResponseCache();
+
+  // The strings are only cached once a request has built them.
+  std::string etag;
+  EXPECT_EQ(std::string(), GetPrecomputedResponse("strings.js", &etag));
+  StartDataRequest("strings.js");
+  std::string result = GetPrecomputedResponse("strings.js", &etag);
+  EXPECT_NE(result.find("\"planet\":\"pluto\""), std::string::npos);
+  EXPECT_FALSE(etag.empty());
+
+  // Modifying the source drops the cache until the next dynamic request.
+  source()->AddString("moon", base::ASCIIToUTF16("charon"));
+  EXPECT_EQ(std::string(), GetPrecomputedResponse("strings.js", &etag));
+  StartDataRequest("strings.js");
+  std::string new_etag;
+  result = GetPrecomputedResponse("strings.js", &new_etag);
+  EXPECT_NE(result.find("\"moon\":\"charon\""), std::string::npos);
+  EXPECT_NE(etag, new_etag);
+}
+
+TEST_F(WebUIDataSourceTest, CachedResources) {
+  source()->SetDefaultResource(kDummyDefaultResourceId);
+  source()->AddResourcePath("foobar", kDummyResourceId);
+  source()->CreateResponseCache();
+
+  std::string named_etag;
+  std::string result = GetPrecomputedResponse("foobar", &named_etag);
+  EXPECT_NE(result.find(kDummytResource), std::string::npos);
+
+  std::string default_etag;
+  result = GetPrecomputedResponse("foobar?query", &default_etag);
+  EXPECT_NE(result.find(kDummyDefaultResource), std::string::npos);
+  EXPECT_NE(named_etag, default_etag);
+
+  // Later lookups return the bytes loaded by the first one.
+  std::string etag;
+  result = GetPrecomputedResponse("foobar", &etag);
+  EXPECT_NE(result.find(kDummytResource), std::string::npos);
+  EXPECT_EQ(named_etag, etag);
+}
+
+TEST_F(WebUIDataSourceTest, NoCachedResponsesWithFilter) {
+  source()->AddResourcePath("foobar", kDummyResourceId);
+  source()->SetRequestFilter(
+      base::Bind(&IgnoreRequest));
+  source()->CreateResponseCache();
+  std::string etag;
+  EXPECT_EQ(std::string(), GetPrecomputedResponse("foobar", &etag));
+}
+
 TEST_F(WebUIDataSourceTest, MimeType) {
   const char* css = "text/css";
   const char* html = "text/html";
@@ -4,15 +4,21 @@
 
 #include "content/child/child_discardable_shared_memory_manager.h"
 
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
 #include "base/atomic_sequence_num.h"
 #include "base/bind.h"
 #include "base/debug/crash_logging.h"
 #include "base/memory/discardable_memory.h"
 #include "base/memory/discardable_shared_memory.h"
+#include "base/memory/scoped_vector.h"
 #include "base/metrics/histogram.h"
 #include "base/process/memory.h"
 #include "base/process/process_metrics.h"
 #include "base/strings/string_number_conversions.h"
+#include "base/task_runner.h"
 #include "base/thread_task_runner_handle.h"
 #include "base/trace_event/memory_dump_manager.h"
 #include "base/trace_event/trace_event.h"
@@ -24,6 +30,13 @@ namespace {
 // Default allocation size.
 const size_t kAllocationSize = 4 * 1024 * 1024;
 
+// Maximum number of default sized segments to fetch ahead of demand.
+const size_t kMaxReservedSegments = 2;
+
+// Demand for new segments halves over this time when the free lists can
+// satisfy allocations.
+const double kSegmentDemandHalfLifeMs = 1000.0;
+
 // Global atomic to generate unique discardable shared memory IDs.
 base::StaticAtomicSequenceNumber g_next_discardable_shared_memory_id;
 
@@ -81,11 +94,157 @@ void SendDeletedDiscardableSharedMemoryMessage(
   sender->Send(new ChildProcessHostMsg_DeletedDiscardableSharedMemory(id));
 }
 
+// Asks the parent process to allocate a new locked discardable shared memory
+// segment. Returns NULL if the segment could not be mapped.
+scoped_ptr<base::DiscardableSharedMemory> AllocateSegment(
+    ThreadSafeSender* sender,
+    size_t size,
+    DiscardableSharedMemoryId id) {
+  TRACE_EVENT2("renderer",
+               "ChildDiscardableSharedMemoryManager::"
+               "AllocateLockedDiscardableSharedMemory",
+               "size", size, "id", id);
+
+  base::SharedMemoryHandle handle = base::SharedMemory::NULLHandle();
+  sender->Send(
+      new ChildProcessHostMsg_SyncAllocateLockedDiscardableSharedMemory(
+          size, id, &handle));
+  scoped_ptr<base::DiscardableSharedMemory> memory(
+      new base::DiscardableSharedMemory(handle));
+  if (!memory->Map(size))
+    return nullptr;
+  return memory.Pass();
+}
+
 }  // namespace
 
+// Default sized segments fetched ahead of demand. Segments are unlocked while
+// they are reserved so that the parent process can purge them when it needs
+// the memory. Refills run on their own task runner and can outlive the
+// manager, which is why the reservoir is reference counted and deletes the
+// segments that arrive after Close().
+class ChildDiscardableSharedMemoryManager::SegmentReservoir
+    : public base::RefCountedThreadSafe<SegmentReservoir> {
+ public:
+  explicit SegmentReservoir(ThreadSafeSender* sender)
+      : sender_(sender), target_(0), refill_pending_(false), closed_(false) {}
+
+  // Returns a locked segment of kAllocationSize bytes and its ID, or NULL if
+  // no reserved segment is left.
+  scoped_ptr<base::DiscardableSharedMemory> Take(
+      DiscardableSharedMemoryId* id) {
+    base::AutoLock lock(lock_);
+    while (!segments_.empty()) {
+      scoped_ptr<base::DiscardableSharedMemory> memory(segments_.back());
+      segments_.weak_erase(segments_.end() - 1);
+      DiscardableSharedMemoryId segment_id = ids_.back();
+      ids_.pop_back();
+
+      switch (memory->Lock(0, kAllocationSize)) {
+        case base::DiscardableSharedMemory::SUCCESS:
+          *id = segment_id;
+          return memory.Pass();
+        case base::DiscardableSharedMemory::PURGED:
+          memory->Unlock(0, kAllocationSize);
+          break;
+        case base::DiscardableSharedMemory::FAILED:
+          break;
+      }
+
+      // Segment has been purged since it was reserved.
+      memory.reset();
+      SendDeletedDiscardableSharedMemoryMessage(sender_, segment_id);
+    }
+    return nullptr;
+  }
+
+  // Fetches segments on |task_runner| until |target| are reserved.
+  void Refill(base::TaskRunner* task_runner, size_t target) {
+    base::AutoLock lock(lock_);
+    target_ = target;
+    if (closed_ || refill_pending_ || segments_.size() >= target_)
+      return;
+    refill_pending_ = true;
+    task_runner->PostTask(FROM_HERE,
+                          base::Bind(&SegmentReservoir::RefillOnTaskRunner,
+                                     this));
+  }
+
+  // Deletes all reserved segments.
+  void Clear() {
+    base::AutoLock lock(lock_);
+    ClearLocked();
+  }
+
+  // Deletes all reserved segments, and any that arrive later.
+  void Close() {
+    base::AutoLock lock(lock_);
+    closed_ = true;
+    ClearLocked();
+  }
+
+ private:
+  friend class base::RefCountedThreadSafe<SegmentReservoir>;
+  ~SegmentReservoir() { DCHECK(segments_.empty()); }
+
+  void RefillOnTaskRunner() {
+    for (;;) {
+      DiscardableSharedMemoryId id;
+      {
+        base::AutoLock lock(lock_);
+        if (closed_ || segments_.size() >= target_) {
+          refill_pending_ = false;
+          return;
+        }
+        id = g_next_discardable_shared_memory_id.GetNext();
+      }
+
+      // Allocate without holding |lock_| so that Take() doesn't have to wait
+      // for the parent process.
+      scoped_ptr<base::DiscardableSharedMemory> memory(
+          AllocateSegment(sender_.get(), kAllocationSize, id));
+
+      base::AutoLock lock(lock_);
+      if (!memory || closed_) {
+        memory.reset();
+        SendDeletedDiscardableSharedMemoryMessage(sender_, id);
+        refill_pending_ = false;
+        return;
+      }
+      memory->Unlock(0, kAllocationSize);
+      segments_.push_back(memory.release());
+      ids_.push_back(id);
+    }
+  }
+
+  void ClearLocked() {
+    lock_.AssertAcquired();
+    segments_.clear();
+    for (DiscardableSharedMemoryId id : ids_)
+      SendDeletedDiscardableSharedMemoryMessage(sender_, id);
+    ids_.clear();
+  }
+
+  scoped_refptr<ThreadSafeSender> sender_;
+
+  base::Lock lock_;
+  ScopedVector<base::DiscardableSharedMemory> segments_;
+  std::vector<DiscardableSharedMemoryId> ids_;
+  size_t target_;
+  bool refill_pending_;
+  bool closed_;
+
+  DISALLOW_COPY_AND_ASSIGN(SegmentReservoir);
+};
+
 ChildDiscardableSharedMemoryManager::ChildDiscardableSharedMemoryManager(
-    ThreadSafeSender* sender)
-    : heap_(base::GetPageSize()), sender_(sender) {
+    ThreadSafeSender* sender,
+    const scoped_refptr<base::TaskRunner>& reservoir_task_runner)
+    : heap_(base::GetPageSize()),
+      sender_(sender),
+      reservoir_task_runner_(reservoir_task_runner),
+      reservoir_(new SegmentReservoir(sender)),
+      segment_demand_(0.0) {
   base::trace_event::MemoryDumpManager::GetInstance()->RegisterDumpProvider(
       this, "ChildDiscardableSharedMemoryManager",
       base::ThreadTaskRunnerHandle::Get());
@@ -94,6 +253,7 @@ ChildDiscardableSharedMemoryManager::ChildDiscardableSharedMemoryManager(
 ChildDiscardableSharedMemoryManager::~ChildDiscardableSharedMemoryManager() {
   base::trace_event::MemoryDumpManager::GetInstance()->UnregisterDumpProvider(
       this);
+  reservoir_->Close();
   // TODO(reveman): Determine if this DCHECK can be enabled. crbug.com/430533
   // DCHECK_EQ(heap_.GetSize(), heap_.GetSizeOfFreeLists());
   if (heap_.GetSize())
@@ -171,12 +331,24 @@ ChildDiscardableSharedMemoryManager::AllocateLockedDiscardableMemory(
       std::max(kAllocationSize / base::GetPageSize(), pages);
   size_t allocation_size_in_bytes = pages_to_allocate * base::GetPageSize();
 
-  DiscardableSharedMemoryId new_id =
-      g_next_discardable_shared_memory_id.GetNext();
+  DiscardableSharedMemoryId new_id = 0;
+  scoped_ptr<base::DiscardableSharedMemory> shared_memory;
+
+  // Default sized segments come from the reservoir when possible, which is
+  // then refilled without blocking this thread.
+  if (pages_to_allocate == allocation_pages && reservoir_task_runner_) {
+    size_t target = UpdateSegmentDemand();
+    shared_memory = reservoir_->Take(&new_id);
+    reservoir_->Refill(reservoir_task_runner_.get(), target);
+  }
 
-  // Ask parent process to allocate a new discardable shared memory segment.
-  scoped_ptr<base::DiscardableSharedMemory> shared_memory(
-      AllocateLockedDiscardableSharedMemory(allocation_size_in_bytes, new_id));
+  if (!shared_memory) {
+    new_id = g_next_discardable_shared_memory_id.GetNext();
+
+    // Ask parent process to allocate a new discardable shared memory segment.
+    shared_memory =
+        AllocateLockedDiscardableSharedMemory(allocation_size_in_bytes, new_id);
+  }
 
   // Create span for allocated memory.
   scoped_ptr<DiscardableSharedMemoryHeap::Span> new_span(heap_.Grow(
@@ -217,6 +389,10 @@ void ChildDiscardableSharedMemoryManager::ReleaseFreeMemory() {
   heap_.ReleasePurgedMemory();
   heap_.ReleaseFreeMemory();
 
+  // Reserved segments are free memory too.
+  reservoir_->Clear();
+  segment_demand_ = 0.0;
+
   if (heap_.GetSize() != heap_size_prior_to_releasing_memory)
     MemoryUsageChanged(heap_.GetSize(), heap_.GetSizeOfFreeLists());
 }
@@ -288,22 +464,29 @@ scoped_ptr<base::DiscardableSharedMemory>
 ChildDiscardableSharedMemoryManager::AllocateLockedDiscardableSharedMemory(
     size_t size,
     DiscardableSharedMemoryId id) {
-  TRACE_EVENT2("renderer",
-               "ChildDiscardableSharedMemoryManager::"
-               "AllocateLockedDiscardableSharedMemory",
-               "size", size, "id", id);
-
-  base::SharedMemoryHandle handle = base::SharedMemory::NULLHandle();
-  sender_->Send(
-      new ChildProcessHostMsg_SyncAllocateLockedDiscardableSharedMemory(
-          size, id, &handle));
   scoped_ptr<base::DiscardableSharedMemory> memory(
-      new base::DiscardableSharedMemory(handle));
-  if (!memory->Map(size))
+      AllocateSegment(sender_.get(), size, id));
+  if (!memory)
     base::TerminateBecauseOutOfMemory(size);
   return memory.Pass();
 }
 
+size_t ChildDiscardableSharedMemoryManager::UpdateSegmentDemand() {
+  lock_.AssertAcquired();
+
+  base::TimeTicks now = base::TimeTicks::Now();
+  if (!segment_demand_time_.is_null()) {
+    segment_demand_ *=
+        std::pow(0.5, (now - segment_demand_time_).InMillisecondsF() /
+                          kSegmentDemandHalfLifeMs);
+  }
+  segment_demand_ += 1.0;
+  segment_demand_time_ = now;
+
+  return std::min(kMaxReservedSegments,
+                  static_cast<size_t>(segment_demand_ + 0.5));
+}
+
 void ChildDiscardableSharedMemoryManager::MemoryUsageChanged(
     size_t new_bytes_total,
     size_t new_bytes_free) const {
@@ -8,21 +8,35 @@
 #include "base/memory/discardable_memory_allocator.h"
 #include "base/memory/ref_counted.h"
 #include "base/synchronization/lock.h"
+#include "base/time/time.h"
 #include "base/trace_event/memory_dump_provider.h"
 #include "content/child/thread_safe_sender.h"
 #include "content/common/content_export.h"
 #include "content/common/discardable_shared_memory_heap.h"
 #include "content/common/host_discardable_shared_memory_manager.h"
 
+namespace base {
+class TaskRunner;
+}
+
 namespace content {
 
 // Implementation of DiscardableMemoryAllocator that allocates
 // discardable memory segments through the browser process.
+//
+// Allocating a segment takes a synchronous IPC. To keep that off the threads
+// which allocate, a small reservoir of segments is fetched ahead of demand on
+// |reservoir_task_runner|, sized from how often the free lists have run out
+// recently. Reserved segments are kept unlocked, so the browser can purge them
+// like any other unused discardable memory. Without a reservoir task runner,
+// every segment is allocated when it is needed.
 class CONTENT_EXPORT ChildDiscardableSharedMemoryManager
     : public base::DiscardableMemoryAllocator,
       public base::trace_event::MemoryDumpProvider {
  public:
-  explicit ChildDiscardableSharedMemoryManager(ThreadSafeSender* sender);
+  ChildDiscardableSharedMemoryManager(
+      ThreadSafeSender* sender,
+      const scoped_refptr<base::TaskRunner>& reservoir_task_runner);
   ~ChildDiscardableSharedMemoryManager() override;
 
   // Overridden from base::DiscardableMemoryAllocator:
@@ -46,15 +60,27 @@ class CONTENT_EXPORT ChildDiscardableSharedMemoryManager
       base::trace_event::ProcessMemoryDump* pmd) const;
 
  private:
+  class SegmentReservoir;
+
   scoped_ptr<base::DiscardableSharedMemory>
   AllocateLockedDiscardableSharedMemory(size_t size,
                                         DiscardableSharedMemoryId id);
   void MemoryUsageChanged(size_t new_bytes_allocated,
                           size_t new_bytes_free) const;
 
+  // Records that the free lists had no room for an allocation which fits in
+  // a default sized segment, and returns how many segments to reserve.
+  size_t UpdateSegmentDemand();
+
   mutable base::Lock lock_;
   DiscardableSharedMemoryHeap heap_;
   scoped_refptr<ThreadSafeSender> sender_;
+  scoped_refptr<base::TaskRunner> reservoir_task_runner_;
+  scoped_refptr<SegmentReservoir> reservoir_;
+
+  // Recent free list misses, decaying over time.
+  double segment_demand_;
+  base::TimeTicks segment_demand_time_;
 
   DISALLOW_COPY_AND_ASSIGN(ChildDiscardableSharedMemoryManager);
 };
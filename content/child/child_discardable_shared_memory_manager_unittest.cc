@@ -0,0 +1,169 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "content/child/child_discardable_shared_memory_manager.h"
+
+#include "base/memory/discardable_memory.h"
+#include "base/memory/discardable_shared_memory.h"
+#include "base/memory/scoped_vector.h"
+#include "base/message_loop/message_loop.h"
+#include "base/process/process_handle.h"
+#include "base/test/test_simple_task_runner.h"
+#include "content/child/thread_safe_sender.h"
+#include "content/common/child_process_messages.h"
+#include "ipc/ipc_sync_message.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace content {
+namespace {
+
+// The size of the segments the manager allocates by default.
+const size_t kSegmentSize = 4 * 1024 * 1024;
+
+// Plays the part of the browser, and counts the segments it is asked for.
+class FakeSender : public ThreadSafeSender {
+ public:
+  FakeSender() : ThreadSafeSender(nullptr, nullptr), allocations_(0) {}
+
+  bool Send(IPC::Message* msg) override {
+    scoped_ptr<IPC::Message> message(msg);
+    if (message->type() ==
+        ChildProcessHostMsg_DeletedDiscardableSharedMemory::ID) {
+      return true;
+    }
+
+    EXPECT_EQ(ChildProcessHostMsg_SyncAllocateLockedDiscardableSharedMemory::ID,
+              message->type());
+    ++allocations_;
+    ChildProcessHostMsg_SyncAllocateLockedDiscardableSharedMemory::SendParam
+        param;
+    EXPECT_TRUE(
+        ChildProcessHostMsg_SyncAllocateLockedDiscardableSharedMemory::
+            ReadSendParam(message.get(), &param));
+    size_t size = base::get<0>(param);
+
+    scoped_ptr<base::DiscardableSharedMemory> memory(
+        new base::DiscardableSharedMemory);
+    base::SharedMemoryHandle handle = base::SharedMemory::NULLHandle();
+    EXPECT_TRUE(memory->CreateAndMap(size));
+    EXPECT_TRUE(
+        memory->ShareToProcess(base::GetCurrentProcessHandle(), &handle));
+    segments_.push_back(memory.release());
+
+    scoped_ptr<IPC::Message> reply(
+        IPC::SyncMessage::GenerateReply(message.get()));
+    ChildProcessHostMsg_SyncAllocateLockedDiscardableSharedMemory::
+        WriteReplyParams(reply.get(), handle);
+    scoped_ptr<IPC::MessageReplyDeserializer> deserializer(
+        static_cast<IPC::SyncMessage*>(message.get())->GetReplyDeserializer());
+    return deserializer->SerializeOutputParameters(*reply);
+  }
+
+  int allocations() const { return allocations_; }
+
+ private:
+  ~FakeSender() override {}
+
+  int allocations_;
+  ScopedVector<base::DiscardableSharedMemory> segments_;
+};
+
+class ChildDiscardableSharedMemoryManagerTest : public testing::Test {
+ protected:
+  ChildDiscardableSharedMemoryManagerTest()
+      : sender_(new FakeSender),
+        task_runner_(new base::TestSimpleTaskRunner),
+        manager_(new ChildDiscardableSharedMemoryManager(sender_.get(),
+                                                         task_runner_)) {}
+
+  base::MessageLoop message_loop_;
+  scoped_refptr<FakeSender> sender_;
+  scoped_refptr<base::TestSimpleTaskRunner> task_runner_;
+  scoped_ptr<ChildDiscardableSharedMemoryManager> manager_;
+};
+
+TEST_F(ChildDiscardableSharedMemoryManagerTest,
+       ReservoirAvoidsSyncAllocation) {
+  scoped_ptr<base::DiscardableMemory> first =
+      manager_->AllocateLockedDiscardableMemory(kSegmentSize);
+  EXPECT_EQ(1, sender_->allocations());
+
+  // A segment is reserved off this thread.
+  ASSERT_TRUE(task_runner_->HasPendingTask());
+  task_runner_->RunPendingTasks();
+  EXPECT_EQ(2, sender_->allocations());
+
+  // Allocations which miss the free lists take reserved segments, and only
+  // the refills ask for more.
+  ScopedVector<base::DiscardableMemory> memory;
+  for (int i = 0; i < 10; ++i) {
+    int allocations = sender_->allocations();
+    memory.push_back(
+        manager_->AllocateLockedDiscardableMemory(kSegmentSize).release());
+    EXPECT_EQ(allocations, sender_->allocations());
+    task_runner_->RunPendingTasks();
+  }
+  // Eleven segments are in use, and no more than two are reserved.
+  EXPECT_LE(sender_->allocations(), 13);
+}
+
+TEST_F(ChildDiscardableSharedMemoryManagerTest, FreeListsComeFirst) {
+  scoped_ptr<base::DiscardableMemory> memory =
+      manager_->AllocateLockedDiscardableMemory(kSegmentSize);
+  task_runner_->RunPendingTasks();
+  int allocations = sender_->allocations();
+
+  // Small allocations are satisfied by the free lists and do not refill.
+  memory.reset();
+  memory = manager_->AllocateLockedDiscardableMemory(1024);
+  EXPECT_FALSE(task_runner_->HasPendingTask());
+  EXPECT_EQ(allocations, sender_->allocations());
+}
+
+TEST_F(ChildDiscardableSharedMemoryManagerTest,
+       LargeAllocationsAreNotReserved) {
+  scoped_ptr<base::DiscardableMemory> memory =
+      manager_->AllocateLockedDiscardableMemory(2 * kSegmentSize);
+  EXPECT_EQ(1, sender_->allocations());
+  EXPECT_FALSE(task_runner_->HasPendingTask());
+}
+
+TEST_F(ChildDiscardableSharedMemoryManagerTest, ReleaseFreeMemory) {
+  scoped_ptr<base::DiscardableMemory> memory =
+      manager_->AllocateLockedDiscardableMemory(kSegmentSize);
+  task_runner_->RunPendingTasks();
+  EXPECT_EQ(2, sender_->allocations());
+
+  // Reserved segments are released with the free memory.
+  manager_->ReleaseFreeMemory();
+  scoped_ptr<base::DiscardableMemory> more =
+      manager_->AllocateLockedDiscardableMemory(kSegmentSize);
+  EXPECT_EQ(3, sender_->allocations());
+}
+
+TEST_F(ChildDiscardableSharedMemoryManagerTest, RefillAfterDestruction) {
+  scoped_ptr<base::DiscardableMemory> memory =
+      manager_->AllocateLockedDiscardableMemory(kSegmentSize);
+  ASSERT_TRUE(task_runner_->HasPendingTask());
+  memory.reset();
+  manager_.reset();
+
+  // The refill doesn't ask for anything once the manager is gone.
+  task_runner_->RunPendingTasks();
+  EXPECT_EQ(1, sender_->allocations());
+}
+
+TEST_F(ChildDiscardableSharedMemoryManagerTest, NoReservoirTaskRunner) {
+  manager_.reset(new ChildDiscardableSharedMemoryManager(sender_.get(),
+                                                         nullptr));
+  ScopedVector<base::DiscardableMemory> memory;
+  for (int i = 0; i < 3; ++i) {
+    memory.push_back(
+        manager_->AllocateLockedDiscardableMemory(kSegmentSize).release());
+  }
+  EXPECT_EQ(3, sender_->allocations());
+}
+
+}  // namespace
+}  // namespace content
@@ -7,6 +7,7 @@
 #include "content/common/child_process_messages.h"
 #include "content/common/generic_shared_memory_id_generator.h"
 #include "content/common/gpu/client/gpu_memory_buffer_impl.h"
+#include "content/common/gpu/client/shared_memory_gpu_memory_buffer_pool.h"
 
 namespace content {
 namespace {
@@ -22,11 +23,22 @@ void DeletedGpuMemoryBuffer(ThreadSafeSender* sender,
 }  // namespace
 
 ChildGpuMemoryBufferManager::ChildGpuMemoryBufferManager(
-    ThreadSafeSender* sender)
-    : sender_(sender) {
+    ThreadSafeSender* sender,
+    const scoped_refptr<base::SingleThreadTaskRunner>& task_runner)
+    : sender_(sender),
+      pool_(new SharedMemoryGpuMemoryBufferPool(
+          base::Bind(&DeletedGpuMemoryBuffer, sender_),
+          task_runner)) {
 }
 
 ChildGpuMemoryBufferManager::~ChildGpuMemoryBufferManager() {
+  // Buffers still in use keep the pool alive, and are deleted for good once
+  // they expire.
+  pool_->ReleaseFreeMemory();
+}
+
+void ChildGpuMemoryBufferManager::ReleaseFreeMemory() {
+  pool_->ReleaseFreeMemory();
 }
 
 scoped_ptr<gfx::GpuMemoryBuffer>
@@ -40,6 +52,11 @@ ChildGpuMemoryBufferManager::AllocateGpuMemoryBuffer(const gfx::Size& size,
                "height",
                size.height());
 
+  scoped_ptr<gfx::GpuMemoryBuffer> buffer =
+      pool_->Allocate(size, format, usage);
+  if (buffer)
+    return buffer.Pass();
+
   gfx::GpuMemoryBufferHandle handle;
   IPC::Message* message = new ChildProcessHostMsg_SyncAllocateGpuMemoryBuffer(
       content::GetNextGenericSharedMemoryId(), size.width(), size.height(),
@@ -48,9 +65,7 @@ ChildGpuMemoryBufferManager::AllocateGpuMemoryBuffer(const gfx::Size& size,
   if (!success || handle.is_null())
     return nullptr;
 
-  scoped_ptr<GpuMemoryBufferImpl> buffer(GpuMemoryBufferImpl::CreateFromHandle(
-      handle, size, format, usage,
-      base::Bind(&DeletedGpuMemoryBuffer, sender_, handle.id)));
+  buffer = pool_->CreateFromHandle(handle, size, format, usage);
   if (!buffer) {
     sender_->Send(new ChildProcessHostMsg_DeletedGpuMemoryBuffer(
         handle.id, gpu::SyncToken()));
@@ -5,16 +5,33 @@
 #ifndef CONTENT_CHILD_CHILD_GPU_MEMORY_BUFFER_MANAGER_H_
 #define CONTENT_CHILD_CHILD_GPU_MEMORY_BUFFER_MANAGER_H_
 
+#include "base/memory/ref_counted.h"
 #include "content/child/thread_safe_sender.h"
+#include "content/common/content_export.h"
 #include "gpu/command_buffer/client/gpu_memory_buffer_manager.h"
 
-namespace content {
+namespace base {
+class SingleThreadTaskRunner;
+}
 
-class ChildGpuMemoryBufferManager : public gpu::GpuMemoryBufferManager {
+namespace content {
+class SharedMemoryGpuMemoryBufferPool;
+
+// Allocates GPU memory buffers through the browser. Shared memory buffers
+// which are deleted are kept for a while and handed out again to allocations
+// of the same size, format and usage, which then don't block on the browser.
+// Buffers which are not reused are deleted by tasks on |task_runner|.
+class CONTENT_EXPORT ChildGpuMemoryBufferManager
+    : public gpu::GpuMemoryBufferManager {
  public:
-  explicit ChildGpuMemoryBufferManager(ThreadSafeSender* sender);
+  ChildGpuMemoryBufferManager(
+      ThreadSafeSender* sender,
+      const scoped_refptr<base::SingleThreadTaskRunner>& task_runner);
   ~ChildGpuMemoryBufferManager() override;
 
+  // Deletes the shared memory buffers which are kept for reuse.
+  void ReleaseFreeMemory();
+
   // Overridden from gpu::GpuMemoryBufferManager:
   scoped_ptr<gfx::GpuMemoryBuffer> AllocateGpuMemoryBuffer(
       const gfx::Size& size,
@@ -31,6 +48,7 @@ class ChildGpuMemoryBufferManager : public gpu::GpuMemoryBufferManager {
 
  private:
   scoped_refptr<ThreadSafeSender> sender_;
+  scoped_refptr<SharedMemoryGpuMemoryBufferPool> pool_;
 
   DISALLOW_COPY_AND_ASSIGN(ChildGpuMemoryBufferManager);
 };
@@ -27,6 +27,7 @@
 #include "base/synchronization/lock.h"
 #include "base/thread_task_runner_handle.h"
 #include "base/threading/thread_local.h"
+#include "base/threading/worker_pool.h"
 #include "base/tracked_objects.h"
 #include "components/tracing/child_trace_message_filter.h"
 #include "content/child/child_discardable_shared_memory_manager.h"
@@ -519,11 +520,12 @@ void ChildThreadImpl::Init(const Options& options) {
   shared_bitmap_manager_.reset(
       new ChildSharedBitmapManager(thread_safe_sender()));
 
-  gpu_memory_buffer_manager_.reset(
-      new ChildGpuMemoryBufferManager(thread_safe_sender()));
+  gpu_memory_buffer_manager_.reset(new ChildGpuMemoryBufferManager(
+      thread_safe_sender(), message_loop_->task_runner()));
 
   discardable_shared_memory_manager_.reset(
-      new ChildDiscardableSharedMemoryManager(thread_safe_sender()));
+      new ChildDiscardableSharedMemoryManager(
+          thread_safe_sender(), base::WorkerPool::GetTaskRunner(true)));
 }
 
 ChildThreadImpl::~ChildThreadImpl() {
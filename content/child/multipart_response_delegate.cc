@@ -4,6 +4,10 @@
 
 #include "content/child/multipart_response_delegate.h"
 
+#include <string.h>
+
+#include <algorithm>
+
 #include "base/logging.h"
 #include "base/memory/ref_counted.h"
 #include "base/strings/string_number_conversions.h"
@@ -37,6 +41,11 @@ const char* kReplaceHeaders[] = {
   "set-cookie"
 };
 
+// Bytes held back from an earlier call are sent together with the ones that
+// follow them in the input when there are no more than this many of those.
+// Longer runs are sent from the input without copying, in a second call.
+const size_t kMaxJoinedInputLength = 1024;
+
 class HeaderCopier : public WebHTTPHeaderVisitor {
  public:
   HeaderCopier(WebURLResponse* response)
@@ -65,16 +74,17 @@ MultipartResponseDelegate::MultipartResponseDelegate(
       loader_(loader),
       original_response_(response),
       encoded_data_length_(0),
-      boundary_("--"),
+      input_(NULL),
+      input_length_(0),
       first_received_data_(true),
       processing_headers_(false),
       stop_sending_(false),
       has_sent_first_response_(false) {
   // Some servers report a boundary prefixed with "--".  See bug 5786.
   if (base::StartsWith(boundary, "--", base::CompareCase::SENSITIVE)) {
-    boundary_.assign(boundary);
+    SetBoundary(boundary);
   } else {
-    boundary_.append(boundary);
+    SetBoundary("--" + boundary);
   }
 }
 
@@ -87,27 +97,39 @@ void MultipartResponseDelegate::OnReceivedData(const char* data,
   if (stop_sending_)
     return;
 
-  data_.append(data, data_len);
   encoded_data_length_ += encoded_data_length;
+  input_ = data;
+  input_length_ = data_len;
+  ParseInput();
+
+  // Keep what couldn't be handled yet for the next call; |data| is only valid
+  // until we return.
+  if (!stop_sending_)
+    BufferInput();
+  input_ = NULL;
+  input_length_ = 0;
+}
+
+void MultipartResponseDelegate::ParseInput() {
   if (first_received_data_) {
     // Some servers don't send a boundary token before the first chunk of
     // data.  We handle this case anyway (Gecko does too).
-    first_received_data_ = false;
 
     // Eat leading \r\n
-    int pos = PushOverLine(data_, 0);
-    if (pos)
-      data_ = data_.substr(pos);
+    ConsumeInput(PushOverLine(0));
 
-    if (data_.length() < boundary_.length() + 2) {
+    if (InputLength() < boundary_.length() + 2) {
       // We don't have enough data yet to make a boundary token.  Just wait
       // until the next chunk of data arrives.
-      first_received_data_ = true;
       return;
     }
+    first_received_data_ = false;
 
-    if (0 != data_.compare(0, boundary_.length(), boundary_)) {
-      data_ = boundary_ + "\n" + data_;
+    for (size_t i = 0; i < boundary_.length(); ++i) {
+      if (InputAt(i) != boundary_[i]) {
+        data_.insert(0, boundary_ + "\n");
+        break;
+      }
     }
   }
   DCHECK(!first_received_data_);
@@ -115,11 +137,9 @@ void MultipartResponseDelegate::OnReceivedData(const char* data,
   // Headers
   if (processing_headers_) {
     // Eat leading \r\n
-    int pos = PushOverLine(data_, 0);
-    if (pos)
-      data_ = data_.substr(pos);
+    ConsumeInput(PushOverLine(0));
 
-    if (ParseHeaders()) {
+    if (ParseInputHeaders()) {
       // Successfully parsed headers.
       processing_headers_ = false;
     } else {
@@ -131,59 +151,48 @@ void MultipartResponseDelegate::OnReceivedData(const char* data,
 
   size_t boundary_pos;
   while ((boundary_pos = FindBoundary()) != std::string::npos) {
-    if (client_) {
-      // Strip out trailing \n\r characters in the buffer preceding the
-      // boundary on the same lines as Firefox.
-      size_t data_length = boundary_pos;
-      if (boundary_pos > 0 && data_[boundary_pos - 1] == '\n') {
+    // Strip out trailing \n\r characters in the buffer preceding the
+    // boundary on the same lines as Firefox.
+    size_t data_length = boundary_pos;
+    if (boundary_pos > 0 && InputAt(boundary_pos - 1) == '\n') {
+      data_length--;
+      if (boundary_pos > 1 && InputAt(boundary_pos - 2) == '\r') {
         data_length--;
-        if (boundary_pos > 1 && data_[boundary_pos - 2] == '\r') {
-          data_length--;
-        }
-      }
-      if (data_length > 0) {
-        // Send the last data chunk.
-        client_->didReceiveData(loader_,
-                                data_.data(),
-                                static_cast<int>(data_length),
-                                encoded_data_length_);
-        encoded_data_length_ = 0;
       }
     }
+    if (data_length > 0) {
+      // Send the last data chunk.
+      SendData(data_length);
+    }
     size_t boundary_end_pos = boundary_pos + boundary_.length();
-    if (boundary_end_pos < data_.length() && '-' == data_[boundary_end_pos]) {
+    if (boundary_end_pos < InputLength() && '-' == InputAt(boundary_end_pos)) {
       // This was the last boundary so we can stop processing.
       stop_sending_ = true;
       data_.clear();
+      input_length_ = 0;
       return;
     }
 
     // We can now throw out data up through the boundary
-    int offset = PushOverLine(data_, boundary_end_pos);
-    data_ = data_.substr(boundary_end_pos + offset);
+    ConsumeInput(boundary_end_pos + PushOverLine(boundary_end_pos));
 
     // Ok, back to parsing headers
-    if (!ParseHeaders()) {
+    if (!ParseInputHeaders()) {
       processing_headers_ = true;
-      break;
+      return;
     }
   }
 
   // At this point, we should send over any data we have, but keep enough data
   // buffered to handle a boundary that may have been truncated.
-  if (!processing_headers_ && data_.length() > boundary_.length()) {
+  if (InputLength() > boundary_.length()) {
     // If the last character is a new line character, go ahead and just send
     // everything we have buffered.  This matches an optimization in Gecko.
-    int send_length = data_.length() - boundary_.length();
-    if (data_[data_.length() - 1] == '\n')
-      send_length = data_.length();
-    if (client_)
-      client_->didReceiveData(loader_,
-                              data_.data(),
-                              send_length,
-                              encoded_data_length_);
-    data_ = data_.substr(send_length);
-    encoded_data_length_ = 0;
+    size_t send_length = InputLength() - boundary_.length();
+    if (InputAt(InputLength() - 1) == '\n')
+      send_length = InputLength();
+    SendData(send_length);
+    ConsumeInput(send_length);
   }
 }
 
@@ -199,29 +208,108 @@ void MultipartResponseDelegate::OnCompletedRequest() {
   }
 }
 
-int MultipartResponseDelegate::PushOverLine(const std::string& data,
-                                            size_t pos) {
+void MultipartResponseDelegate::ConsumeInput(size_t length) {
+  DCHECK_LE(length, InputLength());
+  if (length < data_.length()) {
+    data_.erase(0, length);
+    return;
+  }
+  length -= data_.length();
+  data_.clear();
+  input_ += length;
+  input_length_ -= length;
+}
+
+void MultipartResponseDelegate::BufferInput() {
+  data_.append(input_, input_length_);
+  input_ += input_length_;
+  input_length_ = 0;
+}
+
+void MultipartResponseDelegate::SendData(size_t length) {
+  DCHECK_LE(length, InputLength());
+  if (client_) {
+    size_t buffered_length = data_.length();
+    if (buffered_length == 0) {
+      client_->didReceiveData(loader_, input_, static_cast<int>(length),
+                              encoded_data_length_);
+    } else if (length <= buffered_length) {
+      client_->didReceiveData(loader_, data_.data(), static_cast<int>(length),
+                              encoded_data_length_);
+    } else if (length - buffered_length <= kMaxJoinedInputLength) {
+      // Join the buffered bytes with the few that follow them; that's cheaper
+      // for the client than another call.
+      data_.append(input_, length - buffered_length);
+      client_->didReceiveData(loader_, data_.data(), static_cast<int>(length),
+                              encoded_data_length_);
+      data_.resize(buffered_length);
+    } else {
+      client_->didReceiveData(loader_, data_.data(),
+                              static_cast<int>(buffered_length),
+                              encoded_data_length_);
+      if (client_) {
+        client_->didReceiveData(loader_, input_,
+                                static_cast<int>(length - buffered_length), 0);
+      }
+    }
+  }
+  encoded_data_length_ = 0;
+}
+
+int MultipartResponseDelegate::PushOverLine(size_t pos) const {
   int offset = 0;
-  if (pos < data.length() && (data[pos] == '\r' || data[pos] == '\n')) {
+  if (pos < InputLength() &&
+      (InputAt(pos) == '\r' || InputAt(pos) == '\n')) {
     ++offset;
-    if (pos + 1 < data.length() && data[pos + 1] == '\n')
+    if (pos + 1 < InputLength() && InputAt(pos + 1) == '\n')
       ++offset;
   }
   return offset;
 }
 
+bool MultipartResponseDelegate::ParseInputHeaders() {
+  if (data_.empty()) {
+    int headers_length = ParseHeaders(input_, input_length_);
+    if (headers_length >= 0) {
+      ConsumeInput(headers_length);
+      return true;
+    }
+    BufferInput();
+    return false;
+  }
+
+  // The headers started in an earlier call.  They're short, so reassemble
+  // them in data_, and then read whatever follows them from the input again.
+  size_t input_length = input_length_;
+  BufferInput();
+  if (!ParseHeaders())
+    return false;
+  size_t unread_length = std::min(data_.length(), input_length);
+  data_.resize(data_.length() - unread_length);
+  input_ -= unread_length;
+  input_length_ = unread_length;
+  return true;
+}
+
 bool MultipartResponseDelegate::ParseHeaders() {
+  int headers_length = ParseHeaders(data_.data(), data_.length());
+  if (headers_length < 0)
+    return false;
+  data_.erase(0, headers_length);
+  return true;
+}
+
+int MultipartResponseDelegate::ParseHeaders(const char* data, size_t length) {
   int headers_end_pos = net::HttpUtil::LocateEndOfAdditionalHeaders(
-      data_.c_str(), data_.size(), 0);
+      data, static_cast<int>(length), 0);
 
   if (headers_end_pos < 0)
-    return false;
+    return -1;
 
   // Eat headers and prepend a status line as is required by
   // HttpResponseHeaders.
   std::string headers("HTTP/1.1 200 OK\r\n");
-  headers.append(data_, 0, headers_end_pos);
-  data_ = data_.substr(headers_end_pos);
+  headers.append(data, headers_end_pos);
 
   scoped_refptr<net::HttpResponseHeaders> response_headers =
       new net::HttpResponseHeaders(
@@ -264,27 +352,70 @@ bool MultipartResponseDelegate::ParseHeaders() {
   if (client_)
     client_->didReceiveResponse(loader_, response);
 
-  return true;
+  return headers_end_pos;
 }
 
 // Boundaries are supposed to be preceeded with --, but it looks like gecko
 // doesn't require the dashes to exist.  See nsMultiMixedConv::FindToken.
 size_t MultipartResponseDelegate::FindBoundary() {
-  size_t boundary_pos = data_.find(boundary_);
+  // A boundary which starts in data_ may end in the input, so search data_
+  // with enough of the input appended to complete one.  The input itself is
+  // searched where it is.
+  size_t boundary_pos = std::string::npos;
+  size_t buffered_length = data_.length();
+  if (buffered_length > 0) {
+    data_.append(input_,
+                 std::min(input_length_, boundary_.length() - 1));
+    boundary_pos = SearchBoundary(data_.data(), data_.length());
+    data_.resize(buffered_length);
+  }
+  if (boundary_pos == std::string::npos) {
+    boundary_pos = SearchBoundary(input_, input_length_);
+    if (boundary_pos != std::string::npos)
+      boundary_pos += buffered_length;
+  }
+
   if (boundary_pos != std::string::npos) {
     // Back up over -- for backwards compat
     // TODO(tc): Don't we only want to do this once?  Gecko code doesn't seem
     // to care.
     if (boundary_pos >= 2) {
-      if ('-' == data_[boundary_pos - 1] && '-' == data_[boundary_pos - 2]) {
+      if ('-' == InputAt(boundary_pos - 1) &&
+          '-' == InputAt(boundary_pos - 2)) {
         boundary_pos -= 2;
-        boundary_ = "--" + boundary_;
+        SetBoundary("--" + boundary_);
       }
     }
   }
   return boundary_pos;
 }
 
+size_t MultipartResponseDelegate::SearchBoundary(const char* data,
+                                                 size_t length) const {
+  const size_t boundary_length = boundary_.length();
+  const char boundary_last = boundary_[boundary_length - 1];
+  for (size_t pos = 0; pos + boundary_length <= length;) {
+    char last = data[pos + boundary_length - 1];
+    if (last == boundary_last &&
+        memcmp(data + pos, boundary_.data(), boundary_length - 1) == 0) {
+      return pos;
+    }
+    pos += boundary_skip_[static_cast<unsigned char>(last)];
+  }
+  return std::string::npos;
+}
+
+void MultipartResponseDelegate::SetBoundary(const std::string& boundary) {
+  DCHECK(!boundary.empty());
+  boundary_ = boundary;
+  std::fill(boundary_skip_, boundary_skip_ + arraysize(boundary_skip_),
+            boundary_.length());
+  for (size_t i = 0; i + 1 < boundary_.length(); ++i) {
+    boundary_skip_[static_cast<unsigned char>(boundary_[i])] =
+        boundary_.length() - 1 - i;
+  }
+}
+
 bool MultipartResponseDelegate::ReadMultipartBoundary(
     const WebURLResponse& response,
     std::string* multipart_boundary) {
@@ -106,29 +106,73 @@ class CONTENT_EXPORT MultipartResponseDelegate {
   // starting point for each parts response.
   blink::WebURLResponse original_response_;
 
-  // Checks to see if data[pos] character is a line break; handles crlf, lflf,
-  // lf, or cr. Returns the number of characters to skip over (0, 1 or 2).
-  int PushOverLine(const std::string& data, size_t pos);
+  // Parses the input of one OnReceivedData call, which is available through
+  // the methods below until it returns.
+  void ParseInput();
+
+  // The bytes held back in data_ followed by the current input.  Part bodies
+  // are sent to the client straight from the input, so only partial headers
+  // and the tail of the input that may be the start of a boundary are copied.
+  size_t InputLength() const { return data_.length() + input_length_; }
+  char InputAt(size_t pos) const {
+    return pos < data_.length() ? data_[pos]
+                                : input_[pos - data_.length()];
+  }
+  void ConsumeInput(size_t length);
+  void BufferInput();
+
+  // Sends the first |length| bytes of the input to the client.
+  void SendData(size_t length);
+
+  // Checks to see if the input character at |pos| is a line break; handles
+  // crlf, lflf, lf, or cr. Returns the number of characters to skip over (0, 1
+  // or 2).
+  int PushOverLine(size_t pos) const;
+
+  // Tries to parse http headers from the start of the input.  Returns true if
+  // it succeeds, in which case the headers are consumed.  Returns false if the
+  // header is incomplete, in which case all of the input is buffered.
+  bool ParseInputHeaders();
 
   // Tries to parse http headers from the start of data_.  Returns true if it
   // succeeds and sends a didReceiveResponse to m_client.  Returns false if
   // the header is incomplete (in which case we just wait for more data).
   bool ParseHeaders();
 
-  // Find the next boundary in data_.  Returns std::string::npos if there's no
-  // full token.
+  // Tries to parse http headers from the start of |data|.  Returns their
+  // length if it succeeds and sends a didReceiveResponse to m_client.
+  // Returns -1 if the header is incomplete.
+  int ParseHeaders(const char* data, size_t length);
+
+  // Find the next boundary in the input.  Returns std::string::npos if there's
+  // no full token.
   size_t FindBoundary();
 
+  // Returns the offset of the first boundary_ in |data|, or std::string::npos.
+  size_t SearchBoundary(const char* data, size_t length) const;
+
+  // Sets boundary_ and builds boundary_skip_ for it.
+  void SetBoundary(const std::string& boundary);
+
   // Transferred data size accumulated between client callbacks.
   int encoded_data_length_;
 
   // A temporary buffer to hold data between reads for multipart data that
-  // gets split in the middle of a header.
+  // gets split in the middle of a header or a boundary.
   std::string data_;
 
+  // The part of the current OnReceivedData call's data that hasn't been
+  // consumed or buffered yet.
+  const char* input_;
+  size_t input_length_;
+
   // Multipart boundary token
   std::string boundary_;
 
+  // Boyer-Moore-Horspool shift table for boundary_: how far the search window
+  // can move on when its last byte has a given value.
+  size_t boundary_skip_[256];
+
   // true until we get our first on received data call
   bool first_received_data_;
 
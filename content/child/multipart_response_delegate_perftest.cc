@@ -0,0 +1,101 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "content/child/multipart_response_delegate.h"
+
+#include <algorithm>
+#include <string>
+
+#include "base/strings/stringprintf.h"
+#include "base/time/time.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_test.h"
+#include "third_party/WebKit/public/platform/WebURLLoaderClient.h"
+#include "third_party/WebKit/public/platform/WebURLResponse.h"
+
+using blink::WebURLError;
+using blink::WebURLLoader;
+using blink::WebURLLoaderClient;
+using blink::WebURLRequest;
+using blink::WebURLResponse;
+
+namespace content {
+namespace {
+
+// Counts what it receives, and nothing else.
+class CountingWebURLLoaderClient : public WebURLLoaderClient {
+ public:
+  CountingWebURLLoaderClient() : received_response_(0), received_bytes_(0) {}
+
+  void willFollowRedirect(WebURLLoader*,
+                          WebURLRequest&,
+                          const WebURLResponse&) override {}
+  void didSendData(WebURLLoader*,
+                   unsigned long long,
+                   unsigned long long) override {}
+  void didReceiveResponse(WebURLLoader*, const WebURLResponse&) override {
+    ++received_response_;
+  }
+  void didReceiveData(WebURLLoader*,
+                      const char*,
+                      int data_length,
+                      int) override {
+    received_bytes_ += data_length;
+  }
+  void didFinishLoading(WebURLLoader*, double, int64_t) override {}
+  void didFail(WebURLLoader*, const WebURLError&) override {}
+
+  int received_response_;
+  size_t received_bytes_;
+};
+
+// Builds a stream of |parts| parts of |part_size| bytes each.
+std::string BuildLargePartStream(int parts, size_t part_size) {
+  std::string part(part_size, 'x');
+  // Plenty of near misses for the boundary search.
+  for (size_t i = 0; i < part.size(); i += 7)
+    part[i] = '-';
+  std::string data;
+  for (int i = 0; i < parts; ++i) {
+    data.append("--bound\r\nContent-type: image/jpeg\r\n\r\n");
+    data.append(part);
+    data.append("\r\n");
+  }
+  data.append("--bound--");
+  return data;
+}
+
+TEST(MultipartResponsePerfTest, Throughput) {
+  const size_t kPartSize = 1 << 20;
+  const int kParts = 8;
+  const std::string data = BuildLargePartStream(kParts, kPartSize);
+
+  const size_t kChunkSizes[] = {16, 1460, 32768};
+  for (size_t chunk_size : kChunkSizes) {
+    WebURLResponse response;
+    response.initialize();
+    response.setMIMEType("multipart/x-mixed-replace");
+    CountingWebURLLoaderClient client;
+    MultipartResponseDelegate delegate(&client, NULL, response, "bound");
+
+    base::TimeTicks start = base::TimeTicks::Now();
+    for (size_t pos = 0; pos < data.length(); pos += chunk_size) {
+      size_t length = std::min(chunk_size, data.length() - pos);
+      delegate.OnReceivedData(data.data() + pos, static_cast<int>(length),
+                              static_cast<int>(length));
+    }
+    base::TimeDelta elapsed = base::TimeTicks::Now() - start;
+    EXPECT_EQ(kParts, client.received_response_);
+    EXPECT_EQ(kParts * kPartSize, client.received_bytes_);
+
+    perf_test::PrintResult(
+        "multipart_response_throughput", "",
+        base::StringPrintf("1MB_parts_%dB_chunks",
+                           static_cast<int>(chunk_size)),
+        data.length() / elapsed.InSecondsF() / (1 << 20), "MB/s", true);
+  }
+}
+
+}  // namespace
+}  // namespace content
@@ -4,6 +4,10 @@
 
 #include "content/child/multipart_response_delegate.h"
 
+#include <string.h>
+
+#include <algorithm>
+#include <utility>
 #include <vector>
 
 #include "testing/gtest/include/gtest/gtest.h"
@@ -30,12 +34,15 @@ class MultipartResponseDelegateTester {
   }
 
   int PushOverLine(const std::string& data, size_t pos) {
-    return delegate_->PushOverLine(data, pos);
+    delegate_->data_ = data;
+    return delegate_->PushOverLine(pos);
   }
 
   bool ParseHeaders() { return delegate_->ParseHeaders(); }
   size_t FindBoundary() { return delegate_->FindBoundary(); }
-  std::string& boundary() { return delegate_->boundary_; }
+  void SetBoundary(const std::string& boundary) {
+    delegate_->SetBoundary(boundary);
+  }
   std::string& data() { return delegate_->data_; }
 
  private:
@@ -193,7 +200,7 @@ TEST(MultipartResponseTest, Functions) {
     { "bound", "--boundbound", 0 },
   };
   for (size_t i = 0; i < arraysize(boundary_tests); ++i) {
-    delegate_tester.boundary().assign(boundary_tests[i].boundary);
+    delegate_tester.SetBoundary(boundary_tests[i].boundary);
     delegate_tester.data().assign(boundary_tests[i].data);
     EXPECT_EQ(boundary_tests[i].position,
               delegate_tester.FindBoundary());
@@ -486,6 +493,99 @@ TEST(MultipartResponseTest, MultipleBoundaries) {
   EXPECT_EQ(static_cast<int>(data.length()), client.total_encoded_data_length_);
 }
 
+// Records where the data passed to it was, rather than copying it.
+class DataLocationWebURLLoaderClient : public MockWebURLLoaderClient {
+ public:
+  DataLocationWebURLLoaderClient() : received_bytes_(0) {}
+
+  void didReceiveData(blink::WebURLLoader* loader,
+                      const char* data,
+                      int data_length,
+                      int encoded_data_length) override {
+    ++received_data_;
+    received_bytes_ += data_length;
+    total_encoded_data_length_ += encoded_data_length;
+    data_locations_.push_back(std::make_pair(data, data_length));
+  }
+
+  size_t received_bytes_;
+  std::vector<std::pair<const char*, int>> data_locations_;
+};
+
+// Builds a stream of |parts| parts of |part_size| bytes each.
+string BuildLargePartStream(int parts, size_t part_size) {
+  string part(part_size, 'x');
+  // Plenty of near misses for the boundary search.
+  for (size_t i = 0; i < part.size(); i += 7)
+    part[i] = '-';
+  string data;
+  for (int i = 0; i < parts; ++i) {
+    data.append("--bound\r\nContent-type: image/jpeg\r\n\r\n");
+    data.append(part);
+    data.append("\r\n");
+  }
+  data.append("--bound--");
+  return data;
+}
+
+TEST(MultipartResponseTest, LargePartsAreNotCopied) {
+  WebURLResponse response;
+  response.initialize();
+  response.setMIMEType("multipart/x-mixed-replace");
+  DataLocationWebURLLoaderClient client;
+  MultipartResponseDelegate delegate(&client, NULL, response, "bound");
+
+  const size_t kPartSize = 100000;
+  const string data = BuildLargePartStream(3, kPartSize);
+  // No boundary is close to the start of a chunk.
+  const size_t kChunkSize = 32768;
+  for (size_t pos = 0; pos < data.length(); pos += kChunkSize) {
+    size_t length = std::min(kChunkSize, data.length() - pos);
+    client.data_locations_.clear();
+    delegate.OnReceivedData(data.data() + pos, static_cast<int>(length),
+                            static_cast<int>(length));
+    // Part data is sent from the chunk itself.  Only the few bytes held back
+    // from the previous chunk, in case they started a boundary, are not.
+    for (const auto& location : client.data_locations_) {
+      if (location.first < data.data() + pos ||
+          location.first >= data.data() + pos + length) {
+        EXPECT_GE(static_cast<int>(strlen("--bound")), location.second);
+      }
+    }
+  }
+  delegate.OnCompletedRequest();
+  EXPECT_EQ(3, client.received_response_);
+  EXPECT_EQ(3 * kPartSize, client.received_bytes_);
+  EXPECT_EQ(static_cast<int>(data.length()), client.total_encoded_data_length_);
+}
+
+TEST(MultipartResponseTest, LargePartsInSmallChunks) {
+  const size_t kPartSize = 10000;
+  const string data = BuildLargePartStream(5, kPartSize);
+  const string part = data.substr(data.rfind("\r\n\r\n") + 4, kPartSize);
+
+  const size_t kChunkSizes[] = {1, 2, 3, 7, 8, 100, 1460, 4096};
+  for (size_t chunk_size : kChunkSizes) {
+    WebURLResponse response;
+    response.initialize();
+    response.setMIMEType("multipart/x-mixed-replace");
+    MockWebURLLoaderClient client;
+    MultipartResponseDelegate delegate(&client, NULL, response, "bound");
+    for (size_t pos = 0; pos < data.length(); pos += chunk_size) {
+      size_t length = std::min(chunk_size, data.length() - pos);
+      delegate.OnReceivedData(data.data() + pos, static_cast<int>(length),
+                              static_cast<int>(length));
+    }
+    delegate.OnCompletedRequest();
+    EXPECT_EQ(5, client.received_response_) << chunk_size;
+    EXPECT_EQ(string("image/jpeg"), client.GetResponseHeader("Content-Type"))
+        << chunk_size;
+    EXPECT_TRUE(client.data_ == part) << chunk_size;
+    EXPECT_EQ(static_cast<int>(data.length()),
+              client.total_encoded_data_length_) << chunk_size;
+  }
+}
+
 TEST(MultipartResponseTest, MultipartByteRangeParsingTest) {
   // Test multipart/byteranges based boundary parsing.
   WebURLResponse response1;
@@ -12,6 +12,7 @@
 #include "base/logging.h"
 #include "base/memory/scoped_ptr.h"
 #include "base/values.h"
+#include "content/common/value_wire_format.h"
 #include "third_party/WebKit/public/web/WebArrayBuffer.h"
 #include "third_party/WebKit/public/web/WebArrayBufferConverter.h"
 #include "third_party/WebKit/public/web/WebArrayBufferView.h"
@@ -108,6 +109,9 @@ class V8ValueConverterImpl::FromV8ValueState {
     return max_recursion_depth_ < 0;
   }
 
+  // How deep the value being converted is nested, the top level being 1.
+  int depth() const { return kMaxRecursionDepth - max_recursion_depth_; }
+
  private:
   typedef std::multimap<int, v8::Local<v8::Object> > HashToHandleMap;
   HashToHandleMap unique_map_;
@@ -166,6 +170,31 @@ base::Value* V8ValueConverterImpl::FromV8Value(
   return FromV8ValueImpl(&state, val, context->GetIsolate());
 }
 
+bool V8ValueConverterImpl::FromV8ValueToWire(
+    v8::Local<v8::Value> val,
+    v8::Local<v8::Context> context,
+    std::string* output) const {
+  v8::Context::Scope context_scope(context);
+  v8::HandleScope handle_scope(context->GetIsolate());
+  FromV8ValueState state(avoid_identity_hash_for_testing_);
+  ValueWireWriter writer(output);
+  return WriteV8Value(&state, val, context->GetIsolate(), &writer);
+}
+
+v8::Local<v8::Value> V8ValueConverterImpl::ToV8ValueFromWire(
+    const char* data,
+    size_t size,
+    v8::Local<v8::Context> context) const {
+  v8::Context::Scope context_scope(context);
+  v8::EscapableHandleScope handle_scope(context->GetIsolate());
+  ValueWireReader reader(data, size);
+  v8::Local<v8::Value> result =
+      ReadV8Value(context->GetIsolate(), context->Global(), &reader, 1);
+  if (result.IsEmpty() || reader.RemainingBytes())
+    return v8::Local<v8::Value>();
+  return handle_scope.Escape(result);
+}
+
 v8::Local<v8::Value> V8ValueConverterImpl::ToV8ValueImpl(
     v8::Isolate* isolate,
     v8::Local<v8::Object> creation_context,
@@ -554,4 +583,354 @@ base::Value* V8ValueConverterImpl::FromV8Object(
   return result.release();
 }
 
+bool V8ValueConverterImpl::WriteV8Value(FromV8ValueState* state,
+                                        v8::Local<v8::Value> val,
+                                        v8::Isolate* isolate,
+                                        ValueWireWriter* writer) const {
+  CHECK(!val.IsEmpty());
+
+  FromV8ValueState::Level state_level(state);
+  if (state->HasReachedMaxRecursionDepth())
+    return false;
+
+  if (val->IsNull()) {
+    writer->WriteNull();
+    return true;
+  }
+
+  if (val->IsBoolean()) {
+    writer->WriteBoolean(val->ToBoolean(isolate)->Value());
+    return true;
+  }
+
+  if (val->IsNumber() && strategy_) {
+    base::Value* out = NULL;
+    if (strategy_->FromV8Number(val.As<v8::Number>(), &out))
+      return WriteStrategyValue(out, state, writer);
+  }
+
+  if (val->IsInt32()) {
+    writer->WriteInteger(val->ToInt32(isolate)->Value());
+    return true;
+  }
+
+  if (val->IsNumber()) {
+    double val_as_double = val.As<v8::Number>()->Value();
+    if (!std::isfinite(val_as_double))
+      return false;
+    writer->WriteDouble(val_as_double);
+    return true;
+  }
+
+  if (val->IsString()) {
+    v8::String::Utf8Value utf8(val);
+    writer->WriteString(*utf8, utf8.length());
+    return true;
+  }
+
+  if (val->IsUndefined()) {
+    if (strategy_) {
+      base::Value* out = NULL;
+      if (strategy_->FromV8Undefined(&out))
+        return WriteStrategyValue(out, state, writer);
+    }
+    return false;
+  }
+
+  if (val->IsDate()) {
+    if (!date_allowed_)
+      return WriteV8Object(val->ToObject(isolate), state, isolate, writer);
+    v8::Date* date = v8::Date::Cast(*val);
+    writer->WriteDouble(date->ValueOf() / 1000.0);
+    return true;
+  }
+
+  if (val->IsRegExp()) {
+    if (!reg_exp_allowed_)
+      return WriteV8Object(val.As<v8::Object>(), state, isolate, writer);
+    v8::String::Utf8Value utf8(val);
+    writer->WriteString(*utf8, utf8.length());
+    return true;
+  }
+
+  if (val->IsArray())
+    return WriteV8Array(val.As<v8::Array>(), state, isolate, writer);
+
+  if (val->IsFunction()) {
+    if (!function_allowed_)
+      return false;
+    return WriteV8Object(val.As<v8::Object>(), state, isolate, writer);
+  }
+
+  if (val->IsArrayBuffer() || val->IsArrayBufferView())
+    return WriteV8ArrayBuffer(val.As<v8::Object>(), state, isolate, writer);
+
+  if (val->IsObject())
+    return WriteV8Object(val.As<v8::Object>(), state, isolate, writer);
+
+  LOG(ERROR) << "Unexpected v8 value type encountered.";
+  return false;
+}
+
+bool V8ValueConverterImpl::WriteV8Array(v8::Local<v8::Array> val,
+                                        FromV8ValueState* state,
+                                        v8::Isolate* isolate,
+                                        ValueWireWriter* writer) const {
+  if (!state->UpdateAndCheckUniqueness(val)) {
+    writer->WriteNull();
+    return true;
+  }
+
+  scoped_ptr<v8::Context::Scope> scope;
+  if (!val->CreationContext().IsEmpty() &&
+      val->CreationContext() != isolate->GetCurrentContext())
+    scope.reset(new v8::Context::Scope(val->CreationContext()));
+
+  if (strategy_) {
+    V8ValueConverter::Strategy::FromV8ValueCallback callback =
+        base::Bind(&V8ValueConverterImpl::FromV8ValueImpl,
+                   base::Unretained(this),
+                   base::Unretained(state));
+    base::Value* out = NULL;
+    if (strategy_->FromV8Array(val, &out, isolate, callback))
+      return WriteStrategyValue(out, state, writer);
+  }
+
+  size_t list = writer->BeginList();
+  uint32 count = 0;
+  // The length is checked on every iteration, as FromV8Array() does, since
+  // getters can change it.
+  for (uint32 i = 0; i < val->Length(); ++i, ++count) {
+    v8::TryCatch try_catch(isolate);
+    v8::Local<v8::Value> child_v8 = val->Get(i);
+    if (try_catch.HasCaught()) {
+      LOG(ERROR) << "Getter for index " << i << " threw an exception.";
+      child_v8 = v8::Null(isolate);
+    }
+
+    if (!val->HasRealIndexedProperty(i) ||
+        !WriteV8Value(state, child_v8, isolate, writer)) {
+      writer->WriteNull();
+    }
+  }
+  writer->EndContainer(list, count);
+  return true;
+}
+
+bool V8ValueConverterImpl::WriteV8ArrayBuffer(v8::Local<v8::Object> val,
+                                              FromV8ValueState* state,
+                                              v8::Isolate* isolate,
+                                              ValueWireWriter* writer) const {
+  if (strategy_) {
+    base::Value* out = NULL;
+    if (strategy_->FromV8ArrayBuffer(val, &out, isolate))
+      return WriteStrategyValue(out, state, writer);
+  }
+
+  scoped_ptr<blink::WebArrayBuffer> array_buffer(
+      blink::WebArrayBufferConverter::createFromV8Value(val, isolate));
+  if (array_buffer) {
+    writer->WriteBinary(reinterpret_cast<const char*>(array_buffer->data()),
+                        array_buffer->byteLength());
+    return true;
+  }
+
+  scoped_ptr<blink::WebArrayBufferView> view(
+      blink::WebArrayBufferView::createFromV8Value(val));
+  if (view) {
+    writer->WriteBinary(
+        reinterpret_cast<const char*>(view->baseAddress()) + view->byteOffset(),
+        view->byteLength());
+    return true;
+  }
+  return false;
+}
+
+bool V8ValueConverterImpl::WriteV8Object(v8::Local<v8::Object> val,
+                                         FromV8ValueState* state,
+                                         v8::Isolate* isolate,
+                                         ValueWireWriter* writer) const {
+  if (!state->UpdateAndCheckUniqueness(val)) {
+    writer->WriteNull();
+    return true;
+  }
+
+  scoped_ptr<v8::Context::Scope> scope;
+  if (!val->CreationContext().IsEmpty() &&
+      val->CreationContext() != isolate->GetCurrentContext())
+    scope.reset(new v8::Context::Scope(val->CreationContext()));
+
+  if (strategy_) {
+    V8ValueConverter::Strategy::FromV8ValueCallback callback =
+        base::Bind(&V8ValueConverterImpl::FromV8ValueImpl,
+                   base::Unretained(this),
+                   base::Unretained(state));
+    base::Value* out = NULL;
+    if (strategy_->FromV8Object(val, &out, isolate, callback))
+      return WriteStrategyValue(out, state, writer);
+  }
+
+  // DOM objects become empty dictionaries, see FromV8Object().
+  size_t dictionary = writer->BeginDictionary();
+  uint32 count = 0;
+  if (val->InternalFieldCount()) {
+    writer->EndContainer(dictionary, count);
+    return true;
+  }
+
+  v8::Local<v8::Array> property_names(val->GetOwnPropertyNames());
+  for (uint32 i = 0; i < property_names->Length(); ++i) {
+    v8::Local<v8::Value> key(property_names->Get(i));
+
+    if (!key->IsString() &&
+        !key->IsNumber()) {
+      NOTREACHED() << "Key \"" << *v8::String::Utf8Value(key) << "\" "
+                      "is neither a string nor a number";
+      continue;
+    }
+
+    v8::String::Utf8Value name_utf8(key);
+
+    v8::TryCatch try_catch(isolate);
+    v8::Local<v8::Value> child_v8 = val->Get(key);
+
+    if (try_catch.HasCaught()) {
+      LOG(WARNING) << "Getter for property " << *name_utf8
+                   << " threw an exception.";
+      child_v8 = v8::Null(isolate);
+    }
+
+    // Properties whose values don't convert are dropped, and so are nulls if
+    // |strip_null_from_objects_|, as in FromV8Object().
+    size_t entry = writer->position();
+    writer->WriteKey(*name_utf8, name_utf8.length());
+    size_t child = writer->position();
+    if (!WriteV8Value(state, child_v8, isolate, writer) ||
+        (strip_null_from_objects_ &&
+         writer->GetTypeAt(child) == base::Value::TYPE_NULL)) {
+      writer->Truncate(entry);
+      continue;
+    }
+    ++count;
+  }
+
+  writer->EndContainer(dictionary, count);
+  return true;
+}
+
+bool V8ValueConverterImpl::WriteStrategyValue(base::Value* value,
+                                              FromV8ValueState* state,
+                                              ValueWireWriter* writer) const {
+  scoped_ptr<base::Value> owned_value(value);
+  if (!owned_value)
+    return false;
+  writer->WriteNestedValue(*owned_value, state->depth());
+  return true;
+}
+
+v8::Local<v8::Value> V8ValueConverterImpl::ReadV8Value(
+    v8::Isolate* isolate,
+    v8::Local<v8::Object> creation_context,
+    ValueWireReader* reader,
+    int depth) const {
+  base::Value::Type type;
+  if (depth > kMaxValueWireDepth || !reader->ReadType(&type))
+    return v8::Local<v8::Value>();
+
+  switch (type) {
+    case base::Value::TYPE_NULL:
+      return v8::Null(isolate);
+
+    case base::Value::TYPE_BOOLEAN: {
+      bool val = false;
+      if (!reader->ReadBoolean(&val))
+        return v8::Local<v8::Value>();
+      return v8::Boolean::New(isolate, val);
+    }
+
+    case base::Value::TYPE_INTEGER: {
+      int val = 0;
+      if (!reader->ReadInteger(&val))
+        return v8::Local<v8::Value>();
+      return v8::Integer::New(isolate, val);
+    }
+
+    case base::Value::TYPE_DOUBLE: {
+      double val = 0.0;
+      if (!reader->ReadDouble(&val))
+        return v8::Local<v8::Value>();
+      return v8::Number::New(isolate, val);
+    }
+
+    case base::Value::TYPE_STRING: {
+      const char* data = NULL;
+      size_t length = 0;
+      if (!reader->ReadString(&data, &length))
+        return v8::Local<v8::Value>();
+      return v8::String::NewFromUtf8(isolate, data, v8::String::kNormalString,
+                                     static_cast<int>(length));
+    }
+
+    case base::Value::TYPE_BINARY: {
+      const char* data = NULL;
+      size_t length = 0;
+      if (!reader->ReadBinary(&data, &length))
+        return v8::Local<v8::Value>();
+      blink::WebArrayBuffer buffer = blink::WebArrayBuffer::create(length, 1);
+      memcpy(buffer.data(), data, length);
+      return blink::WebArrayBufferConverter::toV8Value(
+          &buffer, creation_context, isolate);
+    }
+
+    case base::Value::TYPE_LIST: {
+      uint32 count = 0;
+      if (!reader->ReadCount(&count))
+        return v8::Local<v8::Value>();
+      v8::Local<v8::Array> result(v8::Array::New(isolate, count));
+      for (uint32 i = 0; i < count; ++i) {
+        v8::Local<v8::Value> child_v8 =
+            ReadV8Value(isolate, creation_context, reader, depth + 1);
+        if (child_v8.IsEmpty())
+          return v8::Local<v8::Value>();
+
+        v8::TryCatch try_catch(isolate);
+        result->Set(i, child_v8);
+        if (try_catch.HasCaught())
+          LOG(ERROR) << "Setter for index " << i << " threw an exception.";
+      }
+      return result;
+    }
+
+    case base::Value::TYPE_DICTIONARY: {
+      uint32 count = 0;
+      if (!reader->ReadCount(&count))
+        return v8::Local<v8::Value>();
+      v8::Local<v8::Object> result(v8::Object::New(isolate));
+      for (uint32 i = 0; i < count; ++i) {
+        const char* key = NULL;
+        size_t key_length = 0;
+        if (!reader->ReadKey(&key, &key_length))
+          return v8::Local<v8::Value>();
+        v8::Local<v8::Value> child_v8 =
+            ReadV8Value(isolate, creation_context, reader, depth + 1);
+        if (child_v8.IsEmpty())
+          return v8::Local<v8::Value>();
+
+        v8::TryCatch try_catch(isolate);
+        result->Set(v8::String::NewFromUtf8(isolate, key,
+                                            v8::String::kNormalString,
+                                            static_cast<int>(key_length)),
+                    child_v8);
+        if (try_catch.HasCaught()) {
+          LOG(ERROR) << "Setter for property "
+                     << std::string(key, key_length) << " threw an exception.";
+        }
+      }
+      return result;
+    }
+  }
+  NOTREACHED();
+  return v8::Local<v8::Value>();
+}
+
 }  // namespace content
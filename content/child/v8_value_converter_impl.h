@@ -6,6 +6,7 @@
 #define CONTENT_CHILD_V8_VALUE_CONVERTER_IMPL_H_
 
 #include <map>
+#include <string>
 
 #include "base/basictypes.h"
 #include "base/compiler_specific.h"
@@ -21,6 +22,9 @@ class Value;
 
 namespace content {
 
+class ValueWireReader;
+class ValueWireWriter;
+
 class CONTENT_EXPORT V8ValueConverterImpl : public V8ValueConverter {
  public:
   V8ValueConverterImpl();
@@ -37,6 +41,21 @@ class CONTENT_EXPORT V8ValueConverterImpl : public V8ValueConverter {
   base::Value* FromV8Value(v8::Local<v8::Value> value,
                            v8::Local<v8::Context> context) const override;
 
+  // Like FromV8Value(), but appends the result to |output| in the format of
+  // content/common/value_wire_format.h instead of building a base::Value.
+  // Returns false, leaving |output| as it was, where FromV8Value() would
+  // return NULL.
+  bool FromV8ValueToWire(v8::Local<v8::Value> value,
+                         v8::Local<v8::Context> context,
+                         std::string* output) const;
+
+  // Like ToV8Value(), for |size| bytes of |data| in the format of
+  // content/common/value_wire_format.h. Returns an empty handle unless they
+  // hold exactly one well formed value.
+  v8::Local<v8::Value> ToV8ValueFromWire(const char* data,
+                                         size_t size,
+                                         v8::Local<v8::Context> context) const;
+
  private:
   friend class ScopedAvoidIdentityHashForTesting;
 
@@ -72,6 +91,37 @@ class CONTENT_EXPORT V8ValueConverterImpl : public V8ValueConverter {
                             FromV8ValueState* state,
                             v8::Isolate* isolate) const;
 
+  // The FromV8ValueToWire() counterparts of the above. Each returns false
+  // where the above return NULL, in which case nothing has been written.
+  bool WriteV8Value(FromV8ValueState* state,
+                    v8::Local<v8::Value> value,
+                    v8::Isolate* isolate,
+                    ValueWireWriter* writer) const;
+  bool WriteV8Array(v8::Local<v8::Array> array,
+                    FromV8ValueState* state,
+                    v8::Isolate* isolate,
+                    ValueWireWriter* writer) const;
+  bool WriteV8ArrayBuffer(v8::Local<v8::Object> val,
+                          FromV8ValueState* state,
+                          v8::Isolate* isolate,
+                          ValueWireWriter* writer) const;
+  bool WriteV8Object(v8::Local<v8::Object> object,
+                     FromV8ValueState* state,
+                     v8::Isolate* isolate,
+                     ValueWireWriter* writer) const;
+
+  // Writes |value|, which |strategy_| returned and which may be NULL, at the
+  // depth |state| is at.
+  bool WriteStrategyValue(base::Value* value,
+                          FromV8ValueState* state,
+                          ValueWireWriter* writer) const;
+
+  // Reads a value written at nesting level |depth|.
+  v8::Local<v8::Value> ReadV8Value(v8::Isolate* isolate,
+                                   v8::Local<v8::Object> creation_context,
+                                   ValueWireReader* reader,
+                                   int depth) const;
+
   // If true, we will convert Date JavaScript objects to doubles.
   bool date_allowed_;
 
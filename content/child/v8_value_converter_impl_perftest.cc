@@ -0,0 +1,127 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "content/child/v8_value_converter_impl.h"
+
+#include <string>
+
+#include "base/memory/scoped_ptr.h"
+#include "base/time/time.h"
+#include "base/values.h"
+#include "ipc/ipc_message.h"
+#include "ipc/ipc_message_utils.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_test.h"
+#include "v8/include/v8.h"
+
+namespace content {
+
+class V8ValueConverterImplPerfTest : public testing::Test {
+ public:
+  V8ValueConverterImplPerfTest() : isolate_(v8::Isolate::GetCurrent()) {}
+
+ protected:
+  void SetUp() override {
+    v8::HandleScope handle_scope(isolate_);
+    v8::Local<v8::ObjectTemplate> global = v8::ObjectTemplate::New(isolate_);
+    context_.Reset(isolate_, v8::Context::New(isolate_, NULL, global));
+  }
+
+  void TearDown() override { context_.Reset(); }
+
+  v8::Isolate* isolate_;
+
+  // Context for the JavaScript in the test.
+  v8::Persistent<v8::Context> context_;
+};
+
+// Compares sending a large nested payload the way callers do with a
+// base::Value, converted and then written into an IPC message, with writing it
+// in the wire format straight from V8, and the same on the way back.
+TEST_F(V8ValueConverterImplPerfTest, Wire) {
+  v8::HandleScope handle_scope(isolate_);
+  v8::Local<v8::Context> context =
+      v8::Local<v8::Context>::New(isolate_, context_);
+  v8::Context::Scope context_scope(context);
+
+  const char* source = "(function() {"
+      "var items = [];"
+      "for (var i = 0; i < 2000; ++i) {"
+      "  items.push({ id: i, name: 'item ' + i, score: i / 7,"
+      "               tags: [ 'alpha', 'beta', 'gamma' ],"
+      "               nested: { visible: i % 2 == 0, parent: null,"
+      "                         children: [ i - 1, i + 1 ] } });"
+      "}"
+      "return items;"
+      "})();";
+  v8::Local<v8::Script> script(
+      v8::Script::Compile(v8::String::NewFromUtf8(isolate_, source)));
+  v8::Local<v8::Value> payload = script->Run();
+  ASSERT_TRUE(payload->IsArray());
+
+  V8ValueConverterImpl converter;
+  const int kIterations = 20;
+
+  base::TimeTicks start = base::TimeTicks::Now();
+  size_t message_size = 0;
+  for (int i = 0; i < kIterations; ++i) {
+    scoped_ptr<base::Value> value(converter.FromV8Value(payload, context));
+    base::ListValue* list = NULL;
+    ASSERT_TRUE(value->GetAsList(&list));
+    IPC::Message message(1, 2, IPC::Message::PRIORITY_NORMAL);
+    IPC::WriteParam(&message, *list);
+    message_size = message.size();
+  }
+  base::TimeDelta value_write_time = base::TimeTicks::Now() - start;
+
+  start = base::TimeTicks::Now();
+  std::string wire;
+  for (int i = 0; i < kIterations; ++i) {
+    wire.clear();
+    ASSERT_TRUE(converter.FromV8ValueToWire(payload, context, &wire));
+  }
+  base::TimeDelta wire_write_time = base::TimeTicks::Now() - start;
+
+  scoped_ptr<base::Value> value(converter.FromV8Value(payload, context));
+  base::ListValue* list = NULL;
+  ASSERT_TRUE(value->GetAsList(&list));
+  IPC::Message message(1, 2, IPC::Message::PRIORITY_NORMAL);
+  IPC::WriteParam(&message, *list);
+  start = base::TimeTicks::Now();
+  for (int i = 0; i < kIterations; ++i) {
+    v8::HandleScope iteration_scope(isolate_);
+    base::ListValue read_list;
+    base::PickleIterator iter(message);
+    ASSERT_TRUE(IPC::ReadParam(&message, &iter, &read_list));
+    ASSERT_FALSE(converter.ToV8Value(&read_list, context).IsEmpty());
+  }
+  base::TimeDelta value_read_time = base::TimeTicks::Now() - start;
+
+  start = base::TimeTicks::Now();
+  for (int i = 0; i < kIterations; ++i) {
+    v8::HandleScope iteration_scope(isolate_);
+    ASSERT_FALSE(converter.ToV8ValueFromWire(wire.data(), wire.size(), context)
+                     .IsEmpty());
+  }
+  base::TimeDelta wire_read_time = base::TimeTicks::Now() - start;
+
+  perf_test::PrintResult("v8_value_converter", "_value", "write",
+                         value_write_time.InMicrosecondsF() / kIterations,
+                         "us", true);
+  perf_test::PrintResult("v8_value_converter", "_wire", "write",
+                         wire_write_time.InMicrosecondsF() / kIterations,
+                         "us", true);
+  perf_test::PrintResult("v8_value_converter", "_value", "read",
+                         value_read_time.InMicrosecondsF() / kIterations,
+                         "us", true);
+  perf_test::PrintResult("v8_value_converter", "_wire", "read",
+                         wire_read_time.InMicrosecondsF() / kIterations,
+                         "us", true);
+  perf_test::PrintResult("v8_value_converter", "_value", "size",
+                         message_size, "bytes", true);
+  perf_test::PrintResult("v8_value_converter", "_wire", "size", wire.size(),
+                         "bytes", true);
+}
+
+}  // namespace content
@@ -9,6 +9,7 @@
 #include "base/test/values_test_util.h"
 #include "base/values.h"
 #include "content/child/v8_value_converter_impl.h"
+#include "content/common/value_wire_format.h"
 #include "testing/gtest/include/gtest/gtest.h"
 #include "v8/include/v8.h"
 
@@ -136,12 +137,33 @@ class V8ValueConverterImplTest : public testing::Test {
     return child->IsNull();
   }
 
+  // Checks that FromV8ValueToWire() writes what FromV8Value() returns.
+  void ExpectWireMatches(const V8ValueConverterImpl& converter,
+                         v8::Local<v8::Value> val) {
+    v8::Local<v8::Context> context =
+        v8::Local<v8::Context>::New(isolate_, context_);
+    scoped_ptr<base::Value> expected(converter.FromV8Value(val, context));
+    std::string wire;
+    ASSERT_EQ(!!expected, converter.FromV8ValueToWire(val, context, &wire));
+    if (!expected) {
+      EXPECT_TRUE(wire.empty());
+      return;
+    }
+
+    ValueWireReader reader(wire.data(), wire.size());
+    scoped_ptr<base::Value> actual = reader.ReadValue();
+    ASSERT_TRUE(actual);
+    EXPECT_EQ(0u, reader.RemainingBytes());
+    EXPECT_TRUE(expected->Equals(actual.get())) << *expected << *actual;
+  }
+
   void TestWeirdType(const V8ValueConverterImpl& converter,
                      v8::Local<v8::Value> val,
                      base::Value::Type expected_type,
                      scoped_ptr<base::Value> expected_value) {
     v8::Local<v8::Context> context =
         v8::Local<v8::Context>::New(isolate_, context_);
+    ExpectWireMatches(converter, val);
     scoped_ptr<base::Value> raw(converter.FromV8Value(val, context));
 
     if (expected_value) {
@@ -158,6 +180,7 @@ class V8ValueConverterImplTest : public testing::Test {
         static_cast<base::DictionaryValue*>(
             converter.FromV8Value(object, context)));
     ASSERT_TRUE(dictionary.get());
+    ExpectWireMatches(converter, object);
 
     if (expected_value) {
       base::Value* temp = NULL;
@@ -173,6 +196,7 @@ class V8ValueConverterImplTest : public testing::Test {
     scoped_ptr<base::ListValue> list(
         static_cast<base::ListValue*>(converter.FromV8Value(array, context)));
     ASSERT_TRUE(list.get());
+    ExpectWireMatches(converter, array);
     if (expected_value) {
       base::Value* temp = NULL;
       ASSERT_TRUE(list->Get(0, &temp));
@@ -259,6 +283,56 @@ TEST_F(V8ValueConverterImplTest, BasicRoundTrip) {
   scoped_ptr<base::Value> new_root(converter.FromV8Value(v8_object, context));
   EXPECT_NE(original_root.get(), new_root.get());
   EXPECT_TRUE(original_root->Equals(new_root.get()));
+  ExpectWireMatches(converter, v8_object);
+}
+
+TEST_F(V8ValueConverterImplTest, WireRoundTrip) {
+  scoped_ptr<base::Value> original_root = base::test::ParseJson(
+      "{ \n"
+      "  \"null\": null, \n"
+      "  \"true\": true, \n"
+      "  \"false\": false, \n"
+      "  \"positive-int\": 42, \n"
+      "  \"negative-int\": -2147483648, \n"
+      "  \"double\": 88.8, \n"
+      "  \"string\": \"foo\\u00e9bar\", \n"
+      "  \"empty-string\": \"\", \n"
+      "  \"dictionary\": { \"foo.bar\": [ 1, [ 2, {} ] ] }, \n"
+      "  \"empty-list\": [], \n"
+      "}");
+
+  v8::HandleScope handle_scope(isolate_);
+  v8::Local<v8::Context> context =
+      v8::Local<v8::Context>::New(isolate_, context_);
+  v8::Context::Scope context_scope(context);
+
+  std::string wire;
+  ValueWireWriter writer(&wire);
+  writer.WriteValue(*original_root);
+
+  V8ValueConverterImpl converter;
+  v8::Local<v8::Value> v8_value =
+      converter.ToV8ValueFromWire(wire.data(), wire.size(), context);
+  ASSERT_FALSE(v8_value.IsEmpty());
+  ASSERT_TRUE(v8_value->IsObject());
+  EXPECT_TRUE(v8_value.As<v8::Object>()
+                  ->Get(v8::String::NewFromUtf8(isolate_, "negative-int"))
+                  ->IsInt32());
+
+  scoped_ptr<base::Value> new_root(converter.FromV8Value(v8_value, context));
+  EXPECT_TRUE(original_root->Equals(new_root.get()));
+
+  std::string new_wire;
+  EXPECT_TRUE(converter.FromV8ValueToWire(v8_value, context, &new_wire));
+  EXPECT_EQ(wire.size(), new_wire.size());
+
+  // Anything but exactly one well formed value is rejected.
+  EXPECT_TRUE(converter.ToV8ValueFromWire(wire.data(), wire.size() - 1, context)
+                  .IsEmpty());
+  wire.push_back('\0');
+  EXPECT_TRUE(converter.ToV8ValueFromWire(wire.data(), wire.size(), context)
+                  .IsEmpty());
+  EXPECT_TRUE(converter.ToV8ValueFromWire(NULL, 0, context).IsEmpty());
 }
 
 TEST_F(V8ValueConverterImplTest, KeysWithDots) {
@@ -443,6 +517,7 @@ TEST_F(V8ValueConverterImplTest, StripNullFromObjects) {
           converter.FromV8Value(object, context)));
   ASSERT_TRUE(result.get());
   EXPECT_EQ(0u, result->size());
+  ExpectWireMatches(converter, object);
 }
 
 TEST_F(V8ValueConverterImplTest, RecursiveObjects) {
@@ -476,6 +551,9 @@ TEST_F(V8ValueConverterImplTest, RecursiveObjects) {
   ASSERT_TRUE(list_result.get());
   EXPECT_EQ(2u, list_result->GetSize());
   EXPECT_TRUE(IsNull(list_result.get(), 1));
+
+  ExpectWireMatches(converter, object);
+  ExpectWireMatches(converter, array);
 }
 
 TEST_F(V8ValueConverterImplTest, WeirdProperties) {
@@ -707,6 +785,8 @@ TEST_F(V8ValueConverterImplTest, MaxRecursionDepth) {
   // The leaf node shouldn't have any properties.
   base::DictionaryValue empty;
   EXPECT_TRUE(base::Value::Equals(&empty, current)) << *current;
+
+  ExpectWireMatches(converter, deep_object);
 }
 
 class V8ValueConverterOverridingStrategyForTesting
@@ -801,6 +881,11 @@ TEST_F(V8ValueConverterImplTest, StrategyOverrides) {
   ASSERT_TRUE(undefined_value);
   EXPECT_TRUE(
       base::Value::Equals(strategy.reference_value(), undefined_value.get()));
+
+  ExpectWireMatches(converter, object);
+  ExpectWireMatches(converter, array);
+  ExpectWireMatches(converter, number);
+  ExpectWireMatches(converter, undefined);
 }
 
 class V8ValueConverterBypassStrategyForTesting
@@ -870,6 +955,53 @@ TEST_F(V8ValueConverterImplTest, StrategyBypass) {
   scoped_ptr<base::Value> undefined_value(
       converter.FromV8Value(undefined, context));
   EXPECT_FALSE(undefined_value);
+
+  ExpectWireMatches(converter, object);
+  ExpectWireMatches(converter, array);
+  ExpectWireMatches(converter, number);
+  ExpectWireMatches(converter, undefined);
+}
+
+class V8ValueConverterDeepStrategyForTesting
+    : public V8ValueConverter::Strategy {
+ public:
+  bool FromV8Object(v8::Local<v8::Object> value,
+                    base::Value** out,
+                    v8::Isolate* isolate,
+                    const FromV8ValueCallback& callback) const override {
+    scoped_ptr<base::ListValue> deep(new base::ListValue());
+    for (int i = 1; i < kMaxValueWireDepth; ++i) {
+      scoped_ptr<base::ListValue> outer(new base::ListValue());
+      outer->Append(deep.Pass());
+      deep = outer.Pass();
+    }
+    *out = deep.release();
+    return true;
+  }
+};
+
+// Values from the strategy are nested in what is written around them, and
+// mustn't take the wire format past its depth limit.
+TEST_F(V8ValueConverterImplTest, StrategyValuesRespectWireDepth) {
+  v8::HandleScope handle_scope(isolate_);
+  v8::Local<v8::Context> context =
+      v8::Local<v8::Context>::New(isolate_, context_);
+  v8::Context::Scope context_scope(context);
+
+  V8ValueConverterImpl converter;
+  V8ValueConverterDeepStrategyForTesting strategy;
+  converter.SetStrategy(&strategy);
+
+  v8::Local<v8::Array> array(v8::Array::New(isolate_, 1));
+  array->Set(0, v8::Object::New(isolate_));
+  std::string wire;
+  ASSERT_TRUE(converter.FromV8ValueToWire(array, context, &wire));
+
+  ValueWireReader reader(wire.data(), wire.size());
+  EXPECT_TRUE(reader.ReadValue());
+  EXPECT_EQ(0u, reader.RemainingBytes());
+  EXPECT_FALSE(converter.ToV8ValueFromWire(wire.data(), wire.size(), context)
+                   .IsEmpty());
 }
 
 }  // namespace content
@@ -5,6 +5,7 @@
 #include "content/child/websocket_bridge.h"
 
 #include <stdint.h>
+#include <string.h>
 #include <string>
 #include <utility>
 #include <vector>
@@ -71,6 +72,9 @@ bool WebSocketBridge::OnMessageReceived(const IPC::Message& msg) {
                         DidFinishOpeningHandshake)
     IPC_MESSAGE_HANDLER(WebSocketMsg_NotifyFailure, DidFail)
     IPC_MESSAGE_HANDLER(WebSocketMsg_SendFrame, DidReceiveData)
+    IPC_MESSAGE_HANDLER(WebSocketMsg_AddFrameBuffer, DidAddFrameBuffer)
+    IPC_MESSAGE_HANDLER(WebSocketMsg_SendFrameInBuffer, DidReceiveDataInBuffer)
+    IPC_MESSAGE_HANDLER(WebSocketMsg_FrameBufferAck, DidReceiveFrameBufferAck)
     IPC_MESSAGE_HANDLER(WebSocketMsg_FlowControl, DidReceiveFlowControl)
     IPC_MESSAGE_HANDLER(WebSocketMsg_DropChannel, DidClose)
     IPC_MESSAGE_HANDLER(WebSocketMsg_NotifyClosing,
@@ -147,25 +151,53 @@ void WebSocketBridge::DidReceiveData(bool fin,
            << fin << ", "
            << type << ", "
            << "(data size = " << data.size() << "))";
-  if (!client_)
-    return;
+  PassReceivedData(fin, type, data.empty() ? NULL : &data[0], data.size());
+  // |this| can be deleted here.
+}
 
-  WebSocketHandle::MessageType type_to_pass =
-      WebSocketHandle::MessageTypeContinuation;
-  switch (type) {
-    case WEB_SOCKET_MESSAGE_TYPE_CONTINUATION:
-      type_to_pass = WebSocketHandle::MessageTypeContinuation;
-      break;
-    case WEB_SOCKET_MESSAGE_TYPE_TEXT:
-      type_to_pass = WebSocketHandle::MessageTypeText;
-      break;
-    case WEB_SOCKET_MESSAGE_TYPE_BINARY:
-      type_to_pass = WebSocketHandle::MessageTypeBinary;
-      break;
+void WebSocketBridge::DidAddFrameBuffer(int buffer_id,
+                                        base::SharedMemoryHandle handle,
+                                        uint32 size) {
+  DVLOG(1) << "WebSocketBridge::DidAddFrameBuffer("
+           << buffer_id << ", " << size << ")";
+  scoped_ptr<base::SharedMemory> memory(new base::SharedMemory(handle, true));
+  if (!incoming_frame_buffers_.AddBuffer(buffer_id, memory.Pass(), size)) {
+    FailChannel("Invalid WebSocket frame buffer");
+    // |this| can be deleted here.
   }
-  const char* data_to_pass = data.empty() ? NULL : &data[0];
-  client_->didReceiveData(this, fin, type_to_pass, data_to_pass, data.size());
+}
+
+void WebSocketBridge::DidReceiveDataInBuffer(bool fin,
+                                             WebSocketMessageType type,
+                                             int buffer_id,
+                                             uint32 size) {
+  DVLOG(1) << "WebSocketBridge::DidReceiveDataInBuffer("
+           << fin << ", "
+           << type << ", "
+           << buffer_id << ", "
+           << "(data size = " << size << "))";
+  const char* data = incoming_frame_buffers_.GetFrameData(buffer_id, size);
+  if (!data) {
+    FailChannel("Invalid WebSocket frame buffer");
+    // |this| can be deleted here.
+    return;
+  }
+  // The client copies the data before returning, so the buffer can be handed
+  // back right after. |this| can be deleted by the client, so the ack is sent
+  // with the channel id saved beforehand.
+  int channel_id = channel_id_;
+  PassReceivedData(fin, type, data, size);
   // |this| can be deleted here.
+  if (channel_id != kInvalidChannelId) {
+    ChildThreadImpl::current()->Send(
+        new WebSocketMsg_FrameBufferAck(channel_id, buffer_id));
+  }
+}
+
+void WebSocketBridge::DidReceiveFrameBufferAck(int buffer_id) {
+  DVLOG(1) << "WebSocketBridge::DidReceiveFrameBufferAck(" << buffer_id << ")";
+  if (!outgoing_frame_buffers_.ReleaseBuffer(buffer_id))
+    DLOG(ERROR) << "Unexpected WebSocket frame buffer ack " << buffer_id;
 }
 
 void WebSocketBridge::DidReceiveFlowControl(int64_t quota) {
@@ -203,6 +235,68 @@ void WebSocketBridge::DidStartClosingHandshake() {
   // |this| can be deleted here.
 }
 
+void WebSocketBridge::PassReceivedData(bool fin,
+                                       WebSocketMessageType type,
+                                       const char* data,
+                                       size_t size) {
+  if (!client_)
+    return;
+
+  WebSocketHandle::MessageType type_to_pass =
+      WebSocketHandle::MessageTypeContinuation;
+  switch (type) {
+    case WEB_SOCKET_MESSAGE_TYPE_CONTINUATION:
+      type_to_pass = WebSocketHandle::MessageTypeContinuation;
+      break;
+    case WEB_SOCKET_MESSAGE_TYPE_TEXT:
+      type_to_pass = WebSocketHandle::MessageTypeText;
+      break;
+    case WEB_SOCKET_MESSAGE_TYPE_BINARY:
+      type_to_pass = WebSocketHandle::MessageTypeBinary;
+      break;
+  }
+  client_->didReceiveData(this, fin, type_to_pass, data, size);
+  // |this| can be deleted here.
+}
+
+void WebSocketBridge::FailChannel(const std::string& message) {
+  DLOG(ERROR) << "WebSocketBridge::FailChannel(" << message << ")";
+  if (channel_id_ != kInvalidChannelId) {
+    ChildThreadImpl::current()->Send(
+        new WebSocketMsg_DropChannel(channel_id_,
+                                     false,
+                                     kAbnormalShutdownOpCode,
+                                     std::string()));
+  }
+  DidFail(message);
+  // |this| can be deleted here.
+}
+
+bool WebSocketBridge::SendInBuffer(bool fin,
+                                   WebSocketMessageType type,
+                                   const char* data,
+                                   size_t size) {
+  int buffer_id = outgoing_frame_buffers_.TakeFreeBuffer(size);
+  if (buffer_id < 0) {
+    size_t buffer_size = outgoing_frame_buffers_.GetNewBufferSize(size);
+    if (!buffer_size)
+      return false;
+    scoped_ptr<base::SharedMemory> memory =
+        ChildThreadImpl::current()->AllocateSharedMemory(buffer_size);
+    if (!memory || !memory->Map(buffer_size))
+      return false;
+    base::SharedMemoryHandle handle = memory->handle();
+    buffer_id = outgoing_frame_buffers_.AddBuffer(memory.Pass());
+    ChildThreadImpl::current()->Send(new WebSocketMsg_AddFrameBuffer(
+        channel_id_, buffer_id, handle, static_cast<uint32>(buffer_size)));
+  }
+
+  memcpy(outgoing_frame_buffers_.GetFrameMemory(buffer_id), data, size);
+  ChildThreadImpl::current()->Send(new WebSocketMsg_SendFrameInBuffer(
+      channel_id_, fin, type, buffer_id, static_cast<uint32>(size)));
+  return true;
+}
+
 void WebSocketBridge::connect(const WebURL& url,
                               const WebVector<WebString>& protocols,
                               const WebSecurityOrigin& origin,
@@ -249,6 +343,11 @@ void WebSocketBridge::send(bool fin,
            << fin << ", " << type_to_pass << ", "
            << "(data size = "  << size << "))";
 
+  if (size >= WebSocketFrameBufferPool::kMinFrameSize &&
+      SendInBuffer(fin, type_to_pass, data, size)) {
+    return;
+  }
+
   ChildThreadImpl::current()->Send(
       new WebSocketMsg_SendFrame(channel_id_,
                                  fin,
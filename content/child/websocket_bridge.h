@@ -10,7 +10,9 @@
 #include <vector>
 
 #include "base/basictypes.h"
+#include "base/memory/shared_memory.h"
 #include "content/common/websocket.h"
+#include "content/common/websocket_frame_buffers.h"
 #include "ipc/ipc_message.h"
 #include "third_party/WebKit/public/platform/WebSocketHandle.h"
 #include "third_party/WebKit/public/platform/WebVector.h"
@@ -59,14 +61,45 @@ class WebSocketBridge : public blink::WebSocketHandle {
   void DidReceiveData(bool fin,
                       WebSocketMessageType type,
                       const std::vector<char>& data);
+  void DidAddFrameBuffer(int buffer_id,
+                         base::SharedMemoryHandle handle,
+                         uint32 size);
+  void DidReceiveDataInBuffer(bool fin,
+                              WebSocketMessageType type,
+                              int buffer_id,
+                              uint32 size);
+  void DidReceiveFrameBufferAck(int buffer_id);
   void DidReceiveFlowControl(int64_t quota);
   void DidClose(bool was_clean, unsigned short code, const std::string& reason);
   void DidStartClosingHandshake();
 
+  // Passes a frame received in WebSocketMsg_SendFrame or
+  // WebSocketMsg_SendFrameInBuffer to |client_|.
+  void PassReceivedData(bool fin,
+                        WebSocketMessageType type,
+                        const char* data,
+                        size_t size);
+
+  // Drops the channel in the browser, which sent something that makes no
+  // sense, and fails it for |client_|.
+  void FailChannel(const std::string& message);
+
+  // Sends a frame of at least WebSocketFrameBufferPool::kMinFrameSize bytes in
+  // a shared memory buffer. Returns false if no buffer is available.
+  bool SendInBuffer(bool fin,
+                    WebSocketMessageType type,
+                    const char* data,
+                    size_t size);
+
   int channel_id_;
   int render_frame_id_;
   blink::WebSocketHandleClient* client_;
 
+  // The buffers we send large frames to the browser in, and the ones the
+  // browser sends large frames in.
+  WebSocketFrameBufferPool outgoing_frame_buffers_;
+  WebSocketReceivedFrameBuffers incoming_frame_buffers_;
+
   static const int kInvalidChannelId = -1;
 };
 
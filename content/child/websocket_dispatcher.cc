@@ -41,6 +41,9 @@ bool WebSocketDispatcher::OnMessageReceived(const IPC::Message& msg) {
     case WebSocketMsg_NotifyFinishOpeningHandshake::ID:
     case WebSocketMsg_NotifyFailure::ID:
     case WebSocketMsg_SendFrame::ID:
+    case WebSocketMsg_AddFrameBuffer::ID:
+    case WebSocketMsg_SendFrameInBuffer::ID:
+    case WebSocketMsg_FrameBufferAck::ID:
     case WebSocketMsg_FlowControl::ID:
     case WebSocketMsg_DropChannel::ID:
     case WebSocketMsg_NotifyClosing::ID:
@@ -15,6 +15,8 @@ namespace {
 
 void Noop() {}
 
+void NoopDestruction(const gpu::SyncToken& sync_token) {}
+
 }  // namespace
 
 GpuMemoryBufferImplSharedMemory::GpuMemoryBufferImplSharedMemory(
@@ -24,15 +26,19 @@ GpuMemoryBufferImplSharedMemory::GpuMemoryBufferImplSharedMemory(
     const DestructionCallback& callback,
     scoped_ptr<base::SharedMemory> shared_memory,
     size_t offset,
-    int stride)
+    int stride,
+    const RecycleCallback& recycle_callback)
     : GpuMemoryBufferImpl(id, size, format, callback),
       shared_memory_(shared_memory.Pass()),
       offset_(offset),
-      stride_(stride) {
+      stride_(stride),
+      recycle_callback_(recycle_callback) {
   DCHECK(IsSizeValidForFormat(size, format));
 }
 
 GpuMemoryBufferImplSharedMemory::~GpuMemoryBufferImplSharedMemory() {
+  if (!recycle_callback_.is_null())
+    recycle_callback_.Run(shared_memory_.Pass(), destruction_sync_token_);
 }
 
 // static
@@ -51,7 +57,8 @@ GpuMemoryBufferImplSharedMemory::Create(gfx::GpuMemoryBufferId id,
 
   return make_scoped_ptr(new GpuMemoryBufferImplSharedMemory(
       id, size, format, callback, shared_memory.Pass(), 0,
-      gfx::RowSizeForBufferFormat(size.width(), format, 0)));
+      gfx::RowSizeForBufferFormat(size.width(), format, 0),
+      RecycleCallback()));
 }
 
 // static
@@ -92,7 +99,24 @@ GpuMemoryBufferImplSharedMemory::CreateFromHandle(
   return make_scoped_ptr(new GpuMemoryBufferImplSharedMemory(
       handle.id, size, format, callback,
       make_scoped_ptr(new base::SharedMemory(handle.handle, false)),
-      handle.offset, handle.stride));
+      handle.offset, handle.stride, RecycleCallback()));
+}
+
+// static
+scoped_ptr<GpuMemoryBufferImplSharedMemory>
+GpuMemoryBufferImplSharedMemory::CreateRecyclable(
+    gfx::GpuMemoryBufferId id,
+    const gfx::Size& size,
+    gfx::BufferFormat format,
+    scoped_ptr<base::SharedMemory> shared_memory,
+    const RecycleCallback& callback) {
+  DCHECK(!callback.is_null());
+
+  // The shared memory outlives the instance, so the destruction callback of
+  // the instance has nothing to do.
+  return make_scoped_ptr(new GpuMemoryBufferImplSharedMemory(
+      id, size, format, base::Bind(&NoopDestruction), shared_memory.Pass(), 0,
+      gfx::RowSizeForBufferFormat(size.width(), format, 0), callback));
 }
 
 // static
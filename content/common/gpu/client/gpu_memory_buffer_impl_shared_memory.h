@@ -14,6 +14,10 @@ namespace content {
 class CONTENT_EXPORT GpuMemoryBufferImplSharedMemory
     : public GpuMemoryBufferImpl {
  public:
+  typedef base::Callback<void(scoped_ptr<base::SharedMemory> shared_memory,
+                              const gpu::SyncToken& sync_token)>
+      RecycleCallback;
+
   ~GpuMemoryBufferImplSharedMemory() override;
 
   static scoped_ptr<GpuMemoryBufferImplSharedMemory> Create(
@@ -35,6 +39,17 @@ class CONTENT_EXPORT GpuMemoryBufferImplSharedMemory
       gfx::BufferUsage usage,
       const DestructionCallback& callback);
 
+  // Creates an instance of |size| and |format| on top of |shared_memory|,
+  // which holds the buffer at offset 0. Instead of being closed when the
+  // instance is deleted, |shared_memory| is handed to |callback|, still mapped
+  // if it was, so that another instance can be created on top of it.
+  static scoped_ptr<GpuMemoryBufferImplSharedMemory> CreateRecyclable(
+      gfx::GpuMemoryBufferId id,
+      const gfx::Size& size,
+      gfx::BufferFormat format,
+      scoped_ptr<base::SharedMemory> shared_memory,
+      const RecycleCallback& callback);
+
   static bool IsUsageSupported(gfx::BufferUsage usage);
   static bool IsConfigurationSupported(gfx::BufferFormat format,
                                        gfx::BufferUsage usage);
@@ -60,11 +75,13 @@ class CONTENT_EXPORT GpuMemoryBufferImplSharedMemory
                                   const DestructionCallback& callback,
                                   scoped_ptr<base::SharedMemory> shared_memory,
                                   size_t offset,
-                                  int stride);
+                                  int stride,
+                                  const RecycleCallback& recycle_callback);
 
   scoped_ptr<base::SharedMemory> shared_memory_;
   size_t offset_;
   int stride_;
+  const RecycleCallback recycle_callback_;
 
   DISALLOW_COPY_AND_ASSIGN(GpuMemoryBufferImplSharedMemory);
 };
@@ -0,0 +1,230 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "content/common/gpu/client/shared_memory_gpu_memory_buffer_pool.h"
+
+#include "base/bind.h"
+#include "base/memory/shared_memory.h"
+#include "base/single_thread_task_runner.h"
+#include "base/trace_event/trace_event.h"
+#include "content/common/gpu/client/gpu_memory_buffer_impl_shared_memory.h"
+#include "ui/gfx/buffer_format_util.h"
+
+namespace content {
+
+struct SharedMemoryGpuMemoryBufferPool::FreeBuffer {
+  FreeBuffer(gfx::GpuMemoryBufferId id,
+             const gfx::Size& size,
+             gfx::BufferFormat format,
+             gfx::BufferUsage usage,
+             scoped_ptr<base::SharedMemory> shared_memory,
+             base::TimeTicks returned_time)
+      : id(id),
+        size(size),
+        format(format),
+        usage(usage),
+        shared_memory(shared_memory.Pass()),
+        returned_time(returned_time) {}
+
+  size_t bytes() const { return gfx::BufferSizeForBufferFormat(size, format); }
+
+  gfx::GpuMemoryBufferId id;
+  gfx::Size size;
+  gfx::BufferFormat format;
+  gfx::BufferUsage usage;
+  scoped_ptr<base::SharedMemory> shared_memory;
+  base::TimeTicks returned_time;
+};
+
+// Enough for a few frames of 1080p video.
+const size_t SharedMemoryGpuMemoryBufferPool::kMaxFreeBytes = 32 * 1024 * 1024;
+
+const int SharedMemoryGpuMemoryBufferPool::kMaxIdleTimeMs = 2000;
+
+SharedMemoryGpuMemoryBufferPool::SharedMemoryGpuMemoryBufferPool(
+    const DeleteCallback& delete_callback,
+    const scoped_refptr<base::SingleThreadTaskRunner>& task_runner)
+    : delete_callback_(delete_callback),
+      task_runner_(task_runner),
+      free_bytes_(0),
+      release_idle_buffers_pending_(false) {}
+
+SharedMemoryGpuMemoryBufferPool::~SharedMemoryGpuMemoryBufferPool() {
+  DeleteBuffers(free_buffers_);
+}
+
+scoped_ptr<gfx::GpuMemoryBuffer> SharedMemoryGpuMemoryBufferPool::Allocate(
+    const gfx::Size& size,
+    gfx::BufferFormat format,
+    gfx::BufferUsage usage) {
+  scoped_ptr<FreeBuffer> buffer;
+  {
+    base::AutoLock lock(lock_);
+    // The most recently returned buffers are the most likely to be resident.
+    for (size_t i = free_buffers_.size(); i > 0; --i) {
+      FreeBuffer* free_buffer = free_buffers_[i - 1];
+      if (free_buffer->size == size && free_buffer->format == format &&
+          free_buffer->usage == usage) {
+        buffer.reset(free_buffer);
+        free_buffers_.weak_erase(free_buffers_.begin() + i - 1);
+        free_bytes_ -= buffer->bytes();
+        break;
+      }
+    }
+  }
+  if (!buffer)
+    return nullptr;
+
+  TRACE_EVENT2("gpu", "SharedMemoryGpuMemoryBufferPool::Allocate", "width",
+               size.width(), "height", size.height());
+  return CreateRecyclable(buffer->id, size, format, usage,
+                          buffer->shared_memory.Pass());
+}
+
+scoped_ptr<gfx::GpuMemoryBuffer> SharedMemoryGpuMemoryBufferPool::Create(
+    gfx::GpuMemoryBufferId id,
+    const gfx::Size& size,
+    gfx::BufferFormat format,
+    gfx::BufferUsage usage) {
+  size_t buffer_size = 0u;
+  if (!gfx::BufferSizeForBufferFormatChecked(size, format, &buffer_size))
+    return nullptr;
+
+  scoped_ptr<base::SharedMemory> shared_memory(new base::SharedMemory());
+  if (!shared_memory->CreateAndMapAnonymous(buffer_size))
+    return nullptr;
+
+  return CreateRecyclable(id, size, format, usage, shared_memory.Pass());
+}
+
+scoped_ptr<gfx::GpuMemoryBuffer>
+SharedMemoryGpuMemoryBufferPool::CreateFromHandle(
+    const gfx::GpuMemoryBufferHandle& handle,
+    const gfx::Size& size,
+    gfx::BufferFormat format,
+    gfx::BufferUsage usage) {
+  // Only buffers laid out the way Create() lays them out can be handed out
+  // again by Allocate().
+  if (handle.type != gfx::SHARED_MEMORY_BUFFER || handle.offset != 0 ||
+      static_cast<size_t>(handle.stride) !=
+          gfx::RowSizeForBufferFormat(size.width(), format, 0)) {
+    return GpuMemoryBufferImpl::CreateFromHandle(
+        handle, size, format, usage, base::Bind(delete_callback_, handle.id));
+  }
+
+  DCHECK(base::SharedMemory::IsHandleValid(handle.handle));
+  return CreateRecyclable(
+      handle.id, size, format, usage,
+      make_scoped_ptr(new base::SharedMemory(handle.handle, false)));
+}
+
+void SharedMemoryGpuMemoryBufferPool::ReleaseBuffersIdleSince(
+    base::TimeTicks time) {
+  ScopedVector<FreeBuffer> idle_buffers;
+  {
+    base::AutoLock lock(lock_);
+    while (!free_buffers_.empty() &&
+           free_buffers_.front()->returned_time < time) {
+      free_bytes_ -= free_buffers_.front()->bytes();
+      idle_buffers.push_back(free_buffers_.front());
+      free_buffers_.weak_erase(free_buffers_.begin());
+    }
+  }
+  DeleteBuffers(idle_buffers);
+}
+
+void SharedMemoryGpuMemoryBufferPool::ReleaseFreeMemory() {
+  ScopedVector<FreeBuffer> free_buffers;
+  {
+    base::AutoLock lock(lock_);
+    free_buffers.swap(free_buffers_);
+    free_bytes_ = 0;
+  }
+  DeleteBuffers(free_buffers);
+}
+
+size_t SharedMemoryGpuMemoryBufferPool::GetFreeBytesForTesting() const {
+  base::AutoLock lock(lock_);
+  return free_bytes_;
+}
+
+scoped_ptr<gfx::GpuMemoryBuffer>
+SharedMemoryGpuMemoryBufferPool::CreateRecyclable(
+    gfx::GpuMemoryBufferId id,
+    const gfx::Size& size,
+    gfx::BufferFormat format,
+    gfx::BufferUsage usage,
+    scoped_ptr<base::SharedMemory> shared_memory) {
+  // Note: The buffer keeps the pool alive until it is returned.
+  return GpuMemoryBufferImplSharedMemory::CreateRecyclable(
+      id, size, format, shared_memory.Pass(),
+      base::Bind(&SharedMemoryGpuMemoryBufferPool::ReturnBuffer, this, id,
+                 size, format, usage));
+}
+
+void SharedMemoryGpuMemoryBufferPool::ReturnBuffer(
+    gfx::GpuMemoryBufferId id,
+    const gfx::Size& size,
+    gfx::BufferFormat format,
+    gfx::BufferUsage usage,
+    scoped_ptr<base::SharedMemory> shared_memory,
+    const gpu::SyncToken& sync_token) {
+  scoped_ptr<FreeBuffer> buffer(new FreeBuffer(
+      id, size, format, usage, shared_memory.Pass(), base::TimeTicks::Now()));
+  size_t bytes = buffer->bytes();
+  if (sync_token.HasData() || bytes > kMaxFreeBytes) {
+    delete_callback_.Run(id, sync_token);
+    return;
+  }
+
+  // Make room by deleting the buffers which have been idle the longest.
+  ScopedVector<FreeBuffer> evicted_buffers;
+  {
+    base::AutoLock lock(lock_);
+    while (free_bytes_ + bytes > kMaxFreeBytes) {
+      free_bytes_ -= free_buffers_.front()->bytes();
+      evicted_buffers.push_back(free_buffers_.front());
+      free_buffers_.weak_erase(free_buffers_.begin());
+    }
+    free_buffers_.push_back(buffer.release());
+    free_bytes_ += bytes;
+
+    if (task_runner_ && !release_idle_buffers_pending_) {
+      release_idle_buffers_pending_ = true;
+      task_runner_->PostDelayedTask(
+          FROM_HERE,
+          base::Bind(&SharedMemoryGpuMemoryBufferPool::ReleaseIdleBuffers,
+                     this),
+          base::TimeDelta::FromMilliseconds(kMaxIdleTimeMs));
+    }
+  }
+  DeleteBuffers(evicted_buffers);
+}
+
+void SharedMemoryGpuMemoryBufferPool::ReleaseIdleBuffers() {
+  base::TimeDelta max_idle_time =
+      base::TimeDelta::FromMilliseconds(kMaxIdleTimeMs);
+  base::TimeTicks now = base::TimeTicks::Now();
+  ReleaseBuffersIdleSince(now - max_idle_time);
+
+  base::AutoLock lock(lock_);
+  release_idle_buffers_pending_ = false;
+  if (free_buffers_.empty())
+    return;
+
+  // Come back when the buffer which has been idle the longest expires.
+  release_idle_buffers_pending_ = true;
+  task_runner_->PostDelayedTask(
+      FROM_HERE,
+      base::Bind(&SharedMemoryGpuMemoryBufferPool::ReleaseIdleBuffers, this),
+      free_buffers_.front()->returned_time + max_idle_time - now);
+}
+
+void SharedMemoryGpuMemoryBufferPool::DeleteBuffers(
+    const ScopedVector<FreeBuffer>& buffers) {
+  for (const FreeBuffer* buffer : buffers)
+    delete_callback_.Run(buffer->id, gpu::SyncToken());
+}
+
+}  // namespace content
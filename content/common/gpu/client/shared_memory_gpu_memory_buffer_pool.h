@@ -0,0 +1,125 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CONTENT_COMMON_GPU_CLIENT_SHARED_MEMORY_GPU_MEMORY_BUFFER_POOL_H_
+#define CONTENT_COMMON_GPU_CLIENT_SHARED_MEMORY_GPU_MEMORY_BUFFER_POOL_H_
+
+#include "base/callback.h"
+#include "base/memory/ref_counted.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/memory/scoped_vector.h"
+#include "base/synchronization/lock.h"
+#include "base/time/time.h"
+#include "content/common/content_export.h"
+#include "gpu/command_buffer/common/sync_token.h"
+#include "ui/gfx/geometry/size.h"
+#include "ui/gfx/gpu_memory_buffer.h"
+
+namespace base {
+class SharedMemory;
+class SingleThreadTaskRunner;
+}
+
+namespace content {
+
+// Keeps the shared memory of GPU memory buffers which are deleted, so that
+// later allocations of the same size, format and usage can be handed a buffer
+// right away instead of waiting for new memory. A buffer which isn't reused
+// for a while, or which doesn't fit in the pool, is deleted for good with the
+// DeleteCallback. Buffers may be allocated and deleted on any thread.
+//
+// A buffer which is deleted with a destruction sync token may still be read
+// by the GPU process until the token has passed. The pool has no way to wait
+// for that, so such a buffer is never handed out again. It is deleted for good
+// right away, and the token is passed on with it.
+class CONTENT_EXPORT SharedMemoryGpuMemoryBufferPool
+    : public base::RefCountedThreadSafe<SharedMemoryGpuMemoryBufferPool> {
+ public:
+  typedef base::Callback<void(gfx::GpuMemoryBufferId id,
+                              const gpu::SyncToken& sync_token)>
+      DeleteCallback;
+
+  // The most memory kept in buffers which are not in use.
+  static const size_t kMaxFreeBytes;
+
+  // How long a buffer which is not in use is kept.
+  static const int kMaxIdleTimeMs;
+
+  // Buffers which are not reused are deleted by tasks on |task_runner|. If
+  // |task_runner| is null, they are only deleted to make room for others or
+  // by ReleaseFreeMemory().
+  SharedMemoryGpuMemoryBufferPool(
+      const DeleteCallback& delete_callback,
+      const scoped_refptr<base::SingleThreadTaskRunner>& task_runner);
+
+  // Returns a buffer which was deleted by its last user, or null if there is
+  // none of |size|, |format| and |usage|.
+  scoped_ptr<gfx::GpuMemoryBuffer> Allocate(const gfx::Size& size,
+                                            gfx::BufferFormat format,
+                                            gfx::BufferUsage usage);
+
+  // Creates a buffer with new shared memory, which returns to the pool when it
+  // is deleted. Returns null on failure.
+  scoped_ptr<gfx::GpuMemoryBuffer> Create(gfx::GpuMemoryBufferId id,
+                                          const gfx::Size& size,
+                                          gfx::BufferFormat format,
+                                          gfx::BufferUsage usage);
+
+  // Creates a buffer from |handle|, which was just allocated. Shared memory
+  // buffers return to the pool when they are deleted, other buffers are
+  // deleted for good. Returns null on failure.
+  scoped_ptr<gfx::GpuMemoryBuffer> CreateFromHandle(
+      const gfx::GpuMemoryBufferHandle& handle,
+      const gfx::Size& size,
+      gfx::BufferFormat format,
+      gfx::BufferUsage usage);
+
+  // Deletes the buffers which were returned to the pool before |time|.
+  void ReleaseBuffersIdleSince(base::TimeTicks time);
+
+  // Deletes all the buffers which are not in use.
+  void ReleaseFreeMemory();
+
+  size_t GetFreeBytesForTesting() const;
+
+ private:
+  friend class base::RefCountedThreadSafe<SharedMemoryGpuMemoryBufferPool>;
+
+  struct FreeBuffer;
+
+  ~SharedMemoryGpuMemoryBufferPool();
+
+  scoped_ptr<gfx::GpuMemoryBuffer> CreateRecyclable(
+      gfx::GpuMemoryBufferId id,
+      const gfx::Size& size,
+      gfx::BufferFormat format,
+      gfx::BufferUsage usage,
+      scoped_ptr<base::SharedMemory> shared_memory);
+  void ReturnBuffer(gfx::GpuMemoryBufferId id,
+                    const gfx::Size& size,
+                    gfx::BufferFormat format,
+                    gfx::BufferUsage usage,
+                    scoped_ptr<base::SharedMemory> shared_memory,
+                    const gpu::SyncToken& sync_token);
+  void ReleaseIdleBuffers();
+  void DeleteBuffers(const ScopedVector<FreeBuffer>& buffers);
+
+  const DeleteCallback delete_callback_;
+  const scoped_refptr<base::SingleThreadTaskRunner> task_runner_;
+
+  // Protects the members below.
+  mutable base::Lock lock_;
+
+  // Buffers which are not in use, least recently returned first. There are
+  // few of them, so they are looked up linearly.
+  ScopedVector<FreeBuffer> free_buffers_;
+  size_t free_bytes_;
+  bool release_idle_buffers_pending_;
+
+  DISALLOW_COPY_AND_ASSIGN(SharedMemoryGpuMemoryBufferPool);
+};
+
+}  // namespace content
+
+#endif  // CONTENT_COMMON_GPU_CLIENT_SHARED_MEMORY_GPU_MEMORY_BUFFER_POOL_H_
@@ -0,0 +1,118 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "content/common/gpu/client/shared_memory_gpu_memory_buffer_pool.h"
+
+#include <string.h>
+
+#include <deque>
+
+#include "base/bind.h"
+#include "base/time/time.h"
+#include "content/common/gpu/client/gpu_memory_buffer_impl_shared_memory.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_test.h"
+
+namespace content {
+namespace {
+
+const int kTimeLimitMs = 2000;
+const int kTimeCheckInterval = 10;
+
+// Buffers a producer keeps in flight, like a compositor or a video decoder
+// with a few frames queued up.
+const size_t kBuffersInFlight = 3;
+
+const gfx::BufferFormat kFormat = gfx::BufferFormat::RGBA_8888;
+const gfx::BufferUsage kUsage = gfx::BufferUsage::GPU_READ_CPU_READ_WRITE;
+
+void Noop(const gpu::SyncToken& sync_token) {}
+
+void NoopDelete(gfx::GpuMemoryBufferId id, const gpu::SyncToken& sync_token) {}
+
+// Replaces the oldest of a few buffers in flight with a new one every frame,
+// and reports the time it takes until the new buffer is mapped. Without the
+// pool each buffer gets new shared memory, which is what the process which
+// allocates it does; a child process waits on the browser for it on top of
+// that.
+class SharedMemoryGpuMemoryBufferPoolPerfTest : public testing::Test {
+ protected:
+  SharedMemoryGpuMemoryBufferPoolPerfTest()
+      : pool_(new SharedMemoryGpuMemoryBufferPool(base::Bind(&NoopDelete),
+                                                  nullptr)),
+        next_id_(1) {}
+
+  scoped_ptr<gfx::GpuMemoryBuffer> Allocate(const gfx::Size& size,
+                                            bool pooled) {
+    gfx::GpuMemoryBufferId id(next_id_++);
+    if (!pooled) {
+      return GpuMemoryBufferImplSharedMemory::Create(id, size, kFormat,
+                                                     base::Bind(&Noop));
+    }
+    scoped_ptr<gfx::GpuMemoryBuffer> buffer =
+        pool_->Allocate(size, kFormat, kUsage);
+    if (!buffer)
+      buffer = pool_->Create(id, size, kFormat, kUsage);
+    return buffer;
+  }
+
+  void RunTest(const std::string& test_name,
+               const gfx::Size& size,
+               bool pooled) {
+    std::deque<gfx::GpuMemoryBuffer*> in_flight;
+    base::TimeDelta elapsed;
+    int frames = 0;
+    base::TimeTicks end = base::TimeTicks::Now() +
+                          base::TimeDelta::FromMilliseconds(kTimeLimitMs);
+    do {
+      for (int i = 0; i < kTimeCheckInterval; ++i) {
+        if (in_flight.size() == kBuffersInFlight) {
+          delete in_flight.front();
+          in_flight.pop_front();
+        }
+
+        base::TimeTicks start = base::TimeTicks::Now();
+        scoped_ptr<gfx::GpuMemoryBuffer> buffer = Allocate(size, pooled);
+        ASSERT_TRUE(buffer);
+        ASSERT_TRUE(buffer->Map());
+        elapsed += base::TimeTicks::Now() - start;
+
+        // Start filling the buffer, the way the producer would.
+        memset(buffer->memory(0), frames, buffer->stride(0));
+        buffer->Unmap();
+        in_flight.push_back(buffer.release());
+        ++frames;
+      }
+    } while (base::TimeTicks::Now() < end);
+
+    for (gfx::GpuMemoryBuffer* buffer : in_flight)
+      delete buffer;
+
+    perf_test::PrintResult("gpu_memory_buffer_allocate",
+                           pooled ? "_pooled" : "", test_name,
+                           elapsed.InMicrosecondsF() / frames, "us", true);
+  }
+
+  scoped_refptr<SharedMemoryGpuMemoryBufferPool> pool_;
+  int next_id_;
+};
+
+TEST_F(SharedMemoryGpuMemoryBufferPoolPerfTest, Allocate720p) {
+  RunTest("720p", gfx::Size(1280, 720), false);
+}
+
+TEST_F(SharedMemoryGpuMemoryBufferPoolPerfTest, AllocatePooled720p) {
+  RunTest("720p", gfx::Size(1280, 720), true);
+}
+
+TEST_F(SharedMemoryGpuMemoryBufferPoolPerfTest, Allocate1080p) {
+  RunTest("1080p", gfx::Size(1920, 1080), false);
+}
+
+TEST_F(SharedMemoryGpuMemoryBufferPoolPerfTest, AllocatePooled1080p) {
+  RunTest("1080p", gfx::Size(1920, 1080), true);
+}
+
+}  // namespace
+}  // namespace content
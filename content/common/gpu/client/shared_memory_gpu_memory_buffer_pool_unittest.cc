@@ -0,0 +1,213 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "content/common/gpu/client/shared_memory_gpu_memory_buffer_pool.h"
+
+#include <string.h>
+
+#include <vector>
+
+#include "base/bind.h"
+#include "base/test/test_simple_task_runner.h"
+#include "content/common/gpu/client/gpu_memory_buffer_impl_shared_memory.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "ui/gfx/buffer_format_util.h"
+
+namespace content {
+namespace {
+
+const gfx::BufferFormat kFormat = gfx::BufferFormat::RGBA_8888;
+const gfx::BufferUsage kUsage = gfx::BufferUsage::GPU_READ_CPU_READ_WRITE;
+
+class SharedMemoryGpuMemoryBufferPoolTest : public testing::Test {
+ protected:
+  SharedMemoryGpuMemoryBufferPoolTest()
+      : next_id_(1),
+        task_runner_(new base::TestSimpleTaskRunner),
+        pool_(new SharedMemoryGpuMemoryBufferPool(
+            base::Bind(&SharedMemoryGpuMemoryBufferPoolTest::OnDeleted,
+                       base::Unretained(this)),
+            task_runner_)) {}
+
+  ~SharedMemoryGpuMemoryBufferPoolTest() override {
+    // Pending tasks hold on to the pool, which holds on to the task runner.
+    task_runner_->ClearPendingTasks();
+  }
+
+  scoped_ptr<gfx::GpuMemoryBuffer> Create(const gfx::Size& size) {
+    return pool_->Create(gfx::GpuMemoryBufferId(next_id_++), size, kFormat,
+                         kUsage);
+  }
+
+  void OnDeleted(gfx::GpuMemoryBufferId id, const gpu::SyncToken& sync_token) {
+    deleted_ids_.push_back(id.id);
+    deleted_sync_tokens_.push_back(sync_token);
+  }
+
+  std::vector<int> deleted_ids_;
+  std::vector<gpu::SyncToken> deleted_sync_tokens_;
+  int next_id_;
+  // The pool reports to the members above when it goes away.
+  scoped_refptr<base::TestSimpleTaskRunner> task_runner_;
+  scoped_refptr<SharedMemoryGpuMemoryBufferPool> pool_;
+};
+
+TEST_F(SharedMemoryGpuMemoryBufferPoolTest, ReusesDeletedBuffers) {
+  const gfx::Size size(64, 64);
+  scoped_ptr<gfx::GpuMemoryBuffer> buffer = Create(size);
+  ASSERT_TRUE(buffer);
+  gfx::GpuMemoryBufferId id = buffer->GetId();
+  EXPECT_FALSE(pool_->Allocate(size, kFormat, kUsage));
+
+  // The contents written by the last user are still there, so the memory is
+  // the same.
+  ASSERT_TRUE(buffer->Map());
+  memset(buffer->memory(0), 0x5a, 16);
+  buffer->Unmap();
+  buffer.reset();
+  EXPECT_TRUE(deleted_ids_.empty());
+  EXPECT_EQ(gfx::BufferSizeForBufferFormat(size, kFormat),
+            pool_->GetFreeBytesForTesting());
+
+  // Only the same size, format and usage are served from the pool.
+  EXPECT_FALSE(pool_->Allocate(gfx::Size(64, 32), kFormat, kUsage));
+  EXPECT_FALSE(pool_->Allocate(size, gfx::BufferFormat::BGRA_8888, kUsage));
+  EXPECT_FALSE(pool_->Allocate(size, kFormat, gfx::BufferUsage::GPU_READ));
+
+  buffer = pool_->Allocate(size, kFormat, kUsage);
+  ASSERT_TRUE(buffer);
+  EXPECT_EQ(id, buffer->GetId());
+  EXPECT_EQ(0u, pool_->GetFreeBytesForTesting());
+  ASSERT_TRUE(buffer->Map());
+  EXPECT_EQ(0x5a, static_cast<uint8_t*>(buffer->memory(0))[15]);
+  buffer->Unmap();
+  EXPECT_TRUE(deleted_ids_.empty());
+}
+
+TEST_F(SharedMemoryGpuMemoryBufferPoolTest, OldestBuffersMakeRoom) {
+  // Four MB each, so one more than fits.
+  const gfx::Size size(1024, 1024);
+  size_t buffer_size = gfx::BufferSizeForBufferFormat(size, kFormat);
+  size_t count = SharedMemoryGpuMemoryBufferPool::kMaxFreeBytes / buffer_size;
+  std::vector<gfx::GpuMemoryBuffer*> buffers;
+  for (size_t i = 0; i <= count; ++i)
+    buffers.push_back(Create(size).release());
+
+  for (gfx::GpuMemoryBuffer* buffer : buffers)
+    delete buffer;
+  ASSERT_EQ(1u, deleted_ids_.size());
+  EXPECT_EQ(1, deleted_ids_[0]);
+  EXPECT_EQ(count * buffer_size, pool_->GetFreeBytesForTesting());
+
+  // The most recently deleted buffer is handed out first.
+  scoped_ptr<gfx::GpuMemoryBuffer> buffer =
+      pool_->Allocate(size, kFormat, kUsage);
+  ASSERT_TRUE(buffer);
+  EXPECT_EQ(static_cast<int>(count + 1), buffer->GetId().id);
+}
+
+TEST_F(SharedMemoryGpuMemoryBufferPoolTest, LargeBuffersAreNotKept) {
+  scoped_ptr<gfx::GpuMemoryBuffer> buffer = Create(gfx::Size(4096, 4096));
+  ASSERT_TRUE(buffer);
+  buffer.reset();
+  EXPECT_EQ(1u, deleted_ids_.size());
+  EXPECT_EQ(0u, pool_->GetFreeBytesForTesting());
+}
+
+TEST_F(SharedMemoryGpuMemoryBufferPoolTest, BuffersInUseByTheGpuAreNotKept) {
+  const gpu::SyncToken sync_token(gpu::CommandBufferNamespace::GPU_IO, 0, 1,
+                                  42);
+  const gfx::Size size(64, 64);
+  scoped_ptr<gfx::GpuMemoryBuffer> buffer = Create(size);
+  static_cast<GpuMemoryBufferImpl*>(buffer.get())
+      ->set_destruction_sync_token(sync_token);
+  buffer.reset();
+
+  // The GPU process may read the buffer until the token has passed, so the
+  // buffer is deleted for good, with the token.
+  ASSERT_EQ(1u, deleted_ids_.size());
+  EXPECT_EQ(sync_token, deleted_sync_tokens_[0]);
+  EXPECT_EQ(0u, pool_->GetFreeBytesForTesting());
+  EXPECT_FALSE(pool_->Allocate(size, kFormat, kUsage));
+}
+
+TEST_F(SharedMemoryGpuMemoryBufferPoolTest, IdleBuffersAreDeleted) {
+  scoped_ptr<gfx::GpuMemoryBuffer> buffer = Create(gfx::Size(64, 64));
+  buffer.reset();
+  ASSERT_TRUE(task_runner_->HasPendingTask());
+  EXPECT_EQ(base::TimeDelta::FromMilliseconds(
+                SharedMemoryGpuMemoryBufferPool::kMaxIdleTimeMs),
+            task_runner_->GetPendingTasks()[0].delay);
+
+  // The task runs early here, and comes back for the buffer later.
+  task_runner_->RunPendingTasks();
+  EXPECT_TRUE(deleted_ids_.empty());
+  EXPECT_TRUE(task_runner_->HasPendingTask());
+
+  pool_->ReleaseBuffersIdleSince(base::TimeTicks::Now() +
+                                 base::TimeDelta::FromSeconds(1));
+  ASSERT_EQ(1u, deleted_ids_.size());
+  EXPECT_FALSE(deleted_sync_tokens_[0].HasData());
+  EXPECT_EQ(0u, pool_->GetFreeBytesForTesting());
+
+  // Nothing is left to come back for.
+  task_runner_->RunPendingTasks();
+  EXPECT_FALSE(task_runner_->HasPendingTask());
+}
+
+TEST_F(SharedMemoryGpuMemoryBufferPoolTest, ReleaseFreeMemory) {
+  scoped_ptr<gfx::GpuMemoryBuffer> in_use = Create(gfx::Size(64, 64));
+  Create(gfx::Size(64, 64));
+  Create(gfx::Size(128, 128));
+  EXPECT_TRUE(deleted_ids_.empty());
+
+  pool_->ReleaseFreeMemory();
+  EXPECT_EQ(2u, deleted_ids_.size());
+  EXPECT_EQ(0u, pool_->GetFreeBytesForTesting());
+  EXPECT_FALSE(pool_->Allocate(gfx::Size(64, 64), kFormat, kUsage));
+}
+
+TEST_F(SharedMemoryGpuMemoryBufferPoolTest, BuffersOutliveTheirOwner) {
+  // Without a task runner, so that no task holds on to the pool either.
+  pool_ = new SharedMemoryGpuMemoryBufferPool(
+      base::Bind(&SharedMemoryGpuMemoryBufferPoolTest::OnDeleted,
+                 base::Unretained(this)),
+      nullptr);
+  scoped_ptr<gfx::GpuMemoryBuffer> buffer = Create(gfx::Size(64, 64));
+  pool_ = nullptr;
+
+  // The buffer returns to a pool which nobody else holds on to anymore, and
+  // is deleted with it.
+  buffer.reset();
+  EXPECT_EQ(1u, deleted_ids_.size());
+}
+
+TEST_F(SharedMemoryGpuMemoryBufferPoolTest, CreateFromHandle) {
+  const gfx::Size size(64, 64);
+  gfx::GpuMemoryBufferHandle handle;
+  GpuMemoryBufferImplSharedMemory::AllocateForTesting(size, kFormat, kUsage,
+                                                      &handle);
+  handle.id = gfx::GpuMemoryBufferId(7);
+  scoped_ptr<gfx::GpuMemoryBuffer> buffer =
+      pool_->CreateFromHandle(handle, size, kFormat, kUsage);
+  ASSERT_TRUE(buffer);
+  buffer.reset();
+  buffer = pool_->Allocate(size, kFormat, kUsage);
+  ASSERT_TRUE(buffer);
+  EXPECT_EQ(7, buffer->GetId().id);
+
+  // Buffers which don't start at the beginning of the memory are not kept.
+  GpuMemoryBufferImplSharedMemory::AllocateForTesting(
+      gfx::Size(64, 128), kFormat, kUsage, &handle);
+  handle.id = gfx::GpuMemoryBufferId(8);
+  handle.offset = gfx::BufferSizeForBufferFormat(size, kFormat);
+  buffer = pool_->CreateFromHandle(handle, size, kFormat, kUsage);
+  ASSERT_TRUE(buffer);
+  buffer.reset();
+  ASSERT_EQ(1u, deleted_ids_.size());
+  EXPECT_EQ(8, deleted_ids_[0]);
+}
+
+}  // namespace
+}  // namespace content
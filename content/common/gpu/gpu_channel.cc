@@ -69,6 +69,14 @@ const int64 kMaxPreemptTimeMs = kVsyncIntervalMs;
 // below this threshold.
 const int64 kStopPreemptThresholdMs = kVsyncIntervalMs;
 
+// The longest the scheduler handles messages before it lets other tasks on
+// the main thread run.
+const int64 kMaxBatchTimeMs = 2;
+
+// Channels which have had messages waiting for longer than this are served
+// ahead of higher priority ones.
+const int64 kMaxSchedulingDelayMs = 2 * kVsyncIntervalMs;
+
 }  // anonymous namespace
 
 scoped_refptr<GpuChannelMessageQueue> GpuChannelMessageQueue::Create(
@@ -199,8 +207,8 @@ void GpuChannelMessageQueue::DeleteAndDisableMessages() {
 }
 
 void GpuChannelMessageQueue::ScheduleHandleMessage() {
-  task_runner_->PostTask(FROM_HERE,
-                         base::Bind(&GpuChannel::HandleMessage, gpu_channel_));
+  task_runner_->PostTask(
+      FROM_HERE, base::Bind(&GpuChannel::ScheduleHandleMessage, gpu_channel_));
 }
 
 void GpuChannelMessageQueue::PushMessageHelper(
@@ -525,6 +533,109 @@ void GpuChannelMessageFilter::TransitionToWouldPreemptDescheduled() {
   UpdatePreemptionState();
 }
 
+GpuChannelScheduler::GpuChannelScheduler(
+    base::SingleThreadTaskRunner* task_runner)
+    : task_runner_(task_runner),
+      current_channel_(nullptr),
+      batch_scheduled_(false),
+      weak_factory_(this) {}
+
+GpuChannelScheduler::~GpuChannelScheduler() {
+  DCHECK(ready_channels_.empty());
+}
+
+void GpuChannelScheduler::ScheduleChannel(GpuChannel* channel) {
+  if (IsReady(channel))
+    return;
+  ReadyChannel ready = {channel, base::TimeTicks::Now()};
+  ready_channels_.push_back(ready);
+  ScheduleBatch();
+}
+
+void GpuChannelScheduler::RemoveChannel(GpuChannel* channel) {
+  if (current_channel_ == channel)
+    current_channel_ = nullptr;
+  for (auto it = ready_channels_.begin(); it != ready_channels_.end(); ++it) {
+    if (it->channel == channel) {
+      ready_channels_.erase(it);
+      return;
+    }
+  }
+}
+
+std::deque<GpuChannelScheduler::ReadyChannel>::iterator
+GpuChannelScheduler::PickNextChannel(base::TimeTicks now) {
+  auto next = ready_channels_.end();
+  GpuStreamPriority next_priority = GpuStreamPriority::LAST;
+  for (auto it = ready_channels_.begin(); it != ready_channels_.end(); ++it) {
+    if (it->channel->IsPreempted())
+      continue;
+    GpuStreamPriority priority = it->channel->scheduling_priority();
+    if ((now - it->ready_time).InMilliseconds() >= kMaxSchedulingDelayMs)
+      priority = GpuStreamPriority::REAL_TIME;
+    // The first of the channels with the highest priority goes next.
+    if (next == ready_channels_.end() || priority < next_priority) {
+      next = it;
+      next_priority = priority;
+    }
+  }
+  return next;
+}
+
+bool GpuChannelScheduler::IsReady(GpuChannel* channel) const {
+  for (const ReadyChannel& ready : ready_channels_) {
+    if (ready.channel == channel)
+      return true;
+  }
+  return false;
+}
+
+void GpuChannelScheduler::ScheduleBatch() {
+  if (batch_scheduled_)
+    return;
+  batch_scheduled_ = true;
+  task_runner_->PostTask(FROM_HERE, base::Bind(&GpuChannelScheduler::RunBatch,
+                                               weak_factory_.GetWeakPtr()));
+}
+
+void GpuChannelScheduler::RunBatch() {
+  TRACE_EVENT0("gpu", "GpuChannelScheduler::RunBatch");
+  base::TimeTicks now = base::TimeTicks::Now();
+  base::TimeTicks deadline =
+      now + base::TimeDelta::FromMilliseconds(kMaxBatchTimeMs);
+  while (now < deadline) {
+    auto next = PickNextChannel(now);
+    if (next == ready_channels_.end())
+      break;
+    current_channel_ = next->channel;
+    ready_channels_.erase(next);
+
+    // Serve the channel until it runs out of messages it can handle or the
+    // batch runs out of time. Handling a message may remove the channel.
+    bool has_more = true;
+    while (has_more && current_channel_ && now < deadline &&
+           !current_channel_->IsPreempted()) {
+      has_more = current_channel_->HandleMessage();
+      now = base::TimeTicks::Now();
+    }
+    if (!current_channel_)
+      continue;
+    current_channel_->DidHandleMessages();
+    // It takes its next turn after the other channels of the same priority.
+    if (has_more && !IsReady(current_channel_)) {
+      ReadyChannel ready = {current_channel_, now};
+      ready_channels_.push_back(ready);
+    }
+  }
+  current_channel_ = nullptr;
+
+  batch_scheduled_ = false;
+  // Preempted channels are checked again, as they used to be, in a task of
+  // their own.
+  if (!ready_channels_.empty())
+    ScheduleBatch();
+}
+
 GpuChannel::StreamState::StreamState(int32 id, GpuStreamPriority priority)
     : id_(id), priority_(priority) {}
 
@@ -571,6 +682,7 @@ GpuChannel::GpuChannel(GpuChannelManager* gpu_channel_manager,
       pending_valuebuffer_state_(new gpu::ValueStateMap),
       watchdog_(watchdog),
       num_stubs_descheduled_(0),
+      scheduling_priority_(GpuStreamPriority::NORMAL),
       allow_future_sync_points_(allow_future_sync_points),
       allow_real_time_streams_(allow_real_time_streams),
       weak_factory_(this) {
@@ -592,6 +704,7 @@ GpuChannel::~GpuChannel() {
   stubs_.clear();
 
   message_queue_->DeleteAndDisableMessages();
+  gpu_channel_manager_->scheduler()->RemoveChannel(this);
 
   subscription_ref_set_->RemoveObserver(this);
   if (preempting_flag_.get())
@@ -742,6 +855,7 @@ CreateCommandBufferResult GpuChannel::CreateViewCommandBuffer(
     StreamState stream(stream_id, stream_priority);
     stream.AddRoute(route_id);
     streams_.insert(std::make_pair(stream_id, stream));
+    UpdateSchedulingPriority();
   }
 
   stubs_.set(route_id, stub.Pass());
@@ -799,18 +913,34 @@ scoped_refptr<gpu::SyncPointOrderData> GpuChannel::GetSyncPointOrderData() {
   return message_queue_->GetSyncPointOrderData();
 }
 
-void GpuChannel::HandleMessage() {
-  // If we have been preempted by another channel, just post a task to wake up.
-  if (preempted_flag_ && preempted_flag_->IsSet()) {
-    ScheduleHandleMessage();
+void GpuChannel::UpdateSchedulingPriority() {
+  scheduling_priority_ = GpuStreamPriority::NORMAL;
+  if (streams_.empty())
     return;
+  scheduling_priority_ = GpuStreamPriority::LOW;
+  for (const auto& kv : streams_) {
+    GpuStreamPriority priority = kv.second.priority();
+    if (priority == GpuStreamPriority::INHERIT)
+      priority = GpuStreamPriority::NORMAL;
+    scheduling_priority_ = std::min(scheduling_priority_, priority);
   }
+}
+
+bool GpuChannel::IsPreempted() const {
+  return preempted_flag_ && preempted_flag_->IsSet();
+}
+
+bool GpuChannel::HandleMessage() {
+  // If we have been preempted by another channel, the scheduler tries again
+  // later.
+  if (IsPreempted())
+    return true;
 
   GpuChannelMessage* m = message_queue_->GetNextMessage();
 
   // TODO(sunnyps): This could be a DCHECK maybe?
   if (!m)
-    return;
+    return false;
 
   const IPC::Message& message = m->message;
   message_queue_->BeginMessageProcessing(m);
@@ -859,14 +989,15 @@ void GpuChannel::HandleMessage() {
     // schedule a wakeup otherwise some other event will wake us up e.g. sync
     // point completion. No DCHECK for preemption flag because that can change
     // any time.
-    if (stub->IsScheduled())
-      ScheduleHandleMessage();
-    return;
+    return stub->IsScheduled();
   }
 
-  if (message_queue_->MessageProcessed())
-    ScheduleHandleMessage();
+  return message_queue_->MessageProcessed();
+}
 
+void GpuChannel::DidHandleMessages() {
+  // Let the filter know once per run of messages rather than after each one;
+  // it looks at the queue itself to decide whether to keep preempting.
   if (preempting_flag_) {
     io_task_runner_->PostTask(
         FROM_HERE,
@@ -875,8 +1006,7 @@ void GpuChannel::HandleMessage() {
 }
 
 void GpuChannel::ScheduleHandleMessage() {
-  task_runner_->PostTask(FROM_HERE, base::Bind(&GpuChannel::HandleMessage,
-                                               weak_factory_.GetWeakPtr()));
+  gpu_channel_manager_->scheduler()->ScheduleChannel(this);
 }
 
 void GpuChannel::HandleOutOfOrderMessage(const IPC::Message& msg) {
@@ -961,6 +1091,7 @@ void GpuChannel::OnCreateOffscreenCommandBuffer(
     StreamState stream(stream_id, stream_priority);
     stream.AddRoute(route_id);
     streams_.insert(std::make_pair(stream_id, stream));
+    UpdateSchedulingPriority();
   }
 
   stubs_.set(route_id, stub.Pass());
@@ -982,8 +1113,10 @@ void GpuChannel::OnDestroyCommandBuffer(int32 route_id) {
   auto stream_it = streams_.find(stream_id);
   DCHECK(stream_it != streams_.end());
   stream_it->second.RemoveRoute(route_id);
-  if (!stream_it->second.HasRoutes())
+  if (!stream_it->second.HasRoutes()) {
     streams_.erase(stream_it);
+    UpdateSchedulingPriority();
+  }
 
   // In case the renderer is currently blocked waiting for a sync reply from the
   // stub, we need to make sure to reschedule the GpuChannel here.
@@ -5,6 +5,7 @@
 #ifndef CONTENT_COMMON_GPU_GPU_CHANNEL_H_
 #define CONTENT_COMMON_GPU_GPU_CHANNEL_H_
 
+#include <deque>
 #include <string>
 
 #include "base/containers/hash_tables.h"
@@ -53,6 +54,7 @@ namespace content {
 class GpuChannelManager;
 class GpuChannelMessageFilter;
 class GpuChannelMessageQueue;
+class GpuChannelScheduler;
 class GpuJpegDecodeAccelerator;
 class GpuWatchdog;
 
@@ -176,7 +178,25 @@ class CONTENT_EXPORT GpuChannel
   // Returns the shared sync point global order data.
   scoped_refptr<gpu::SyncPointOrderData> GetSyncPointOrderData();
 
-  void HandleMessage();
+  // Asks the GpuChannelScheduler to handle this channel's queued messages.
+  void ScheduleHandleMessage();
+
+  // Handles the next queued message. Returns true if the channel has more
+  // messages it can handle right away. Called by the GpuChannelScheduler.
+  bool HandleMessage();
+
+  // Called by the GpuChannelScheduler after it handled a run of this
+  // channel's messages.
+  void DidHandleMessages();
+
+  // True while another channel preempts this one, in which case the
+  // GpuChannelScheduler leaves its messages queued.
+  bool IsPreempted() const;
+
+  // The highest priority of the streams on this channel. Streams don't get
+  // scheduled on their own, since the channel's messages must be handled in
+  // order.
+  GpuStreamPriority scheduling_priority() const { return scheduling_priority_; }
 
   // Some messages such as WaitForGetOffsetInRange and WaitForTokenInRange are
   // processed as soon as possible because the client is blocked until they
@@ -218,7 +238,7 @@ class CONTENT_EXPORT GpuChannel
 
   bool OnControlMessageReceived(const IPC::Message& msg);
 
-  void ScheduleHandleMessage();
+  void UpdateSchedulingPriority();
 
   // Message handlers.
   void OnCreateOffscreenCommandBuffer(
@@ -286,6 +306,8 @@ class CONTENT_EXPORT GpuChannel
   // Map of stream id to stream state.
   base::hash_map<int32, StreamState> streams_;
 
+  GpuStreamPriority scheduling_priority_;
+
   bool allow_future_sync_points_;
   bool allow_real_time_streams_;
 
@@ -472,6 +494,56 @@ class GpuChannelMessageQueue
   DISALLOW_COPY_AND_ASSIGN(GpuChannelMessageQueue);
 };
 
+// Handles the queued messages of all the channels on the main thread. Rather
+// than posting a task per message, it handles them in batches of bounded
+// duration. Each batch serves the channels by the priority of their streams,
+// taking turns among channels of the same priority, and serves channels which
+// have waited too long ahead of the others so that low priority ones don't
+// starve. Preempted channels are skipped until the preemption ends.
+class CONTENT_EXPORT GpuChannelScheduler {
+ public:
+  explicit GpuChannelScheduler(base::SingleThreadTaskRunner* task_runner);
+  ~GpuChannelScheduler();
+
+  // Lets |channel| handle its queued messages in an upcoming batch.
+  void ScheduleChannel(GpuChannel* channel);
+
+  // Forgets about |channel|, which is being destroyed.
+  void RemoveChannel(GpuChannel* channel);
+
+ private:
+  struct ReadyChannel {
+    GpuChannel* channel;
+    // When the channel last became ready or was last served.
+    base::TimeTicks ready_time;
+  };
+
+  // Returns the channel to serve next, or ready_channels_.end() if none can
+  // be served right now.
+  std::deque<ReadyChannel>::iterator PickNextChannel(base::TimeTicks now);
+
+  bool IsReady(GpuChannel* channel) const;
+
+  void ScheduleBatch();
+  void RunBatch();
+
+  scoped_refptr<base::SingleThreadTaskRunner> task_runner_;
+
+  // The channels with messages to handle, in the order they are served among
+  // channels of the same priority.
+  std::deque<ReadyChannel> ready_channels_;
+
+  // The channel RunBatch() is handling messages for. Reset if the channel is
+  // removed meanwhile.
+  GpuChannel* current_channel_;
+
+  bool batch_scheduled_;
+
+  base::WeakPtrFactory<GpuChannelScheduler> weak_factory_;
+
+  DISALLOW_COPY_AND_ASSIGN(GpuChannelScheduler);
+};
+
 }  // namespace content
 
 #endif  // CONTENT_COMMON_GPU_GPU_CHANNEL_H_
@@ -60,6 +60,7 @@ GpuChannelManager::GpuChannelManager(
       sync_point_manager_(sync_point_manager),
       sync_point_client_waiter_(new gpu::SyncPointClientWaiter),
       gpu_memory_buffer_factory_(gpu_memory_buffer_factory),
+      scheduler_(new GpuChannelScheduler(task_runner)),
       weak_factory_(this) {
   DCHECK(task_runner);
   DCHECK(io_task_runner);
@@ -56,6 +56,7 @@ struct GpuMsg_EstablishChannel_Params;
 
 namespace content {
 class GpuChannel;
+class GpuChannelScheduler;
 class GpuMemoryBufferFactory;
 class GpuWatchdog;
 
@@ -103,6 +104,9 @@ class CONTENT_EXPORT GpuChannelManager : public IPC::Listener,
     return gpu_memory_buffer_factory_;
   }
 
+  // Handles the queued messages of all the channels.
+  GpuChannelScheduler* scheduler() { return scheduler_.get(); }
+
   // Returns the maximum order number for unprocessed IPC messages across all
   // channels.
   uint32_t GetUnprocessedOrderNum() const;
@@ -191,6 +195,7 @@ class CONTENT_EXPORT GpuChannelManager : public IPC::Listener,
       framebuffer_completeness_cache_;
   scoped_refptr<gfx::GLSurface> default_offscreen_surface_;
   GpuMemoryBufferFactory* const gpu_memory_buffer_factory_;
+  scoped_ptr<GpuChannelScheduler> scheduler_;
 #if defined(OS_ANDROID)
   // Last time we know the GPU was powered on. Global for tracking across all
   // transport surfaces.
@@ -2,11 +2,15 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <algorithm>
+#include <vector>
+
 #include "base/test/test_simple_task_runner.h"
 #include "content/common/gpu/gpu_channel.h"
 #include "content/common/gpu/gpu_channel_manager.h"
 #include "content/common/gpu/gpu_channel_test_common.h"
 #include "content/common/gpu/gpu_messages.h"
+#include "ipc/ipc_sync_message.h"
 #include "ipc/ipc_test_sink.h"
 
 namespace content {
@@ -30,6 +34,51 @@ class GpuChannelTest : public GpuChannelTestCommon {
         channel_manager()->OnMessageReceived(GpuMsg_EstablishChannel(params)));
     return channel_manager()->LookupChannel(client_id);
   }
+
+  void CreateCommandBuffer(int32 client_id,
+                           int32 route_id,
+                           int32 stream_id,
+                           GpuStreamPriority stream_priority) {
+    GPUCreateCommandBufferConfig init_params;
+    init_params.share_group_id = MSG_ROUTING_NONE;
+    init_params.stream_id = stream_id;
+    init_params.stream_priority = stream_priority;
+    init_params.attribs = std::vector<int>();
+    init_params.active_url = GURL();
+    init_params.gpu_preference = gfx::PreferIntegratedGpu;
+    channel_manager()->OnMessageReceived(GpuMsg_CreateViewCommandBuffer(
+        gfx::GLSurfaceHandle(), client_id, init_params, route_id));
+    sink()->ClearMessages();
+  }
+
+  // Queues a request on |channel| which fails as soon as it's handled, and
+  // returns the id of the request, which its reply carries.
+  int QueueRequest(GpuChannel* channel) {
+    const int32 kNoSuchRouteId = 1000;
+    GPUCreateCommandBufferConfig init_params;
+    init_params.share_group_id = kNoSuchRouteId;
+    init_params.stream_id = 0;
+    init_params.stream_priority = GpuStreamPriority::NORMAL;
+    init_params.attribs = std::vector<int>();
+    init_params.active_url = GURL();
+    init_params.gpu_preference = gfx::PreferIntegratedGpu;
+    bool succeeded = false;
+    GpuChannelMsg_CreateOffscreenCommandBuffer request(
+        gfx::Size(1, 1), init_params, kNoSuchRouteId + 1, &succeeded);
+    channel->filter()->OnMessageReceived(request);
+    return IPC::SyncMessage::GetMessageId(request);
+  }
+
+  // Returns the ids of the requests replied to, in order.
+  std::vector<int> GetRepliedRequests() {
+    std::vector<int> requests;
+    for (size_t i = 0; i < sink()->message_count(); ++i) {
+      const IPC::Message* reply = sink()->GetMessageAt(i);
+      EXPECT_TRUE(reply->is_reply());
+      requests.push_back(IPC::SyncMessage::GetMessageId(*reply));
+    }
+    return requests;
+  }
 };
 
 TEST_F(GpuChannelTest, CreateViewCommandBuffer) {
@@ -324,4 +373,101 @@ TEST_F(GpuChannelTest, RealTimeStreamsAllowed) {
   ASSERT_TRUE(stub);
 }
 
+TEST_F(GpuChannelTest, HandlesQueuedMessagesInBatches) {
+  GpuChannel* channel1 = CreateChannel(1, false);
+  GpuChannel* channel2 = CreateChannel(2, false);
+  ASSERT_TRUE(channel1);
+  ASSERT_TRUE(channel2);
+  task_runner()->RunUntilIdle();
+  sink()->ClearMessages();
+
+  const int kRequestsPerChannel = 5;
+  std::vector<int> requests;
+  for (int i = 0; i < kRequestsPerChannel; ++i) {
+    requests.push_back(QueueRequest(channel1));
+    requests.push_back(QueueRequest(channel2));
+  }
+
+  // Each channel asks to be scheduled once, rather than once per message.
+  EXPECT_EQ(2u, task_runner()->GetPendingTasks().size());
+  task_runner()->RunPendingTasks();
+
+  // Each batch handles as many messages as it can in its time, where there
+  // used to be a task per message.
+  size_t batches = 0;
+  while (task_runner()->HasPendingTask()) {
+    task_runner()->RunPendingTasks();
+    ++batches;
+  }
+  EXPECT_LT(batches, requests.size());
+  EXPECT_EQ(requests.size(), sink()->message_count());
+
+  // Messages of the same channel are still handled in order.
+  std::vector<int> replies = GetRepliedRequests();
+  for (int channel = 0; channel < 2; ++channel) {
+    std::vector<int> sent;
+    std::vector<int> replied;
+    for (size_t i = channel; i < requests.size(); i += 2)
+      sent.push_back(requests[i]);
+    for (int reply : replies) {
+      if (std::find(sent.begin(), sent.end(), reply) != sent.end())
+        replied.push_back(reply);
+    }
+    EXPECT_EQ(sent, replied);
+  }
+  EXPECT_EQ(channel1->GetUnprocessedOrderNum(),
+            channel1->GetProcessedOrderNum());
+  EXPECT_EQ(channel2->GetUnprocessedOrderNum(),
+            channel2->GetProcessedOrderNum());
+}
+
+TEST_F(GpuChannelTest, HigherPriorityChannelsGoFirst) {
+  int32 kLowPriorityClientId = 1;
+  int32 kRealTimeClientId = 2;
+  GpuChannel* low_priority_channel = CreateChannel(kLowPriorityClientId, false);
+  GpuChannel* real_time_channel = CreateChannel(kRealTimeClientId, true);
+  ASSERT_TRUE(low_priority_channel);
+  ASSERT_TRUE(real_time_channel);
+  CreateCommandBuffer(kLowPriorityClientId, 1, 1, GpuStreamPriority::LOW);
+  CreateCommandBuffer(kRealTimeClientId, 2, 1, GpuStreamPriority::REAL_TIME);
+  EXPECT_EQ(GpuStreamPriority::LOW,
+            low_priority_channel->scheduling_priority());
+  EXPECT_EQ(GpuStreamPriority::REAL_TIME,
+            real_time_channel->scheduling_priority());
+
+  // The low priority channel's messages arrive first, but wait for the real
+  // time channel's.
+  std::vector<int> low_priority_requests;
+  std::vector<int> real_time_requests;
+  for (int i = 0; i < 3; ++i)
+    low_priority_requests.push_back(QueueRequest(low_priority_channel));
+  for (int i = 0; i < 3; ++i)
+    real_time_requests.push_back(QueueRequest(real_time_channel));
+  task_runner()->RunUntilIdle();
+
+  std::vector<int> expected = real_time_requests;
+  expected.insert(expected.end(), low_priority_requests.begin(),
+                  low_priority_requests.end());
+  EXPECT_EQ(expected, GetRepliedRequests());
+}
+
+TEST_F(GpuChannelTest, SchedulingPriorityFollowsStreams) {
+  int32 kClientId = 1;
+  GpuChannel* channel = CreateChannel(kClientId, true);
+  ASSERT_TRUE(channel);
+  EXPECT_EQ(GpuStreamPriority::NORMAL, channel->scheduling_priority());
+
+  CreateCommandBuffer(kClientId, 1, 1, GpuStreamPriority::LOW);
+  EXPECT_EQ(GpuStreamPriority::LOW, channel->scheduling_priority());
+
+  CreateCommandBuffer(kClientId, 2, 2, GpuStreamPriority::REAL_TIME);
+  EXPECT_EQ(GpuStreamPriority::REAL_TIME, channel->scheduling_priority());
+
+  // The channel drops back once the real time stream is gone.
+  channel->filter()->OnMessageReceived(GpuChannelMsg_DestroyCommandBuffer(2));
+  task_runner()->RunUntilIdle();
+  EXPECT_FALSE(channel->LookupCommandBuffer(2));
+  EXPECT_EQ(GpuStreamPriority::LOW, channel->scheduling_priority());
+}
+
 }  // namespace content
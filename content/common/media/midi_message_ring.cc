@@ -0,0 +1,243 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "content/common/media/midi_message_ring.h"
+
+#include <cstring>
+
+#include "base/logging.h"
+
+namespace content {
+
+namespace {
+
+// Size of the data area of each ring. It must be a power of two, and large
+// enough to hold a record of kMaxMessageSize wherever the write position is.
+const uint32 kDataSize = 256 * 1024;
+
+// Records start at multiples of this, which keeps the timestamps aligned.
+const uint32 kRecordAlignment = 8;
+
+// Where the data area starts, leaving the shared indices on their own cache
+// line.
+const size_t kDataOffset = 64;
+
+// Written in place of a record's size when the record didn't fit between the
+// write position and the end of the data area, and was written at the start
+// instead.
+const uint32 kWrapMarker = 0xffffffff;
+
+}  // namespace
+
+// Bigger SysEx dumps are rare, and are fine to send in IPC messages.
+const uint32 MidiMessageRing::kMaxMessageSize = 64 * 1024;
+
+struct MidiMessageRing::Header {
+  base::subtle::Atomic32 write_index;
+  base::subtle::Atomic32 read_index;
+  base::subtle::Atomic32 consumer_waiting;
+  base::subtle::Atomic32 producer_waiting;
+};
+
+struct MidiMessageRing::RecordHeader {
+  uint32 size;
+  uint32 port;
+  double timestamp;
+};
+
+// static
+size_t MidiMessageRing::GetSharedMemorySize() {
+  COMPILE_ASSERT(sizeof(Header) <= kDataOffset, header_too_big);
+  COMPILE_ASSERT((kDataSize & (kDataSize - 1)) == 0,
+                 data_size_must_be_a_power_of_two);
+  return kDataOffset + kDataSize;
+}
+
+// static
+uint32 MidiMessageRing::GetRecordSize(uint32 size) {
+  uint32 record_size = sizeof(RecordHeader) + size;
+  return (record_size + kRecordAlignment - 1) & ~(kRecordAlignment - 1);
+}
+
+MidiMessageRing::MidiMessageRing()
+    : header_(NULL), write_index_(0), read_index_(0), corrupt_(false) {
+  DCHECK_LE(2 * GetRecordSize(kMaxMessageSize), kDataSize);
+}
+
+MidiMessageRing::~MidiMessageRing() {
+}
+
+bool MidiMessageRing::Init(scoped_ptr<base::SharedMemory> shm,
+                           bool initialize) {
+  DCHECK(shm);
+  if (!shm->memory() && !shm->Map(GetSharedMemorySize()))
+    return false;
+  if (shm->mapped_size() < GetSharedMemorySize())
+    return false;
+
+  shm_ = shm.Pass();
+  header_ = reinterpret_cast<Header*>(shm_->memory());
+  if (initialize) {
+    memset(header_, 0, sizeof(*header_));
+    // The consumer starts out idle, so the first message rings the doorbell.
+    base::subtle::Release_Store(&header_->consumer_waiting, 1);
+  }
+  write_index_ = static_cast<uint32>(
+      base::subtle::Acquire_Load(&header_->write_index));
+  read_index_ = static_cast<uint32>(
+      base::subtle::Acquire_Load(&header_->read_index));
+  corrupt_ = false;
+  return true;
+}
+
+bool MidiMessageRing::Push(uint32 port,
+                           const uint8* message,
+                           uint32 size,
+                           double timestamp,
+                           bool* wake_consumer) {
+  DCHECK(header_);
+  *wake_consumer = false;
+  if (size > kMaxMessageSize) {
+    NOTREACHED();
+    return false;
+  }
+
+  uint32 record_size = GetRecordSize(size);
+  uint32 pos = write_index_ & (kDataSize - 1);
+  uint32 tail = kDataSize - pos;
+  uint32 needed = record_size <= tail ? record_size : tail + record_size;
+
+  // A read index the consumer published more than a ring ago is bogus; treat
+  // the ring as full so a misbehaving consumer only stalls itself.
+  uint32 used = write_index_ - static_cast<uint32>(
+                                   base::subtle::Acquire_Load(
+                                       &header_->read_index));
+  if (used > kDataSize || kDataSize - used < needed) {
+    base::subtle::NoBarrier_Store(&header_->producer_waiting, 1);
+    base::subtle::MemoryBarrier();
+    // The consumer may have made room before it saw the flag.
+    used = write_index_ - static_cast<uint32>(
+                              base::subtle::Acquire_Load(&header_->read_index));
+    if (used > kDataSize || kDataSize - used < needed)
+      return false;
+  }
+
+  if (record_size > tail) {
+    memcpy(data() + pos, &kWrapMarker, sizeof(kWrapMarker));
+    write_index_ += tail;
+    pos = 0;
+  }
+
+  RecordHeader record;
+  record.size = size;
+  record.port = port;
+  record.timestamp = timestamp;
+  memcpy(data() + pos, &record, sizeof(record));
+  if (size)
+    memcpy(data() + pos + sizeof(record), message, size);
+  write_index_ += record_size;
+
+  base::subtle::Release_Store(&header_->write_index,
+                              static_cast<base::subtle::Atomic32>(write_index_));
+  base::subtle::MemoryBarrier();
+  if (base::subtle::NoBarrier_AtomicExchange(&header_->consumer_waiting, 0))
+    *wake_consumer = true;
+  return true;
+}
+
+MidiMessageRing::Status MidiMessageRing::Peek(uint32* size) {
+  RecordHeader record;
+  Status status = ReadRecordHeader(&record);
+  if (status == STATUS_OK)
+    *size = record.size;
+  return status;
+}
+
+MidiMessageRing::Status MidiMessageRing::Pop(uint8* buffer,
+                                             uint32 buffer_size,
+                                             uint32* port,
+                                             uint32* size,
+                                             double* timestamp,
+                                             bool* wake_producer) {
+  *wake_producer = false;
+  RecordHeader record;
+  Status status = ReadRecordHeader(&record);
+  if (status != STATUS_OK)
+    return status;
+  if (record.size > buffer_size)
+    return STATUS_TOO_BIG;
+
+  uint32 pos = read_index_ & (kDataSize - 1);
+  if (record.size)
+    memcpy(buffer, data() + pos + sizeof(record), record.size);
+  *port = record.port;
+  *size = record.size;
+  *timestamp = record.timestamp;
+  read_index_ += GetRecordSize(record.size);
+
+  base::subtle::Release_Store(&header_->read_index,
+                              static_cast<base::subtle::Atomic32>(read_index_));
+  base::subtle::MemoryBarrier();
+  if (base::subtle::NoBarrier_AtomicExchange(&header_->producer_waiting, 0))
+    *wake_producer = true;
+  return STATUS_OK;
+}
+
+char* MidiMessageRing::data() {
+  return static_cast<char*>(shm_->memory()) + kDataOffset;
+}
+
+MidiMessageRing::Status MidiMessageRing::ReadRecordHeader(
+    RecordHeader* record) {
+  DCHECK(header_);
+  if (corrupt_)
+    return STATUS_CORRUPT;
+
+  for (;;) {
+    uint32 used = static_cast<uint32>(base::subtle::Acquire_Load(
+                      &header_->write_index)) - read_index_;
+    if (!used) {
+      // About to go idle: ask for a doorbell, then look again in case a
+      // message was published before the producer could see the request.
+      base::subtle::NoBarrier_Store(&header_->consumer_waiting, 1);
+      base::subtle::MemoryBarrier();
+      used = static_cast<uint32>(base::subtle::Acquire_Load(
+                 &header_->write_index)) - read_index_;
+      if (!used)
+        return STATUS_EMPTY;
+    }
+
+    uint32 pos = read_index_ & (kDataSize - 1);
+    uint32 tail = kDataSize - pos;
+    if (used > kDataSize || used % kRecordAlignment)
+      break;
+
+    // The producer may change the record while we read it, so read each field
+    // once and only use the validated copy.
+    uint32 size;
+    memcpy(&size, data() + pos, sizeof(size));
+    if (size == kWrapMarker) {
+      if (tail >= used)
+        break;
+      read_index_ += tail;
+      continue;
+    }
+
+    if (size > kMaxMessageSize)
+      break;
+    uint32 record_size = GetRecordSize(size);
+    if (record_size > tail || record_size > used)
+      break;
+
+    memcpy(record, data() + pos, sizeof(*record));
+    record->size = size;
+    return STATUS_OK;
+  }
+
+  LOG(ERROR) << "Invalid record in MIDI message ring.";
+  corrupt_ = true;
+  return STATUS_CORRUPT;
+}
+
+}  // namespace content
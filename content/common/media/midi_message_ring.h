@@ -0,0 +1,121 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CONTENT_COMMON_MEDIA_MIDI_MESSAGE_RING_H_
+#define CONTENT_COMMON_MEDIA_MIDI_MESSAGE_RING_H_
+
+#include "base/atomicops.h"
+#include "base/basictypes.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/memory/shared_memory.h"
+#include "content/common/content_export.h"
+
+namespace content {
+
+// A single-producer, single-consumer queue of timestamped MIDI messages in a
+// block of shared memory. MidiMessageFilter and MidiHost use one ring per
+// direction, so that a burst of messages costs a single wakeup instead of one
+// IPC message each.
+//
+// Each side keeps its own copy of the index it advances, and only publishes it
+// to shared memory, so the other process can't make it read or write outside
+// of the ring. The consumer validates every record it reads.
+//
+// IPC messages are only needed to wake the other side up:
+//  1. The consumer finds the ring empty and marks itself as waiting.
+//  2. The producer's next Push() reports that the consumer must be woken up,
+//     and the producer sends a "doorbell" message.
+//  3. The consumer drains the ring until it is empty again.
+// The producer waits for free space in the same way: a Push() which doesn't
+// fit marks the producer as waiting, and the Pop() which makes room reports
+// that the producer must be woken up.
+//
+// Messages larger than kMaxMessageSize still travel in IPC messages. The
+// producer pushes an empty record in their place, so that the consumer can
+// deliver them in order.
+class CONTENT_EXPORT MidiMessageRing {
+ public:
+  enum Status {
+    STATUS_OK,
+    // There's no message to read.
+    STATUS_EMPTY,
+    // The oldest message doesn't fit into the given buffer. It's left in the
+    // ring.
+    STATUS_TOO_BIG,
+    // The ring holds something that isn't a valid message. The ring can't be
+    // used anymore.
+    STATUS_CORRUPT,
+  };
+
+  // The largest message a ring can carry.
+  static const uint32 kMaxMessageSize;
+
+  // Returns the number of bytes of shared memory needed for one ring.
+  static size_t GetSharedMemorySize();
+
+  MidiMessageRing();
+  ~MidiMessageRing();
+
+  // Maps |shm|, which must be at least GetSharedMemorySize() bytes. The side
+  // which created the memory passes |initialize| as true to reset the ring.
+  bool Init(scoped_ptr<base::SharedMemory> shm, bool initialize);
+
+  base::SharedMemory* shm() { return shm_.get(); }
+
+  // Producer side. Appends a message for |port|. An empty message is the
+  // placeholder for one sent in an IPC message. Returns false if the message
+  // doesn't fit; the caller should retry after the consumer has woken it up.
+  // |wake_consumer| is set to true if the consumer must be sent a doorbell
+  // message.
+  bool Push(uint32 port,
+            const uint8* message,
+            uint32 size,
+            double timestamp,
+            bool* wake_consumer);
+
+  // Consumer side. Returns the size of the oldest message through |size|,
+  // without removing it.
+  Status Peek(uint32* size);
+
+  // Consumer side. Removes the oldest message, copying it into |buffer|.
+  // |wake_producer| is set to true if the producer must be told that space is
+  // available.
+  Status Pop(uint8* buffer,
+             uint32 buffer_size,
+             uint32* port,
+             uint32* size,
+             double* timestamp,
+             bool* wake_producer);
+
+ private:
+  struct Header;
+  struct RecordHeader;
+
+  // Returns the space taken by a record carrying |size| bytes.
+  static uint32 GetRecordSize(uint32 size);
+
+  // Returns the ring's data area.
+  char* data();
+
+  // Consumer side. Skips wrap markers and validates the record at
+  // |read_index_|, returning its header through |record|.
+  Status ReadRecordHeader(RecordHeader* record);
+
+  scoped_ptr<base::SharedMemory> shm_;
+  Header* header_;
+
+  // The indices this side advances, as free-running byte counts. These are
+  // the only copies trusted by this side.
+  uint32 write_index_;
+  uint32 read_index_;
+
+  // True once a corrupt record has been found.
+  bool corrupt_;
+
+  DISALLOW_COPY_AND_ASSIGN(MidiMessageRing);
+};
+
+}  // namespace content
+
+#endif  // CONTENT_COMMON_MEDIA_MIDI_MESSAGE_RING_H_
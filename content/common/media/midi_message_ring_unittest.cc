@@ -0,0 +1,169 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "content/common/media/midi_message_ring.h"
+
+#include <cstring>
+#include <vector>
+
+#include "base/memory/scoped_ptr.h"
+#include "base/memory/shared_memory.h"
+#include "base/process/process_handle.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace content {
+
+namespace {
+
+// Sets up a producer and a consumer sharing one ring, as the renderer and the
+// browser would.
+void CreateRingPair(MidiMessageRing* producer, MidiMessageRing* consumer) {
+  scoped_ptr<base::SharedMemory> shm(new base::SharedMemory);
+  ASSERT_TRUE(
+      shm->CreateAndMapAnonymous(MidiMessageRing::GetSharedMemorySize()));
+  base::SharedMemoryHandle handle;
+  ASSERT_TRUE(shm->ShareToProcess(base::GetCurrentProcessHandle(), &handle));
+  ASSERT_TRUE(producer->Init(shm.Pass(), true));
+  ASSERT_TRUE(consumer->Init(
+      make_scoped_ptr(new base::SharedMemory(handle, false)), false));
+}
+
+const uint8 kNoteOn[] = {0x90, 0x3c, 0x7f};
+const uint8 kNoteOff[] = {0x80, 0x3c, 0x00};
+
+}  // namespace
+
+TEST(MidiMessageRingTest, PushAndPop) {
+  MidiMessageRing producer;
+  MidiMessageRing consumer;
+  CreateRingPair(&producer, &consumer);
+
+  uint32 size = 0;
+  EXPECT_EQ(MidiMessageRing::STATUS_EMPTY, consumer.Peek(&size));
+
+  // The consumer is idle, so the first message rings the doorbell and the
+  // others don't.
+  bool wake_consumer = false;
+  EXPECT_TRUE(producer.Push(1, kNoteOn, sizeof(kNoteOn), 12.5,
+                            &wake_consumer));
+  EXPECT_TRUE(wake_consumer);
+  EXPECT_TRUE(producer.Push(2, kNoteOff, sizeof(kNoteOff), 13.25,
+                            &wake_consumer));
+  EXPECT_FALSE(wake_consumer);
+  // The placeholder for a large message.
+  EXPECT_TRUE(producer.Push(3, NULL, 0, 14.0, &wake_consumer));
+  EXPECT_FALSE(wake_consumer);
+
+  uint8 buffer[16];
+  uint32 port;
+  double timestamp;
+  bool wake_producer;
+  ASSERT_EQ(MidiMessageRing::STATUS_OK, consumer.Peek(&size));
+  EXPECT_EQ(sizeof(kNoteOn), size);
+  // A buffer that's too small leaves the message in the ring.
+  EXPECT_EQ(MidiMessageRing::STATUS_TOO_BIG,
+            consumer.Pop(buffer, 2, &port, &size, &timestamp, &wake_producer));
+  ASSERT_EQ(MidiMessageRing::STATUS_OK,
+            consumer.Pop(buffer, sizeof(buffer), &port, &size, &timestamp,
+                         &wake_producer));
+  EXPECT_EQ(1u, port);
+  EXPECT_EQ(12.5, timestamp);
+  EXPECT_EQ(0, memcmp(kNoteOn, buffer, size));
+  EXPECT_FALSE(wake_producer);
+
+  ASSERT_EQ(MidiMessageRing::STATUS_OK,
+            consumer.Pop(buffer, sizeof(buffer), &port, &size, &timestamp,
+                         &wake_producer));
+  EXPECT_EQ(2u, port);
+  EXPECT_EQ(13.25, timestamp);
+  EXPECT_EQ(0, memcmp(kNoteOff, buffer, size));
+
+  ASSERT_EQ(MidiMessageRing::STATUS_OK,
+            consumer.Pop(buffer, sizeof(buffer), &port, &size, &timestamp,
+                         &wake_producer));
+  EXPECT_EQ(3u, port);
+  EXPECT_EQ(0u, size);
+
+  // Having drained the ring, the consumer asks to be woken up again.
+  EXPECT_EQ(MidiMessageRing::STATUS_EMPTY, consumer.Peek(&size));
+  EXPECT_TRUE(producer.Push(1, kNoteOn, sizeof(kNoteOn), 15.0,
+                            &wake_consumer));
+  EXPECT_TRUE(wake_consumer);
+}
+
+TEST(MidiMessageRingTest, FullRingWakesProducer) {
+  MidiMessageRing producer;
+  MidiMessageRing consumer;
+  CreateRingPair(&producer, &consumer);
+
+  std::vector<uint8> message(MidiMessageRing::kMaxMessageSize, 0x7f);
+  bool wake_consumer;
+  int pushed = 0;
+  while (producer.Push(0, &message[0], message.size(), 0.0, &wake_consumer))
+    ++pushed;
+  ASSERT_GT(pushed, 0);
+
+  std::vector<uint8> buffer(MidiMessageRing::kMaxMessageSize);
+  uint32 port;
+  uint32 size;
+  double timestamp;
+  bool wake_producer = false;
+  ASSERT_EQ(MidiMessageRing::STATUS_OK,
+            consumer.Pop(&buffer[0], buffer.size(), &port, &size, &timestamp,
+                         &wake_producer));
+  EXPECT_TRUE(wake_producer);
+  EXPECT_TRUE(producer.Push(0, &message[0], message.size(), 0.0,
+                            &wake_consumer));
+}
+
+TEST(MidiMessageRingTest, WrapsAround) {
+  MidiMessageRing producer;
+  MidiMessageRing consumer;
+  CreateRingPair(&producer, &consumer);
+
+  // Odd sizes make records straddle the end of the ring at varying offsets.
+  std::vector<uint8> buffer(MidiMessageRing::kMaxMessageSize);
+  for (uint32 i = 0; i < 200; ++i) {
+    std::vector<uint8> message(100 + i * 997 % 30000,
+                               static_cast<uint8>(i & 0x7f));
+    bool wake_consumer;
+    ASSERT_TRUE(producer.Push(i, &message[0], message.size(), i * 0.5,
+                              &wake_consumer));
+
+    uint32 port;
+    uint32 size;
+    double timestamp;
+    bool wake_producer;
+    ASSERT_EQ(MidiMessageRing::STATUS_OK,
+              consumer.Pop(&buffer[0], buffer.size(), &port, &size,
+                           &timestamp, &wake_producer));
+    EXPECT_EQ(i, port);
+    EXPECT_EQ(i * 0.5, timestamp);
+    ASSERT_EQ(message.size(), size);
+    EXPECT_EQ(0, memcmp(&message[0], &buffer[0], size));
+  }
+}
+
+TEST(MidiMessageRingTest, CorruptRecord) {
+  MidiMessageRing producer;
+  MidiMessageRing consumer;
+  CreateRingPair(&producer, &consumer);
+
+  bool wake_consumer;
+  ASSERT_TRUE(producer.Push(0, kNoteOn, sizeof(kNoteOn), 0.0,
+                            &wake_consumer));
+
+  // Scribble over the size of the first record, at the start of the data
+  // area, as a compromised producer could.
+  uint32 bogus_size = MidiMessageRing::kMaxMessageSize + 1;
+  memcpy(static_cast<char*>(producer.shm()->memory()) + 64, &bogus_size,
+         sizeof(bogus_size));
+
+  uint32 size;
+  EXPECT_EQ(MidiMessageRing::STATUS_CORRUPT, consumer.Peek(&size));
+  // Once corrupt, the ring stays unusable.
+  EXPECT_EQ(MidiMessageRing::STATUS_CORRUPT, consumer.Peek(&size));
+}
+
+}  // namespace content
@@ -6,6 +6,7 @@
 // Multiply-included message file, hence no include guard.
 
 #include "base/basictypes.h"
+#include "base/memory/shared_memory.h"
 #include "content/common/content_export.h"
 #include "ipc/ipc_message_macros.h"
 #include "ipc/param_traits_macros.h"
@@ -42,6 +43,25 @@ IPC_MESSAGE_CONTROL3(MidiHostMsg_SendData,
 
 IPC_MESSAGE_CONTROL0(MidiHostMsg_EndSession)
 
+// Once the browser has sent MidiMsg_SessionRings, data to be sent goes through
+// the renderer's send ring instead of MidiHostMsg_SendData; see
+// MidiMessageRing.
+
+// Sent when the renderer has put data into the send ring while the browser
+// was waiting for it.
+IPC_MESSAGE_CONTROL0(MidiHostMsg_SendRingDoorbell)
+
+// Data too large for the send ring. It takes the place of an empty message in
+// the ring.
+IPC_MESSAGE_CONTROL3(MidiHostMsg_SendLargeData,
+                     uint32 /* port */,
+                     std::vector<uint8> /* data */,
+                     double /* timestamp */)
+
+// Sent when the renderer has made room in the receive ring while the browser
+// was waiting for it.
+IPC_MESSAGE_CONTROL0(MidiHostMsg_RecvRingSpaceAvailable)
+
 // Messages sent from the browser to the renderer.
 
 IPC_MESSAGE_CONTROL1(MidiMsg_AddInputPort,
@@ -67,3 +87,24 @@ IPC_MESSAGE_CONTROL3(MidiMsg_DataReceived,
 
 IPC_MESSAGE_CONTROL1(MidiMsg_AcknowledgeSentData,
                      uint32 /* bytes sent */)
+
+// Sent once, before the first MidiMsg_SessionStarted, with the rings which
+// carry MIDI data from the renderer and to the renderer.
+IPC_MESSAGE_CONTROL2(MidiMsg_SessionRings,
+                     base::SharedMemoryHandle /* send ring */,
+                     base::SharedMemoryHandle /* receive ring */)
+
+// Sent when the browser has made room in the send ring while the renderer was
+// waiting for it.
+IPC_MESSAGE_CONTROL0(MidiMsg_SendRingSpaceAvailable)
+
+// Sent when the browser has put data into the receive ring while the renderer
+// was waiting for it.
+IPC_MESSAGE_CONTROL0(MidiMsg_DataReceivedDoorbell)
+
+// Received data too large for the receive ring. It takes the place of an
+// empty message in the ring.
+IPC_MESSAGE_CONTROL3(MidiMsg_LargeDataReceived,
+                     uint32 /* port */,
+                     std::vector<uint8> /* data */,
+                     double /* timestamp */)
@@ -0,0 +1,433 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "content/common/media/peer_connection_stats_encoding.h"
+
+#include <cstring>
+#include <limits>
+
+#include "base/logging.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/values.h"
+
+// A set is a byte telling whether it starts over (kSetReset) or refers to the
+// previous sets (kSetDelta), followed by a sequence of reports, each of which
+// is:
+//   string  id
+//   string  type
+//   double  timestamp
+//   values, each of which is:
+//     name   value name, never 0
+//     byte   value type
+//     ...    the value, unless its type is TYPE_UNCHANGED
+//   varint  0
+// Strings are written as a varint index into the string table, offset by one
+// more than a "literal" code, or as the literal code, the varint length and
+// the string itself. Literals are added to the string table while it has room,
+// and the table is emptied when a set starts over.
+// Value names use 1 as the literal code, so that 0 can end the report; other
+// strings use 0.
+
+namespace content {
+
+namespace {
+
+enum ValueType {
+  TYPE_UNCHANGED,
+  TYPE_INT,
+  TYPE_DOUBLE,
+  TYPE_STRING,
+  TYPE_FALSE,
+  TYPE_TRUE,
+  TYPE_LAST = TYPE_TRUE,
+};
+
+const uint64 kStringLiteral = 0;
+const uint64 kEndOfReport = 0;
+const uint64 kNameLiteral = 1;
+
+const char kSetDelta = 0;
+const char kSetReset = 1;
+
+// With a set per second, a decoder which lost track is back within half a
+// minute.
+const int kSetsBetweenResets = 30;
+
+// Keeps a peer connection with ever-changing strings from growing the tables
+// without bound.
+const size_t kMaxStrings = 16 * 1024;
+
+void WriteVarint(uint64 value, std::string* out) {
+  while (value >= 0x80) {
+    out->push_back(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  out->push_back(static_cast<char>(value));
+}
+
+bool ReadVarint(const char** pos, const char* end, uint64* value) {
+  *value = 0;
+  for (int shift = 0; shift < 64 && *pos < end; shift += 7) {
+    uint8 byte = static_cast<uint8>(*(*pos)++);
+    *value |= static_cast<uint64>(byte & 0x7f) << shift;
+    if (!(byte & 0x80))
+      return true;
+  }
+  return false;
+}
+
+void WriteDouble(double value, std::string* out) {
+  out->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+bool ReadDouble(const char** pos, const char* end, double* value) {
+  if (end - *pos < static_cast<ptrdiff_t>(sizeof(*value)))
+    return false;
+  memcpy(value, *pos, sizeof(*value));
+  *pos += sizeof(*value);
+  return true;
+}
+
+// Zigzag encoding keeps small negative numbers short.
+uint64 ZigZagEncode(int64 value) {
+  return (static_cast<uint64>(value) << 1) ^ static_cast<uint64>(value >> 63);
+}
+
+int64 ZigZagDecode(uint64 value) {
+  return static_cast<int64>(value >> 1) ^ -static_cast<int64>(value & 1);
+}
+
+}  // namespace
+
+PeerConnectionStatsEncoder::Value::Value()
+    : type(TYPE_UNCHANGED), int_value(0), double_value(0) {
+}
+
+PeerConnectionStatsEncoder::Value::~Value() {
+}
+
+bool PeerConnectionStatsEncoder::Value::operator==(const Value& other) const {
+  // Doubles are compared bitwise, so that NaN counts as unchanged.
+  return type == other.type && int_value == other.int_value &&
+         !memcmp(&double_value, &other.double_value, sizeof(double_value)) &&
+         string_value == other.string_value;
+}
+
+PeerConnectionStatsEncoder::PeerConnectionStatsEncoder()
+    : sets_until_reset_(0),
+      report_values_(NULL),
+      previous_report_values_(NULL) {
+}
+
+PeerConnectionStatsEncoder::~PeerConnectionStatsEncoder() {
+}
+
+void PeerConnectionStatsEncoder::BeginReport(const std::string& id,
+                                             const std::string& type,
+                                             double timestamp) {
+  EndReport();
+  if (data_.empty()) {
+    // The first report of the set.
+    if (sets_until_reset_ == 0) {
+      string_table_.clear();
+      previous_.clear();
+      data_.push_back(kSetReset);
+      sets_until_reset_ = kSetsBetweenResets;
+    } else {
+      data_.push_back(kSetDelta);
+    }
+    --sets_until_reset_;
+  }
+  WriteString(id, kStringLiteral);
+  WriteString(type, kStringLiteral);
+  WriteDouble(timestamp, &data_);
+
+  report_values_ = &current_[id];
+  report_values_->clear();
+  auto it = previous_.find(id);
+  previous_report_values_ = it == previous_.end() ? NULL : &it->second;
+}
+
+void PeerConnectionStatsEncoder::AddInt(const std::string& name, int value) {
+  Value v;
+  v.type = TYPE_INT;
+  v.int_value = value;
+  AddValue(name, v);
+}
+
+void PeerConnectionStatsEncoder::AddDouble(const std::string& name,
+                                           double value) {
+  Value v;
+  v.type = TYPE_DOUBLE;
+  v.double_value = value;
+  AddValue(name, v);
+}
+
+void PeerConnectionStatsEncoder::AddString(const std::string& name,
+                                           const std::string& value) {
+  Value v;
+  v.type = TYPE_STRING;
+  v.string_value = value;
+  AddValue(name, v);
+}
+
+void PeerConnectionStatsEncoder::AddBool(const std::string& name, bool value) {
+  Value v;
+  v.type = value ? TYPE_TRUE : TYPE_FALSE;
+  AddValue(name, v);
+}
+
+std::string PeerConnectionStatsEncoder::Finish() {
+  EndReport();
+  std::string data;
+  data.swap(data_);
+  if (!data.empty())
+    previous_.swap(current_);
+  current_.clear();
+  return data;
+}
+
+void PeerConnectionStatsEncoder::WriteString(const std::string& str,
+                                             uint64 literal_code) {
+  auto it = string_table_.find(str);
+  if (it != string_table_.end()) {
+    WriteVarint(it->second + literal_code + 1, &data_);
+    return;
+  }
+  WriteVarint(literal_code, &data_);
+  WriteVarint(str.size(), &data_);
+  data_.append(str);
+  if (string_table_.size() < kMaxStrings) {
+    size_t index = string_table_.size();
+    string_table_[str] = index;
+  }
+}
+
+void PeerConnectionStatsEncoder::AddValue(const std::string& name,
+                                          const Value& value) {
+  DCHECK(report_values_) << "BeginReport() must be called first.";
+  WriteString(name, kNameLiteral);
+  (*report_values_)[name] = value;
+
+  if (previous_report_values_) {
+    auto it = previous_report_values_->find(name);
+    if (it != previous_report_values_->end() && it->second == value) {
+      data_.push_back(static_cast<char>(TYPE_UNCHANGED));
+      return;
+    }
+  }
+
+  data_.push_back(static_cast<char>(value.type));
+  switch (value.type) {
+    case TYPE_INT:
+      WriteVarint(ZigZagEncode(value.int_value), &data_);
+      break;
+    case TYPE_DOUBLE:
+      WriteDouble(value.double_value, &data_);
+      break;
+    case TYPE_STRING:
+      WriteString(value.string_value, kStringLiteral);
+      break;
+    default:
+      break;
+  }
+}
+
+void PeerConnectionStatsEncoder::EndReport() {
+  if (!report_values_)
+    return;
+  WriteVarint(kEndOfReport, &data_);
+  report_values_ = NULL;
+  previous_report_values_ = NULL;
+}
+
+PeerConnectionStatsDecoder::Value::Value()
+    : type(TYPE_UNCHANGED), int_value(0), double_value(0) {
+}
+
+PeerConnectionStatsDecoder::Value::~Value() {
+}
+
+PeerConnectionStatsDecoder::PeerConnectionStatsDecoder()
+    : needs_reset_(true) {
+}
+
+PeerConnectionStatsDecoder::~PeerConnectionStatsDecoder() {
+}
+
+bool PeerConnectionStatsDecoder::Decode(const std::string& data,
+                                        base::ListValue* reports) {
+  // Every set has a report, so sets are at least two bytes long.
+  bool valid = data.size() >= 2 &&
+               (data[0] == kSetDelta || data[0] == kSetReset);
+  if (valid && data[0] == kSetReset) {
+    Reset();
+    needs_reset_ = false;
+  }
+  if (valid && needs_reset_)
+    return false;
+
+  if (!valid ||
+      !DecodeSet(data.data() + 1, data.data() + data.size(), reports)) {
+    // The sets after this one may refer to it, so they can't be decoded
+    // either until the encoder starts over.
+    Reset();
+    needs_reset_ = true;
+    return false;
+  }
+  return true;
+}
+
+void PeerConnectionStatsDecoder::Reset() {
+  string_table_.clear();
+  previous_.clear();
+}
+
+bool PeerConnectionStatsDecoder::DecodeSet(const char* pos,
+                                           const char* end,
+                                           base::ListValue* reports) {
+  std::map<std::string, ReportValues> current;
+  while (pos < end) {
+    uint64 code;
+    std::string id;
+    std::string type;
+    double timestamp;
+    if (!ReadVarint(&pos, end, &code) ||
+        !ReadString(&pos, end, code, kStringLiteral, &id) ||
+        !ReadVarint(&pos, end, &code) ||
+        !ReadString(&pos, end, code, kStringLiteral, &type) ||
+        !ReadDouble(&pos, end, &timestamp)) {
+      return false;
+    }
+
+    auto previous_it = previous_.find(id);
+    const ReportValues* previous_values =
+        previous_it == previous_.end() ? NULL : &previous_it->second;
+    ReportValues& values = current[id];
+    values.clear();
+    scoped_ptr<base::ListValue> list;
+    if (reports)
+      list.reset(new base::ListValue());
+
+    for (;;) {
+      std::string name;
+      if (!ReadVarint(&pos, end, &code))
+        return false;
+      if (code == kEndOfReport)
+        break;
+      if (!ReadString(&pos, end, code, kNameLiteral, &name) || pos >= end)
+        return false;
+
+      Value value;
+      int type_byte = static_cast<uint8>(*pos++);
+      if (type_byte > TYPE_LAST)
+        return false;
+      uint64 raw;
+      switch (type_byte) {
+        case TYPE_UNCHANGED: {
+          if (!previous_values)
+            return false;
+          auto it = previous_values->find(name);
+          if (it == previous_values->end())
+            return false;
+          value = it->second;
+          break;
+        }
+        case TYPE_INT:
+          if (!ReadVarint(&pos, end, &raw))
+            return false;
+          value.int_value = ZigZagDecode(raw);
+          if (value.int_value < std::numeric_limits<int>::min() ||
+              value.int_value > std::numeric_limits<int>::max()) {
+            return false;
+          }
+          break;
+        case TYPE_DOUBLE:
+          if (!ReadDouble(&pos, end, &value.double_value))
+            return false;
+          break;
+        case TYPE_STRING:
+          if (!ReadVarint(&pos, end, &raw) ||
+              !ReadString(&pos, end, raw, kStringLiteral,
+                          &value.string_value)) {
+            return false;
+          }
+          break;
+        default:
+          break;
+      }
+      if (type_byte != TYPE_UNCHANGED)
+        value.type = type_byte;
+      values[name] = value;
+
+      if (!list)
+        continue;
+      // Note:
+      // The format must be consistent with what webrtc_internals.js expects,
+      // and with what PeerConnectionTracker used to send.
+      list->AppendString(name);
+      switch (value.type) {
+        case TYPE_INT:
+          list->AppendInteger(static_cast<int>(value.int_value));
+          break;
+        case TYPE_DOUBLE:
+          list->AppendDouble(value.double_value);
+          break;
+        case TYPE_STRING:
+          list->AppendString(value.string_value);
+          break;
+        case TYPE_FALSE:
+        case TYPE_TRUE:
+          list->AppendBoolean(value.type == TYPE_TRUE);
+          break;
+        default:
+          NOTREACHED();
+          break;
+      }
+    }
+
+    if (reports) {
+      base::DictionaryValue* stats = new base::DictionaryValue();
+      stats->SetDouble("timestamp", timestamp);
+      stats->Set("values", list.release());
+      base::DictionaryValue* report = new base::DictionaryValue();
+      report->Set("stats", stats);
+      report->SetString("id", id);
+      report->SetString("type", type);
+      reports->Append(report);
+    }
+  }
+
+  previous_.swap(current);
+  return true;
+}
+
+bool PeerConnectionStatsDecoder::ReadString(const char** pos,
+                                            const char* end,
+                                            uint64 code,
+                                            uint64 literal_code,
+                                            std::string* str) {
+  if (code > literal_code) {
+    uint64 index = code - literal_code - 1;
+    if (index >= string_table_.size())
+      return false;
+    *str = string_table_[index];
+    return true;
+  }
+  if (code != literal_code)
+    return false;
+
+  uint64 length;
+  if (!ReadVarint(pos, end, &length) ||
+      length > static_cast<uint64>(end - *pos)) {
+    return false;
+  }
+  str->assign(*pos, static_cast<size_t>(length));
+  *pos += length;
+  if (string_table_.size() < kMaxStrings)
+    string_table_.push_back(*str);
+  return true;
+}
+
+}  // namespace content
@@ -0,0 +1,154 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CONTENT_COMMON_MEDIA_PEER_CONNECTION_STATS_ENCODING_H_
+#define CONTENT_COMMON_MEDIA_PEER_CONNECTION_STATS_ENCODING_H_
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/containers/hash_tables.h"
+#include "content/common/content_export.h"
+
+namespace base {
+class ListValue;
+}
+
+namespace content {
+
+// PeerConnectionTracker sends the stats of each peer connection every second
+// for as long as chrome://webrtc-internals is open, and little changes from
+// one set of stats reports to the next. PeerConnectionStatsEncoder turns each
+// set into a compact binary form which only carries what changed since the
+// previous set:
+//  - Report ids, value names and string values are sent once, and are then
+//    referred to by index.
+//  - A value which is the same as in the previous set takes a single byte.
+//  - Integers take as few bytes as they need.
+// Every so often a set starts over without referring to earlier ones, so that
+// a decoder which rejected a set can pick up again.
+// PeerConnectionStatsDecoder rebuilds the stats in the format
+// webrtc_internals.js expects.
+//
+// An encoder and its decoder belong to one peer connection, and must see the
+// same sets in the same order.
+class CONTENT_EXPORT PeerConnectionStatsEncoder {
+ public:
+  PeerConnectionStatsEncoder();
+  ~PeerConnectionStatsEncoder();
+
+  // Starts the next report of the set being built. Reports without values
+  // should be left out.
+  void BeginReport(const std::string& id,
+                   const std::string& type,
+                   double timestamp);
+
+  // Add a value to the current report.
+  void AddInt(const std::string& name, int value);
+  void AddDouble(const std::string& name, double value);
+  void AddString(const std::string& name, const std::string& value);
+  void AddBool(const std::string& name, bool value);
+
+  // Returns the set built since the last call, which becomes the one the next
+  // set is encoded against. Returns an empty string, which mustn't be passed
+  // to the decoder, if the set is empty; the previous set is kept then.
+  std::string Finish();
+
+ private:
+  struct Value {
+    Value();
+    ~Value();
+
+    bool operator==(const Value& other) const;
+
+    int type;
+    int64 int_value;
+    double double_value;
+    std::string string_value;
+  };
+
+  // Values by name.
+  typedef std::map<std::string, Value> ReportValues;
+
+  // Appends a reference to |str| to |data_|, or |str| itself if the decoder
+  // doesn't know it yet.
+  void WriteString(const std::string& str, uint64 literal_code);
+
+  // Appends |value|, or a marker if it's the same as in the previous set.
+  void AddValue(const std::string& name, const Value& value);
+
+  // Ends the current report, if any.
+  void EndReport();
+
+  // Number of sets to encode before the next one which starts over.
+  int sets_until_reset_;
+
+  // Indices of the strings the decoder knows.
+  base::hash_map<std::string, size_t> string_table_;
+
+  // The values of each report of the previous set and of the set being built,
+  // by report id.
+  std::map<std::string, ReportValues> previous_;
+  std::map<std::string, ReportValues> current_;
+
+  // The set being built.
+  std::string data_;
+  // The values of the current report, and those it had in the previous set.
+  ReportValues* report_values_;
+  const ReportValues* previous_report_values_;
+
+  DISALLOW_COPY_AND_ASSIGN(PeerConnectionStatsEncoder);
+};
+
+class CONTENT_EXPORT PeerConnectionStatsDecoder {
+ public:
+  PeerConnectionStatsDecoder();
+  ~PeerConnectionStatsDecoder();
+
+  // Decodes a set made by PeerConnectionStatsEncoder::Finish(), appending the
+  // reports to |reports|. |reports| may be NULL if the stats aren't needed,
+  // but every set must still be decoded. Returns false if |data| is invalid;
+  // the decoder then forgets the earlier sets, and rejects the ones which
+  // refer to them until the encoder starts over.
+  bool Decode(const std::string& data, base::ListValue* reports);
+
+ private:
+  struct Value {
+    Value();
+    ~Value();
+
+    int type;
+    int64 int_value;
+    double double_value;
+    std::string string_value;
+  };
+
+  typedef std::map<std::string, Value> ReportValues;
+
+  bool DecodeSet(const char* pos, const char* end, base::ListValue* reports);
+
+  // Forgets the strings and the sets decoded so far.
+  void Reset();
+
+  // Reads what PeerConnectionStatsEncoder::WriteString() wrote, given the
+  // |code| it started with.
+  bool ReadString(const char** pos,
+                  const char* end,
+                  uint64 code,
+                  uint64 literal_code,
+                  std::string* str);
+
+  std::vector<std::string> string_table_;
+  std::map<std::string, ReportValues> previous_;
+  // Whether only a set which starts over can be decoded.
+  bool needs_reset_;
+
+  DISALLOW_COPY_AND_ASSIGN(PeerConnectionStatsDecoder);
+};
+
+}  // namespace content
+
+#endif  // CONTENT_COMMON_MEDIA_PEER_CONNECTION_STATS_ENCODING_H_
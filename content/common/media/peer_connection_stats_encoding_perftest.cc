@@ -0,0 +1,110 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "content/common/media/peer_connection_stats_encoding.h"
+
+#include "base/strings/string_number_conversions.h"
+#include "base/time/time.h"
+#include "base/values.h"
+#include "ipc/ipc_message.h"
+#include "ipc/ipc_message_utils.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_test.h"
+
+namespace content {
+namespace {
+
+const int kTimeLimitMs = 2000;
+const int kTimeCheckInterval = 10;
+
+// Roughly what a call with one audio and one video stream reports every
+// second.
+const int kReportsPerSet = 12;
+const int kValuesPerReport = 30;
+
+// Adds set |n| to |encoder| and, in the format PeerConnectionTracker used to
+// send, to |reports|. Counters change from one set to the next, the rest
+// doesn't.
+void AddSet(int n,
+            PeerConnectionStatsEncoder* encoder,
+            base::ListValue* reports) {
+  for (int r = 0; r < kReportsPerSet; ++r) {
+    std::string id = "ssrc_" + base::IntToString(1000 + r) + "_send";
+    double timestamp = 1000.0 * n;
+    encoder->BeginReport(id, "ssrc", timestamp);
+    base::ListValue* values = new base::ListValue();
+    for (int v = 0; v < kValuesPerReport; ++v) {
+      std::string name = "googValue" + base::IntToString(v);
+      values->AppendString(name);
+      if (v % 3 == 0) {
+        encoder->AddInt(name, n * (v + 1) * 100);
+        values->AppendInteger(n * (v + 1) * 100);
+      } else if (v % 3 == 1) {
+        encoder->AddDouble(name, v * 0.5);
+        values->AppendDouble(v * 0.5);
+      } else {
+        encoder->AddString(name, "value-" + base::IntToString(v));
+        values->AppendString("value-" + base::IntToString(v));
+      }
+    }
+
+    base::DictionaryValue* stats = new base::DictionaryValue();
+    stats->SetDouble("timestamp", timestamp);
+    stats->Set("values", values);
+    base::DictionaryValue* report = new base::DictionaryValue();
+    report->Set("stats", stats);
+    report->SetString("id", id);
+    report->SetString("type", "ssrc");
+    reports->Append(report);
+  }
+}
+
+TEST(PeerConnectionStatsEncodingPerfTest, EncodeAndDecode) {
+  PeerConnectionStatsEncoder encoder;
+  PeerConnectionStatsDecoder decoder;
+  base::TimeDelta encode_time;
+  base::TimeDelta decode_time;
+  size_t encoded_bytes = 0;
+  size_t list_value_bytes = 0;
+  int sets = 0;
+
+  base::TimeTicks end =
+      base::TimeTicks::Now() + base::TimeDelta::FromMilliseconds(kTimeLimitMs);
+  while (base::TimeTicks::Now() < end) {
+    for (int i = 0; i < kTimeCheckInterval; ++i, ++sets) {
+      base::ListValue expected;
+      base::TimeTicks start = base::TimeTicks::Now();
+      AddSet(sets, &encoder, &expected);
+      std::string data = encoder.Finish();
+      encode_time += base::TimeTicks::Now() - start;
+      encoded_bytes += data.size();
+
+      // What PeerConnectionTrackerHost_AddStats used to carry.
+      IPC::Message msg(1, 2, IPC::Message::PRIORITY_NORMAL);
+      IPC::WriteParam(&msg, expected);
+      list_value_bytes += msg.size();
+
+      base::ListValue reports;
+      start = base::TimeTicks::Now();
+      ASSERT_TRUE(decoder.Decode(data, &reports));
+      decode_time += base::TimeTicks::Now() - start;
+      ASSERT_TRUE(reports.Equals(&expected));
+    }
+  }
+
+  int reports = sets * kReportsPerSet;
+  perf_test::PrintResult("encode_time", "", "per_report",
+                         encode_time.InMicrosecondsF() / reports, "us", true);
+  perf_test::PrintResult("decode_time", "", "per_report",
+                         decode_time.InMicrosecondsF() / reports, "us", true);
+  perf_test::PrintResult("encoded_size", "", "per_report",
+                         static_cast<double>(encoded_bytes) / reports, "bytes",
+                         true);
+  perf_test::PrintResult("list_value_size", "", "per_report",
+                         static_cast<double>(list_value_bytes) / reports,
+                         "bytes", true);
+}
+
+}  // namespace
+}  // namespace content
@@ -0,0 +1,220 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "content/common/media/peer_connection_stats_encoding.h"
+
+#include <cstring>
+
+#include "base/strings/string_number_conversions.h"
+#include "base/values.h"
+#include "ipc/ipc_message.h"
+#include "ipc/ipc_message_utils.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace content {
+
+namespace {
+
+// Adds a report resembling libjingle's "ssrc" reports to |encoder| and, in the
+// format PeerConnectionTracker used to send, to |expected|.
+void AddSsrcReport(int ssrc,
+                   int packets,
+                   double timestamp,
+                   PeerConnectionStatsEncoder* encoder,
+                   base::ListValue* expected) {
+  std::string id = "ssrc_" + base::IntToString(ssrc) + "_send";
+  encoder->BeginReport(id, "ssrc", timestamp);
+  encoder->AddString("googTrackId", "audio-track-1");
+  encoder->AddString("transportId", "Channel-audio-1");
+  encoder->AddInt("packetsSent", packets);
+  encoder->AddInt("bytesSent", packets * 160);
+  encoder->AddInt("audioInputLevel", -packets % 7);
+  encoder->AddDouble("googEchoCancellationReturnLoss", 12.5);
+  encoder->AddBool("googTypingNoiseState", false);
+
+  base::ListValue* values = new base::ListValue();
+  values->AppendString("googTrackId");
+  values->AppendString("audio-track-1");
+  values->AppendString("transportId");
+  values->AppendString("Channel-audio-1");
+  values->AppendString("packetsSent");
+  values->AppendInteger(packets);
+  values->AppendString("bytesSent");
+  values->AppendInteger(packets * 160);
+  values->AppendString("audioInputLevel");
+  values->AppendInteger(-packets % 7);
+  values->AppendString("googEchoCancellationReturnLoss");
+  values->AppendDouble(12.5);
+  values->AppendString("googTypingNoiseState");
+  values->AppendBoolean(false);
+
+  base::DictionaryValue* stats = new base::DictionaryValue();
+  stats->SetDouble("timestamp", timestamp);
+  stats->Set("values", values);
+  base::DictionaryValue* report = new base::DictionaryValue();
+  report->Set("stats", stats);
+  report->SetString("id", id);
+  report->SetString("type", "ssrc");
+  expected->Append(report);
+}
+
+// Returns the size |reports| had in the old PeerConnectionTrackerHost_AddStats
+// message.
+size_t GetListValueSize(const base::ListValue& reports) {
+  IPC::Message msg(1, 2, IPC::Message::PRIORITY_NORMAL);
+  IPC::WriteParam(&msg, reports);
+  return msg.size();
+}
+
+}  // namespace
+
+TEST(PeerConnectionStatsEncodingTest, RoundTrip) {
+  PeerConnectionStatsEncoder encoder;
+  PeerConnectionStatsDecoder decoder;
+
+  for (int i = 0; i < 5; ++i) {
+    base::ListValue expected;
+    AddSsrcReport(1234, 100 * i, 1000.0 * i, &encoder, &expected);
+    AddSsrcReport(5678, 50 * i, 1000.0 * i, &encoder, &expected);
+
+    base::ListValue reports;
+    ASSERT_TRUE(decoder.Decode(encoder.Finish(), &reports));
+    EXPECT_TRUE(reports.Equals(&expected)) << "set " << i;
+  }
+}
+
+TEST(PeerConnectionStatsEncodingTest, SendsOnlyChanges) {
+  PeerConnectionStatsEncoder encoder;
+  PeerConnectionStatsDecoder decoder;
+
+  base::ListValue expected;
+  AddSsrcReport(1234, 100, 1000.0, &encoder, &expected);
+  std::string first = encoder.Finish();
+  ASSERT_TRUE(decoder.Decode(first, NULL));
+  // Even the first set is smaller than what used to be sent.
+  EXPECT_LT(first.size(), GetListValueSize(expected));
+
+  // Only the counters and the timestamp change.
+  expected.Clear();
+  AddSsrcReport(1234, 150, 2000.0, &encoder, &expected);
+  std::string second = encoder.Finish();
+  EXPECT_LT(second.size() * 3, first.size());
+
+  base::ListValue reports;
+  ASSERT_TRUE(decoder.Decode(second, &reports));
+  EXPECT_TRUE(reports.Equals(&expected));
+}
+
+TEST(PeerConnectionStatsEncodingTest, ReportsComeAndGo) {
+  PeerConnectionStatsEncoder encoder;
+  PeerConnectionStatsDecoder decoder;
+
+  base::ListValue expected;
+  AddSsrcReport(1, 10, 1.0, &encoder, &expected);
+  ASSERT_TRUE(decoder.Decode(encoder.Finish(), NULL));
+
+  // A report which is missing from a set starts over when it comes back.
+  expected.Clear();
+  AddSsrcReport(2, 20, 2.0, &encoder, &expected);
+  base::ListValue reports;
+  ASSERT_TRUE(decoder.Decode(encoder.Finish(), &reports));
+  EXPECT_TRUE(reports.Equals(&expected));
+
+  expected.Clear();
+  AddSsrcReport(1, 30, 3.0, &encoder, &expected);
+  reports.Clear();
+  ASSERT_TRUE(decoder.Decode(encoder.Finish(), &reports));
+  EXPECT_TRUE(reports.Equals(&expected));
+
+  // Nothing is sent for an empty set, and the next set is still encoded
+  // against the previous one.
+  EXPECT_TRUE(encoder.Finish().empty());
+  expected.Clear();
+  AddSsrcReport(1, 40, 4.0, &encoder, &expected);
+  reports.Clear();
+  ASSERT_TRUE(decoder.Decode(encoder.Finish(), &reports));
+  EXPECT_TRUE(reports.Equals(&expected));
+}
+
+TEST(PeerConnectionStatsEncodingTest, ValuesChangeType) {
+  PeerConnectionStatsEncoder encoder;
+  PeerConnectionStatsDecoder decoder;
+
+  encoder.BeginReport("report", "type", 1.0);
+  encoder.AddInt("value", -1);
+  ASSERT_TRUE(decoder.Decode(encoder.Finish(), NULL));
+
+  encoder.BeginReport("report", "type", 1.0);
+  encoder.AddString("value", "-1");
+  base::ListValue reports;
+  ASSERT_TRUE(decoder.Decode(encoder.Finish(), &reports));
+
+  const base::DictionaryValue* report;
+  const base::ListValue* values;
+  std::string value;
+  ASSERT_TRUE(reports.GetDictionary(0, &report));
+  ASSERT_TRUE(report->GetList("stats.values", &values));
+  ASSERT_TRUE(values->GetString(1, &value));
+  EXPECT_EQ("-1", value);
+}
+
+TEST(PeerConnectionStatsEncodingTest, RejectsInvalidData) {
+  PeerConnectionStatsEncoder encoder;
+  base::ListValue expected;
+  AddSsrcReport(1234, 100, 1000.0, &encoder, &expected);
+  std::string first = encoder.Finish();
+  AddSsrcReport(1234, 150, 2000.0, &encoder, &expected);
+  std::string second = encoder.Finish();
+
+  // Every truncation of a set is rejected.
+  for (size_t size = 1; size < first.size(); ++size) {
+    PeerConnectionStatsDecoder decoder;
+    EXPECT_FALSE(decoder.Decode(first.substr(0, size), NULL)) << size;
+  }
+
+  // A set which refers to one the decoder hasn't seen is rejected. The first
+  // set starts over, so the decoder picks up from there.
+  PeerConnectionStatsDecoder decoder;
+  EXPECT_FALSE(decoder.Decode(second, NULL));
+  EXPECT_TRUE(decoder.Decode(first, NULL));
+  EXPECT_TRUE(decoder.Decode(second, NULL));
+
+  // An unknown value type.
+  PeerConnectionStatsDecoder other_decoder;
+  std::string bogus = first;
+  // The first value's type follows the set header, the id, the type, the
+  // timestamp and the value name, all literals.
+  size_t type_offset = 1 + 2 + strlen("ssrc_1234_send") + 2 + strlen("ssrc") +
+                       sizeof(double) + 2 + strlen("googTrackId");
+  ASSERT_LT(type_offset, bogus.size());
+  bogus[type_offset] = 42;
+  EXPECT_FALSE(other_decoder.Decode(bogus, NULL));
+}
+
+TEST(PeerConnectionStatsEncodingTest, RecoversFromInvalidData) {
+  PeerConnectionStatsEncoder encoder;
+  PeerConnectionStatsDecoder decoder;
+  base::ListValue expected;
+  AddSsrcReport(1234, 100, 1000.0, &encoder, &expected);
+  ASSERT_TRUE(decoder.Decode(encoder.Finish(), NULL));
+
+  // After a bad set, the sets which refer to earlier ones are rejected until
+  // the encoder starts over.
+  EXPECT_FALSE(decoder.Decode(std::string(1, '\0'), NULL));
+  int rejected = 0;
+  for (int i = 0; i < 100; ++i) {
+    expected.Clear();
+    AddSsrcReport(1234, 100 + i, 1001.0 + i, &encoder, &expected);
+    base::ListValue reports;
+    if (!decoder.Decode(encoder.Finish(), &reports)) {
+      ++rejected;
+      continue;
+    }
+    EXPECT_TRUE(reports.Equals(&expected)) << "set " << i;
+  }
+  EXPECT_GT(rejected, 0);
+  EXPECT_LT(rejected, 100);
+}
+
+}  // namespace content
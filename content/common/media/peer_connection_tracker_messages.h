@@ -2,7 +2,9 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
-#include "base/values.h"
+#include <string>
+#include <vector>
+
 #include "content/common/content_export.h"
 #include "ipc/ipc_message_macros.h"
 
@@ -17,18 +19,24 @@ IPC_STRUCT_BEGIN(PeerConnectionInfo)
   IPC_STRUCT_MEMBER(std::string, url)
 IPC_STRUCT_END()
 
+// Either an update, with |type| and |value|, or a set of stats reports as
+// made by PeerConnectionStatsEncoder, with |stats|.
+IPC_STRUCT_BEGIN(PeerConnectionUpdate)
+  IPC_STRUCT_MEMBER(int, lid)
+  IPC_STRUCT_MEMBER(std::string, type)
+  IPC_STRUCT_MEMBER(std::string, value)
+  IPC_STRUCT_MEMBER(std::string, stats)
+IPC_STRUCT_END()
+
 // Messages sent from PeerConnectionTracker to PeerConnectionTrackerHost.
 IPC_MESSAGE_CONTROL1(PeerConnectionTrackerHost_AddPeerConnection,
                      PeerConnectionInfo /* info */)
 IPC_MESSAGE_CONTROL1(PeerConnectionTrackerHost_RemovePeerConnection,
                      int /* lid */)
-IPC_MESSAGE_CONTROL3(PeerConnectionTrackerHost_UpdatePeerConnection,
-                     int /* lid */,
-                     std::string /* type */,
-                     std::string /* value */)
-IPC_MESSAGE_CONTROL2(PeerConnectionTrackerHost_AddStats,
-                     int /* lid */,
-                     base::ListValue /* value */)
+// Carries the updates and the stats gathered since the previous message, in
+// the order they happened.
+IPC_MESSAGE_CONTROL1(PeerConnectionTrackerHost_UpdatePeerConnections,
+                     std::vector<PeerConnectionUpdate> /* updates */)
 IPC_MESSAGE_CONTROL5(PeerConnectionTrackerHost_GetUserMedia,
                      std::string /*origin*/,
                      bool /*audio*/,
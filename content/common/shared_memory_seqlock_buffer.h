@@ -5,6 +5,8 @@
 #ifndef CONTENT_COMMON_SHARED_MEMORY_SEQLOCK_BUFFER_H_
 #define CONTENT_COMMON_SHARED_MEMORY_SEQLOCK_BUFFER_H_
 
+#include <string.h>
+
 #include "content/common/one_writer_seqlock.h"
 
 namespace content {
@@ -17,10 +19,25 @@ namespace content {
 //
 // Writer and reader operate on the same buffer assuming contention is low, and
 // contention is detected by using the associated SeqLock.
+//
+// Readers can tell from the sequence number alone whether there is anything
+// new, so writers which sample a source that often doesn't change should use
+// WriteIfChanged() rather than writing every sample.
 
 template<class Data>
 class SharedMemorySeqLockBuffer {
  public:
+  // Copies |new_data| into the buffer unless it holds the same data already.
+  // Returns true if it wrote. Only the writer may call this.
+  bool WriteIfChanged(const Data& new_data) {
+    if (memcmp(&data, &new_data, sizeof(Data)) == 0)
+      return false;
+    seqlock.WriteBegin();
+    memcpy(&data, &new_data, sizeof(Data));
+    seqlock.WriteEnd();
+    return true;
+  }
+
   OneWriterSeqLock seqlock;
   Data data;
 };
@@ -0,0 +1,350 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "content/common/value_wire_format.h"
+
+#include <string.h>
+
+#include "base/logging.h"
+
+namespace content {
+
+namespace {
+
+const size_t kCountSize = sizeof(uint32);
+const size_t kMaxVarintSize = 10;
+
+}  // namespace
+
+ValueWireWriter::ValueWireWriter(std::string* output)
+    : output_(output), start_(output->size()) {}
+
+ValueWireWriter::~ValueWireWriter() {}
+
+void ValueWireWriter::WriteNull() {
+  WriteType(base::Value::TYPE_NULL);
+}
+
+void ValueWireWriter::WriteBoolean(bool value) {
+  WriteType(base::Value::TYPE_BOOLEAN);
+  output_->push_back(value ? 1 : 0);
+}
+
+void ValueWireWriter::WriteInteger(int value) {
+  WriteType(base::Value::TYPE_INTEGER);
+  uint32 zigzag = (static_cast<uint32>(value) << 1) ^
+                  static_cast<uint32>(value >> 31);
+  WriteVarint(zigzag);
+}
+
+void ValueWireWriter::WriteDouble(double value) {
+  WriteType(base::Value::TYPE_DOUBLE);
+  output_->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void ValueWireWriter::WriteString(const char* data, size_t length) {
+  WriteType(base::Value::TYPE_STRING);
+  WriteKey(data, length);
+}
+
+void ValueWireWriter::WriteBinary(const char* data, size_t length) {
+  WriteType(base::Value::TYPE_BINARY);
+  WriteVarint(length);
+  output_->append(data, length);
+}
+
+size_t ValueWireWriter::BeginList() {
+  WriteType(base::Value::TYPE_LIST);
+  size_t container = position();
+  output_->append(kCountSize, '\0');
+  return container;
+}
+
+size_t ValueWireWriter::BeginDictionary() {
+  WriteType(base::Value::TYPE_DICTIONARY);
+  size_t container = position();
+  output_->append(kCountSize, '\0');
+  return container;
+}
+
+void ValueWireWriter::WriteKey(const char* data, size_t length) {
+  WriteVarint(length);
+  output_->append(data, length);
+}
+
+void ValueWireWriter::EndContainer(size_t container, uint32 count) {
+  DCHECK_LE(container + kCountSize, position());
+  memcpy(&(*output_)[start_ + container], &count, kCountSize);
+}
+
+void ValueWireWriter::WriteValue(const base::Value& value) {
+  WriteNestedValue(value, 1);
+}
+
+void ValueWireWriter::WriteNestedValue(const base::Value& value, int depth) {
+  if (depth > kMaxValueWireDepth) {
+    WriteNull();
+    return;
+  }
+
+  switch (value.GetType()) {
+    case base::Value::TYPE_NULL:
+      WriteNull();
+      break;
+
+    case base::Value::TYPE_BOOLEAN: {
+      bool val = false;
+      CHECK(value.GetAsBoolean(&val));
+      WriteBoolean(val);
+      break;
+    }
+
+    case base::Value::TYPE_INTEGER: {
+      int val = 0;
+      CHECK(value.GetAsInteger(&val));
+      WriteInteger(val);
+      break;
+    }
+
+    case base::Value::TYPE_DOUBLE: {
+      double val = 0.0;
+      CHECK(value.GetAsDouble(&val));
+      WriteDouble(val);
+      break;
+    }
+
+    case base::Value::TYPE_STRING: {
+      const std::string& val =
+          static_cast<const base::StringValue&>(value).GetString();
+      WriteString(val.data(), val.length());
+      break;
+    }
+
+    case base::Value::TYPE_BINARY: {
+      const base::BinaryValue& binary =
+          static_cast<const base::BinaryValue&>(value);
+      WriteBinary(binary.GetBuffer(), binary.GetSize());
+      break;
+    }
+
+    case base::Value::TYPE_DICTIONARY: {
+      const base::DictionaryValue& dictionary =
+          static_cast<const base::DictionaryValue&>(value);
+      size_t container = BeginDictionary();
+      for (base::DictionaryValue::Iterator it(dictionary); !it.IsAtEnd();
+           it.Advance()) {
+        WriteKey(it.key().data(), it.key().length());
+        WriteNestedValue(it.value(), depth + 1);
+      }
+      EndContainer(container, static_cast<uint32>(dictionary.size()));
+      break;
+    }
+
+    case base::Value::TYPE_LIST: {
+      const base::ListValue& list = static_cast<const base::ListValue&>(value);
+      size_t container = BeginList();
+      for (base::ListValue::const_iterator it = list.begin(); it != list.end();
+           ++it) {
+        WriteNestedValue(**it, depth + 1);
+      }
+      EndContainer(container, static_cast<uint32>(list.GetSize()));
+      break;
+    }
+  }
+}
+
+void ValueWireWriter::Truncate(size_t position) {
+  DCHECK_LE(position, this->position());
+  output_->resize(start_ + position);
+}
+
+base::Value::Type ValueWireWriter::GetTypeAt(size_t position) const {
+  DCHECK_LT(position, this->position());
+  return static_cast<base::Value::Type>((*output_)[start_ + position]);
+}
+
+void ValueWireWriter::WriteType(base::Value::Type type) {
+  output_->push_back(static_cast<char>(type));
+}
+
+void ValueWireWriter::WriteVarint(uint64 value) {
+  while (value >= 0x80) {
+    output_->push_back(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  output_->push_back(static_cast<char>(value));
+}
+
+ValueWireReader::ValueWireReader(const char* data, size_t size)
+    : current_(data), end_(data + size) {}
+
+ValueWireReader::~ValueWireReader() {}
+
+bool ValueWireReader::ReadType(base::Value::Type* type) {
+  const char* data = NULL;
+  if (!ReadBytes(1, &data))
+    return false;
+  if (*data < base::Value::TYPE_NULL || *data > base::Value::TYPE_LIST)
+    return false;
+  *type = static_cast<base::Value::Type>(*data);
+  return true;
+}
+
+bool ValueWireReader::ReadBoolean(bool* value) {
+  const char* data = NULL;
+  if (!ReadBytes(1, &data) || (*data != 0 && *data != 1))
+    return false;
+  *value = *data == 1;
+  return true;
+}
+
+bool ValueWireReader::ReadInteger(int* value) {
+  uint64 zigzag = 0;
+  if (!ReadVarint(&zigzag) || zigzag > kuint32max)
+    return false;
+  uint32 bits = static_cast<uint32>(zigzag);
+  *value = static_cast<int>((bits >> 1) ^ (0u - (bits & 1)));
+  return true;
+}
+
+bool ValueWireReader::ReadDouble(double* value) {
+  const char* data = NULL;
+  if (!ReadBytes(sizeof(*value), &data))
+    return false;
+  memcpy(value, data, sizeof(*value));
+  return true;
+}
+
+bool ValueWireReader::ReadString(const char** data, size_t* length) {
+  return ReadKey(data, length);
+}
+
+bool ValueWireReader::ReadBinary(const char** data, size_t* length) {
+  return ReadKey(data, length);
+}
+
+bool ValueWireReader::ReadKey(const char** data, size_t* length) {
+  uint64 size = 0;
+  if (!ReadVarint(&size) || size > RemainingBytes())
+    return false;
+  *length = static_cast<size_t>(size);
+  return ReadBytes(*length, data);
+}
+
+bool ValueWireReader::ReadCount(uint32* count) {
+  const char* data = NULL;
+  if (!ReadBytes(kCountSize, &data))
+    return false;
+  memcpy(count, data, kCountSize);
+  return *count <= RemainingBytes();
+}
+
+scoped_ptr<base::Value> ValueWireReader::ReadValue() {
+  return ReadValueImpl(1);
+}
+
+bool ValueWireReader::ReadVarint(uint64* value) {
+  *value = 0;
+  for (size_t i = 0; i < kMaxVarintSize && current_ < end_; ++i) {
+    uint8 byte = static_cast<uint8>(*current_++);
+    *value |= static_cast<uint64>(byte & 0x7f) << (7 * i);
+    if (!(byte & 0x80))
+      return true;
+  }
+  return false;
+}
+
+bool ValueWireReader::ReadBytes(size_t length, const char** data) {
+  if (length > RemainingBytes())
+    return false;
+  *data = current_;
+  current_ += length;
+  return true;
+}
+
+scoped_ptr<base::Value> ValueWireReader::ReadValueImpl(int depth) {
+  base::Value::Type type;
+  if (depth > kMaxValueWireDepth || !ReadType(&type))
+    return nullptr;
+
+  switch (type) {
+    case base::Value::TYPE_NULL:
+      return base::Value::CreateNullValue();
+
+    case base::Value::TYPE_BOOLEAN: {
+      bool val = false;
+      if (!ReadBoolean(&val))
+        return nullptr;
+      return make_scoped_ptr(new base::FundamentalValue(val));
+    }
+
+    case base::Value::TYPE_INTEGER: {
+      int val = 0;
+      if (!ReadInteger(&val))
+        return nullptr;
+      return make_scoped_ptr(new base::FundamentalValue(val));
+    }
+
+    case base::Value::TYPE_DOUBLE: {
+      double val = 0.0;
+      if (!ReadDouble(&val))
+        return nullptr;
+      return make_scoped_ptr(new base::FundamentalValue(val));
+    }
+
+    case base::Value::TYPE_STRING: {
+      const char* data = NULL;
+      size_t length = 0;
+      if (!ReadString(&data, &length))
+        return nullptr;
+      return make_scoped_ptr(new base::StringValue(std::string(data, length)));
+    }
+
+    case base::Value::TYPE_BINARY: {
+      const char* data = NULL;
+      size_t length = 0;
+      if (!ReadBinary(&data, &length))
+        return nullptr;
+      return make_scoped_ptr(
+          base::BinaryValue::CreateWithCopiedBuffer(data, length));
+    }
+
+    case base::Value::TYPE_DICTIONARY: {
+      uint32 count = 0;
+      if (!ReadCount(&count))
+        return nullptr;
+      scoped_ptr<base::DictionaryValue> dictionary(new base::DictionaryValue());
+      for (uint32 i = 0; i < count; ++i) {
+        const char* key = NULL;
+        size_t key_length = 0;
+        if (!ReadKey(&key, &key_length))
+          return nullptr;
+        scoped_ptr<base::Value> child = ReadValueImpl(depth + 1);
+        if (!child)
+          return nullptr;
+        dictionary->SetWithoutPathExpansion(std::string(key, key_length),
+                                            child.Pass());
+      }
+      return dictionary.Pass();
+    }
+
+    case base::Value::TYPE_LIST: {
+      uint32 count = 0;
+      if (!ReadCount(&count))
+        return nullptr;
+      scoped_ptr<base::ListValue> list(new base::ListValue());
+      for (uint32 i = 0; i < count; ++i) {
+        scoped_ptr<base::Value> child = ReadValueImpl(depth + 1);
+        if (!child)
+          return nullptr;
+        list->Append(child.Pass());
+      }
+      return list.Pass();
+    }
+  }
+  NOTREACHED();
+  return nullptr;
+}
+
+}  // namespace content
@@ -0,0 +1,121 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CONTENT_COMMON_VALUE_WIRE_FORMAT_H_
+#define CONTENT_COMMON_VALUE_WIRE_FORMAT_H_
+
+#include <string>
+
+#include "base/basictypes.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/values.h"
+#include "content/common/content_export.h"
+
+namespace content {
+
+// A compact binary encoding of the values base::Value can hold, which
+// V8ValueConverterImpl writes from and reads into V8 values directly, without
+// building a base::Value tree on the way.
+//
+// Each value is a byte holding its base::Value::Type, followed by
+//   TYPE_NULL:       nothing
+//   TYPE_BOOLEAN:    one byte, 0 or 1
+//   TYPE_INTEGER:    a zigzag encoded varint
+//   TYPE_DOUBLE:     8 bytes in host byte order
+//   TYPE_STRING:     a varint length and that many bytes of UTF-8
+//   TYPE_BINARY:     a varint length and that many bytes
+//   TYPE_DICTIONARY: a 32 bit count, and that many keys (encoded like strings,
+//                    without the type byte) each followed by its value
+//   TYPE_LIST:       a 32 bit count and that many values
+//
+// Counts have a fixed size so that a writer which only knows how many entries
+// a list or dictionary has once it has written them can fill them in then.
+// Values are nested at most kMaxValueWireDepth deep.
+const int kMaxValueWireDepth = 100;
+
+class CONTENT_EXPORT ValueWireWriter {
+ public:
+  // Appends values to |output|, which must outlive the writer.
+  explicit ValueWireWriter(std::string* output);
+  ~ValueWireWriter();
+
+  void WriteNull();
+  void WriteBoolean(bool value);
+  void WriteInteger(int value);
+  void WriteDouble(double value);
+  void WriteString(const char* data, size_t length);
+  void WriteBinary(const char* data, size_t length);
+
+  // Start a list or dictionary, and return what EndContainer() takes once its
+  // entries are written. A dictionary entry is a key followed by a value.
+  size_t BeginList();
+  size_t BeginDictionary();
+  void WriteKey(const char* data, size_t length);
+  void EndContainer(size_t container, uint32 count);
+
+  // Writes |value| and everything in it. Values nested deeper than
+  // kMaxValueWireDepth are written as null.
+  void WriteValue(const base::Value& value);
+
+  // Like WriteValue(), for a value which is itself nested |depth| deep, the
+  // top level being 1, in what is being written.
+  void WriteNestedValue(const base::Value& value, int depth);
+
+  // The amount written so far, which Truncate() can go back to.
+  size_t position() const { return output_->size() - start_; }
+  void Truncate(size_t position);
+
+  // Returns the type of the value written at |position|.
+  base::Value::Type GetTypeAt(size_t position) const;
+
+ private:
+  void WriteType(base::Value::Type type);
+  void WriteVarint(uint64 value);
+
+  std::string* output_;
+  const size_t start_;
+
+  DISALLOW_COPY_AND_ASSIGN(ValueWireWriter);
+};
+
+// Reads values written by ValueWireWriter, possibly by another process. Every
+// method returns false on malformed input.
+class CONTENT_EXPORT ValueWireReader {
+ public:
+  ValueWireReader(const char* data, size_t size);
+  ~ValueWireReader();
+
+  bool ReadType(base::Value::Type* type);
+  bool ReadBoolean(bool* value);
+  bool ReadInteger(int* value);
+  bool ReadDouble(double* value);
+
+  // Strings, binary values and keys are returned in place.
+  bool ReadString(const char** data, size_t* length);
+  bool ReadBinary(const char** data, size_t* length);
+  bool ReadKey(const char** data, size_t* length);
+
+  // Reads the count of the list or dictionary whose type was just read. Each
+  // entry takes at least one byte, so it is never more than RemainingBytes().
+  bool ReadCount(uint32* count);
+
+  // Reads a value and everything in it.
+  scoped_ptr<base::Value> ReadValue();
+
+  size_t RemainingBytes() const { return end_ - current_; }
+
+ private:
+  bool ReadVarint(uint64* value);
+  bool ReadBytes(size_t length, const char** data);
+  scoped_ptr<base::Value> ReadValueImpl(int depth);
+
+  const char* current_;
+  const char* const end_;
+
+  DISALLOW_COPY_AND_ASSIGN(ValueWireReader);
+};
+
+}  // namespace content
+
+#endif  // CONTENT_COMMON_VALUE_WIRE_FORMAT_H_
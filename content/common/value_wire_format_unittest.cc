@@ -0,0 +1,176 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "content/common/value_wire_format.h"
+
+#include <limits>
+
+#include "base/test/values_test_util.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace content {
+namespace {
+
+std::string Write(const base::Value& value) {
+  std::string wire;
+  ValueWireWriter writer(&wire);
+  writer.WriteValue(value);
+  return wire;
+}
+
+scoped_ptr<base::Value> Read(const std::string& wire) {
+  ValueWireReader reader(wire.data(), wire.size());
+  scoped_ptr<base::Value> value = reader.ReadValue();
+  if (reader.RemainingBytes())
+    return nullptr;
+  return value;
+}
+
+TEST(ValueWireFormatTest, RoundTrip) {
+  scoped_ptr<base::Value> original = base::test::ParseJson(
+      "{ \n"
+      "  \"null\": null, \n"
+      "  \"true\": true, \n"
+      "  \"false\": false, \n"
+      "  \"zero\": 0, \n"
+      "  \"negative-int\": -42, \n"
+      "  \"double\": 88.8, \n"
+      "  \"string\": \"foobar\", \n"
+      "  \"empty-string\": \"\", \n"
+      "  \"dictionary\": { \"foo.bar\": \"baz\" }, \n"
+      "  \"empty-dictionary\": {}, \n"
+      "  \"list\": [ 1, [ 2, [ 3 ] ], {} ], \n"
+      "  \"empty-list\": [], \n"
+      "}");
+  base::DictionaryValue* dictionary = NULL;
+  ASSERT_TRUE(original->GetAsDictionary(&dictionary));
+  dictionary->SetWithoutPathExpansion(
+      "binary", make_scoped_ptr(base::BinaryValue::CreateWithCopiedBuffer(
+                    "\0\1\2", 3)));
+
+  scoped_ptr<base::Value> copy = Read(Write(*original));
+  ASSERT_TRUE(copy);
+  EXPECT_TRUE(original->Equals(copy.get())) << *copy;
+}
+
+TEST(ValueWireFormatTest, Integers) {
+  const int kIntegers[] = {0, 1, -1, 63, -64, 64, 1 << 20,
+                           std::numeric_limits<int>::max(),
+                           std::numeric_limits<int>::min()};
+  for (size_t i = 0; i < arraysize(kIntegers); ++i) {
+    base::FundamentalValue value(kIntegers[i]);
+    std::string wire = Write(value);
+    // Small integers take two bytes.
+    if (kIntegers[i] >= -64 && kIntegers[i] < 64)
+      EXPECT_EQ(2u, wire.size());
+    scoped_ptr<base::Value> copy = Read(wire);
+    ASSERT_TRUE(copy);
+    EXPECT_TRUE(value.Equals(copy.get())) << kIntegers[i];
+  }
+}
+
+TEST(ValueWireFormatTest, CountsAreFilledInAfterwards) {
+  std::string wire;
+  ValueWireWriter writer(&wire);
+  size_t dictionary = writer.BeginDictionary();
+  writer.WriteKey("a", 1);
+  writer.WriteInteger(1);
+
+  // An entry which is written and then dropped again.
+  size_t entry = writer.position();
+  writer.WriteKey("b", 1);
+  size_t child = writer.position();
+  writer.WriteNull();
+  EXPECT_EQ(base::Value::TYPE_NULL, writer.GetTypeAt(child));
+  writer.Truncate(entry);
+
+  writer.WriteKey("c", 1);
+  size_t list = writer.BeginList();
+  writer.WriteString("d", 1);
+  writer.EndContainer(list, 1);
+  writer.EndContainer(dictionary, 2);
+
+  scoped_ptr<base::Value> value = Read(wire);
+  ASSERT_TRUE(value);
+  EXPECT_TRUE(
+      base::test::ParseJson("{ \"a\": 1, \"c\": [ \"d\" ] }")->Equals(
+          value.get()))
+      << *value;
+}
+
+TEST(ValueWireFormatTest, WriterAppends) {
+  std::string wire = "prefix";
+  ValueWireWriter writer(&wire);
+  EXPECT_EQ(0u, writer.position());
+  size_t list = writer.BeginList();
+  writer.WriteBoolean(true);
+  writer.EndContainer(list, 1);
+
+  ASSERT_EQ("prefix", wire.substr(0, 6));
+  scoped_ptr<base::Value> value = Read(wire.substr(6));
+  ASSERT_TRUE(value);
+  EXPECT_TRUE(base::test::ParseJson("[ true ]")->Equals(value.get()));
+}
+
+TEST(ValueWireFormatTest, MalformedInput) {
+  std::string wire = Write(*base::test::ParseJson(
+      "{ \"foo\": [ \"bar\", 1.5, 7, true, null ] }"));
+  // Every truncation is rejected.
+  for (size_t i = 0; i < wire.size(); ++i) {
+    ValueWireReader reader(wire.data(), i);
+    EXPECT_FALSE(reader.ReadValue()) << i;
+  }
+
+  // Unknown types.
+  EXPECT_FALSE(Read(std::string(1, '\x08')));
+  EXPECT_FALSE(Read(std::string(1, '\xff')));
+
+  // Booleans other than 0 and 1.
+  EXPECT_FALSE(Read(std::string("\x01\x02", 2)));
+
+  // Counts larger than what follows.
+  EXPECT_FALSE(Read(std::string("\x07\xff\xff\xff\x7f", 5)));
+  EXPECT_FALSE(Read(std::string("\x05\x80\x80\x80\x80\x80\x80\x80\x80\x80\x01",
+                                11)));
+}
+
+TEST(ValueWireFormatTest, MaxDepth) {
+  // A list in a list ... kMaxValueWireDepth deep is fine, one more isn't.
+  std::string wire;
+  ValueWireWriter writer(&wire);
+  for (int i = 0; i < kMaxValueWireDepth; ++i)
+    writer.BeginList();
+  for (int i = 0; i < kMaxValueWireDepth - 1; ++i)
+    writer.EndContainer(1 + 5 * i, 1);
+  EXPECT_TRUE(Read(wire));
+
+  wire.clear();
+  for (int i = 0; i < kMaxValueWireDepth + 1; ++i)
+    writer.BeginList();
+  for (int i = 0; i < kMaxValueWireDepth; ++i)
+    writer.EndContainer(1 + 5 * i, 1);
+  EXPECT_FALSE(Read(wire));
+
+  // The writer replaces values nested deeper with null.
+  scoped_ptr<base::ListValue> deep(new base::ListValue());
+  for (int i = 0; i < kMaxValueWireDepth; ++i) {
+    scoped_ptr<base::ListValue> outer(new base::ListValue());
+    outer->Append(deep.Pass());
+    deep = outer.Pass();
+  }
+  EXPECT_TRUE(Read(Write(*deep)));
+
+  // A value written inside a list counts the list's level too. What |deep|
+  // holds is kMaxValueWireDepth deep itself.
+  base::Value* inner = NULL;
+  ASSERT_TRUE(deep->Get(0, &inner));
+  wire.clear();
+  size_t list = writer.BeginList();
+  writer.WriteNestedValue(*inner, 2);
+  writer.EndContainer(list, 1);
+  EXPECT_TRUE(Read(wire));
+}
+
+}  // namespace
+}  // namespace content
@@ -0,0 +1,99 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "content/common/websocket_frame_buffers.h"
+
+#include <algorithm>
+
+#include "base/logging.h"
+#include "base/memory/shared_memory.h"
+
+namespace content {
+
+const size_t WebSocketFrameBufferPool::kMinFrameSize = 16 * 1024;
+const size_t WebSocketFrameBufferPool::kMinBufferSize = 64 * 1024;
+const size_t WebSocketFrameBufferPool::kMaxBufferSize = 4 * 1024 * 1024;
+const size_t WebSocketFrameBufferPool::kMaxBuffers = 4;
+
+WebSocketFrameBufferPool::WebSocketFrameBufferPool() {}
+
+WebSocketFrameBufferPool::~WebSocketFrameBufferPool() {}
+
+int WebSocketFrameBufferPool::TakeFreeBuffer(size_t size) {
+  // The smallest buffer that will do, to leave the larger ones for larger
+  // frames.
+  int best = -1;
+  for (size_t i = 0; i < buffers_.size(); ++i) {
+    if (in_use_[i] || buffers_[i]->mapped_size() < size)
+      continue;
+    if (best < 0 || buffers_[i]->mapped_size() < buffers_[best]->mapped_size())
+      best = static_cast<int>(i);
+  }
+  if (best >= 0)
+    in_use_[best] = true;
+  return best;
+}
+
+size_t WebSocketFrameBufferPool::GetNewBufferSize(size_t frame_size) const {
+  if (frame_size > kMaxBufferSize || buffers_.size() >= kMaxBuffers)
+    return 0;
+  size_t size = kMinBufferSize;
+  while (size < frame_size)
+    size *= 2;
+  return std::min(size, kMaxBufferSize);
+}
+
+int WebSocketFrameBufferPool::AddBuffer(scoped_ptr<base::SharedMemory> memory) {
+  DCHECK_LT(buffers_.size(), kMaxBuffers);
+  DCHECK(memory->memory());
+  buffers_.push_back(memory.Pass());
+  in_use_.push_back(true);
+  return static_cast<int>(buffers_.size() - 1);
+}
+
+char* WebSocketFrameBufferPool::GetFrameMemory(int buffer_id) {
+  DCHECK_GE(buffer_id, 0);
+  DCHECK_LT(static_cast<size_t>(buffer_id), buffers_.size());
+  DCHECK(in_use_[buffer_id]);
+  return static_cast<char*>(buffers_[buffer_id]->memory());
+}
+
+bool WebSocketFrameBufferPool::ReleaseBuffer(int buffer_id) {
+  if (buffer_id < 0 || static_cast<size_t>(buffer_id) >= buffers_.size() ||
+      !in_use_[buffer_id]) {
+    return false;
+  }
+  in_use_[buffer_id] = false;
+  return true;
+}
+
+WebSocketReceivedFrameBuffers::WebSocketReceivedFrameBuffers() {}
+
+WebSocketReceivedFrameBuffers::~WebSocketReceivedFrameBuffers() {}
+
+bool WebSocketReceivedFrameBuffers::AddBuffer(
+    int buffer_id,
+    scoped_ptr<base::SharedMemory> memory,
+    size_t size) {
+  if (buffer_id < 0 || static_cast<size_t>(buffer_id) != buffers_.size() ||
+      buffers_.size() >= WebSocketFrameBufferPool::kMaxBuffers || size == 0 ||
+      size > WebSocketFrameBufferPool::kMaxBufferSize) {
+    return false;
+  }
+  if (!memory->Map(size))
+    return false;
+  buffers_.push_back(memory.Pass());
+  return true;
+}
+
+const char* WebSocketReceivedFrameBuffers::GetFrameData(int buffer_id,
+                                                        size_t size) const {
+  if (buffer_id < 0 || static_cast<size_t>(buffer_id) >= buffers_.size() ||
+      size > buffers_[buffer_id]->mapped_size()) {
+    return NULL;
+  }
+  return static_cast<const char*>(buffers_[buffer_id]->memory());
+}
+
+}  // namespace content
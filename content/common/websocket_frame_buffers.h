@@ -0,0 +1,92 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CONTENT_COMMON_WEBSOCKET_FRAME_BUFFERS_H_
+#define CONTENT_COMMON_WEBSOCKET_FRAME_BUFFERS_H_
+
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/memory/scoped_vector.h"
+#include "content/common/content_export.h"
+
+namespace base {
+class SharedMemory;
+}
+
+namespace content {
+
+// Large WebSocket frames are passed between the renderer and the browser in
+// shared memory buffers rather than in WebSocketMsg_SendFrame, which would
+// copy them into and out of the IPC channel. The sender of frames owns the
+// buffers: it shares each one with the receiver once
+// (WebSocketMsg_AddFrameBuffer), and puts a frame in it again once the
+// receiver is done with the previous one (WebSocketMsg_FrameBufferAck).
+//
+// WebSocketFrameBufferPool keeps the buffers on the sending side of a channel.
+class CONTENT_EXPORT WebSocketFrameBufferPool {
+ public:
+  // Frames of at least this many bytes are sent in buffers.
+  static const size_t kMinFrameSize;
+  // Bounds on the size of each buffer and on their number, per channel and
+  // direction. Frames which don't fit are sent in WebSocketMsg_SendFrame.
+  static const size_t kMinBufferSize;
+  static const size_t kMaxBufferSize;
+  static const size_t kMaxBuffers;
+
+  WebSocketFrameBufferPool();
+  ~WebSocketFrameBufferPool();
+
+  // Returns the id of a free buffer with room for |size| bytes, which is now
+  // in use, or -1 if there is none.
+  int TakeFreeBuffer(size_t size);
+
+  // Returns the size a new buffer for a frame of |frame_size| bytes should
+  // have, or 0 if no buffer may be added for it.
+  size_t GetNewBufferSize(size_t frame_size) const;
+
+  // Adds |memory|, which is mapped, as a new buffer which is in use, and
+  // returns its id.
+  int AddBuffer(scoped_ptr<base::SharedMemory> memory);
+
+  // Returns where the frame goes in the buffer |buffer_id|, which is in use.
+  char* GetFrameMemory(int buffer_id);
+
+  // Returns the buffer |buffer_id| to the pool once the receiver is done with
+  // the frame in it. Returns false if it isn't in use.
+  bool ReleaseBuffer(int buffer_id);
+
+ private:
+  ScopedVector<base::SharedMemory> buffers_;
+  std::vector<bool> in_use_;
+
+  DISALLOW_COPY_AND_ASSIGN(WebSocketFrameBufferPool);
+};
+
+// The buffers a WebSocketFrameBufferPool on the other side has shared.
+class CONTENT_EXPORT WebSocketReceivedFrameBuffers {
+ public:
+  WebSocketReceivedFrameBuffers();
+  ~WebSocketReceivedFrameBuffers();
+
+  // Maps |memory| as the buffer |buffer_id| of |size| bytes. Returns false if
+  // that isn't the buffer the pool would add next or it can't be mapped.
+  bool AddBuffer(int buffer_id,
+                 scoped_ptr<base::SharedMemory> memory,
+                 size_t size);
+
+  // Returns the data of a frame of |size| bytes in the buffer |buffer_id|, or
+  // NULL if there can't be one.
+  const char* GetFrameData(int buffer_id, size_t size) const;
+
+ private:
+  ScopedVector<base::SharedMemory> buffers_;
+
+  DISALLOW_COPY_AND_ASSIGN(WebSocketReceivedFrameBuffers);
+};
+
+}  // namespace content
+
+#endif  // CONTENT_COMMON_WEBSOCKET_FRAME_BUFFERS_H_
@@ -0,0 +1,128 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "content/common/websocket_frame_buffers.h"
+
+#include <string.h>
+
+#include <vector>
+
+#include "base/memory/shared_memory.h"
+#include "base/process/process_handle.h"
+#include "base/time/time.h"
+#include "content/common/websocket_messages.h"
+#include "ipc/ipc_message.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_test.h"
+
+namespace content {
+namespace {
+
+const int kTimeLimitMs = 2000;
+const int kTimeCheckInterval = 10;
+const int kRoutingId = 1;
+
+// Loops a frame of |frame_size| bytes back from a sender to a receiver on this
+// thread, in WebSocketMsg_SendFrame or in a shared memory buffer, and reports
+// the time spent per MB. The receiver copies the frame out the way
+// WebSocketHost does for net::WebSocketChannel.
+class WebSocketFrameBuffersPerfTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    size_t size =
+        pool_.GetNewBufferSize(WebSocketFrameBufferPool::kMaxBufferSize);
+    scoped_ptr<base::SharedMemory> memory(new base::SharedMemory);
+    ASSERT_TRUE(memory->CreateAndMapAnonymous(size));
+    base::SharedMemoryHandle handle;
+    ASSERT_TRUE(
+        memory->ShareToProcess(base::GetCurrentProcessHandle(), &handle));
+    int buffer_id = pool_.AddBuffer(memory.Pass());
+    ASSERT_TRUE(received_.AddBuffer(
+        buffer_id, make_scoped_ptr(new base::SharedMemory(handle, true)),
+        size));
+    ASSERT_TRUE(pool_.ReleaseBuffer(buffer_id));
+  }
+
+  void SendInMessage(const std::vector<char>& frame,
+                     std::vector<char>* received) {
+    WebSocketMsg_SendFrame message(kRoutingId, true,
+                                   WEB_SOCKET_MESSAGE_TYPE_BINARY, frame);
+    WebSocketMsg_SendFrame::Param param;
+    ASSERT_TRUE(WebSocketMsg_SendFrame::Read(&message, &param));
+    received->swap(base::get<2>(param));
+  }
+
+  void SendInBuffer(const std::vector<char>& frame,
+                    std::vector<char>* received) {
+    int buffer_id = pool_.TakeFreeBuffer(frame.size());
+    ASSERT_LE(0, buffer_id);
+    memcpy(pool_.GetFrameMemory(buffer_id), &frame[0], frame.size());
+    WebSocketMsg_SendFrameInBuffer message(
+        kRoutingId, true, WEB_SOCKET_MESSAGE_TYPE_BINARY, buffer_id,
+        static_cast<uint32>(frame.size()));
+
+    WebSocketMsg_SendFrameInBuffer::Param param;
+    ASSERT_TRUE(WebSocketMsg_SendFrameInBuffer::Read(&message, &param));
+    const char* data = received_.GetFrameData(base::get<2>(param),
+                                              base::get<3>(param));
+    ASSERT_TRUE(data);
+    received->assign(data, data + base::get<3>(param));
+    // The ack is part of the cost of the buffer path.
+    WebSocketMsg_FrameBufferAck ack(kRoutingId, buffer_id);
+    WebSocketMsg_FrameBufferAck::Param ack_param;
+    ASSERT_TRUE(WebSocketMsg_FrameBufferAck::Read(&ack, &ack_param));
+    ASSERT_TRUE(pool_.ReleaseBuffer(buffer_id));
+  }
+
+  void RunTest(const std::string& test_name,
+               size_t frame_size,
+               bool in_buffer) {
+    std::vector<char> frame(frame_size, 'x');
+    std::vector<char> received;
+    int64 bytes = 0;
+    base::TimeTicks start = base::TimeTicks::Now();
+    base::TimeTicks end =
+        start + base::TimeDelta::FromMilliseconds(kTimeLimitMs);
+    base::TimeTicks now;
+    do {
+      for (int i = 0; i < kTimeCheckInterval; ++i) {
+        if (in_buffer)
+          SendInBuffer(frame, &received);
+        else
+          SendInMessage(frame, &received);
+        ASSERT_EQ(frame_size, received.size());
+        bytes += frame_size;
+      }
+      now = base::TimeTicks::Now();
+    } while (now < end);
+
+    double megabytes = bytes / (1024.0 * 1024.0);
+    perf_test::PrintResult("websocket_frame_loopback", "", test_name,
+                           (now - start).InMicrosecondsF() / megabytes,
+                           "us/MB", true);
+  }
+
+ private:
+  WebSocketFrameBufferPool pool_;
+  WebSocketReceivedFrameBuffers received_;
+};
+
+TEST_F(WebSocketFrameBuffersPerfTest, Message64KB) {
+  RunTest("message_64KB", 64 * 1024, false);
+}
+
+TEST_F(WebSocketFrameBuffersPerfTest, Buffer64KB) {
+  RunTest("buffer_64KB", 64 * 1024, true);
+}
+
+TEST_F(WebSocketFrameBuffersPerfTest, Message1MB) {
+  RunTest("message_1MB", 1024 * 1024, false);
+}
+
+TEST_F(WebSocketFrameBuffersPerfTest, Buffer1MB) {
+  RunTest("buffer_1MB", 1024 * 1024, true);
+}
+
+}  // namespace
+}  // namespace content
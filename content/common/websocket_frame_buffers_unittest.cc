@@ -0,0 +1,118 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "content/common/websocket_frame_buffers.h"
+
+#include <string.h>
+
+#include "base/memory/shared_memory.h"
+#include "base/process/process_handle.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace content {
+namespace {
+
+scoped_ptr<base::SharedMemory> CreateBuffer(size_t size) {
+  scoped_ptr<base::SharedMemory> memory(new base::SharedMemory);
+  EXPECT_TRUE(memory->CreateAndMapAnonymous(size));
+  return memory.Pass();
+}
+
+// Shares |memory| the way it would be shared with another process.
+scoped_ptr<base::SharedMemory> ShareBuffer(base::SharedMemory* memory) {
+  base::SharedMemoryHandle handle;
+  EXPECT_TRUE(
+      memory->ShareToProcess(base::GetCurrentProcessHandle(), &handle));
+  return make_scoped_ptr(new base::SharedMemory(handle, true));
+}
+
+TEST(WebSocketFrameBufferPoolTest, NewBufferSize) {
+  WebSocketFrameBufferPool pool;
+  EXPECT_EQ(WebSocketFrameBufferPool::kMinBufferSize,
+            pool.GetNewBufferSize(WebSocketFrameBufferPool::kMinFrameSize));
+  EXPECT_EQ(128u * 1024, pool.GetNewBufferSize(64 * 1024 + 1));
+  EXPECT_EQ(WebSocketFrameBufferPool::kMaxBufferSize,
+            pool.GetNewBufferSize(WebSocketFrameBufferPool::kMaxBufferSize));
+  EXPECT_EQ(0u, pool.GetNewBufferSize(
+                    WebSocketFrameBufferPool::kMaxBufferSize + 1));
+}
+
+TEST(WebSocketFrameBufferPoolTest, BuffersAreReused) {
+  WebSocketFrameBufferPool pool;
+  EXPECT_EQ(-1, pool.TakeFreeBuffer(1000));
+
+  size_t size = pool.GetNewBufferSize(100000);
+  EXPECT_EQ(0, pool.AddBuffer(CreateBuffer(size)));
+  // Buffers are in use when added, until the receiver acks the frame.
+  EXPECT_EQ(-1, pool.TakeFreeBuffer(1000));
+  EXPECT_TRUE(pool.ReleaseBuffer(0));
+  EXPECT_FALSE(pool.ReleaseBuffer(0));
+  EXPECT_FALSE(pool.ReleaseBuffer(1));
+  EXPECT_FALSE(pool.ReleaseBuffer(-1));
+
+  EXPECT_EQ(-1, pool.TakeFreeBuffer(size + 1));
+  EXPECT_EQ(0, pool.TakeFreeBuffer(size));
+  EXPECT_EQ(-1, pool.TakeFreeBuffer(1000));
+}
+
+TEST(WebSocketFrameBufferPoolTest, SmallestFreeBufferIsTaken) {
+  WebSocketFrameBufferPool pool;
+  EXPECT_EQ(0, pool.AddBuffer(CreateBuffer(1024 * 1024)));
+  EXPECT_EQ(1, pool.AddBuffer(CreateBuffer(64 * 1024)));
+  EXPECT_TRUE(pool.ReleaseBuffer(0));
+  EXPECT_TRUE(pool.ReleaseBuffer(1));
+
+  EXPECT_EQ(1, pool.TakeFreeBuffer(20000));
+  EXPECT_EQ(0, pool.TakeFreeBuffer(20000));
+}
+
+TEST(WebSocketFrameBufferPoolTest, NumberOfBuffersIsLimited) {
+  WebSocketFrameBufferPool pool;
+  for (size_t i = 0; i < WebSocketFrameBufferPool::kMaxBuffers; ++i) {
+    size_t size =
+        pool.GetNewBufferSize(WebSocketFrameBufferPool::kMinFrameSize);
+    ASSERT_NE(0u, size);
+    EXPECT_EQ(static_cast<int>(i), pool.AddBuffer(CreateBuffer(size)));
+  }
+  EXPECT_EQ(0u,
+            pool.GetNewBufferSize(WebSocketFrameBufferPool::kMinFrameSize));
+}
+
+TEST(WebSocketReceivedFrameBuffersTest, FrameDataIsShared) {
+  WebSocketFrameBufferPool pool;
+  WebSocketReceivedFrameBuffers received;
+  size_t size = pool.GetNewBufferSize(WebSocketFrameBufferPool::kMinFrameSize);
+  scoped_ptr<base::SharedMemory> memory = CreateBuffer(size);
+  scoped_ptr<base::SharedMemory> shared = ShareBuffer(memory.get());
+  int buffer_id = pool.AddBuffer(memory.Pass());
+  ASSERT_TRUE(received.AddBuffer(buffer_id, shared.Pass(), size));
+
+  memcpy(pool.GetFrameMemory(buffer_id), "frame", 5);
+  const char* data = received.GetFrameData(buffer_id, 5);
+  ASSERT_TRUE(data);
+  EXPECT_EQ(0, memcmp("frame", data, 5));
+}
+
+TEST(WebSocketReceivedFrameBuffersTest, InvalidBuffersAreRejected) {
+  WebSocketReceivedFrameBuffers received;
+  size_t size = WebSocketFrameBufferPool::kMinBufferSize;
+  scoped_ptr<base::SharedMemory> memory = CreateBuffer(size);
+
+  // Buffers must be added in order.
+  EXPECT_FALSE(received.AddBuffer(1, ShareBuffer(memory.get()), size));
+  EXPECT_FALSE(received.AddBuffer(-1, ShareBuffer(memory.get()), size));
+  EXPECT_FALSE(received.AddBuffer(0, ShareBuffer(memory.get()), 0));
+  EXPECT_FALSE(received.AddBuffer(
+      0, ShareBuffer(memory.get()),
+      WebSocketFrameBufferPool::kMaxBufferSize + 1));
+  EXPECT_TRUE(received.AddBuffer(0, ShareBuffer(memory.get()), size));
+
+  EXPECT_TRUE(received.GetFrameData(0, size));
+  EXPECT_FALSE(received.GetFrameData(0, size + 1));
+  EXPECT_FALSE(received.GetFrameData(1, 1));
+  EXPECT_FALSE(received.GetFrameData(-1, 1));
+}
+
+}  // namespace
+}  // namespace content
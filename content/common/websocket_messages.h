@@ -32,6 +32,7 @@
 #include <vector>
 
 #include "base/basictypes.h"
+#include "base/memory/shared_memory.h"
 #include "content/common/content_export.h"
 #include "content/common/websocket.h"
 #include "ipc/ipc_message_macros.h"
@@ -129,6 +130,28 @@ IPC_MESSAGE_ROUTED3(WebSocketMsg_SendFrame,
                     content::WebSocketMessageType /* type */,
                     std::vector<char> /* data */)
 
+// Share a shared memory buffer of |size| bytes which frames will be sent in,
+// under |buffer_id|. Buffers are numbered from 0 in the order they are added.
+// See content/common/websocket_frame_buffers.h.
+IPC_MESSAGE_ROUTED3(WebSocketMsg_AddFrameBuffer,
+                    int /* buffer_id */,
+                    base::SharedMemoryHandle /* handle */,
+                    uint32 /* size */)
+
+// The same as SendFrame, for a frame whose |size| bytes of data are at the
+// start of the buffer |buffer_id|. The receiver must reply with
+// FrameBufferAck once it is done with the data.
+IPC_MESSAGE_ROUTED4(WebSocketMsg_SendFrameInBuffer,
+                    bool /* fin */,
+                    content::WebSocketMessageType /* type */,
+                    int /* buffer_id */,
+                    uint32 /* size */)
+
+// The receiver of the frame in |buffer_id| is done with it, so that the sender
+// may put another one there.
+IPC_MESSAGE_ROUTED1(WebSocketMsg_FrameBufferAck,
+                    int /* buffer_id */)
+
 // Add |quota| tokens of send quota for the channel. |quota| must be a positive
 // integer. Both the browser and the renderer set send quota for the other
 // side, and check that quota has not been exceeded when receiving messages.
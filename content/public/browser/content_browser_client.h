@@ -568,6 +568,11 @@ class CONTENT_EXPORT ContentBrowserClient {
   // Returns the path to the browser shader disk cache root.
   virtual base::FilePath GetShaderDiskCacheDirectory();
 
+  // Returns the file in which the results of scanning plugin libraries are
+  // kept between runs, or an empty path to only keep them in memory. Only
+  // used on POSIX systems. This is called on the IO thread.
+  virtual base::FilePath GetPluginScanCacheFile();
+
   // Notification that a pepper plugin has just been spawned. This allows the
   // embedder to add filters onto the host to implement interfaces.
   // This is called on the IO thread.
@@ -58,6 +58,10 @@ bool DeviceLightEventPump::ShouldFireEvent(double lux) const {
   return lux != last_seen_data_;
 }
 
+bool DeviceLightEventPump::HasNewData() {
+  return reader_->HasNewData();
+}
+
 bool DeviceLightEventPump::InitializeReader(base::SharedMemoryHandle handle) {
   if (!reader_)
     reader_.reset(new DeviceLightSharedMemoryReader());
@@ -36,6 +36,7 @@ class CONTENT_EXPORT DeviceLightEventPump
  protected:
   // Methods overriden from base class DeviceSensorEventPump
   void FireEvent() override;
+  bool HasNewData() override;
   bool InitializeReader(base::SharedMemoryHandle handle) override;
 
   // PlatformEventObserver implementation.
@@ -34,6 +34,10 @@ void DeviceMotionEventPump::FireEvent() {
     listener()->didChangeDeviceMotion(data);
 }
 
+bool DeviceMotionEventPump::HasNewData() {
+  return reader_->HasNewData();
+}
+
 bool DeviceMotionEventPump::InitializeReader(base::SharedMemoryHandle handle) {
   if (!reader_)
     reader_.reset(new DeviceMotionSharedMemoryReader());
@@ -31,6 +31,7 @@ class CONTENT_EXPORT DeviceMotionEventPump
 
  protected:
   void FireEvent() override;
+  bool HasNewData() override;
   bool InitializeReader(base::SharedMemoryHandle handle) override;
 
   // PlatformEventObserver.
@@ -9,6 +9,7 @@
 #include "base/memory/scoped_ptr.h"
 #include "base/single_thread_task_runner.h"
 #include "base/thread_task_runner_handle.h"
+#include "base/time/time.h"
 #include "content/common/device_sensors/device_motion_hardware_buffer.h"
 #include "content/public/test/test_utils.h"
 #include "testing/gtest/include/gtest/gtest.h"
@@ -28,6 +29,7 @@ class MockDeviceMotionListener : public blink::WebDeviceMotionListener {
     memcpy(&data_, &data, sizeof(data));
     did_change_device_motion_ = true;
     ++number_of_events_;
+    last_event_time_ = base::TimeTicks::Now();
   }
 
   bool did_change_device_motion() const {
@@ -36,6 +38,8 @@ class MockDeviceMotionListener : public blink::WebDeviceMotionListener {
 
   int number_of_events() const { return number_of_events_; }
 
+  base::TimeTicks last_event_time() const { return last_event_time_; }
+
   const blink::WebDeviceMotionData& data() const {
     return data_;
   }
@@ -43,6 +47,7 @@ class MockDeviceMotionListener : public blink::WebDeviceMotionListener {
  private:
   bool did_change_device_motion_;
   int number_of_events_;
+  base::TimeTicks last_event_time_;
   blink::WebDeviceMotionData data_;
 
   DISALLOW_COPY_AND_ASSIGN(MockDeviceMotionListener);
@@ -51,7 +56,7 @@ class MockDeviceMotionListener : public blink::WebDeviceMotionListener {
 class DeviceMotionEventPumpForTesting : public DeviceMotionEventPump {
  public:
   DeviceMotionEventPumpForTesting()
-      : DeviceMotionEventPump(0), stop_on_fire_event_(true) {}
+      : DeviceMotionEventPump(0), stop_on_fire_event_(true), polls_(0) {}
   ~DeviceMotionEventPumpForTesting() override {}
 
   void set_stop_on_fire_event(bool stop_on_fire_event) {
@@ -61,6 +66,10 @@ class DeviceMotionEventPumpForTesting : public DeviceMotionEventPump {
   bool stop_on_fire_event() { return stop_on_fire_event_; }
 
   int pump_delay_microseconds() const { return pump_delay_microseconds_; }
+  int64 current_delay_microseconds() const {
+    return timer_.GetCurrentDelay().InMicroseconds();
+  }
+  int polls() const { return polls_; }
 
   void OnDidStart(base::SharedMemoryHandle renderer_handle) {
     DeviceMotionEventPump::OnDidStart(renderer_handle);
@@ -74,9 +83,14 @@ class DeviceMotionEventPumpForTesting : public DeviceMotionEventPump {
       base::MessageLoop::current()->QuitWhenIdle();
     }
   }
+  bool HasNewData() override {
+    ++polls_;
+    return DeviceMotionEventPump::HasNewData();
+  }
 
  private:
   bool stop_on_fire_event_;
+  int polls_;
 
   DISALLOW_COPY_AND_ASSIGN(DeviceMotionEventPumpForTesting);
 };
@@ -111,6 +125,13 @@ class DeviceMotionEventPumpTest : public testing::Test {
     data.allAvailableSensorsAreActive = allAvailableSensorsActive;
   }
 
+  // Writes the way the browser does.
+  void UpdateBuffer(double acceleration_x) {
+    buffer_->seqlock.WriteBegin();
+    buffer_->data.accelerationX = acceleration_x;
+    buffer_->seqlock.WriteEnd();
+  }
+
   MockDeviceMotionListener* listener() { return listener_.get(); }
   DeviceMotionEventPumpForTesting* motion_pump() { return motion_pump_.get(); }
   base::SharedMemoryHandle handle() { return handle_; }
@@ -204,4 +225,50 @@ TEST_F(DeviceMotionEventPumpTest, PumpThrottlesEventRate) {
   EXPECT_GE(6, listener()->number_of_events());
 }
 
+// While the browser writes nothing new, the pump neither fires events nor
+// keeps polling at its full rate. Once it does, the data is delivered and the
+// full rate is back.
+TEST_F(DeviceMotionEventPumpTest, PumpBacksOffWhileDataIsUnchanged) {
+  base::MessageLoopForUI loop;
+
+  InitBuffer(true);
+
+  motion_pump()->set_stop_on_fire_event(false);
+  motion_pump()->Start(listener());
+  motion_pump()->OnDidStart(handle());
+
+  const int kIdleMilliseconds = 600;
+  base::ThreadTaskRunnerHandle::Get()->PostDelayedTask(
+      FROM_HERE, base::MessageLoop::QuitWhenIdleClosure(),
+      base::TimeDelta::FromMilliseconds(kIdleMilliseconds));
+  base::MessageLoop::current()->Run();
+
+  EXPECT_EQ(1, listener()->number_of_events());
+  int full_rate_polls = kIdleMilliseconds * 1000 /
+                        motion_pump()->pump_delay_microseconds();
+  EXPECT_LT(motion_pump()->polls(), full_rate_polls / 2);
+  const int64 max_delay_microseconds =
+      DeviceMotionEventPump::kMaxPumpBackoffFactor *
+      motion_pump()->pump_delay_microseconds();
+  EXPECT_EQ(max_delay_microseconds,
+            motion_pump()->current_delay_microseconds());
+
+  base::TimeTicks write_time = base::TimeTicks::Now();
+  UpdateBuffer(4);
+  base::ThreadTaskRunnerHandle::Get()->PostDelayedTask(
+      FROM_HERE, base::MessageLoop::QuitWhenIdleClosure(),
+      base::TimeDelta::FromMilliseconds(200));
+  base::MessageLoop::current()->Run();
+  motion_pump()->Stop();
+
+  EXPECT_EQ(2, listener()->number_of_events());
+  EXPECT_EQ(4, static_cast<double>(listener()->data().accelerationX));
+  // The update waits for one poll at the lowest rate at most. Allow for slow
+  // bots on top of that.
+  EXPECT_LE((listener()->last_event_time() - write_time).InMicroseconds(),
+            max_delay_microseconds + 100000);
+  EXPECT_EQ(motion_pump()->pump_delay_microseconds(),
+            motion_pump()->current_delay_microseconds());
+}
+
 }  // namespace content
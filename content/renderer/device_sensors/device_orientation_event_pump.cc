@@ -66,6 +66,10 @@ bool DeviceOrientationEventPump::ShouldFireEvent(
              data_.hasGamma, data_.gamma, data.hasGamma, data.gamma);
 }
 
+bool DeviceOrientationEventPump::HasNewData() {
+  return reader_->HasNewData();
+}
+
 bool DeviceOrientationEventPump::InitializeReader(
     base::SharedMemoryHandle handle) {
   memset(&data_, 0, sizeof(data_));
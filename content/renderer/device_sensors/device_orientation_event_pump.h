@@ -35,6 +35,7 @@ class CONTENT_EXPORT DeviceOrientationEventPump
 
  protected:
   void FireEvent() override;
+  bool HasNewData() override;
   bool InitializeReader(base::SharedMemoryHandle handle) override;
 
   // PlatformEventObserver.
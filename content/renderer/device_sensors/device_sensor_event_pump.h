@@ -5,6 +5,8 @@
 #ifndef CONTENT_RENDERER_DEVICE_SENSORS_DEVICE_SENSOR_EVENT_PUMP_H_
 #define CONTENT_RENDERER_DEVICE_SENSORS_DEVICE_SENSOR_EVENT_PUMP_H_
 
+#include <algorithm>
+
 #include "base/memory/shared_memory.h"
 #include "base/time/time.h"
 #include "base/timer/timer.h"
@@ -21,6 +23,12 @@ class CONTENT_EXPORT DeviceSensorEventPump
   static const int kDefaultPumpDelayMicroseconds =
       base::Time::kMicrosecondsPerSecond / kDefaultPumpFrequencyHz;
 
+  // While the browser doesn't write new data, the pump halves its rate after
+  // every kIdlePollsBeforeBackoff polls, down to 1/kMaxPumpBackoffFactor of
+  // the rate above.
+  static const int kIdlePollsBeforeBackoff = 5;
+  static const int kMaxPumpBackoffFactor = 4;
+
   // PlatformEventObserver
   void Start(blink::WebPlatformEventListener* listener) override {
     DVLOG(2) << "requested start";
@@ -53,6 +61,7 @@ class CONTENT_EXPORT DeviceSensorEventPump
   explicit DeviceSensorEventPump(RenderThread* thread)
       : PlatformEventObserver<ListenerType>(thread),
         pump_delay_microseconds_(kDefaultPumpDelayMicroseconds),
+        idle_polls_(0),
         state_(STOPPED) {}
 
   ~DeviceSensorEventPump() override {
@@ -79,18 +88,46 @@ class CONTENT_EXPORT DeviceSensorEventPump
     DCHECK(!timer_.IsRunning());
 
     if (InitializeReader(handle)) {
-      timer_.Start(FROM_HERE,
-                   base::TimeDelta::FromMicroseconds(pump_delay_microseconds_),
-                   this,
-                   &DeviceSensorEventPump::FireEvent);
+      idle_polls_ = 0;
+      StartTimer(pump_delay_microseconds_);
       state_ = RUNNING;
     }
   }
 
+  // Fires an event if the browser has written to the shared memory buffer
+  // since the last one, and otherwise slows the pump down.
+  void Poll() {
+    if (HasNewData()) {
+      idle_polls_ = 0;
+      if (timer_.GetCurrentDelay().InMicroseconds() != pump_delay_microseconds_)
+        StartTimer(pump_delay_microseconds_);
+      FireEvent();
+      return;
+    }
+
+    if (++idle_polls_ < kIdlePollsBeforeBackoff)
+      return;
+    idle_polls_ = 0;
+    int delay_microseconds = static_cast<int>(std::min<int64>(
+        2 * timer_.GetCurrentDelay().InMicroseconds(),
+        kMaxPumpBackoffFactor * pump_delay_microseconds_));
+    if (delay_microseconds != timer_.GetCurrentDelay().InMicroseconds())
+      StartTimer(delay_microseconds);
+  }
+
+  void StartTimer(int delay_microseconds) {
+    timer_.Start(FROM_HERE,
+                 base::TimeDelta::FromMicroseconds(delay_microseconds),
+                 this,
+                 &DeviceSensorEventPump::Poll);
+  }
+
   virtual void FireEvent() = 0;
+  virtual bool HasNewData() = 0;
   virtual bool InitializeReader(base::SharedMemoryHandle handle) = 0;
 
   int pump_delay_microseconds_;
+  int idle_polls_;
   PumpState state_;
   base::RepeatingTimer timer_;
 
@@ -4,6 +4,9 @@
 
 #include "content/renderer/media/media_stream_audio_processor.h"
 
+#include <algorithm>
+#include <cstring>
+
 #include "base/command_line.h"
 #include "base/metrics/field_trial.h"
 #include "base/metrics/histogram.h"
@@ -15,7 +18,6 @@
 #include "content/renderer/media/webrtc_audio_device_impl.h"
 #include "media/audio/audio_parameters.h"
 #include "media/base/audio_converter.h"
-#include "media/base/audio_fifo.h"
 #include "media/base/channel_layout.h"
 #include "third_party/WebKit/public/platform/WebMediaConstraints.h"
 #include "third_party/libjingle/source/talk/app/webrtc/mediaconstraintsinterface.h"
@@ -137,6 +139,14 @@ class MediaStreamAudioBus {
     thread_checker_.DetachFromThread();
   }
 
+  // Creates a bus which wraps memory owned by someone else, set with
+  // bus()->SetChannelData().
+  explicit MediaStreamAudioBus(int channels)
+      : bus_(media::AudioBus::CreateWrapper(channels)),
+        channel_ptrs_(new float*[channels]) {
+    thread_checker_.DetachFromThread();
+  }
+
   media::AudioBus* bus() {
     DCHECK(thread_checker_.CalledOnValidThread());
     return bus_.get();
@@ -156,11 +166,21 @@ class MediaStreamAudioBus {
   scoped_ptr<float*[]> channel_ptrs_;
 };
 
-// Wraps AudioFifo to provide a cleaner interface to MediaStreamAudioProcessor.
-// It avoids the FIFO when the source and destination frames match. All methods
-// are called on one of the capture or render audio threads exclusively. If
-// |source_channels| is larger than |destination_channels|, only the first
-// |destination_channels| are kept from the source.
+// Rebuffers audio into chunks of |destination_frames| for
+// MediaStreamAudioProcessor, without copying any more than it has to. All
+// methods are called on one of the capture or render audio threads
+// exclusively. If |source_channels| is larger than |destination_channels|, only
+// the first |destination_channels| are kept from the source.
+//
+// When the source and destination frames match, Consume() hands out a view of
+// the bus given to Push(), which therefore must stay valid and unchanged until
+// Consume() returns false. Otherwise, Push() copies the source into a ring, and
+// Consume() hands out views of the ring. The first |destination_frames| of the
+// ring are mirrored past its end, so that every chunk is contiguous, however
+// the ring is wrapped. A chunk which doesn't start on a channel alignment
+// boundary of the ring is copied out, since AudioBus and the SIMD code which
+// processes it need aligned channels. Either way, the chunk handed out is valid
+// until the next call to Push().
 class MediaStreamAudioFifo {
  public:
   MediaStreamAudioFifo(int source_channels,
@@ -170,25 +190,26 @@ class MediaStreamAudioFifo {
                        int sample_rate)
      : source_channels_(source_channels),
        source_frames_(source_frames),
+       destination_frames_(destination_frames),
        sample_rate_(sample_rate),
-       destination_(
-           new MediaStreamAudioBus(destination_channels, destination_frames)),
-       data_available_(false) {
+       destination_(new MediaStreamAudioBus(destination_channels)),
+       ring_frames_(0),
+       read_position_(0),
+       write_position_(0),
+       frames_available_(0) {
     DCHECK_GE(source_channels, destination_channels);
     DCHECK_GE(sample_rate_, 8000);
     DCHECK_LE(sample_rate_, 48000);
 
-    if (source_channels > destination_channels) {
-      audio_source_intermediate_ =
-          media::AudioBus::CreateWrapper(destination_channels);
-    }
-
     if (source_frames != destination_frames) {
       // Since we require every Push to be followed by as many Consumes as
       // possible, twice the larger of the two is a (probably) loose upper bound
-      // on the FIFO size.
-      const int fifo_frames = 2 * std::max(source_frames, destination_frames);
-      fifo_.reset(new media::AudioFifo(destination_channels, fifo_frames));
+      // on the ring size.
+      ring_frames_ = 2 * std::max(source_frames, destination_frames);
+      ring_ = media::AudioBus::Create(destination_channels,
+                                      ring_frames_ + destination_frames);
+      unaligned_chunk_ =
+          media::AudioBus::Create(destination_channels, destination_frames);
     }
 
     // May be created in the main render thread and used in the audio threads.
@@ -200,29 +221,29 @@ class MediaStreamAudioFifo {
     DCHECK_EQ(source.channels(), source_channels_);
     DCHECK_EQ(source.frames(), source_frames_);
 
-    const media::AudioBus* source_to_push = &source;
-
-    if (audio_source_intermediate_) {
-      for (int i = 0; i < destination_->bus()->channels(); ++i) {
-        audio_source_intermediate_->SetChannelData(
-            i,
-            const_cast<float*>(source.channel(i)));
-      }
-      audio_source_intermediate_->set_frames(source.frames());
-      source_to_push = audio_source_intermediate_.get();
-    }
-
-    if (fifo_) {
-      CHECK_LT(fifo_->frames(), destination_->bus()->frames());
+    if (ring_) {
+      CHECK_LT(frames_available_, destination_frames_);
       next_audio_delay_ = audio_delay +
-          fifo_->frames() * base::TimeDelta::FromSeconds(1) / sample_rate_;
-      fifo_->Push(source_to_push);
+          frames_available_ * base::TimeDelta::FromSeconds(1) / sample_rate_;
+      for (int i = 0; i < ring_->channels(); ++i) {
+        const float* source_channel = source.channel(i);
+        const int first_part =
+            std::min(source_frames_, ring_frames_ - write_position_);
+        WriteToRing(i, write_position_, source_channel, first_part);
+        WriteToRing(i, 0, source_channel + first_part,
+                    source_frames_ - first_part);
+      }
+      write_position_ = (write_position_ + source_frames_) % ring_frames_;
     } else {
-      CHECK(!data_available_);
-      source_to_push->CopyTo(destination_->bus());
+      CHECK(!frames_available_);
+      // Hand out the source itself.
+      media::AudioBus* destination = destination_->bus();
+      for (int i = 0; i < destination->channels(); ++i)
+        destination->SetChannelData(i, const_cast<float*>(source.channel(i)));
+      destination->set_frames(source_frames_);
       next_audio_delay_ = audio_delay;
-      data_available_ = true;
     }
+    frames_available_ += source_frames_;
   }
 
   // Returns true if there are destination_frames() of data available to be
@@ -231,44 +252,81 @@ class MediaStreamAudioFifo {
                base::TimeDelta* audio_delay) {
     DCHECK(thread_checker_.CalledOnValidThread());
 
-    if (fifo_) {
-      if (fifo_->frames() < destination_->bus()->frames())
-        return false;
-
-      fifo_->Consume(destination_->bus(), 0, destination_->bus()->frames());
-      *audio_delay = next_audio_delay_;
-      next_audio_delay_ -=
-          destination_->bus()->frames() * base::TimeDelta::FromSeconds(1) /
-              sample_rate_;
-    } else {
-      if (!data_available_)
-        return false;
-      *audio_delay = next_audio_delay_;
-      // The data was already copied to |destination_| in this case.
-      data_available_ = false;
+    if (frames_available_ < destination_frames_)
+      return false;
+
+    if (ring_) {
+      media::AudioBus* bus = destination_->bus();
+      const bool aligned = read_position_ % kFramesPerChannelAlignment == 0;
+      for (int i = 0; i < bus->channels(); ++i) {
+        float* chunk = ring_->channel(i) + read_position_;
+        if (!aligned) {
+          memcpy(unaligned_chunk_->channel(i), chunk,
+                 destination_frames_ * sizeof(*chunk));
+          chunk = unaligned_chunk_->channel(i);
+        }
+        bus->SetChannelData(i, chunk);
+      }
+      bus->set_frames(destination_frames_);
+      read_position_ = (read_position_ + destination_frames_) % ring_frames_;
     }
+    // Otherwise |destination_| already wraps the source.
+
+    *audio_delay = next_audio_delay_;
+    next_audio_delay_ -=
+        destination_frames_ * base::TimeDelta::FromSeconds(1) / sample_rate_;
+    frames_available_ -= destination_frames_;
 
     *destination = destination_.get();
     return true;
   }
 
  private:
+  // Chunks starting at a multiple of this many frames into the ring are
+  // aligned.
+  static const int kFramesPerChannelAlignment =
+      media::AudioBus::kChannelAlignment / sizeof(float);
+
+  // Copies |frames| frames from |source| to |channel| of the ring, starting at
+  // |position|, which the frames mustn't wrap around. Frames which land in the
+  // first |destination_frames_| of the ring are mirrored past its end.
+  void WriteToRing(int channel, int position, const float* source, int frames) {
+    if (!frames)
+      return;
+    DCHECK_LE(position + frames, ring_frames_);
+    float* ring_channel = ring_->channel(channel);
+    memcpy(ring_channel + position, source, frames * sizeof(*source));
+    if (position < destination_frames_) {
+      const int mirrored = std::min(frames, destination_frames_ - position);
+      memcpy(ring_channel + ring_frames_ + position, source,
+             mirrored * sizeof(*source));
+    }
+  }
+
   base::ThreadChecker thread_checker_;
   const int source_channels_;  // For a DCHECK.
-  const int source_frames_;  // For a DCHECK.
+  const int source_frames_;
+  const int destination_frames_;
   const int sample_rate_;
-  scoped_ptr<media::AudioBus> audio_source_intermediate_;
+
+  // The chunk handed out by Consume(), wrapping either the source or |ring_|.
   scoped_ptr<MediaStreamAudioBus> destination_;
-  scoped_ptr<media::AudioFifo> fifo_;
 
-  // When using |fifo_|, this is the audio delay of the first sample to be
-  // consumed next from the FIFO.  When not using |fifo_|, this is the audio
-  // delay of the first sample in |destination_|.
-  base::TimeDelta next_audio_delay_;
+  // Only used when the source and destination frames differ. Holds
+  // |ring_frames_| frames, followed by the mirror of the first
+  // |destination_frames_|.
+  scoped_ptr<media::AudioBus> ring_;
+  // Where chunks which start unaligned in |ring_| are copied to.
+  scoped_ptr<media::AudioBus> unaligned_chunk_;
+  int ring_frames_;
+  int read_position_;
+  int write_position_;
+
+  // The number of frames pushed and not consumed yet.
+  int frames_available_;
 
-  // True when |destination_| contains the data to be returned by the next call
-  // to Consume().  Only used when the FIFO is disabled.
-  bool data_available_;
+  // The audio delay of the first frame to be consumed next.
+  base::TimeDelta next_audio_delay_;
 };
 
 MediaStreamAudioProcessor::MediaStreamAudioProcessor(
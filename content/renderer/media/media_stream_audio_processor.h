@@ -26,7 +26,6 @@ class WebMediaConstraints;
 
 namespace media {
 class AudioBus;
-class AudioFifo;
 class AudioParameters;
 }  // namespace media
 
@@ -68,8 +67,10 @@ class CONTENT_EXPORT MediaStreamAudioProcessor :
   void OnCaptureFormatChanged(const media::AudioParameters& source_params);
 
   // Pushes capture data in |audio_source| to the internal FIFO. Each call to
-  // this method should be followed by calls to ProcessAndConsumeData() while
-  // it returns false, to pull out all available data.
+  // this method should be followed by calls to ProcessAndConsumeData() until
+  // it returns false, to pull out all available data. When no rebuffering is
+  // needed, |audio_source| is processed without being copied, so it must not
+  // change or go away before then.
   // Called on the capture audio thread.
   void PushCaptureData(const media::AudioBus& audio_source,
                        base::TimeDelta capture_delay);
@@ -77,7 +78,8 @@ class CONTENT_EXPORT MediaStreamAudioProcessor :
   // Processes a block of 10 ms data from the internal FIFO, returning true if
   // |processed_data| contains the result. Returns false and does not modify the
   // outputs if the internal FIFO has insufficient data. The caller does NOT own
-  // the object pointed to by |*processed_data|.
+  // the object pointed to by |*processed_data|, which is only valid until the
+  // next call to this method or to PushCaptureData().
   // |capture_delay| is an adjustment on the |capture_delay| value provided in
   // the last call to PushCaptureData().
   // |new_volume| receives the new microphone volume from the AGC.
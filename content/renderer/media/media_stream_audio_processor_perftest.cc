@@ -0,0 +1,86 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "content/renderer/media/media_stream_audio_processor.h"
+
+#include "base/memory/scoped_ptr.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/time/time.h"
+#include "content/public/common/media_stream_request.h"
+#include "content/renderer/media/media_stream_audio_processor_options.h"
+#include "content/renderer/media/mock_media_constraint_factory.h"
+#include "content/renderer/media/webrtc_audio_device_impl.h"
+#include "media/audio/audio_parameters.h"
+#include "media/base/audio_bus.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_test.h"
+#include "third_party/WebKit/public/platform/WebMediaConstraints.h"
+#include "third_party/libjingle/source/talk/app/webrtc/mediastreaminterface.h"
+
+namespace content {
+namespace {
+
+// Buffer sizes which do and don't need rebuffering into 10 ms chunks.
+const int kBufferSizes[] = { 480, 441, 512 };
+const int kBuffers = 1000;
+
+// Reports the CPU time the capture path takes per buffer, with and without
+// audio processing.
+void RunCapturePath(bool processing) {
+  MockMediaConstraintFactory constraint_factory;
+  if (!processing) {
+    constraint_factory.AddMandatory(MediaAudioConstraints::kEchoCancellation,
+                                    false);
+  }
+  scoped_refptr<WebRtcAudioDeviceImpl> webrtc_audio_device(
+      new WebRtcAudioDeviceImpl());
+  scoped_refptr<MediaStreamAudioProcessor> audio_processor(
+      new rtc::RefCountedObject<MediaStreamAudioProcessor>(
+          constraint_factory.CreateWebMediaConstraints(),
+          MediaStreamDevice::AudioDeviceParameters(),
+          webrtc_audio_device.get()));
+  EXPECT_EQ(processing, audio_processor->has_audio_processing());
+
+  for (size_t i = 0; i < arraysize(kBufferSizes); ++i) {
+    const media::AudioParameters source_params(
+        media::AudioParameters::AUDIO_PCM_LOW_LATENCY,
+        media::CHANNEL_LAYOUT_STEREO, 48000, 16, kBufferSizes[i]);
+    audio_processor->OnCaptureFormatChanged(source_params);
+    scoped_ptr<media::AudioBus> source = media::AudioBus::Create(source_params);
+    source->Zero();
+
+    const base::TimeTicks start = base::TimeTicks::Now();
+    for (int buffer = 0; buffer < kBuffers; ++buffer) {
+      audio_processor->PushCaptureData(*source, base::TimeDelta());
+      media::AudioBus* processed_data = nullptr;
+      base::TimeDelta capture_delay;
+      int new_volume = 0;
+      while (audio_processor->ProcessAndConsumeData(
+                 0, false, &processed_data, &capture_delay, &new_volume)) {
+      }
+    }
+    const base::TimeDelta elapsed = base::TimeTicks::Now() - start;
+
+    perf_test::PrintResult(
+        "capture_path_time",
+        processing ? "_with_processing" : "_without_processing",
+        base::IntToString(kBufferSizes[i]) + "_frames",
+        elapsed.InMicrosecondsF() / kBuffers, "us", true);
+  }
+
+  // Release |audio_processor| first to make sure |webrtc_audio_device|
+  // outlives it.
+  audio_processor = NULL;
+}
+
+TEST(MediaStreamAudioProcessorPerfTest, CapturePathWithoutProcessing) {
+  RunCapturePath(false);
+}
+
+TEST(MediaStreamAudioProcessorPerfTest, CapturePathWithProcessing) {
+  RunCapturePath(true);
+}
+
+}  // namespace
+}  // namespace content
@@ -594,4 +594,96 @@ TEST_F(MediaStreamAudioProcessorTest, MAYBE_TestWithKeyboardMicChannel) {
   audio_processor = NULL;
 }
 
+// Without audio processing, and when no rebuffering is needed, the captured
+// data is handed to the sinks as is.
+TEST_F(MediaStreamAudioProcessorTest, PassesThroughWithoutCopying) {
+  MockMediaConstraintFactory constraint_factory;
+  constraint_factory.AddMandatory(MediaAudioConstraints::kEchoCancellation,
+                                  false);
+  scoped_refptr<WebRtcAudioDeviceImpl> webrtc_audio_device(
+      new WebRtcAudioDeviceImpl());
+  scoped_refptr<MediaStreamAudioProcessor> audio_processor(
+      new rtc::RefCountedObject<MediaStreamAudioProcessor>(
+          constraint_factory.CreateWebMediaConstraints(), input_device_params_,
+          webrtc_audio_device.get()));
+  EXPECT_FALSE(audio_processor->has_audio_processing());
+  const media::AudioParameters source_params(
+      media::AudioParameters::AUDIO_PCM_LOW_LATENCY,
+      media::CHANNEL_LAYOUT_STEREO, 48000, 16, 480);
+  audio_processor->OnCaptureFormatChanged(source_params);
+
+  scoped_ptr<media::AudioBus> source = media::AudioBus::Create(source_params);
+  source->Zero();
+  audio_processor->PushCaptureData(*source, base::TimeDelta());
+
+  media::AudioBus* processed_data = nullptr;
+  base::TimeDelta capture_delay;
+  int new_volume = 0;
+  ASSERT_TRUE(audio_processor->ProcessAndConsumeData(
+      0, false, &processed_data, &capture_delay, &new_volume));
+  EXPECT_EQ(source->channel(0), processed_data->channel(0));
+  EXPECT_EQ(source->channel(1), processed_data->channel(1));
+  EXPECT_FALSE(audio_processor->ProcessAndConsumeData(
+      0, false, &processed_data, &capture_delay, &new_volume));
+
+  // Set |audio_processor| to NULL to make sure |webrtc_audio_device| outlives
+  // |audio_processor|.
+  audio_processor = NULL;
+}
+
+// Rebuffering must neither drop, duplicate nor reorder samples, wherever the
+// chunks fall in the FIFO.
+TEST_F(MediaStreamAudioProcessorTest, RebuffersOddBufferSizes) {
+  MockMediaConstraintFactory constraint_factory;
+  constraint_factory.AddMandatory(MediaAudioConstraints::kEchoCancellation,
+                                  false);
+  scoped_refptr<WebRtcAudioDeviceImpl> webrtc_audio_device(
+      new WebRtcAudioDeviceImpl());
+  scoped_refptr<MediaStreamAudioProcessor> audio_processor(
+      new rtc::RefCountedObject<MediaStreamAudioProcessor>(
+          constraint_factory.CreateWebMediaConstraints(), input_device_params_,
+          webrtc_audio_device.get()));
+  EXPECT_FALSE(audio_processor->has_audio_processing());
+
+  static const int kBufferSizes[] = { 512, 1000, 4410 };
+  for (size_t i = 0; i < arraysize(kBufferSizes); ++i) {
+    const media::AudioParameters source_params(
+        media::AudioParameters::AUDIO_PCM_LOW_LATENCY,
+        media::CHANNEL_LAYOUT_STEREO, 44100, 16, kBufferSizes[i]);
+    audio_processor->OnCaptureFormatChanged(source_params);
+    const int output_frames =
+        audio_processor->OutputFormat().frames_per_buffer();
+    ASSERT_NE(kBufferSizes[i], output_frames);
+
+    scoped_ptr<media::AudioBus> source =
+        media::AudioBus::Create(source_params);
+    int next_pushed = 0;
+    int next_consumed = 0;
+    for (int packet = 0; packet < kNumberOfPacketsForTest; ++packet) {
+      for (int frame = 0; frame < source->frames(); ++frame, ++next_pushed) {
+        source->channel(0)[frame] = next_pushed;
+        source->channel(1)[frame] = -next_pushed;
+      }
+      audio_processor->PushCaptureData(*source, base::TimeDelta());
+
+      media::AudioBus* processed_data = nullptr;
+      base::TimeDelta capture_delay;
+      int new_volume = 0;
+      while (audio_processor->ProcessAndConsumeData(
+                 0, false, &processed_data, &capture_delay, &new_volume)) {
+        ASSERT_EQ(output_frames, processed_data->frames());
+        for (int frame = 0; frame < output_frames; ++frame, ++next_consumed) {
+          ASSERT_EQ(next_consumed, processed_data->channel(0)[frame]);
+          ASSERT_EQ(-next_consumed, processed_data->channel(1)[frame]);
+        }
+      }
+      EXPECT_LT(next_pushed - next_consumed, output_frames);
+    }
+  }
+
+  // Set |audio_processor| to NULL to make sure |webrtc_audio_device| outlives
+  // |audio_processor|.
+  audio_processor = NULL;
+}
+
 }  // namespace content
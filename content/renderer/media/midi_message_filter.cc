@@ -10,6 +10,7 @@
 #include "base/single_thread_task_runner.h"
 #include "base/strings/utf_string_conversions.h"
 #include "base/trace_event/trace_event.h"
+#include "content/common/media/midi_message_ring.h"
 #include "content/common/media/midi_messages.h"
 #include "content/renderer/render_thread_impl.h"
 #include "ipc/ipc_logging.h"
@@ -18,7 +19,8 @@ using base::AutoLock;
 
 // The maximum number of bytes which we're allowed to send to the browser
 // before getting acknowledgement back from the browser that they've been
-// successfully sent.
+// successfully sent. Once the rings are in use, this bounds the bytes waiting
+// for space in the send ring instead.
 static const size_t kMaxUnacknowledgedBytesSent = 10 * 1024 * 1024;  // 10 MB.
 
 namespace content {
@@ -30,11 +32,22 @@ MidiMessageFilter::MidiMessageFilter(
       io_task_runner_(io_task_runner),
       main_task_runner_(base::ThreadTaskRunnerHandle::Get()),
       session_result_(media::midi::Result::NOT_INITIALIZED),
-      unacknowledged_bytes_sent_(0u) {
+      unacknowledged_bytes_sent_(0u),
+      pending_send_bytes_(0u) {
 }
 
 MidiMessageFilter::~MidiMessageFilter() {}
 
+MidiMessageFilter::PendingMessage::PendingMessage(
+    uint32 port,
+    const std::vector<uint8>& data,
+    double timestamp)
+    : port(port), data(data), timestamp(timestamp) {
+}
+
+MidiMessageFilter::PendingMessage::~PendingMessage() {
+}
+
 void MidiMessageFilter::AddClient(blink::WebMIDIAccessorClient* client) {
   DCHECK(main_task_runner_->BelongsToCurrentThread());
   TRACE_EVENT0("midi", "MidiMessageFilter::AddClient");
@@ -70,6 +83,24 @@ void MidiMessageFilter::SendMidiData(uint32 port,
                                      size_t length,
                                      double timestamp) {
   DCHECK(main_task_runner_->BelongsToCurrentThread());
+  if (send_ring_) {
+    // An empty message would be taken for a large one's placeholder, and the
+    // browser ignores them anyway.
+    if (!length)
+      return;
+    if (pending_sends_.empty() &&
+        PushToSendRing(port, data, length, timestamp)) {
+      return;
+    }
+    if ((kMaxUnacknowledgedBytesSent - pending_send_bytes_) < length)
+      return;
+    pending_sends_.push_back(
+        PendingMessage(port, std::vector<uint8>(data, data + length),
+                       timestamp));
+    pending_send_bytes_ += length;
+    return;
+  }
+
   if ((kMaxUnacknowledgedBytesSent - unacknowledged_bytes_sent_) < length) {
     // TODO(toyoshim): buffer up the data to send at a later time.
     // For now we're just dropping these bytes on the floor.
@@ -96,6 +127,24 @@ void MidiMessageFilter::SendMidiDataOnIOThread(uint32 port,
   Send(new MidiHostMsg_SendData(port, data, timestamp));
 }
 
+void MidiMessageFilter::SendLargeMidiDataOnIOThread(
+    uint32 port,
+    const std::vector<uint8>& data,
+    double timestamp) {
+  DCHECK(io_task_runner_->BelongsToCurrentThread());
+  Send(new MidiHostMsg_SendLargeData(port, data, timestamp));
+}
+
+void MidiMessageFilter::SendRingDoorbellOnIOThread() {
+  DCHECK(io_task_runner_->BelongsToCurrentThread());
+  Send(new MidiHostMsg_SendRingDoorbell());
+}
+
+void MidiMessageFilter::RecvRingSpaceAvailableOnIOThread() {
+  DCHECK(io_task_runner_->BelongsToCurrentThread());
+  Send(new MidiHostMsg_RecvRingSpaceAvailable());
+}
+
 void MidiMessageFilter::EndSessionOnIOThread() {
   DCHECK(io_task_runner_->BelongsToCurrentThread());
   Send(new MidiHostMsg_EndSession());
@@ -121,6 +170,11 @@ bool MidiMessageFilter::OnMessageReceived(const IPC::Message& message) {
     IPC_MESSAGE_HANDLER(MidiMsg_SetOutputPortState, OnSetOutputPortState)
     IPC_MESSAGE_HANDLER(MidiMsg_DataReceived, OnDataReceived)
     IPC_MESSAGE_HANDLER(MidiMsg_AcknowledgeSentData, OnAcknowledgeSentData)
+    IPC_MESSAGE_HANDLER(MidiMsg_SessionRings, OnSessionRings)
+    IPC_MESSAGE_HANDLER(MidiMsg_SendRingSpaceAvailable,
+                        OnSendRingSpaceAvailable)
+    IPC_MESSAGE_HANDLER(MidiMsg_DataReceivedDoorbell, OnDataReceivedDoorbell)
+    IPC_MESSAGE_HANDLER(MidiMsg_LargeDataReceived, OnLargeDataReceived)
     IPC_MESSAGE_UNHANDLED(handled = false)
   IPC_END_MESSAGE_MAP()
   return handled;
@@ -200,6 +254,48 @@ void MidiMessageFilter::OnAcknowledgeSentData(size_t bytes_sent) {
                             this, bytes_sent));
 }
 
+void MidiMessageFilter::OnSessionRings(base::SharedMemoryHandle send_handle,
+                                       base::SharedMemoryHandle recv_handle) {
+  DCHECK(io_task_runner_->BelongsToCurrentThread());
+  scoped_ptr<base::SharedMemory> send_shm(
+      new base::SharedMemory(send_handle, false));
+  scoped_ptr<base::SharedMemory> recv_shm(
+      new base::SharedMemory(recv_handle, false));
+  scoped_ptr<MidiMessageRing> send_ring(new MidiMessageRing);
+  scoped_ptr<MidiMessageRing> recv_ring(new MidiMessageRing);
+  if (!send_ring->Init(send_shm.Pass(), false) ||
+      !recv_ring->Init(recv_shm.Pass(), false)) {
+    LOG(ERROR) << "Failed to map MIDI message rings.";
+    return;
+  }
+  main_task_runner_->PostTask(
+      FROM_HERE, base::Bind(&MidiMessageFilter::HandleSessionRings, this,
+                            base::Passed(&send_ring), base::Passed(&recv_ring)));
+}
+
+void MidiMessageFilter::OnSendRingSpaceAvailable() {
+  DCHECK(io_task_runner_->BelongsToCurrentThread());
+  main_task_runner_->PostTask(
+      FROM_HERE,
+      base::Bind(&MidiMessageFilter::HandleSendRingSpaceAvailable, this));
+}
+
+void MidiMessageFilter::OnDataReceivedDoorbell() {
+  TRACE_EVENT0("midi", "MidiMessageFilter::OnDataReceivedDoorbell");
+  DCHECK(io_task_runner_->BelongsToCurrentThread());
+  main_task_runner_->PostTask(
+      FROM_HERE, base::Bind(&MidiMessageFilter::DrainRecvRing, this));
+}
+
+void MidiMessageFilter::OnLargeDataReceived(uint32 port,
+                                            const std::vector<uint8>& data,
+                                            double timestamp) {
+  DCHECK(io_task_runner_->BelongsToCurrentThread());
+  main_task_runner_->PostTask(
+      FROM_HERE, base::Bind(&MidiMessageFilter::HandleLargeDataReceived, this,
+                            port, data, timestamp));
+}
+
 void MidiMessageFilter::HandleClientAdded(media::midi::Result result) {
   TRACE_EVENT0("midi", "MidiMessageFilter::HandleClientAdded");
   DCHECK(main_task_runner_->BelongsToCurrentThread());
@@ -295,9 +391,120 @@ void MidiMessageFilter::HandleDataReceived(uint32 port,
 
 void MidiMessageFilter::HandleAckknowledgeSentData(size_t bytes_sent) {
   DCHECK(main_task_runner_->BelongsToCurrentThread());
-  DCHECK_GE(unacknowledged_bytes_sent_, bytes_sent);
-  if (unacknowledged_bytes_sent_ >= bytes_sent)
-    unacknowledged_bytes_sent_ -= bytes_sent;
+  // The browser counts the bytes which went through the send ring too.
+  unacknowledged_bytes_sent_ -=
+      std::min(unacknowledged_bytes_sent_, bytes_sent);
+}
+
+void MidiMessageFilter::HandleSessionRings(
+    scoped_ptr<MidiMessageRing> send_ring,
+    scoped_ptr<MidiMessageRing> recv_ring) {
+  DCHECK(main_task_runner_->BelongsToCurrentThread());
+  send_ring_ = send_ring.Pass();
+  recv_ring_ = recv_ring.Pass();
+  recv_ring_buffer_.resize(MidiMessageRing::kMaxMessageSize);
+}
+
+void MidiMessageFilter::HandleSendRingSpaceAvailable() {
+  DCHECK(main_task_runner_->BelongsToCurrentThread());
+  while (!pending_sends_.empty()) {
+    const PendingMessage& message = pending_sends_.front();
+    if (!PushToSendRing(message.port, &message.data[0], message.data.size(),
+                        message.timestamp)) {
+      break;
+    }
+    pending_send_bytes_ -= message.data.size();
+    pending_sends_.pop_front();
+  }
+}
+
+void MidiMessageFilter::HandleLargeDataReceived(uint32 port,
+                                                const std::vector<uint8>& data,
+                                                double timestamp) {
+  DCHECK(main_task_runner_->BelongsToCurrentThread());
+  if (!recv_ring_) {
+    HandleDataReceived(port, data, timestamp);
+    return;
+  }
+  large_received_messages_.push_back(PendingMessage(port, data, timestamp));
+  DrainRecvRing();
+}
+
+bool MidiMessageFilter::PushToSendRing(uint32 port,
+                                       const uint8* data,
+                                       size_t length,
+                                       double timestamp) {
+  DCHECK(main_task_runner_->BelongsToCurrentThread());
+  DCHECK(send_ring_);
+  // Large messages go in an IPC message, which the browser matches up with
+  // an empty message in the ring.
+  const bool large = length > MidiMessageRing::kMaxMessageSize;
+  bool wake_consumer;
+  if (!send_ring_->Push(port, large ? nullptr : data,
+                        large ? 0 : static_cast<uint32>(length), timestamp,
+                        &wake_consumer)) {
+    return false;
+  }
+  if (large) {
+    std::vector<uint8> v(data, data + length);
+    io_task_runner_->PostTask(
+        FROM_HERE, base::Bind(&MidiMessageFilter::SendLargeMidiDataOnIOThread,
+                              this, port, v, timestamp));
+  }
+  if (wake_consumer) {
+    io_task_runner_->PostTask(
+        FROM_HERE,
+        base::Bind(&MidiMessageFilter::SendRingDoorbellOnIOThread, this));
+  }
+  return true;
+}
+
+void MidiMessageFilter::DrainRecvRing() {
+  TRACE_EVENT0("midi", "MidiMessageFilter::DrainRecvRing");
+  DCHECK(main_task_runner_->BelongsToCurrentThread());
+  if (!recv_ring_)
+    return;
+
+  bool wake_browser = false;
+  for (;;) {
+    uint32 size = 0;
+    MidiMessageRing::Status status = recv_ring_->Peek(&size);
+    if (status == MidiMessageRing::STATUS_CORRUPT) {
+      recv_ring_.reset();
+      large_received_messages_.clear();
+      return;
+    }
+    if (status != MidiMessageRing::STATUS_OK)
+      break;
+    // Wait for the large message this one stands in for.
+    if (!size && large_received_messages_.empty())
+      break;
+
+    uint32 port;
+    double timestamp;
+    bool wake_producer;
+    status = recv_ring_->Pop(&recv_ring_buffer_[0], recv_ring_buffer_.size(),
+                             &port, &size, &timestamp, &wake_producer);
+    DCHECK_EQ(MidiMessageRing::STATUS_OK, status);
+    wake_browser |= wake_producer;
+
+    if (size) {
+      for (auto client : clients_)
+        client->didReceiveMIDIData(port, &recv_ring_buffer_[0], size,
+                                   timestamp);
+    } else {
+      PendingMessage message = large_received_messages_.front();
+      large_received_messages_.pop_front();
+      HandleDataReceived(message.port, message.data, message.timestamp);
+    }
+  }
+
+  // One wakeup covers all the space made above.
+  if (wake_browser) {
+    io_task_runner_->PostTask(
+        FROM_HERE,
+        base::Bind(&MidiMessageFilter::RecvRingSpaceAvailableOnIOThread, this));
+  }
 }
 
 void MidiMessageFilter::HandleSetInputPortState(
@@ -5,10 +5,12 @@
 #ifndef CONTENT_RENDERER_MEDIA_MIDI_MESSAGE_FILTER_H_
 #define CONTENT_RENDERER_MEDIA_MIDI_MESSAGE_FILTER_H_
 
+#include <deque>
 #include <set>
 #include <vector>
 
 #include "base/memory/scoped_ptr.h"
+#include "base/memory/shared_memory.h"
 #include "content/common/content_export.h"
 #include "ipc/message_filter.h"
 #include "media/midi/midi_port_info.h"
@@ -21,6 +23,8 @@ class SingleThreadTaskRunner;
 
 namespace content {
 
+class MidiMessageRing;
+
 // MessageFilter that handles MIDI messages.
 class CONTENT_EXPORT MidiMessageFilter : public IPC::MessageFilter {
  public:
@@ -56,11 +60,28 @@ class CONTENT_EXPORT MidiMessageFilter : public IPC::MessageFilter {
   ~MidiMessageFilter() override;
 
  private:
+  // A message waiting for its turn in one of the rings.
+  struct PendingMessage {
+    PendingMessage(uint32 port,
+                   const std::vector<uint8>& data,
+                   double timestamp);
+    ~PendingMessage();
+
+    uint32 port;
+    std::vector<uint8> data;
+    double timestamp;
+  };
+
   void StartSessionOnIOThread();
 
   void SendMidiDataOnIOThread(uint32 port,
                               const std::vector<uint8>& data,
                               double timestamp);
+  void SendLargeMidiDataOnIOThread(uint32 port,
+                                   const std::vector<uint8>& data,
+                                   double timestamp);
+  void SendRingDoorbellOnIOThread();
+  void RecvRingSpaceAvailableOnIOThread();
 
   void EndSessionOnIOThread();
 
@@ -102,6 +123,20 @@ class CONTENT_EXPORT MidiMessageFilter : public IPC::MessageFilter {
   // sending too much data before knowing how much has already been sent.
   void OnAcknowledgeSentData(size_t bytes_sent);
 
+  // Called with the rings which carry MIDI data from then on. The rings are
+  // mapped here and handed to the main thread.
+  void OnSessionRings(base::SharedMemoryHandle send_handle,
+                      base::SharedMemoryHandle recv_handle);
+
+  // Called when the browser has made room in, or put data into, the rings.
+  void OnSendRingSpaceAvailable();
+  void OnDataReceivedDoorbell();
+
+  // Called with received data too large for the receive ring.
+  void OnLargeDataReceived(uint32 port,
+                           const std::vector<uint8>& data,
+                           double timestamp);
+
   // Following methods, Handle*, run on |main_task_runner_|.
   void HandleClientAdded(media::midi::Result result);
 
@@ -116,6 +151,23 @@ class CONTENT_EXPORT MidiMessageFilter : public IPC::MessageFilter {
 
   void HandleAckknowledgeSentData(size_t bytes_sent);
 
+  void HandleSessionRings(scoped_ptr<MidiMessageRing> send_ring,
+                          scoped_ptr<MidiMessageRing> recv_ring);
+  void HandleSendRingSpaceAvailable();
+  void HandleLargeDataReceived(uint32 port,
+                               const std::vector<uint8>& data,
+                               double timestamp);
+
+  // Appends a message to |send_ring_|, ringing the browser's doorbell if it's
+  // idle. Returns false if the ring is full.
+  bool PushToSendRing(uint32 port,
+                      const uint8* data,
+                      size_t length,
+                      double timestamp);
+
+  // Passes the messages in |recv_ring_| to the clients.
+  void DrainRecvRing();
+
   // IPC sender for Send(); must only be accessed on |io_task_runner_|.
   IPC::Sender* sender_;
 
@@ -148,8 +200,23 @@ class CONTENT_EXPORT MidiMessageFilter : public IPC::MessageFilter {
   media::midi::MidiPortInfoList inputs_;
   media::midi::MidiPortInfoList outputs_;
 
+  // The number of bytes sent in MidiHostMsg_SendData, and not acknowledged
+  // yet. Only used until the rings arrive.
   size_t unacknowledged_bytes_sent_;
 
+  // Carry the messages to and from the browser, once it has sent them.
+  scoped_ptr<MidiMessageRing> send_ring_;
+  scoped_ptr<MidiMessageRing> recv_ring_;
+  std::vector<uint8> recv_ring_buffer_;
+
+  // Messages waiting for space in |send_ring_|, and their total size.
+  std::deque<PendingMessage> pending_sends_;
+  size_t pending_send_bytes_;
+
+  // Messages from MidiMsg_LargeDataReceived whose place in |recv_ring_|
+  // hasn't been reached yet.
+  std::deque<PendingMessage> large_received_messages_;
+
   DISALLOW_COPY_AND_ASSIGN(MidiMessageFilter);
 };
 
@@ -3,10 +3,12 @@
 // found in the LICENSE file.
 #include "content/renderer/media/peer_connection_tracker.h"
 
+#include "base/bind.h"
 #include "base/strings/string_number_conversions.h"
 #include "base/strings/utf_string_conversions.h"
+#include "base/synchronization/lock.h"
 #include "base/thread_task_runner_handle.h"
-#include "content/common/media/peer_connection_tracker_messages.h"
+#include "content/common/media/peer_connection_stats_encoding.h"
 #include "content/renderer/media/rtc_media_constraints.h"
 #include "content/renderer/media/rtc_peer_connection_handler.h"
 #include "content/renderer/render_thread_impl.h"
@@ -236,90 +238,92 @@ static string GetIceGatheringStateString(
   return result;
 }
 
-// Builds a DictionaryValue from the StatsReport.
-// The caller takes the ownership of the returned value.
+// Adds the values of |report| to |encoder|.
 // Note:
-// The format must be consistent with what webrtc_internals.js expects.
-// If you change it here, you must change webrtc_internals.js as well.
-static base::DictionaryValue* GetDictValueStats(const StatsReport& report) {
+// The values must stay consistent with what webrtc_internals.js expects.
+// If you change them here, you must change webrtc_internals.js as well.
+static void EncodeReport(const StatsReport& report,
+                         PeerConnectionStatsEncoder* encoder) {
   if (report.values().empty())
-    return NULL;
-
-  base::DictionaryValue* dict = new base::DictionaryValue();
-  dict->SetDouble("timestamp", report.timestamp());
-
-  base::ListValue* values = new base::ListValue();
-  dict->Set("values", values);
+    return;
 
+  encoder->BeginReport(report.id()->ToString(), report.TypeToString(),
+                       report.timestamp());
   for (const auto& v : report.values()) {
     const StatsReport::ValuePtr& value = v.second;
-    values->AppendString(value->display_name());
+    const std::string name = value->display_name();
     switch (value->type()) {
       case StatsReport::Value::kInt:
-        values->AppendInteger(value->int_val());
+        encoder->AddInt(name, value->int_val());
         break;
       case StatsReport::Value::kFloat:
-        values->AppendDouble(value->float_val());
+        encoder->AddDouble(name, value->float_val());
         break;
       case StatsReport::Value::kString:
-        values->AppendString(value->string_val());
+        encoder->AddString(name, value->string_val());
         break;
       case StatsReport::Value::kStaticString:
-        values->AppendString(value->static_string_val());
+        encoder->AddString(name, value->static_string_val());
         break;
       case StatsReport::Value::kBool:
-        values->AppendBoolean(value->bool_val());
+        encoder->AddBool(name, value->bool_val());
         break;
       case StatsReport::Value::kInt64:  // int64 isn't supported, so use string.
       case StatsReport::Value::kId:
       default:
-        values->AppendString(value->ToString());
+        encoder->AddString(name, value->ToString());
         break;
     }
   }
-
-  return dict;
 }
 
-// Builds a DictionaryValue from the StatsReport.
-// The caller takes the ownership of the returned value.
-static base::DictionaryValue* GetDictValue(const StatsReport& report) {
-  scoped_ptr<base::DictionaryValue> stats, result;
+// Encodes the stats of one peer connection. Stats are encoded on libjingle's
+// signaling thread, where they're delivered, and sent from the main thread.
+// The browser must decode the sets in the order they're encoded, so they're
+// posted to the main thread while |lock_| is held.
+class PeerConnectionTracker::StatsEncoder
+    : public base::RefCountedThreadSafe<StatsEncoder> {
+ public:
+  StatsEncoder(int lid, const base::WeakPtr<PeerConnectionTracker>& tracker)
+      : lid_(lid),
+        tracker_(tracker),
+        main_thread_(base::ThreadTaskRunnerHandle::Get()) {}
+
+  void Encode(const StatsReports& reports) {
+    base::AutoLock auto_lock(lock_);
+    for (const auto* r : reports)
+      EncodeReport(*r, &encoder_);
+
+    std::string data = encoder_.Finish();
+    if (!data.empty()) {
+      main_thread_->PostTask(FROM_HERE,
+          base::Bind(&PeerConnectionTracker::AddEncodedStats, tracker_, lid_,
+                     data));
+    }
+  }
 
-  stats.reset(GetDictValueStats(report));
-  if (!stats)
-    return NULL;
+ private:
+  friend class base::RefCountedThreadSafe<StatsEncoder>;
+  ~StatsEncoder() {}
 
-  result.reset(new base::DictionaryValue());
-  // Note:
-  // The format must be consistent with what webrtc_internals.js expects.
-  // If you change it here, you must change webrtc_internals.js as well.
-  result->Set("stats", stats.release());
-  result->SetString("id", report.id()->ToString());
-  result->SetString("type", report.TypeToString());
+  const int lid_;
+  const base::WeakPtr<PeerConnectionTracker> tracker_;
+  const scoped_refptr<base::SingleThreadTaskRunner> main_thread_;
 
-  return result.release();
-}
+  base::Lock lock_;
+  PeerConnectionStatsEncoder encoder_;
+
+  DISALLOW_COPY_AND_ASSIGN(StatsEncoder);
+};
 
 class InternalStatsObserver : public webrtc::StatsObserver {
  public:
-  InternalStatsObserver(int lid)
-      : lid_(lid), main_thread_(base::ThreadTaskRunnerHandle::Get()) {}
+  explicit InternalStatsObserver(
+      const scoped_refptr<PeerConnectionTracker::StatsEncoder>& encoder)
+      : encoder_(encoder) {}
 
   void OnComplete(const StatsReports& reports) override {
-    scoped_ptr<base::ListValue> list(new base::ListValue());
-
-    for (const auto* r : reports) {
-      base::DictionaryValue* report = GetDictValue(*r);
-      if (report)
-        list->Append(report);
-    }
-
-    if (!list->empty()) {
-      main_thread_->PostTask(FROM_HERE,
-          base::Bind(&InternalStatsObserver::OnCompleteImpl,
-                     base::Passed(&list), lid_));
-    }
+    encoder_->Encode(reports);
   }
 
  protected:
@@ -331,19 +335,11 @@ class InternalStatsObserver : public webrtc::StatsObserver {
   }
 
  private:
-  // Static since |this| will most likely have been deleted by the time we
-  // get here.
-  static void OnCompleteImpl(scoped_ptr<base::ListValue> list, int lid) {
-    DCHECK(!list->empty());
-    RenderThreadImpl::current()->Send(
-        new PeerConnectionTrackerHost_AddStats(lid, *list.get()));
-  }
-
-  const int lid_;
-  const scoped_refptr<base::SingleThreadTaskRunner> main_thread_;
+  const scoped_refptr<PeerConnectionTracker::StatsEncoder> encoder_;
 };
 
-PeerConnectionTracker::PeerConnectionTracker() : next_lid_(1) {
+PeerConnectionTracker::PeerConnectionTracker()
+    : flush_scheduled_(false), next_lid_(1) {
 }
 
 PeerConnectionTracker::~PeerConnectionTracker() {
@@ -367,7 +363,8 @@ void PeerConnectionTracker::OnGetAllStats() {
   for (PeerConnectionIdMap::iterator it = peer_connection_id_map_.begin();
        it != peer_connection_id_map_.end(); ++it) {
     rtc::scoped_refptr<InternalStatsObserver> observer(
-        new rtc::RefCountedObject<InternalStatsObserver>(it->second));
+        new rtc::RefCountedObject<InternalStatsObserver>(
+            stats_encoders_[it->second]));
 
     // The last type parameter is ignored when the track id is empty.
     it->first->GetStats(
@@ -403,12 +400,14 @@ void PeerConnectionTracker::RegisterPeerConnection(
 
   info.constraints = SerializeMediaConstraints(constraints);
   info.url = frame->document().url().spec();
+  FlushPendingMessages();
   RenderThreadImpl::current()->Send(
       new PeerConnectionTrackerHost_AddPeerConnection(info));
 
   DCHECK(peer_connection_id_map_.find(pc_handler) ==
          peer_connection_id_map_.end());
   peer_connection_id_map_[pc_handler] = info.lid;
+  stats_encoders_[info.lid] = new StatsEncoder(info.lid, AsWeakPtr());
 }
 
 void PeerConnectionTracker::UnregisterPeerConnection(
@@ -425,9 +424,11 @@ void PeerConnectionTracker::UnregisterPeerConnection(
     return;
   }
 
+  FlushPendingMessages();
   RenderThreadImpl::current()->Send(
       new PeerConnectionTrackerHost_RemovePeerConnection(it->second));
 
+  stats_encoders_.erase(it->second);
   peer_connection_id_map_.erase(it);
 }
 
@@ -624,6 +625,7 @@ void PeerConnectionTracker::TrackGetUserMedia(
   RTCMediaConstraints video_constraints(
       GetNativeMediaConstraints(user_media_request.videoConstraints()));
 
+  FlushPendingMessages();
   RenderThreadImpl::current()->Send(new PeerConnectionTrackerHost_GetUserMedia(
       user_media_request.securityOrigin().toString().utf8(),
       user_media_request.audio(),
@@ -642,12 +644,52 @@ void PeerConnectionTracker::SendPeerConnectionUpdate(
     const std::string& type,
     const std::string& value) {
   DCHECK(main_thread_.CalledOnValidThread());
-  if (peer_connection_id_map_.find(pc_handler) == peer_connection_id_map_.end())
+  PeerConnectionIdMap::const_iterator it =
+      peer_connection_id_map_.find(pc_handler);
+  if (it == peer_connection_id_map_.end())
+    return;
+
+  PeerConnectionUpdate update;
+  update.lid = it->second;
+  update.type = type;
+  update.value = value;
+  pending_updates_.push_back(update);
+  ScheduleFlush();
+}
+
+void PeerConnectionTracker::AddEncodedStats(int lid, const std::string& data) {
+  DCHECK(main_thread_.CalledOnValidThread());
+  // Stats of a peer connection which has been unregistered since can't be
+  // decoded anymore.
+  if (stats_encoders_.find(lid) == stats_encoders_.end())
+    return;
+
+  PeerConnectionUpdate update;
+  update.lid = lid;
+  update.stats = data;
+  pending_updates_.push_back(update);
+  ScheduleFlush();
+}
+
+void PeerConnectionTracker::ScheduleFlush() {
+  DCHECK(main_thread_.CalledOnValidThread());
+  if (flush_scheduled_)
+    return;
+  flush_scheduled_ = true;
+  base::ThreadTaskRunnerHandle::Get()->PostTask(
+      FROM_HERE,
+      base::Bind(&PeerConnectionTracker::FlushPendingMessages, AsWeakPtr()));
+}
+
+void PeerConnectionTracker::FlushPendingMessages() {
+  DCHECK(main_thread_.CalledOnValidThread());
+  flush_scheduled_ = false;
+  if (pending_updates_.empty())
     return;
 
   RenderThreadImpl::current()->Send(
-      new PeerConnectionTrackerHost_UpdatePeerConnection(
-          peer_connection_id_map_[pc_handler], type, value));
+      new PeerConnectionTrackerHost_UpdatePeerConnections(pending_updates_));
+  pending_updates_.clear();
 }
 
 }  // namespace content
@@ -6,10 +6,14 @@
 #define CONTENT_RENDERER_MEDIA_PEER_CONNECTION_TRACKER_H_
 
 #include <map>
+#include <string>
+#include <vector>
 
 #include "base/compiler_specific.h"
+#include "base/memory/ref_counted.h"
 #include "base/memory/weak_ptr.h"
 #include "base/threading/thread_checker.h"
+#include "content/common/media/peer_connection_tracker_messages.h"
 #include "content/public/renderer/render_process_observer.h"
 #include "third_party/WebKit/public/platform/WebMediaStream.h"
 #include "third_party/WebKit/public/platform/WebRTCPeerConnectionHandlerClient.h"
@@ -29,6 +33,7 @@ class DataChannelInterface;
 }  // namespace webrtc
 
 namespace content {
+class InternalStatsObserver;
 class RTCMediaConstraints;
 class RTCPeerConnectionHandler;
 
@@ -174,10 +179,29 @@ class CONTENT_EXPORT PeerConnectionTracker
                                 const std::string& callback_type,
                                 const std::string& value);
 
+  // Queues a set of stats reports of the peer connection |lid|, encoded by its
+  // StatsEncoder.
+  void AddEncodedStats(int lid, const std::string& data);
+
+  // Updates and stats are sent in batches, at most one message per task, since
+  // negotiation and getStats() produce many of them at once.
+  void ScheduleFlush();
+  void FlushPendingMessages();
+
   // This map stores the local ID assigned to each RTCPeerConnectionHandler.
   typedef std::map<RTCPeerConnectionHandler*, int> PeerConnectionIdMap;
   PeerConnectionIdMap peer_connection_id_map_;
 
+  // The stats encoder of each peer connection, by local ID.
+  class StatsEncoder;
+  friend class InternalStatsObserver;
+  typedef std::map<int, scoped_refptr<StatsEncoder>> StatsEncoderMap;
+  StatsEncoderMap stats_encoders_;
+
+  // Updates and stats, in the order they happened.
+  std::vector<PeerConnectionUpdate> pending_updates_;
+  bool flush_scheduled_;
+
   // This keeps track of the next available local ID.
   int next_lid_;
   base::ThreadChecker main_thread_;
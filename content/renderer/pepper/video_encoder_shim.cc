@@ -6,6 +6,7 @@
 
 #include <inttypes.h>
 
+#include <algorithm>
 #include <deque>
 
 #include "base/bind.h"
@@ -13,6 +14,8 @@
 #include "base/location.h"
 #include "base/single_thread_task_runner.h"
 #include "base/sys_info.h"
+#include "base/threading/thread.h"
+#include "base/threading/worker_pool.h"
 #include "base/thread_task_runner_handle.h"
 #include "content/renderer/pepper/pepper_video_encoder_host.h"
 #include "content/renderer/render_thread_impl.h"
@@ -31,11 +34,13 @@ namespace {
 const int32_t kMaxWidth = 4096;
 const int32_t kMaxHeight = 2176;
 
-// Bitstream buffer size.
-const uint32_t kBitstreamBufferSize = 2 * 1024 * 1024;
+// Minimal bitstream buffer size. Buffers are larger for large frames, so that
+// keyframes of those fit.
+const uint32_t kMinBitstreamBufferSize = 2 * 1024 * 1024;
 
-// Number of frames needs at any given time.
-const uint32_t kInputFrameCount = 1;
+// Number of frames needs at any given time. The plugin can fill the next
+// frames while one is being encoded.
+const uint32_t kInputFrameCount = 4;
 
 // Maximal number or threads used for encoding.
 const int32_t kMaxNumThreads = 8;
@@ -62,6 +67,14 @@ const int32_t kVp9DefaultMaxQuantizer = 30;
 // conferencing)).
 const int kVp9AqModeCyclicRefresh = 3;
 
+// Fastest VP9 speed the encoder falls back to when it can't keep up with the
+// frame rate.
+const int32_t kVp9MaxCpuUsed = 8;
+
+// Number of frames encoded at a speed before it is changed again, so that the
+// average encode time reflects the current speed.
+const int kFramesBetweenSpeedChanges = 10;
+
 void GetVpxCodecParameters(media::VideoCodecProfile codec,
                            vpx_codec_iface_t** vpx_codec,
                            int32_t* min_quantizer,
@@ -89,8 +102,218 @@ void GetVpxCodecParameters(media::VideoCodecProfile codec,
   }
 }
 
+void ShutdownEncodingThread(scoped_ptr<base::Thread> encoding_thread) {
+  encoding_thread->Stop();
+}
+
 }  // namespace
 
+VpxVideoEncoder::VpxVideoEncoder()
+    : config_(new vpx_codec_enc_cfg_t),
+      profile_(media::VIDEO_CODEC_PROFILE_UNKNOWN),
+      framerate_(0),
+      default_cpu_used_(0),
+      cpu_used_(0),
+      frames_since_speed_change_(0) {}
+
+VpxVideoEncoder::~VpxVideoEncoder() {
+  if (encoder_)
+    vpx_codec_destroy(encoder_.get());
+}
+
+bool VpxVideoEncoder::Initialize(const gfx::Size& visible_size,
+                                 media::VideoCodecProfile profile,
+                                 uint32 initial_bitrate) {
+  DCHECK(!encoder_);
+  profile_ = profile;
+
+  vpx_codec_iface_t* vpx_codec;
+  int32_t min_quantizer, max_quantizer;
+  GetVpxCodecParameters(profile, &vpx_codec, &min_quantizer, &max_quantizer,
+                        &default_cpu_used_);
+  cpu_used_ = default_cpu_used_;
+
+  // Populate encoder configuration with default values.
+  if (vpx_codec_enc_config_default(vpx_codec, config_.get(), 0) !=
+      VPX_CODEC_OK) {
+    return false;
+  }
+
+  config_->g_w = visible_size.width();
+  config_->g_h = visible_size.height();
+
+  framerate_ = config_->g_timebase.den;
+
+  config_->g_lag_in_frames = 0;
+  config_->g_timebase.num = 1;
+  config_->g_timebase.den = base::Time::kMicrosecondsPerSecond;
+  config_->rc_target_bitrate = initial_bitrate / 1000;
+  config_->rc_min_quantizer = min_quantizer;
+  config_->rc_max_quantizer = max_quantizer;
+  // Do not saturate CPU utilization just for encoding. On a lower-end system
+  // with only 1 or 2 cores, use only one thread for encoding. On systems with
+  // more cores, allow half of the cores to be used for encoding.
+  config_->g_threads =
+      std::min(kMaxNumThreads, (base::SysInfo::NumberOfProcessors() + 1) / 2);
+
+  // Use Q/CQ mode if no target bitrate is given. Note that in the VP8/CQ case
+  // the meaning of rc_target_bitrate changes to target maximum rate.
+  if (initial_bitrate == 0) {
+    if (profile == media::VP9PROFILE_ANY) {
+      config_->rc_end_usage = VPX_Q;
+    } else if (profile == media::VP8PROFILE_ANY) {
+      config_->rc_end_usage = VPX_CQ;
+      config_->rc_target_bitrate = kVp8MaxCQBitrate;
+    }
+  }
+
+  scoped_ptr<vpx_codec_ctx_t> encoder(new vpx_codec_ctx_t);
+  vpx_codec_flags_t flags = 0;
+  if (vpx_codec_enc_init(encoder.get(), vpx_codec, config_.get(), flags) !=
+      VPX_CODEC_OK) {
+    return false;
+  }
+  encoder_ = encoder.Pass();
+
+  if (vpx_codec_enc_config_set(encoder_.get(), config_.get()) != VPX_CODEC_OK)
+    return false;
+
+  if (vpx_codec_control(encoder_.get(), VP8E_SET_CPUUSED, cpu_used_) !=
+      VPX_CODEC_OK) {
+    return false;
+  }
+
+  if (profile == media::VP9PROFILE_ANY) {
+    if (vpx_codec_control(encoder_.get(), VP9E_SET_AQ_MODE,
+                          kVp9AqModeCyclicRefresh) != VPX_CODEC_OK) {
+      return false;
+    }
+
+    // VP9 only spreads the work of a frame over its threads when the frame is
+    // split in tile columns. Use one column per thread (the value is log2).
+    int tile_columns = 0;
+    while ((2u << tile_columns) <= config_->g_threads)
+      ++tile_columns;
+    if (vpx_codec_control(encoder_.get(), VP9E_SET_TILE_COLUMNS,
+                          tile_columns) != VPX_CODEC_OK) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool VpxVideoEncoder::SetRates(uint32 bitrate, uint32 framerate) {
+  DCHECK(encoder_);
+  framerate_ = framerate;
+
+  uint32 bitrate_kbit = bitrate / 1000;
+  if (config_->rc_target_bitrate == bitrate_kbit)
+    return true;
+
+  config_->rc_target_bitrate = bitrate_kbit;
+  return vpx_codec_enc_config_set(encoder_.get(), config_.get()) ==
+         VPX_CODEC_OK;
+}
+
+bool VpxVideoEncoder::Encode(const scoped_refptr<media::VideoFrame>& frame,
+                             bool force_keyframe,
+                             uint8_t* output,
+                             size_t output_size,
+                             size_t* payload_size,
+                             bool* key_frame) {
+  DCHECK(encoder_);
+  *payload_size = 0;
+  *key_frame = false;
+
+  // Wrapper for vpx_codec_encode() to access the YUV data in the
+  // |video_frame|. Only the VISIBLE rectangle within |video_frame|
+  // is exposed to the codec.
+  vpx_image_t vpx_image;
+  vpx_image_t* const result = vpx_img_wrap(
+      &vpx_image, VPX_IMG_FMT_I420, frame->visible_rect().width(),
+      frame->visible_rect().height(), 1,
+      frame->data(media::VideoFrame::kYPlane));
+  DCHECK_EQ(result, &vpx_image);
+  vpx_image.planes[VPX_PLANE_Y] =
+      frame->visible_data(media::VideoFrame::kYPlane);
+  vpx_image.planes[VPX_PLANE_U] =
+      frame->visible_data(media::VideoFrame::kUPlane);
+  vpx_image.planes[VPX_PLANE_V] =
+      frame->visible_data(media::VideoFrame::kVPlane);
+  vpx_image.stride[VPX_PLANE_Y] = frame->stride(media::VideoFrame::kYPlane);
+  vpx_image.stride[VPX_PLANE_U] = frame->stride(media::VideoFrame::kUPlane);
+  vpx_image.stride[VPX_PLANE_V] = frame->stride(media::VideoFrame::kVPlane);
+
+  vpx_codec_flags_t flags = 0;
+  if (force_keyframe)
+    flags = VPX_EFLAG_FORCE_KF;
+
+  const base::TimeDelta frame_duration =
+      base::TimeDelta::FromSecondsD(1.0 / framerate_);
+  base::TimeTicks start = base::TimeTicks::Now();
+  if (vpx_codec_encode(encoder_.get(), &vpx_image, 0,
+                       frame_duration.InMicroseconds(), flags,
+                       VPX_DL_REALTIME) != VPX_CODEC_OK) {
+    return false;
+  }
+  if (!AdaptSpeed(base::TimeTicks::Now() - start))
+    return false;
+
+  const vpx_codec_cx_pkt_t* packet = nullptr;
+  vpx_codec_iter_t iter = nullptr;
+  while ((packet = vpx_codec_get_cx_data(encoder_.get(), &iter)) != nullptr) {
+    if (packet->kind != VPX_CODEC_CX_FRAME_PKT)
+      continue;
+
+    if (packet->data.frame.sz > output_size)
+      return false;
+    memcpy(output, packet->data.frame.buf, packet->data.frame.sz);
+    *payload_size = packet->data.frame.sz;
+    *key_frame = (packet->data.frame.flags & VPX_FRAME_IS_KEY) != 0;
+    break;  // Done, since all data is provided in one CX_FRAME_PKT packet.
+  }
+  return true;
+}
+
+// static
+size_t VpxVideoEncoder::GetBitstreamBufferSize(const gfx::Size& coded_size) {
+  return std::max(static_cast<size_t>(kMinBitstreamBufferSize),
+                  media::VideoFrame::AllocationSize(media::PIXEL_FORMAT_I420,
+                                                    coded_size) /
+                      2);
+}
+
+bool VpxVideoEncoder::AdaptSpeed(base::TimeDelta encode_time) {
+  // libvpx already trades quality for speed in realtime mode with a negative
+  // VP8 speed; VP9 needs to be told.
+  if (profile_ != media::VP9PROFILE_ANY || framerate_ == 0)
+    return true;
+
+  if (average_encode_time_ == base::TimeDelta())
+    average_encode_time_ = encode_time;
+  else
+    average_encode_time_ = (average_encode_time_ * 7 + encode_time) / 8;
+
+  if (++frames_since_speed_change_ < kFramesBetweenSpeedChanges)
+    return true;
+
+  const base::TimeDelta frame_duration =
+      base::TimeDelta::FromSecondsD(1.0 / framerate_);
+  int cpu_used = cpu_used_;
+  if (average_encode_time_ > frame_duration * 9 / 10)
+    cpu_used = std::min(cpu_used + 1, kVp9MaxCpuUsed);
+  else if (average_encode_time_ < frame_duration / 2)
+    cpu_used = std::max(cpu_used - 1, default_cpu_used_);
+  if (cpu_used == cpu_used_)
+    return true;
+
+  cpu_used_ = cpu_used;
+  frames_since_speed_change_ = 0;
+  return vpx_codec_control(encoder_.get(), VP8E_SET_CPUUSED, cpu_used_) ==
+         VPX_CODEC_OK;
+}
+
 class VideoEncoderShim::EncoderImpl {
  public:
   explicit EncoderImpl(const base::WeakPtr<VideoEncoderShim>& shim);
@@ -135,11 +358,8 @@ class VideoEncoderShim::EncoderImpl {
 
   bool initialized_;
 
-  // Libvpx internal objects. Only valid if |initialized_| is true.
-  vpx_codec_enc_cfg_t config_;
-  vpx_codec_ctx_t encoder_;
-
-  uint32 framerate_;
+  // Only valid if |initialized_| is true.
+  VpxVideoEncoder encoder_;
 
   std::deque<PendingEncode> frames_;
   std::deque<BitstreamBuffer> buffers_;
@@ -153,8 +373,6 @@ VideoEncoderShim::EncoderImpl::EncoderImpl(
 }
 
 VideoEncoderShim::EncoderImpl::~EncoderImpl() {
-  if (initialized_)
-    vpx_codec_destroy(&encoder_);
 }
 
 void VideoEncoderShim::EncoderImpl::Initialize(
@@ -165,76 +383,18 @@ void VideoEncoderShim::EncoderImpl::Initialize(
   gfx::Size coded_size =
       media::VideoFrame::PlaneSize(input_format, 0, input_visible_size);
 
-  vpx_codec_iface_t* vpx_codec;
-  int32_t min_quantizer, max_quantizer, cpu_used;
-  GetVpxCodecParameters(output_profile, &vpx_codec, &min_quantizer,
-                        &max_quantizer, &cpu_used);
-
-  // Populate encoder configuration with default values.
-  if (vpx_codec_enc_config_default(vpx_codec, &config_, 0) != VPX_CODEC_OK) {
-    NotifyError(media::VideoEncodeAccelerator::kPlatformFailureError);
-    return;
-  }
-
-  config_.g_w = input_visible_size.width();
-  config_.g_h = input_visible_size.height();
-
-  framerate_ = config_.g_timebase.den;
-
-  config_.g_lag_in_frames = 0;
-  config_.g_timebase.num = 1;
-  config_.g_timebase.den = base::Time::kMicrosecondsPerSecond;
-  config_.rc_target_bitrate = initial_bitrate / 1000;
-  config_.rc_min_quantizer = min_quantizer;
-  config_.rc_max_quantizer = max_quantizer;
-  // Do not saturate CPU utilization just for encoding. On a lower-end system
-  // with only 1 or 2 cores, use only one thread for encoding. On systems with
-  // more cores, allow half of the cores to be used for encoding.
-  config_.g_threads =
-      std::min(kMaxNumThreads, (base::SysInfo::NumberOfProcessors() + 1) / 2);
-
-  // Use Q/CQ mode if no target bitrate is given. Note that in the VP8/CQ case
-  // the meaning of rc_target_bitrate changes to target maximum rate.
-  if (initial_bitrate == 0) {
-    if (output_profile == media::VP9PROFILE_ANY) {
-      config_.rc_end_usage = VPX_Q;
-    } else if (output_profile == media::VP8PROFILE_ANY) {
-      config_.rc_end_usage = VPX_CQ;
-      config_.rc_target_bitrate = kVp8MaxCQBitrate;
-    }
-  }
-
-  vpx_codec_flags_t flags = 0;
-  if (vpx_codec_enc_init(&encoder_, vpx_codec, &config_, flags) !=
-      VPX_CODEC_OK) {
+  if (!encoder_.Initialize(input_visible_size, output_profile,
+                           initial_bitrate)) {
     NotifyError(media::VideoEncodeAccelerator::kPlatformFailureError);
     return;
   }
   initialized_ = true;
 
-  if (vpx_codec_enc_config_set(&encoder_, &config_) != VPX_CODEC_OK) {
-    NotifyError(media::VideoEncodeAccelerator::kPlatformFailureError);
-    return;
-  }
-
-  if (vpx_codec_control(&encoder_, VP8E_SET_CPUUSED, cpu_used) !=
-      VPX_CODEC_OK) {
-    NotifyError(media::VideoEncodeAccelerator::kPlatformFailureError);
-    return;
-  }
-
-  if (output_profile == media::VP9PROFILE_ANY) {
-    if (vpx_codec_control(&encoder_, VP9E_SET_AQ_MODE,
-                          kVp9AqModeCyclicRefresh) != VPX_CODEC_OK) {
-      NotifyError(media::VideoEncodeAccelerator::kPlatformFailureError);
-      return;
-    }
-  }
-
   renderer_task_runner_->PostTask(
       FROM_HERE,
       base::Bind(&VideoEncoderShim::OnRequireBitstreamBuffers, shim_,
-                 kInputFrameCount, coded_size, kBitstreamBufferSize));
+                 kInputFrameCount, coded_size,
+                 VpxVideoEncoder::GetBitstreamBufferSize(coded_size)));
 }
 
 void VideoEncoderShim::EncoderImpl::Encode(
@@ -254,14 +414,10 @@ void VideoEncoderShim::EncoderImpl::UseOutputBitstreamBuffer(
 void VideoEncoderShim::EncoderImpl::RequestEncodingParametersChange(
     uint32 bitrate,
     uint32 framerate) {
-  framerate_ = framerate;
-
-  uint32 bitrate_kbit = bitrate / 1000;
-  if (config_.rc_target_bitrate == bitrate_kbit)
+  if (!initialized_)
     return;
 
-  config_.rc_target_bitrate = bitrate_kbit;
-  if (vpx_codec_enc_config_set(&encoder_, &config_) != VPX_CODEC_OK)
+  if (!encoder_.SetRates(bitrate, framerate))
     NotifyError(media::VideoEncodeAccelerator::kPlatformFailureError);
 }
 
@@ -280,67 +436,30 @@ void VideoEncoderShim::EncoderImpl::Stop() {
 }
 
 void VideoEncoderShim::EncoderImpl::DoEncode() {
-  while (!frames_.empty() && !buffers_.empty()) {
+  while (initialized_ && !frames_.empty() && !buffers_.empty()) {
     PendingEncode frame = frames_.front();
     frames_.pop_front();
 
-    // Wrapper for vpx_codec_encode() to access the YUV data in the
-    // |video_frame|. Only the VISIBLE rectangle within |video_frame|
-    // is exposed to the codec.
-    vpx_image_t vpx_image;
-    vpx_image_t* const result = vpx_img_wrap(
-        &vpx_image, VPX_IMG_FMT_I420, frame.frame->visible_rect().width(),
-        frame.frame->visible_rect().height(), 1,
-        frame.frame->data(media::VideoFrame::kYPlane));
-    DCHECK_EQ(result, &vpx_image);
-    vpx_image.planes[VPX_PLANE_Y] =
-        frame.frame->visible_data(media::VideoFrame::kYPlane);
-    vpx_image.planes[VPX_PLANE_U] =
-        frame.frame->visible_data(media::VideoFrame::kUPlane);
-    vpx_image.planes[VPX_PLANE_V] =
-        frame.frame->visible_data(media::VideoFrame::kVPlane);
-    vpx_image.stride[VPX_PLANE_Y] =
-        frame.frame->stride(media::VideoFrame::kYPlane);
-    vpx_image.stride[VPX_PLANE_U] =
-        frame.frame->stride(media::VideoFrame::kUPlane);
-    vpx_image.stride[VPX_PLANE_V] =
-        frame.frame->stride(media::VideoFrame::kVPlane);
-
-    vpx_codec_flags_t flags = 0;
-    if (frame.force_keyframe)
-      flags = VPX_EFLAG_FORCE_KF;
-
-    const base::TimeDelta frame_duration =
-        base::TimeDelta::FromSecondsD(1.0 / framerate_);
-    if (vpx_codec_encode(&encoder_, &vpx_image, 0,
-                         frame_duration.InMicroseconds(), flags,
-                         VPX_DL_REALTIME) != VPX_CODEC_OK) {
+    const BitstreamBuffer& buffer = buffers_.front();
+    size_t payload_size = 0;
+    bool key_frame = false;
+    if (!encoder_.Encode(frame.frame, frame.force_keyframe, buffer.mem,
+                         buffer.buffer.size(), &payload_size, &key_frame)) {
       NotifyError(media::VideoEncodeAccelerator::kPlatformFailureError);
       return;
     }
-
-    const vpx_codec_cx_pkt_t* packet = nullptr;
-    vpx_codec_iter_t iter = nullptr;
-    while ((packet = vpx_codec_get_cx_data(&encoder_, &iter)) != nullptr) {
-      if (packet->kind != VPX_CODEC_CX_FRAME_PKT)
-        continue;
-
-      BitstreamBuffer buffer = buffers_.front();
-      buffers_.pop_front();
-
-      CHECK(buffer.buffer.size() >= packet->data.frame.sz);
-      memcpy(buffer.mem, packet->data.frame.buf, packet->data.frame.sz);
-
-      // Pass the media::VideoFrame back to the renderer thread so it's
-      // freed on the right thread.
-      renderer_task_runner_->PostTask(
-          FROM_HERE,
-          base::Bind(&VideoEncoderShim::OnBitstreamBufferReady, shim_,
-                     frame.frame, buffer.buffer.id(),
-                     base::checked_cast<size_t>(packet->data.frame.sz),
-                     (packet->data.frame.flags & VPX_FRAME_IS_KEY) != 0));
-      break;  // Done, since all data is provided in one CX_FRAME_PKT packet.
-    }
+    if (!payload_size)
+      continue;
+
+    int32 buffer_id = buffer.buffer.id();
+    buffers_.pop_front();
+
+    // Pass the media::VideoFrame back to the renderer thread so it's
+    // freed on the right thread.
+    renderer_task_runner_->PostTask(
+        FROM_HERE,
+        base::Bind(&VideoEncoderShim::OnBitstreamBufferReady, shim_,
+                   frame.frame, buffer_id, payload_size, key_frame));
   }
 }
 
@@ -353,18 +472,25 @@ void VideoEncoderShim::EncoderImpl::NotifyError(
 
 VideoEncoderShim::VideoEncoderShim(PepperVideoEncoderHost* host)
     : host_(host),
-      media_task_runner_(
-          RenderThreadImpl::current()->GetMediaThreadTaskRunner()),
+      encoding_thread_(new base::Thread("PepperVideoEncoder")),
       weak_ptr_factory_(this) {
+  encoding_thread_->Start();
+  encoder_task_runner_ = encoding_thread_->task_runner();
   encoder_impl_.reset(new EncoderImpl(weak_ptr_factory_.GetWeakPtr()));
 }
 
 VideoEncoderShim::~VideoEncoderShim() {
   DCHECK(RenderThreadImpl::current());
 
-  media_task_runner_->PostTask(
+  encoder_task_runner_->PostTask(
       FROM_HERE, base::Bind(&VideoEncoderShim::EncoderImpl::Stop,
                             base::Owned(encoder_impl_.release())));
+  // Joining the thread waits for the frame being encoded, so do it on a
+  // worker rather than blocking the renderer main thread.
+  base::WorkerPool::PostTask(
+      FROM_HERE,
+      base::Bind(&ShutdownEncodingThread, base::Passed(&encoding_thread_)),
+      true);
 }
 
 media::VideoEncodeAccelerator::SupportedProfiles
@@ -415,7 +541,7 @@ bool VideoEncoderShim::Initialize(
       output_profile != media::VP9PROFILE_ANY)
     return false;
 
-  media_task_runner_->PostTask(
+  encoder_task_runner_->PostTask(
       FROM_HERE,
       base::Bind(&VideoEncoderShim::EncoderImpl::Initialize,
                  base::Unretained(encoder_impl_.get()), input_format,
@@ -428,7 +554,7 @@ void VideoEncoderShim::Encode(const scoped_refptr<media::VideoFrame>& frame,
                               bool force_keyframe) {
   DCHECK(RenderThreadImpl::current());
 
-  media_task_runner_->PostTask(
+  encoder_task_runner_->PostTask(
       FROM_HERE,
       base::Bind(&VideoEncoderShim::EncoderImpl::Encode,
                  base::Unretained(encoder_impl_.get()), frame, force_keyframe));
@@ -438,7 +564,7 @@ void VideoEncoderShim::UseOutputBitstreamBuffer(
     const media::BitstreamBuffer& buffer) {
   DCHECK(RenderThreadImpl::current());
 
-  media_task_runner_->PostTask(
+  encoder_task_runner_->PostTask(
       FROM_HERE,
       base::Bind(&VideoEncoderShim::EncoderImpl::UseOutputBitstreamBuffer,
                  base::Unretained(encoder_impl_.get()), buffer,
@@ -449,7 +575,7 @@ void VideoEncoderShim::RequestEncodingParametersChange(uint32 bitrate,
                                                        uint32 framerate) {
   DCHECK(RenderThreadImpl::current());
 
-  media_task_runner_->PostTask(
+  encoder_task_runner_->PostTask(
       FROM_HERE,
       base::Bind(
           &VideoEncoderShim::EncoderImpl::RequestEncodingParametersChange,
@@ -9,10 +9,16 @@
 
 #include "base/memory/scoped_ptr.h"
 #include "base/memory/weak_ptr.h"
+#include "base/time/time.h"
+#include "content/common/content_export.h"
 #include "media/video/video_encode_accelerator.h"
 
+struct vpx_codec_ctx;
+struct vpx_codec_enc_cfg;
+
 namespace base {
 class SingleThreadTaskRunner;
+class Thread;
 }
 
 namespace gfx {
@@ -23,6 +29,56 @@ namespace content {
 
 class PepperVideoEncoderHost;
 
+// Encodes I420 frames to VP8 or VP9 with libvpx, for VideoEncoderShim. Must be
+// used on a single thread.
+//
+// Frames are encoded with realtime settings. For VP9, the encoder speeds up
+// when encoding takes more than the time of a frame at the current frame
+// rate, and slows down again when there is time to spare. libvpx does this
+// itself for VP8.
+class CONTENT_EXPORT VpxVideoEncoder {
+ public:
+  VpxVideoEncoder();
+  ~VpxVideoEncoder();
+
+  bool Initialize(const gfx::Size& visible_size,
+                  media::VideoCodecProfile profile,
+                  uint32 initial_bitrate);
+  bool SetRates(uint32 bitrate, uint32 framerate);
+
+  // Encodes |frame| into |output|. |payload_size| is 0 if the encoder dropped
+  // the frame. Fails if the encoded frame doesn't fit in |output_size| bytes.
+  bool Encode(const scoped_refptr<media::VideoFrame>& frame,
+              bool force_keyframe,
+              uint8_t* output,
+              size_t output_size,
+              size_t* payload_size,
+              bool* key_frame);
+
+  // Returns the size of the output buffers for frames of |coded_size|.
+  static size_t GetBitstreamBufferSize(const gfx::Size& coded_size);
+
+  int cpu_used() const { return cpu_used_; }
+
+ private:
+  // Changes the VP9 speed for frames taking |encode_time| to encode.
+  bool AdaptSpeed(base::TimeDelta encode_time);
+
+  scoped_ptr<vpx_codec_enc_cfg> config_;
+  // Only set once initialization succeeded.
+  scoped_ptr<vpx_codec_ctx> encoder_;
+  media::VideoCodecProfile profile_;
+  uint32 framerate_;
+
+  int default_cpu_used_;
+  int cpu_used_;
+  // Moving average of the time spent in libvpx per frame.
+  base::TimeDelta average_encode_time_;
+  int frames_since_speed_change_;
+
+  DISALLOW_COPY_AND_ASSIGN(VpxVideoEncoder);
+};
+
 // This class is a shim to wrap a media::cast::SoftwareVideoEncoder so that it
 // can be used by PepperVideoEncoderHost in place of a
 // media::VideoEncodeAccelerator. This class should be constructed, used, and
@@ -63,8 +119,10 @@ class VideoEncoderShim : public media::VideoEncodeAccelerator {
 
   PepperVideoEncoderHost* host_;
 
-  // Task doing the encoding.
-  scoped_refptr<base::SingleThreadTaskRunner> media_task_runner_;
+  // Each encoder has a thread of its own, so that it neither waits for nor
+  // holds up other media work.
+  scoped_ptr<base::Thread> encoding_thread_;
+  scoped_refptr<base::SingleThreadTaskRunner> encoder_task_runner_;
 
   base::WeakPtrFactory<VideoEncoderShim> weak_ptr_factory_;
 
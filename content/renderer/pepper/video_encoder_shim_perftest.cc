@@ -0,0 +1,96 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "content/renderer/pepper/video_encoder_shim.h"
+
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "base/time/time.h"
+#include "media/base/video_frame.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_test.h"
+#include "ui/gfx/geometry/rect.h"
+#include "ui/gfx/geometry/size.h"
+
+namespace content {
+namespace {
+
+const uint32 kBitrate = 2000000;
+const uint32 kFramerate = 30;
+
+// Encode this many frames, or for this long.
+const int kFrames = 60;
+const int kTimeLimitMs = 10000;
+
+// Returns an I420 frame of |size| with a pattern which moves with |index|.
+scoped_refptr<media::VideoFrame> CreateFrame(const gfx::Size& size,
+                                             int index) {
+  scoped_refptr<media::VideoFrame> frame = media::VideoFrame::CreateFrame(
+      media::PIXEL_FORMAT_I420, size, gfx::Rect(size), size,
+      base::TimeDelta::FromSeconds(index) / kFramerate);
+  for (int y = 0; y < size.height(); ++y) {
+    uint8_t* row = frame->data(media::VideoFrame::kYPlane) +
+                   y * frame->stride(media::VideoFrame::kYPlane);
+    for (int x = 0; x < size.width(); ++x)
+      row[x] = static_cast<uint8_t>(x + y + 4 * index);
+  }
+  for (size_t plane = media::VideoFrame::kUPlane;
+       plane <= media::VideoFrame::kVPlane; ++plane) {
+    memset(frame->data(plane), 128 + index % 16,
+           frame->stride(plane) * frame->rows(plane));
+  }
+  return frame;
+}
+
+class VpxVideoEncoderPerfTest
+    : public testing::TestWithParam<media::VideoCodecProfile> {
+ protected:
+  void RunTest(const std::string& trace, const gfx::Size& size) {
+    VpxVideoEncoder encoder;
+    ASSERT_TRUE(encoder.Initialize(size, GetParam(), kBitrate));
+    ASSERT_TRUE(encoder.SetRates(kBitrate, kFramerate));
+
+    std::vector<uint8_t> output(VpxVideoEncoder::GetBitstreamBufferSize(size));
+    int frames = 0;
+    base::TimeTicks start = base::TimeTicks::Now();
+    base::TimeTicks end =
+        start + base::TimeDelta::FromMilliseconds(kTimeLimitMs);
+    base::TimeTicks now;
+    do {
+      scoped_refptr<media::VideoFrame> frame = CreateFrame(size, frames);
+      size_t payload_size = 0;
+      bool key_frame = false;
+      ASSERT_TRUE(encoder.Encode(frame, false, &output[0], output.size(),
+                                 &payload_size, &key_frame));
+      ++frames;
+      now = base::TimeTicks::Now();
+    } while (frames < kFrames && now < end);
+
+    std::string codec = GetParam() == media::VP8PROFILE_ANY ? "vp8" : "vp9";
+    perf_test::PrintResult("pepper_video_encode_time", "_" + codec, trace,
+                           (now - start).InMillisecondsF() / frames,
+                           "ms/frame", true);
+    perf_test::PrintResult("pepper_video_encode_cpu_used", "_" + codec, trace,
+                           encoder.cpu_used(), "", false);
+  }
+};
+
+TEST_P(VpxVideoEncoderPerfTest, Encode1080p) {
+  RunTest("1080p", gfx::Size(1920, 1080));
+}
+
+TEST_P(VpxVideoEncoderPerfTest, Encode4K) {
+  RunTest("4K", gfx::Size(3840, 2160));
+}
+
+INSTANTIATE_TEST_CASE_P(,
+                        VpxVideoEncoderPerfTest,
+                        testing::Values(media::VP8PROFILE_ANY,
+                                        media::VP9PROFILE_ANY));
+
+}  // namespace
+}  // namespace content
@@ -0,0 +1,90 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "content/renderer/pepper/video_encoder_shim.h"
+
+#include <string.h>
+
+#include <vector>
+
+#include "base/time/time.h"
+#include "media/base/video_frame.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "ui/gfx/geometry/rect.h"
+#include "ui/gfx/geometry/size.h"
+
+namespace content {
+namespace {
+
+const uint32 kBitrate = 2000000;
+const uint32 kFramerate = 30;
+
+// Returns an I420 frame of |size| with a pattern which moves with |index|.
+scoped_refptr<media::VideoFrame> CreateFrame(const gfx::Size& size,
+                                             int index) {
+  scoped_refptr<media::VideoFrame> frame = media::VideoFrame::CreateFrame(
+      media::PIXEL_FORMAT_I420, size, gfx::Rect(size), size,
+      base::TimeDelta::FromSeconds(index) / kFramerate);
+  for (int y = 0; y < size.height(); ++y) {
+    uint8_t* row = frame->data(media::VideoFrame::kYPlane) +
+                   y * frame->stride(media::VideoFrame::kYPlane);
+    for (int x = 0; x < size.width(); ++x)
+      row[x] = static_cast<uint8_t>(x + y + 4 * index);
+  }
+  for (size_t plane = media::VideoFrame::kUPlane;
+       plane <= media::VideoFrame::kVPlane; ++plane) {
+    memset(frame->data(plane), 128 + index % 16,
+           frame->stride(plane) * frame->rows(plane));
+  }
+  return frame;
+}
+
+class VpxVideoEncoderTest
+    : public testing::TestWithParam<media::VideoCodecProfile> {};
+
+TEST_P(VpxVideoEncoderTest, Encode) {
+  const gfx::Size size(320, 240);
+  VpxVideoEncoder encoder;
+  ASSERT_TRUE(encoder.Initialize(size, GetParam(), kBitrate));
+
+  std::vector<uint8_t> output(VpxVideoEncoder::GetBitstreamBufferSize(size));
+  for (int i = 0; i < 5; ++i) {
+    size_t payload_size = 0;
+    bool key_frame = false;
+    ASSERT_TRUE(encoder.Encode(CreateFrame(size, i), i == 3, &output[0],
+                               output.size(), &payload_size, &key_frame));
+    EXPECT_LT(0u, payload_size);
+    EXPECT_EQ(i == 0 || i == 3, key_frame) << i;
+  }
+}
+
+TEST_P(VpxVideoEncoderTest, OutputTooSmall) {
+  const gfx::Size size(320, 240);
+  VpxVideoEncoder encoder;
+  ASSERT_TRUE(encoder.Initialize(size, GetParam(), kBitrate));
+
+  uint8_t output[1];
+  size_t payload_size = 0;
+  bool key_frame = false;
+  EXPECT_FALSE(encoder.Encode(CreateFrame(size, 0), true, output,
+                              sizeof(output), &payload_size, &key_frame));
+}
+
+INSTANTIATE_TEST_CASE_P(,
+                        VpxVideoEncoderTest,
+                        testing::Values(media::VP8PROFILE_ANY,
+                                        media::VP9PROFILE_ANY));
+
+TEST(VpxVideoEncoderBufferTest, BitstreamBufferSize) {
+  // Small frames get the minimal buffer size, large ones half a frame.
+  EXPECT_EQ(2u * 1024 * 1024,
+            VpxVideoEncoder::GetBitstreamBufferSize(gfx::Size(640, 480)));
+  const gfx::Size size(4096, 2176);
+  EXPECT_EQ(media::VideoFrame::AllocationSize(media::PIXEL_FORMAT_I420, size) /
+                2,
+            VpxVideoEncoder::GetBitstreamBufferSize(size));
+}
+
+}  // namespace
+}  // namespace content
@@ -1993,6 +1993,7 @@ void RenderThreadImpl::OnRendererVisible() {
 void RenderThreadImpl::ReleaseFreeMemory() {
   base::allocator::ReleaseFreeMemory();
   discardable_shared_memory_manager()->ReleaseFreeMemory();
+  gpu_memory_buffer_manager()->ReleaseFreeMemory();
 
   if (blink_platform_impl_)
     blink::decommitFreeableMemory();
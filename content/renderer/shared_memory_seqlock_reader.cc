@@ -7,7 +7,8 @@
 namespace content {
 namespace internal {
 
-SharedMemorySeqLockReaderBase::SharedMemorySeqLockReaderBase() { }
+SharedMemorySeqLockReaderBase::SharedMemorySeqLockReaderBase()
+    : has_fetched_version_(false), fetched_version_(0) { }
 
 SharedMemorySeqLockReaderBase::~SharedMemorySeqLockReaderBase() { }
 
@@ -15,6 +16,7 @@ void*
 SharedMemorySeqLockReaderBase::InitializeSharedMemory(
     base::SharedMemoryHandle shared_memory_handle, size_t buffer_size) {
   renderer_shared_memory_handle_ = shared_memory_handle;
+  has_fetched_version_ = false;
   if (!base::SharedMemory::IsHandleValid(renderer_shared_memory_handle_))
     return 0;
   renderer_shared_memory_.reset(new base::SharedMemory(
@@ -53,8 +55,17 @@ bool SharedMemorySeqLockReaderBase::FetchFromBuffer(
 
   // New data was read successfully, copy it into the output buffer.
   memcpy(final, temp, size);
+  has_fetched_version_ = true;
+  fetched_version_ = version;
   return true;
 }
 
+bool SharedMemorySeqLockReaderBase::HasNewDataInBuffer(
+    content::OneWriterSeqLock* seqlock) {
+  if (!base::SharedMemory::IsHandleValid(renderer_shared_memory_handle_))
+    return false;
+  return !has_fetched_version_ || seqlock->ReadBegin() != fetched_version_;
+}
+
 }  // namespace internal
 }  // namespace content
@@ -25,9 +25,15 @@ class SharedMemorySeqLockReaderBase  {
   bool FetchFromBuffer(content::OneWriterSeqLock* seqlock, void* final,
       void* temp, void* from, size_t size);
 
+  // Returns true if the buffer may have been written since the last
+  // successful FetchFromBuffer().
+  bool HasNewDataInBuffer(content::OneWriterSeqLock* seqlock);
+
   static const int kMaximumContentionCount = 10;
   base::SharedMemoryHandle renderer_shared_memory_handle_;
   scoped_ptr<base::SharedMemory> renderer_shared_memory_;
+  bool has_fetched_version_;
+  base::subtle::Atomic32 fetched_version_;
 };
 
 }  // namespace internal
@@ -48,6 +54,13 @@ class SharedMemorySeqLockReader
         &buffer_->data, sizeof(*temp_buffer_));
   }
 
+  // Returns true if there is data GetLatestData() hasn't returned yet. This
+  // only looks at the sequence number, so it is cheap enough to poll.
+  bool HasNewData() {
+    DCHECK(buffer_);
+    return HasNewDataInBuffer(&buffer_->seqlock);
+  }
+
   bool Initialize(base::SharedMemoryHandle shared_memory_handle) {
     if (void* memory = InitializeSharedMemory(
         shared_memory_handle, sizeof(SharedMemorySeqLockBuffer<Data>))) {
@@ -4,6 +4,7 @@
 
 #include "google_apis/gaia/oauth2_token_service.h"
 
+#include <algorithm>
 #include <vector>
 
 #include "base/bind.h"
@@ -13,6 +14,7 @@
 #include "base/profiler/scoped_tracker.h"
 #include "base/rand_util.h"
 #include "base/stl_util.h"
+#include "base/time/default_clock.h"
 #include "base/time/time.h"
 #include "base/timer/timer.h"
 #include "google_apis/gaia/gaia_urls.h"
@@ -21,6 +23,18 @@
 #include "google_apis/gaia/oauth2_token_service_delegate.h"
 #include "net/url_request/url_request_context_getter.h"
 
+namespace {
+
+// A cached token is refreshed in the background once it is this close to
+// expiring, provided it is hot (see kMinCacheHitsForRefreshAhead).
+const int kRefreshAheadWindowSeconds = 5 * 60;
+
+// The number of requests a cached token must have served before it is
+// considered hot enough to be refreshed ahead of its expiration.
+const int kMinCacheHitsForRefreshAhead = 2;
+
+}  // namespace
+
 int OAuth2TokenService::max_fetch_retry_num_ = 5;
 
 OAuth2TokenService::RequestParameters::RequestParameters(
@@ -50,6 +64,9 @@ bool OAuth2TokenService::RequestParameters::operator<(
   return scopes < p.scopes;
 }
 
+OAuth2TokenService::CacheEntry::CacheEntry() : hits(0) {
+}
+
 OAuth2TokenService::RequestImpl::RequestImpl(
     const std::string& account_id,
     OAuth2TokenService::Consumer* consumer)
@@ -384,7 +401,8 @@ OAuth2TokenService::Consumer::~Consumer() {
 }
 
 OAuth2TokenService::OAuth2TokenService(OAuth2TokenServiceDelegate* delegate)
-    : delegate_(delegate) {
+    : clock_(new base::DefaultClock()),
+      delegate_(delegate) {
   DCHECK(delegate_);
 }
 
@@ -518,6 +536,7 @@ OAuth2TokenService::StartRequestForClientWithContext(
             "422460 OAuth2TokenService::StartRequestForClientWithContext 3"));
 
     StartCacheLookupRequest(request.get(), request_parameters, consumer);
+    OnCacheHit(getter, client_secret, request_parameters);
   } else {
     FetchOAuth2Token(request.get(),
                      account_id,
@@ -541,16 +560,15 @@ void OAuth2TokenService::FetchOAuth2Token(RequestImpl* request,
       FROM_HERE_WITH_EXPLICIT_FUNCTION(
           "422460 OAuth2TokenService::FetchOAuth2Token"));
 
-  // If there is already a pending fetcher for |scopes| and |account_id|,
-  // simply register this |request| for those results rather than starting
-  // a new fetcher.
+  // If there is already a pending fetcher for |scopes| (or a superset of them)
+  // and |account_id|, simply register this |request| for those results rather
+  // than starting a new fetcher.
   RequestParameters request_parameters = RequestParameters(client_id,
                                                            account_id,
                                                            scopes);
-  std::map<RequestParameters, Fetcher*>::iterator iter =
-      pending_fetchers_.find(request_parameters);
-  if (iter != pending_fetchers_.end()) {
-    iter->second->AddWaitingRequest(request->AsWeakPtr());
+  Fetcher* pending_fetcher = FindPendingFetcher(request_parameters);
+  if (pending_fetcher) {
+    pending_fetcher->AddWaitingRequest(request->AsWeakPtr());
     return;
   }
 
@@ -705,31 +723,137 @@ bool OAuth2TokenService::HasCacheEntry(
 const OAuth2TokenService::CacheEntry* OAuth2TokenService::GetCacheEntry(
     const RequestParameters& request_parameters) {
   DCHECK(CalledOnValidThread());
-  TokenCache::iterator token_iterator = token_cache_.find(request_parameters);
+  TokenCache::iterator token_iterator = FindCacheEntry(request_parameters);
   if (token_iterator == token_cache_.end())
     return NULL;
-  if (token_iterator->second.expiration_date <= base::Time::Now()) {
+  return &token_iterator->second;
+}
+
+OAuth2TokenService::TokenCache::iterator OAuth2TokenService::FindCacheEntry(
+    const RequestParameters& request_parameters) {
+  DCHECK(CalledOnValidThread());
+  const base::Time now = clock_->Now();
+  TokenCache::iterator token_iterator = token_cache_.find(request_parameters);
+  if (token_iterator != token_cache_.end()) {
+    if (token_iterator->second.expiration_date > now)
+      return token_iterator;
     token_cache_.erase(token_iterator);
-    return NULL;
   }
-  return &token_iterator->second;
+
+  // A token issued for a superset of the requested scopes is just as good.
+  // Entries are ordered by client id, then account id, so those for the same
+  // client and account are contiguous and start at the one with no scopes.
+  const ScopeSet& scopes = request_parameters.scopes;
+  token_iterator = token_cache_.lower_bound(
+      RequestParameters(request_parameters.client_id,
+                        request_parameters.account_id,
+                        ScopeSet()));
+  while (token_iterator != token_cache_.end() &&
+         token_iterator->first.client_id == request_parameters.client_id &&
+         token_iterator->first.account_id == request_parameters.account_id) {
+    const ScopeSet& cached_scopes = token_iterator->first.scopes;
+    if (token_iterator->second.expiration_date <= now) {
+      token_cache_.erase(token_iterator++);
+      continue;
+    }
+    if (std::includes(cached_scopes.begin(), cached_scopes.end(),
+                      scopes.begin(), scopes.end())) {
+      return token_iterator;
+    }
+    ++token_iterator;
+  }
+  return token_cache_.end();
+}
+
+void OAuth2TokenService::OnCacheHit(
+    net::URLRequestContextGetter* getter,
+    const std::string& client_secret,
+    const RequestParameters& request_parameters) {
+  TokenCache::iterator token_iterator = FindCacheEntry(request_parameters);
+  DCHECK(token_iterator != token_cache_.end());
+  CacheEntry& entry = token_iterator->second;
+  ++entry.hits;
+  if (entry.hits < kMinCacheHitsForRefreshAhead ||
+      entry.expiration_date - clock_->Now() >
+          base::TimeDelta::FromSeconds(kRefreshAheadWindowSeconds)) {
+    return;
+  }
+
+  // Refresh the token for the scopes of the entry actually used, which may be
+  // a superset of the requested ones. No request waits on the result; it
+  // replaces the cache entry once fetched.
+  const RequestParameters cached_parameters = token_iterator->first;
+  if (pending_fetchers_.count(cached_parameters))
+    return;
+  DVLOG(1) << "Refreshing access token ahead of its expiration.";
+  pending_fetchers_[cached_parameters] =
+      Fetcher::CreateAndStart(this,
+                              cached_parameters.account_id,
+                              getter,
+                              cached_parameters.client_id,
+                              client_secret,
+                              cached_parameters.scopes,
+                              base::WeakPtr<RequestImpl>());
+}
+
+OAuth2TokenService::Fetcher* OAuth2TokenService::FindPendingFetcher(
+    const RequestParameters& request_parameters) {
+  PendingFetcherMap::iterator iter =
+      pending_fetchers_.find(request_parameters);
+  if (iter != pending_fetchers_.end())
+    return iter->second;
+
+  // Join a fetch for a superset of the requested scopes instead of starting
+  // another one.
+  const ScopeSet& scopes = request_parameters.scopes;
+  for (iter = pending_fetchers_.lower_bound(
+           RequestParameters(request_parameters.client_id,
+                             request_parameters.account_id,
+                             ScopeSet()));
+       iter != pending_fetchers_.end() &&
+       iter->first.client_id == request_parameters.client_id &&
+       iter->first.account_id == request_parameters.account_id;
+       ++iter) {
+    const ScopeSet& pending_scopes = iter->first.scopes;
+    if (std::includes(pending_scopes.begin(), pending_scopes.end(),
+                      scopes.begin(), scopes.end())) {
+      return iter->second;
+    }
+  }
+  return NULL;
 }
 
 bool OAuth2TokenService::RemoveCacheEntry(
     const RequestParameters& request_parameters,
     const std::string& token_to_remove) {
   DCHECK(CalledOnValidThread());
-  TokenCache::iterator token_iterator = token_cache_.find(request_parameters);
-  if (token_iterator != token_cache_.end() &&
-      token_iterator->second.access_token == token_to_remove) {
-    FOR_EACH_OBSERVER(DiagnosticsObserver, diagnostics_observer_list_,
-                      OnTokenRemoved(request_parameters.account_id,
-                                     request_parameters.scopes));
-    token_cache_.erase(token_iterator);
-    return true;
+  // The token may have been served from an entry for a superset of the
+  // requested scopes, so look at every entry for this client and account.
+  const ScopeSet& scopes = request_parameters.scopes;
+  bool removed = false;
+  TokenCache::iterator token_iterator = token_cache_.lower_bound(
+      RequestParameters(request_parameters.client_id,
+                        request_parameters.account_id,
+                        ScopeSet()));
+  while (token_iterator != token_cache_.end() &&
+         token_iterator->first.client_id == request_parameters.client_id &&
+         token_iterator->first.account_id == request_parameters.account_id) {
+    const ScopeSet& cached_scopes = token_iterator->first.scopes;
+    if (token_iterator->second.access_token == token_to_remove &&
+        std::includes(cached_scopes.begin(), cached_scopes.end(),
+                      scopes.begin(), scopes.end())) {
+      FOR_EACH_OBSERVER(DiagnosticsObserver, diagnostics_observer_list_,
+                        OnTokenRemoved(request_parameters.account_id,
+                                       cached_scopes));
+      token_cache_.erase(token_iterator++);
+      removed = true;
+    } else {
+      ++token_iterator;
+    }
   }
-  return false;
+  return removed;
 }
+
 void OAuth2TokenService::UpdateAuthError(const std::string& account_id,
                                          const GoogleServiceAuthError& error) {
   delegate_->UpdateAuthError(account_id, error);
@@ -811,6 +935,10 @@ void OAuth2TokenService::CancelFetchers(
   }
 }
 
+void OAuth2TokenService::SetClockForTesting(scoped_ptr<base::Clock> clock) {
+  clock_ = clock.Pass();
+}
+
 void OAuth2TokenService::set_max_authorization_token_fetch_retries_for_testing(
     int max_retries) {
   DCHECK(CalledOnValidThread());
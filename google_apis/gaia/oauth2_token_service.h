@@ -20,6 +20,10 @@
 #include "google_apis/gaia/oauth2_access_token_consumer.h"
 #include "google_apis/gaia/oauth2_access_token_fetcher.h"
 
+namespace base {
+class Clock;
+}
+
 namespace net {
 class URLRequestContextGetter;
 }
@@ -51,6 +55,12 @@ class OAuth2TokenServiceDelegate;
 //
 // The caller of StartRequest() owns the returned request and is responsible to
 // delete the request even once the callback has been invoked.
+//
+// Access tokens are cached until they expire. A cached token is also used for
+// requests whose scopes are a subset of the token's scopes, and concurrent
+// requests share a single fetch. Tokens that keep being requested are
+// refreshed in the background shortly before they expire, so that consumers
+// never wait on a fetch for them.
 class OAuth2TokenService : public base::NonThreadSafe {
  public:
   // A set of scopes in OAuth2 authentication.
@@ -199,6 +209,9 @@ class OAuth2TokenService : public base::NonThreadSafe {
                                       const ScopeSet& scopes,
                                       const std::string& access_token);
 
+  // Overrides the clock used to decide when cached tokens expire.
+  void SetClockForTesting(scoped_ptr<base::Clock> clock);
+
   void set_max_authorization_token_fetch_retries_for_testing(int max_retries);
   // Returns the current number of pending fetchers matching given params.
   size_t GetNumPendingRequestsForTesting(
@@ -315,10 +328,17 @@ class OAuth2TokenService : public base::NonThreadSafe {
 
   // Struct that contains the information of an OAuth2 access token.
   struct CacheEntry {
+    CacheEntry();
+
     std::string access_token;
     base::Time expiration_date;
+    // The number of requests served from the cache with this entry.
+    int hits;
   };
 
+  // The cache of currently valid tokens.
+  typedef std::map<RequestParameters, CacheEntry> TokenCache;
+
   // This method does the same as |StartRequestWithContext| except it
   // uses |client_id| and |client_secret| to identify OAuth
   // client app instead of using Chrome's default values.
@@ -346,6 +366,24 @@ class OAuth2TokenService : public base::NonThreadSafe {
   // the returned entry is done.
   const CacheEntry* GetCacheEntry(const RequestParameters& client_scopes);
 
+  // Returns the cache entry holding a currently valid token for
+  // |client_scopes|: the entry for exactly those scopes if there is one, else
+  // any entry for the same client and account whose scopes are a superset.
+  // Expired entries encountered on the way are removed. Returns
+  // token_cache_.end() if there is no such entry.
+  TokenCache::iterator FindCacheEntry(const RequestParameters& client_scopes);
+
+  // Records that a request for |client_scopes| was served from the cache, and
+  // starts a background refresh of the entry used if it is hot and close to
+  // expiring.
+  void OnCacheHit(net::URLRequestContextGetter* getter,
+                  const std::string& client_secret,
+                  const RequestParameters& client_scopes);
+
+  // Returns the pending fetcher whose results can satisfy |client_scopes|, or
+  // NULL if there is none.
+  Fetcher* FindPendingFetcher(const RequestParameters& client_scopes);
+
   // Removes an access token for the given set of scopes from the cache.
   // Returns true if the entry was removed, otherwise false.
   bool RemoveCacheEntry(const RequestParameters& client_scopes,
@@ -357,10 +395,11 @@ class OAuth2TokenService : public base::NonThreadSafe {
   // Called when a number of fetchers need to be canceled.
   void CancelFetchers(std::vector<Fetcher*> fetchers_to_cancel);
 
-  // The cache of currently valid tokens.
-  typedef std::map<RequestParameters, CacheEntry> TokenCache;
   TokenCache token_cache_;
 
+  // Decides when cached tokens expire.
+  scoped_ptr<base::Clock> clock_;
+
   scoped_ptr<OAuth2TokenServiceDelegate> delegate_;
 
   // A map from fetch parameters to a fetcher that is fetching an OAuth2 access
@@ -380,6 +419,8 @@ class OAuth2TokenService : public base::NonThreadSafe {
   FRIEND_TEST_ALL_PREFIXES(OAuth2TokenServiceTest,
                            SameScopesRequestedForDifferentClients);
   FRIEND_TEST_ALL_PREFIXES(OAuth2TokenServiceTest, UpdateClearsCache);
+  FRIEND_TEST_ALL_PREFIXES(OAuth2TokenServiceTest,
+                           SupersetScopesServedFromCache);
 
   DISALLOW_COPY_AND_ASSIGN(OAuth2TokenService);
 };
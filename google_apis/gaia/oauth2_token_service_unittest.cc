@@ -6,8 +6,10 @@
 
 #include "base/message_loop/message_loop.h"
 #include "base/run_loop.h"
+#include "base/test/simple_test_clock.h"
 #include "google_apis/gaia/fake_oauth2_token_service_delegate.h"
 #include "google_apis/gaia/gaia_constants.h"
+#include "google_apis/gaia/gaia_urls.h"
 #include "google_apis/gaia/google_service_auth_error.h"
 #include "google_apis/gaia/oauth2_access_token_consumer.h"
 #include "google_apis/gaia/oauth2_access_token_fetcher_impl.h"
@@ -675,3 +677,137 @@ TEST_F(OAuth2TokenServiceTest, UpdateClearsCache) {
   EXPECT_EQ("another token", consumer_.last_token_);
   EXPECT_EQ(1, (int)oauth2_service_->token_cache_.size());
 }
+
+TEST_F(OAuth2TokenServiceTest, SupersetScopesServedFromCache) {
+  OAuth2TokenService::ScopeSet scopes;
+  scopes.insert("s1");
+  scopes.insert("s2");
+  OAuth2TokenService::ScopeSet subset_scopes;
+  subset_scopes.insert("s1");
+  OAuth2TokenService::ScopeSet other_scopes;
+  other_scopes.insert("s1");
+  other_scopes.insert("s3");
+  oauth2_service_->GetFakeOAuth2TokenServiceDelegate()->UpdateCredentials(
+      account_id_, "refreshToken");
+
+  scoped_ptr<OAuth2TokenService::Request> request(
+      oauth2_service_->StartRequest(account_id_, scopes, &consumer_));
+  base::RunLoop().RunUntilIdle();
+  net::TestURLFetcher* fetcher = factory_.GetFetcherByID(0);
+  ASSERT_TRUE(fetcher);
+  fetcher->set_response_code(net::HTTP_OK);
+  fetcher->SetResponseString(GetValidTokenResponse("token", 3600));
+  fetcher->delegate()->OnURLFetchComplete(fetcher);
+  EXPECT_EQ(1, consumer_.number_of_successful_tokens_);
+
+  // The token covers a subset of its scopes without a network request.
+  scoped_ptr<OAuth2TokenService::Request> request2(
+      oauth2_service_->StartRequest(account_id_, subset_scopes, &consumer_));
+  base::RunLoop().RunUntilIdle();
+  EXPECT_FALSE(factory_.GetFetcherByID(0));
+  EXPECT_EQ(2, consumer_.number_of_successful_tokens_);
+  EXPECT_EQ("token", consumer_.last_token_);
+
+  // Invalidating it for the subset removes it for the superset as well.
+  oauth2_service_->InvalidateAccessToken(account_id_, subset_scopes, "token");
+  EXPECT_EQ(0U, oauth2_service_->token_cache_.size());
+
+  // Scopes that are not covered need a new token.
+  scoped_ptr<OAuth2TokenService::Request> request3(
+      oauth2_service_->StartRequest(account_id_, other_scopes, &consumer_));
+  base::RunLoop().RunUntilIdle();
+  EXPECT_TRUE(factory_.GetFetcherByID(0));
+  EXPECT_EQ(2, consumer_.number_of_successful_tokens_);
+}
+
+TEST_F(OAuth2TokenServiceTest, SubsetRequestJoinsPendingFetch) {
+  OAuth2TokenService::ScopeSet scopes;
+  scopes.insert("s1");
+  scopes.insert("s2");
+  OAuth2TokenService::ScopeSet subset_scopes;
+  subset_scopes.insert("s2");
+  oauth2_service_->GetFakeOAuth2TokenServiceDelegate()->UpdateCredentials(
+      account_id_, "refreshToken");
+
+  scoped_ptr<OAuth2TokenService::Request> request(
+      oauth2_service_->StartRequest(account_id_, scopes, &consumer_));
+  scoped_ptr<OAuth2TokenService::Request> request2(
+      oauth2_service_->StartRequest(account_id_, subset_scopes, &consumer_));
+  base::RunLoop().RunUntilIdle();
+  const std::string& client_id =
+      GaiaUrls::GetInstance()->oauth2_chrome_client_id();
+  EXPECT_EQ(2U, oauth2_service_->GetNumPendingRequestsForTesting(
+                    client_id, account_id_, scopes));
+  EXPECT_EQ(0U, oauth2_service_->GetNumPendingRequestsForTesting(
+                    client_id, account_id_, subset_scopes));
+
+  net::TestURLFetcher* fetcher = factory_.GetFetcherByID(0);
+  ASSERT_TRUE(fetcher);
+  fetcher->set_response_code(net::HTTP_OK);
+  fetcher->SetResponseString(GetValidTokenResponse("token", 3600));
+  fetcher->delegate()->OnURLFetchComplete(fetcher);
+  EXPECT_EQ(2, consumer_.number_of_successful_tokens_);
+  EXPECT_EQ(0, consumer_.number_of_errors_);
+  EXPECT_EQ("token", consumer_.last_token_);
+}
+
+TEST_F(OAuth2TokenServiceTest, RefreshAheadOfExpiration) {
+  base::SimpleTestClock* clock = new base::SimpleTestClock();
+  clock->SetNow(base::Time::Now());
+  oauth2_service_->SetClockForTesting(make_scoped_ptr(clock));
+  oauth2_service_->GetFakeOAuth2TokenServiceDelegate()->UpdateCredentials(
+      account_id_, "refreshToken");
+
+  scoped_ptr<OAuth2TokenService::Request> request(
+      oauth2_service_->StartRequest(account_id_,
+                                    OAuth2TokenService::ScopeSet(),
+                                    &consumer_));
+  base::RunLoop().RunUntilIdle();
+  net::TestURLFetcher* fetcher = factory_.GetFetcherByID(0);
+  ASSERT_TRUE(fetcher);
+  fetcher->set_response_code(net::HTTP_OK);
+  fetcher->SetResponseString(GetValidTokenResponse("token", 3600));
+  fetcher->delegate()->OnURLFetchComplete(fetcher);
+  EXPECT_EQ(1, consumer_.number_of_successful_tokens_);
+
+  // Well before expiration the token is simply served from the cache.
+  scoped_ptr<OAuth2TokenService::Request> request2(
+      oauth2_service_->StartRequest(account_id_,
+                                    OAuth2TokenService::ScopeSet(),
+                                    &consumer_));
+  base::RunLoop().RunUntilIdle();
+  EXPECT_EQ(2, consumer_.number_of_successful_tokens_);
+  EXPECT_FALSE(factory_.GetFetcherByID(0));
+
+  // Shortly before expiration the token is still served from the cache, and a
+  // replacement is fetched in the background.
+  clock->Advance(base::TimeDelta::FromSeconds(3600 - 60));
+  scoped_ptr<OAuth2TokenService::Request> request3(
+      oauth2_service_->StartRequest(account_id_,
+                                    OAuth2TokenService::ScopeSet(),
+                                    &consumer_));
+  base::RunLoop().RunUntilIdle();
+  EXPECT_EQ(3, consumer_.number_of_successful_tokens_);
+  EXPECT_EQ("token", consumer_.last_token_);
+  fetcher = factory_.GetFetcherByID(0);
+  ASSERT_TRUE(fetcher);
+  fetcher->set_response_code(net::HTTP_OK);
+  // Expiration dates are computed from the real clock, which |clock| is now
+  // ahead of, so give the replacement a lifetime that covers the difference.
+  fetcher->SetResponseString(GetValidTokenResponse("token2", 2 * 3600));
+  fetcher->delegate()->OnURLFetchComplete(fetcher);
+  EXPECT_EQ(3, consumer_.number_of_successful_tokens_);
+
+  // Once the original token has expired, requests get the replacement without
+  // waiting on the network.
+  clock->Advance(base::TimeDelta::FromSeconds(120));
+  scoped_ptr<OAuth2TokenService::Request> request4(
+      oauth2_service_->StartRequest(account_id_,
+                                    OAuth2TokenService::ScopeSet(),
+                                    &consumer_));
+  base::RunLoop().RunUntilIdle();
+  EXPECT_FALSE(factory_.GetFetcherByID(0));
+  EXPECT_EQ(4, consumer_.number_of_successful_tokens_);
+  EXPECT_EQ(0, consumer_.number_of_errors_);
+  EXPECT_EQ("token2", consumer_.last_token_);
+}
@@ -54,8 +54,9 @@ class GCM_EXPORT ConnectionHandler {
   // a connection reset happens externally to the handler.
   virtual void Reset() = 0;
 
-  // Checks that a handshake has been completed and a message is not already
-  // in flight.
+  // Checks that a handshake has been completed and the handler is able to
+  // accept another message. Implementations may accept several messages while
+  // a previous write is still in flight.
   virtual bool CanSendMessage() const = 0;
 
   // Send an MCS protobuf message. CanSendMessage() must be true.
@@ -40,6 +40,25 @@ const int kDefaultDataPacketLimit = 1024 * 4;
 // The current MCS protocol version.
 const int kMCSVersion = 41;
 
+// Messages sent while a write is in flight are queued and packed into a single
+// socket write of at most this many bytes (the size of the socket output
+// stream buffer) once the write completes. CanSendMessage() returns false
+// while this much data is already queued.
+const size_t kMaxWriteBatchBytes = 1024 * 8;
+
+// Writes |message| in the MCS message form (tag + varint size + bytes) to
+// |output|.
+void WriteMessage(const google::protobuf::MessageLite& message,
+                  ZeroCopyOutputStream* output) {
+  CodedOutputStream coded_output_stream(output);
+  DVLOG(1) << "Writing proto of size " << message.ByteSize();
+  int tag = GetMCSProtoTag(message);
+  DCHECK_NE(tag, -1);
+  coded_output_stream.WriteRaw(&tag, 1);
+  coded_output_stream.WriteVarint32(message.ByteSize());
+  message.SerializeToCodedStream(&coded_output_stream);
+}
+
 }  // namespace
 
 ConnectionHandlerImpl::ConnectionHandlerImpl(
@@ -50,6 +69,8 @@ ConnectionHandlerImpl::ConnectionHandlerImpl(
     : read_timeout_(read_timeout),
       socket_(NULL),
       handshake_complete_(false),
+      pending_bytes_(0),
+      messages_in_flight_(0),
       message_tag_(0),
       message_size_(0),
       read_callback_(read_callback),
@@ -73,6 +94,9 @@ void ConnectionHandlerImpl::Init(
   weak_ptr_factory_.InvalidateWeakPtrs();
 
   handshake_complete_ = false;
+  pending_messages_.clear();
+  pending_bytes_ = 0;
+  messages_in_flight_ = 0;
   message_tag_ = 0;
   message_size_ = 0;
   socket_ = socket;
@@ -88,24 +112,66 @@ void ConnectionHandlerImpl::Reset() {
 
 bool ConnectionHandlerImpl::CanSendMessage() const {
   return handshake_complete_ && output_stream_.get() &&
-      output_stream_->GetState() == SocketOutputStream::EMPTY;
+      output_stream_->GetState() != SocketOutputStream::CLOSED &&
+      pending_bytes_ < kMaxWriteBatchBytes;
 }
 
 void ConnectionHandlerImpl::SendMessage(
     const google::protobuf::MessageLite& message) {
+  DCHECK(CanSendMessage());
+
+  if (messages_in_flight_ == 0 && pending_messages_.empty()) {
+    // Nothing is queued ahead of this message, so write it straight into the
+    // socket stream.
+    DCHECK_EQ(output_stream_->GetState(), SocketOutputStream::EMPTY);
+    WriteMessage(message, output_stream_.get());
+    FlushOutputStream(1);
+    return;
+  }
+
+  // A write is in flight. Queue the message so that it is packed together
+  // with any others sent in the meantime once that write completes.
+  std::string serialized;
+  {
+    StringOutputStream string_output_stream(&serialized);
+    WriteMessage(message, &string_output_stream);
+  }
+  pending_bytes_ += serialized.size();
+  pending_messages_.push_back(std::string());
+  pending_messages_.back().swap(serialized);
+}
+
+void ConnectionHandlerImpl::FlushPendingMessages() {
+  DCHECK_EQ(messages_in_flight_, 0);
+  DCHECK(!pending_messages_.empty());
   DCHECK_EQ(output_stream_->GetState(), SocketOutputStream::EMPTY);
-  DCHECK(handshake_complete_);
 
+  int message_count = 0;
+  size_t batch_bytes = 0;
   {
     CodedOutputStream coded_output_stream(output_stream_.get());
-    DVLOG(1) << "Writing proto of size " << message.ByteSize();
-    int tag = GetMCSProtoTag(message);
-    DCHECK_NE(tag, -1);
-    coded_output_stream.WriteRaw(&tag, 1);
-    coded_output_stream.WriteVarint32(message.ByteSize());
-    message.SerializeToCodedStream(&coded_output_stream);
+    while (!pending_messages_.empty()) {
+      const std::string& next = pending_messages_.front();
+      // Always send at least one message, but never split one across writes.
+      if (message_count > 0 &&
+          batch_bytes + next.size() > kMaxWriteBatchBytes) {
+        break;
+      }
+      coded_output_stream.WriteRaw(next.data(), next.size());
+      batch_bytes += next.size();
+      pending_bytes_ -= next.size();
+      pending_messages_.pop_front();
+      ++message_count;
+    }
   }
 
+  DVLOG(1) << "Packed " << message_count << " messages (" << batch_bytes
+           << " bytes) into a single write.";
+  FlushOutputStream(message_count);
+}
+
+void ConnectionHandlerImpl::FlushOutputStream(int message_count) {
+  messages_in_flight_ = message_count;
   if (output_stream_->Flush(
           base::Bind(&ConnectionHandlerImpl::OnMessageSent,
                      weak_ptr_factory_.GetWeakPtr())) != net::ERR_IO_PENDING) {
@@ -127,6 +193,7 @@ void ConnectionHandlerImpl::Login(
     login_request.SerializeToCodedStream(&coded_output_stream);
   }
 
+  messages_in_flight_ = 1;
   if (output_stream_->Flush(
           base::Bind(&ConnectionHandlerImpl::OnMessageSent,
                      weak_ptr_factory_.GetWeakPtr())) != net::ERR_IO_PENDING) {
@@ -161,7 +228,20 @@ void ConnectionHandlerImpl::OnMessageSent() {
     return;
   }
 
-  write_callback_.Run();
+  // Acknowledge each message of the completed write individually.
+  int messages_sent = messages_in_flight_;
+  messages_in_flight_ = 0;
+  for (int i = 0; i < messages_sent; ++i) {
+    write_callback_.Run();
+    // The callback may have closed the connection.
+    if (!output_stream_.get())
+      return;
+  }
+
+  // Send everything queued behind the completed write, unless one of the
+  // callbacks above already started a new write.
+  if (messages_in_flight_ == 0 && !pending_messages_.empty())
+    FlushPendingMessages();
 }
 
 void ConnectionHandlerImpl::GetNextMessage() {
@@ -474,6 +554,9 @@ void ConnectionHandlerImpl::CloseConnection() {
     socket_->Disconnect();
   socket_ = NULL;
   handshake_complete_ = false;
+  pending_messages_.clear();
+  pending_bytes_ = 0;
+  messages_in_flight_ = 0;
   message_tag_ = 0;
   message_size_ = 0;
   size_packet_so_far_ = 0;
@@ -5,6 +5,8 @@
 #ifndef GOOGLE_APIS_GCM_ENGINE_CONNECTION_HANDLER_IMPL_H_
 #define GOOGLE_APIS_GCM_ENGINE_CONNECTION_HANDLER_IMPL_H_
 
+#include <deque>
+#include <string>
 #include <vector>
 
 #include "base/memory/weak_ptr.h"
@@ -23,8 +25,9 @@ class GCM_EXPORT ConnectionHandlerImpl : public ConnectionHandler {
   // |read_callback| will be invoked with the contents of any received protobuf
   // message.
   // |write_callback| will be invoked anytime a message has been successfully
-  // sent. Note: this just means the data was sent to the wire, not that the
-  // other end received it.
+  // sent (once per message, even when several messages were packed into a
+  // single socket write). Note: this just means the data was sent to the wire,
+  // not that the other end received it.
   // |connection_callback| will be invoked with any fatal read/write errors
   // encountered.
   ConnectionHandlerImpl(
@@ -61,6 +64,13 @@ class GCM_EXPORT ConnectionHandlerImpl : public ConnectionHandler {
   // connection handshake.
   void Login(const google::protobuf::MessageLite& login_request);
 
+  // Packs as many of |pending_messages_| as fit into a single socket write and
+  // flushes them.
+  void FlushPendingMessages();
+
+  // Flushes |output_stream_|, which holds |message_count| messages.
+  void FlushOutputStream(int message_count);
+
   // SendMessage continuation. Invoked when Socket::Write completes.
   void OnMessageSent();
 
@@ -104,6 +114,15 @@ class GCM_EXPORT ConnectionHandlerImpl : public ConnectionHandler {
   // description for more info on what the handshake involves.
   bool handshake_complete_;
 
+  // Serialized messages accepted while a previous write was in flight. They
+  // are packed into as few socket writes as possible once it completes.
+  std::deque<std::string> pending_messages_;
+  // Total size of |pending_messages_|, in bytes.
+  size_t pending_bytes_;
+  // The number of messages in the socket write currently in flight. The
+  // write callback is invoked once for each of them on completion.
+  int messages_in_flight_;
+
   // State for the message currently being processed, if there is one.
   uint8 message_tag_;
   uint32 message_size_;
@@ -42,6 +42,8 @@ const char kDataMsgFromLong2[] =
 const char kDataMsgCategoryLong2[] =
     "this is a second long category that will result in a message > 128 bytes";
 const uint8 kInvalidTag = 100;  // An invalid tag.
+// Mirrors the maximum size of a packed socket write in connection_handler_impl.
+const size_t kMaxWriteBatchBytes = 1024 * 8;
 
 // ---- Helpers for building messages. ----
 
@@ -122,6 +124,7 @@ class GCMConnectionHandlerImplTest : public testing::Test {
     return data_provider_.get();
   }
   int last_error() const { return last_error_; }
+  int write_callbacks() const { return write_callbacks_; }
 
   // Initialize the connection handler, setting |dst_proto| as the destination
   // for any received messages.
@@ -146,6 +149,9 @@ class GCMConnectionHandlerImplTest : public testing::Test {
   // The last connection error received.
   int last_error_;
 
+  // The number of times the write callback has been invoked.
+  int write_callbacks_;
+
   // net:: components.
   scoped_ptr<net::StreamSocket> socket_;
   net::MockClientSocketFactory socket_factory_;
@@ -156,7 +162,7 @@ class GCMConnectionHandlerImplTest : public testing::Test {
 };
 
 GCMConnectionHandlerImplTest::GCMConnectionHandlerImplTest()
-  : last_error_(0) {
+  : last_error_(0), write_callbacks_(0) {
   net::IPAddressNumber ip_number;
   net::ParseIPLiteralToNumber("127.0.0.1", &ip_number);
   address_list_ = net::AddressList::CreateFromIPAddress(ip_number, kMCSPort);
@@ -222,6 +228,7 @@ void GCMConnectionHandlerImplTest::WaitForMessage() {
 }
 
 void GCMConnectionHandlerImplTest::WriteContinuation() {
+  ++write_callbacks_;
   run_loop_->Quit();
 }
 
@@ -635,11 +642,130 @@ TEST_F(GCMConnectionHandlerImplTest, SendMsg) {
   WaitForMessage();  // The login response.
   EXPECT_TRUE(connection_handler()->CanSendMessage());
   connection_handler()->SendMessage(data_message);
-  EXPECT_FALSE(connection_handler()->CanSendMessage());
+  // Further messages may be queued behind the in-flight write.
+  EXPECT_TRUE(connection_handler()->CanSendMessage());
   WaitForMessage();  // The message send.
   EXPECT_TRUE(connection_handler()->CanSendMessage());
 }
 
+// Send several messages while a write is in flight. They should be packed into
+// a single socket write, with the write callback invoked once per message.
+TEST_F(GCMConnectionHandlerImplTest, SendMsgsPacked) {
+  mcs_proto::DataMessageStanza data_message;
+  data_message.set_from(kDataMsgFrom);
+  data_message.set_category(kDataMsgCategory);
+  mcs_proto::DataMessageStanza data_message2;
+  data_message2.set_from(kDataMsgFrom2);
+  data_message2.set_category(kDataMsgCategory2);
+  mcs_proto::HeartbeatPing heartbeat_ping;
+  std::string handshake_request = EncodeHandshakeRequest();
+  std::string data_message_pkt =
+      EncodePacket(kDataMessageStanzaTag, data_message.SerializeAsString());
+  std::string packed_pkts =
+      EncodePacket(kDataMessageStanzaTag, data_message2.SerializeAsString()) +
+      EncodePacket(kHeartbeatPingTag, heartbeat_ping.SerializeAsString());
+  WriteList write_list;
+  write_list.push_back(net::MockWrite(net::ASYNC,
+                                      handshake_request.c_str(),
+                                      handshake_request.size()));
+  write_list.push_back(net::MockWrite(net::ASYNC,
+                                      data_message_pkt.c_str(),
+                                      data_message_pkt.size()));
+  write_list.push_back(net::MockWrite(net::ASYNC,
+                                      packed_pkts.c_str(),
+                                      packed_pkts.size()));
+  std::string handshake_response = EncodeHandshakeResponse();
+  ReadList read_list;
+  read_list.push_back(net::MockRead(net::ASYNC,
+                                    handshake_response.c_str(),
+                                    handshake_response.size()));
+  read_list.push_back(net::MockRead(net::SYNCHRONOUS, net::ERR_IO_PENDING));
+  BuildSocket(read_list, write_list);
+
+  ScopedMessage received_message;
+  Connect(&received_message);
+  WaitForMessage();  // The login send.
+  WaitForMessage();  // The login response.
+  EXPECT_EQ(1, write_callbacks());
+  connection_handler()->SendMessage(data_message);
+  ASSERT_TRUE(connection_handler()->CanSendMessage());
+  connection_handler()->SendMessage(data_message2);
+  ASSERT_TRUE(connection_handler()->CanSendMessage());
+  connection_handler()->SendMessage(heartbeat_ping);
+  PumpLoop();
+  EXPECT_EQ(4, write_callbacks());
+  EXPECT_EQ(3U, data_provider()->write_index());
+  EXPECT_TRUE(data_provider()->AllWriteDataConsumed());
+  EXPECT_TRUE(connection_handler()->CanSendMessage());
+  EXPECT_EQ(net::OK, last_error());
+}
+
+// Queue messages behind an in-flight write until the handler stops accepting
+// them. The queued messages should go out in writes no larger than the batch
+// limit, without splitting any message across writes.
+TEST_F(GCMConnectionHandlerImplTest, SendMsgsPackedUpToLimit) {
+  mcs_proto::DataMessageStanza data_message;
+  data_message.set_from(kDataMsgFrom);
+  data_message.set_category(std::string(1000, 'c'));
+  std::string handshake_request = EncodeHandshakeRequest();
+  std::string data_message_pkt =
+      EncodePacket(kDataMessageStanzaTag, data_message.SerializeAsString());
+  // Messages are accepted until at least |kMaxWriteBatchBytes| are queued.
+  const size_t queued_messages =
+      (kMaxWriteBatchBytes + data_message_pkt.size() - 1) /
+      data_message_pkt.size();
+  const size_t messages_per_write =
+      kMaxWriteBatchBytes / data_message_pkt.size();
+  ASSERT_GT(queued_messages, messages_per_write);
+
+  std::vector<std::string> packed_writes;
+  for (size_t queued = 0; queued < queued_messages;
+       queued += messages_per_write) {
+    std::string packed;
+    for (size_t i = queued;
+         i < queued + messages_per_write && i < queued_messages; ++i) {
+      packed.append(data_message_pkt);
+    }
+    packed_writes.push_back(packed);
+  }
+  WriteList write_list;
+  write_list.push_back(net::MockWrite(net::ASYNC,
+                                      handshake_request.c_str(),
+                                      handshake_request.size()));
+  write_list.push_back(net::MockWrite(net::ASYNC,
+                                      data_message_pkt.c_str(),
+                                      data_message_pkt.size()));
+  for (size_t i = 0; i < packed_writes.size(); ++i) {
+    write_list.push_back(net::MockWrite(net::ASYNC,
+                                        packed_writes[i].c_str(),
+                                        packed_writes[i].size()));
+  }
+  std::string handshake_response = EncodeHandshakeResponse();
+  ReadList read_list;
+  read_list.push_back(net::MockRead(net::ASYNC,
+                                    handshake_response.c_str(),
+                                    handshake_response.size()));
+  read_list.push_back(net::MockRead(net::SYNCHRONOUS, net::ERR_IO_PENDING));
+  BuildSocket(read_list, write_list);
+
+  ScopedMessage received_message;
+  Connect(&received_message);
+  WaitForMessage();  // The login send.
+  WaitForMessage();  // The login response.
+  connection_handler()->SendMessage(data_message);
+  size_t sent = 0;
+  while (connection_handler()->CanSendMessage()) {
+    connection_handler()->SendMessage(data_message);
+    ++sent;
+  }
+  EXPECT_EQ(queued_messages, sent);
+  PumpLoop();
+  EXPECT_EQ(static_cast<int>(2 + queued_messages), write_callbacks());
+  EXPECT_EQ(2 + packed_writes.size(), data_provider()->write_index());
+  EXPECT_TRUE(data_provider()->AllWriteDataConsumed());
+  EXPECT_TRUE(connection_handler()->CanSendMessage());
+}
+
 // Attempt to send a message after the socket is disconnected due to a timeout.
 TEST_F(GCMConnectionHandlerImplTest, SendMsgSocketDisconnected) {
   std::string handshake_request = EncodeHandshakeRequest();
@@ -526,35 +526,29 @@ void MCSClient::OnGCMUpdateFinished(bool success) {
 }
 
 void MCSClient::MaybeSendMessage() {
-  if (to_send_.empty())
-    return;
-
+  // Hand the connection handler as many messages as it will accept, so that
+  // messages queued behind an in-flight write can share a single socket write.
   // If the connection has been reset, do nothing. On reconnection
   // MaybeSendMessage will be automatically invoked again.
   // TODO(zea): consider doing TTL expiration at connection reset time, rather
   // than reconnect time.
-  if (!connection_factory_->IsEndpointReachable())
-    return;
-
-  MCSPacketInternal packet = PopMessageForSend();
-  if (HasTTLExpired(*packet->protobuf, clock_)) {
-    DCHECK(!packet->persistent_id.empty());
-    DVLOG(1) << "Dropping expired message " << packet->persistent_id << ".";
-    NotifyMessageSendStatus(*packet->protobuf, TTL_EXCEEDED);
-    gcm_store_->RemoveOutgoingMessage(
-        packet->persistent_id,
-        base::Bind(&MCSClient::OnGCMUpdateFinished,
-                   weak_ptr_factory_.GetWeakPtr()));
-    base::ThreadTaskRunnerHandle::Get()->PostTask(
-            FROM_HERE,
-            base::Bind(&MCSClient::MaybeSendMessage,
-                       weak_ptr_factory_.GetWeakPtr()));
-    return;
+  while (!to_send_.empty() && connection_factory_->IsEndpointReachable()) {
+    MCSPacketInternal packet = PopMessageForSend();
+    if (HasTTLExpired(*packet->protobuf, clock_)) {
+      DCHECK(!packet->persistent_id.empty());
+      DVLOG(1) << "Dropping expired message " << packet->persistent_id << ".";
+      NotifyMessageSendStatus(*packet->protobuf, TTL_EXCEEDED);
+      gcm_store_->RemoveOutgoingMessage(
+          packet->persistent_id,
+          base::Bind(&MCSClient::OnGCMUpdateFinished,
+                     weak_ptr_factory_.GetWeakPtr()));
+      continue;
+    }
+    DVLOG(1) << "Pending output message found, sending.";
+    if (!packet->persistent_id.empty())
+      to_resend_.push_back(packet);
+    SendPacketToWire(packet.get());
   }
-  DVLOG(1) << "Pending output message found, sending.";
-  if (!packet->persistent_id.empty())
-    to_resend_.push_back(packet);
-  SendPacketToWire(packet.get());
 }
 
 void MCSClient::SendPacketToWire(ReliablePacketInfo* packet_info) {
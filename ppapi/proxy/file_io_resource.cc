@@ -4,9 +4,11 @@
 
 #include "ppapi/proxy/file_io_resource.h"
 
+#include <algorithm>
 #include <limits>
 
 #include "base/bind.h"
+#include "base/task_runner.h"
 #include "base/task_runner_util.h"
 #include "ipc/ipc_message.h"
 #include "ppapi/c/pp_errors.h"
@@ -29,12 +31,17 @@ using ppapi::thunk::PPB_FileSystem_API;
 
 namespace {
 
-// We must allocate a buffer sized according to the request of the plugin. To
-// reduce the chance of out-of-memory errors, we cap the read and write size to
-// 32MB. This is OK since the API specifies that it may perform a partial read
-// or write.
+// Unless we read straight into the plugin's buffer, we must allocate a buffer
+// sized according to the request of the plugin. To reduce the chance of
+// out-of-memory errors, we cap the size of those reads, and of writes, to 32MB.
+// This is OK since the API specifies that it may perform a partial read or
+// write.
 static const int32_t kMaxReadWriteSize = 32 * 1024 * 1024;  // 32MB
 
+// Reads straight into the plugin's buffer aren't capped, but are done in
+// chunks of this size, so that cancelling one only waits for the current chunk.
+static const int32_t kInPlaceReadChunkSize = 1024 * 1024;  // 1MB
+
 // An adapter to let Read() share the same implementation with ReadToArray().
 void* DummyGetDataBuffer(void* user_data, uint32_t count, uint32_t size) {
   return user_data;
@@ -63,10 +70,13 @@ int32_t FileIOResource::QueryOp::DoWork() {
 
 FileIOResource::ReadOp::ReadOp(scoped_refptr<FileHolder> file_holder,
                                int64_t offset,
-                               int32_t bytes_to_read)
+                               int32_t bytes_to_read,
+                               char* plugin_buffer)
   : file_holder_(file_holder),
     offset_(offset),
-    bytes_to_read_(bytes_to_read) {
+    bytes_to_read_(bytes_to_read),
+    reads_in_place_(plugin_buffer != NULL),
+    plugin_buffer_(plugin_buffer) {
   DCHECK(file_holder_.get());
 }
 
@@ -74,11 +84,34 @@ FileIOResource::ReadOp::~ReadOp() {
 }
 
 int32_t FileIOResource::ReadOp::DoWork() {
+  if (reads_in_place_) {
+    int32_t bytes_read = 0;
+    while (bytes_read < bytes_to_read_) {
+      base::AutoLock lock(lock_);
+      if (!plugin_buffer_)
+        return PP_ERROR_ABORTED;
+      int32_t chunk_size =
+          std::min(bytes_to_read_ - bytes_read, kInPlaceReadChunkSize);
+      int32_t result = file_holder_->file()->Read(
+          offset_ + bytes_read, plugin_buffer_ + bytes_read, chunk_size);
+      if (result < 0)
+        return bytes_read > 0 ? bytes_read : result;
+      bytes_read += result;
+      if (result < chunk_size)
+        break;
+    }
+    return bytes_read;
+  }
   DCHECK(!buffer_.get());
   buffer_.reset(new char[bytes_to_read_]);
   return file_holder_->file()->Read(offset_, buffer_.get(), bytes_to_read_);
 }
 
+void FileIOResource::ReadOp::Cancel() {
+  base::AutoLock lock(lock_);
+  plugin_buffer_ = NULL;
+}
+
 FileIOResource::WriteOp::WriteOp(scoped_refptr<FileHolder> file_holder,
                                  int64_t offset,
                                  scoped_ptr<char[]> buffer,
@@ -210,7 +243,7 @@ int32_t FileIOResource::Query(PP_FileInfo* info,
   // completion task to write the result.
   scoped_refptr<QueryOp> query_op(new QueryOp(file_holder_));
   base::PostTaskAndReplyWithResult(
-      PpapiGlobals::Get()->GetFileTaskRunner(),
+      file_holder_->task_runner(),
       FROM_HERE,
       Bind(&FileIOResource::QueryOp::DoWork, query_op),
       RunWhileLocked(Bind(&TrackedCallback::Run, callback)));
@@ -249,7 +282,8 @@ int32_t FileIOResource::Read(int64_t offset,
   PP_ArrayOutput output_adapter;
   output_adapter.GetDataBuffer = &DummyGetDataBuffer;
   output_adapter.user_data = buffer;
-  return ReadValidated(offset, bytes_to_read, output_adapter, callback);
+  return ReadValidated(offset, bytes_to_read, buffer, output_adapter,
+                       callback);
 }
 
 int32_t FileIOResource::ReadToArray(int64_t offset,
@@ -262,7 +296,8 @@ int32_t FileIOResource::ReadToArray(int64_t offset,
   if (rv != PP_OK)
     return rv;
 
-  return ReadValidated(offset, max_read_length, *array_output, callback);
+  return ReadValidated(offset, max_read_length, NULL, *array_output,
+                       callback);
 }
 
 int32_t FileIOResource::Write(int64_t offset,
@@ -426,7 +461,8 @@ int32_t FileIOResource::RequestOSFileHandle(
 }
 
 FileIOResource::FileHolder::FileHolder(PP_FileHandle file_handle)
-    : file_(file_handle) {
+    : file_(file_handle),
+      task_runner_(PpapiGlobals::Get()->CreateFileIOTaskRunner()) {
 }
 
 // static
@@ -437,15 +473,14 @@ bool FileIOResource::FileHolder::IsValid(
 
 FileIOResource::FileHolder::~FileHolder() {
   if (file_.IsValid()) {
-    base::TaskRunner* file_task_runner =
-        PpapiGlobals::Get()->GetFileTaskRunner();
-    file_task_runner->PostTask(FROM_HERE,
-                               base::Bind(&DoClose, Passed(&file_)));
+    // The file is closed after the operations which are still queued for it.
+    task_runner_->PostTask(FROM_HERE, base::Bind(&DoClose, Passed(&file_)));
   }
 }
 
 int32_t FileIOResource::ReadValidated(int64_t offset,
                                       int32_t bytes_to_read,
+                                      char* plugin_buffer,
                                       const PP_ArrayOutput& array_output,
                                       scoped_refptr<TrackedCallback> callback) {
   if (bytes_to_read < 0)
@@ -455,7 +490,8 @@ int32_t FileIOResource::ReadValidated(int64_t offset,
 
   state_manager_.SetPendingOperation(FileIOStateManager::OPERATION_READ);
 
-  bytes_to_read = std::min(bytes_to_read, kMaxReadWriteSize);
+  if (!plugin_buffer)
+    bytes_to_read = std::min(bytes_to_read, kMaxReadWriteSize);
   if (callback->is_blocking()) {
     char* buffer = static_cast<char*>(
         array_output.GetDataBuffer(array_output.user_data, bytes_to_read, 1));
@@ -474,11 +510,13 @@ int32_t FileIOResource::ReadValidated(int64_t offset,
     return result;
   }
 
-  // For the non-blocking case, post a task to the file thread.
+  // For the non-blocking case, post a task to the file's task runner. Read()
+  // reads straight into the plugin's buffer; ReadToArray() can't, since the
+  // size of its output must match the amount read.
   scoped_refptr<ReadOp> read_op(
-      new ReadOp(file_holder_, offset, bytes_to_read));
+      new ReadOp(file_holder_, offset, bytes_to_read, plugin_buffer));
   base::PostTaskAndReplyWithResult(
-      PpapiGlobals::Get()->GetFileTaskRunner(),
+      file_holder_->task_runner(),
       FROM_HERE,
       Bind(&FileIOResource::ReadOp::DoWork, read_op),
       RunWhileLocked(Bind(&TrackedCallback::Run, callback)));
@@ -520,7 +558,7 @@ int32_t FileIOResource::WriteValidated(
   scoped_refptr<WriteOp> write_op(
       new WriteOp(file_holder_, offset, copy.Pass(), bytes_to_write, append));
   base::PostTaskAndReplyWithResult(
-      PpapiGlobals::Get()->GetFileTaskRunner(),
+      file_holder_->task_runner(),
       FROM_HERE,
       Bind(&FileIOResource::WriteOp::DoWork, write_op),
       RunWhileLocked(Bind(&TrackedCallback::Run, callback)));
@@ -565,7 +603,16 @@ int32_t FileIOResource::OnReadComplete(scoped_refptr<ReadOp> read_op,
                                        int32_t result) {
   DCHECK(state_manager_.get_pending_operation() ==
          FileIOStateManager::OPERATION_READ);
-  if (result >= 0) {
+  if (read_op->reads_in_place()) {
+    if (result == PP_ERROR_ABORTED) {
+      // The plugin may free its buffer as soon as it sees the abort. This
+      // only waits for the chunk being read, which doesn't need the proxy
+      // lock, so we keep holding it.
+      read_op->Cancel();
+    } else if (result < 0) {
+      result = PP_ERROR_FAILED;
+    }
+  } else if (result >= 0) {
     ArrayWriter output;
     output.set_pp_array_output(array_output);
     if (output.is_valid())
@@ -612,7 +659,7 @@ void FileIOResource::OnRequestWriteQuotaComplete(
     scoped_refptr<WriteOp> write_op(new WriteOp(
         file_holder_, offset, buffer.Pass(), bytes_to_write, append));
     base::PostTaskAndReplyWithResult(
-        PpapiGlobals::Get()->GetFileTaskRunner(),
+        file_holder_->task_runner(),
         FROM_HERE,
         Bind(&FileIOResource::WriteOp::DoWork, write_op),
         RunWhileLocked(Bind(&TrackedCallback::Run, callback)));
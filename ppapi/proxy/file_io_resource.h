@@ -10,6 +10,7 @@
 #include "base/files/file.h"
 #include "base/memory/ref_counted.h"
 #include "base/memory/scoped_ptr.h"
+#include "base/synchronization/lock.h"
 #include "ppapi/c/private/pp_file_handle.h"
 #include "ppapi/proxy/connection.h"
 #include "ppapi/proxy/plugin_resource.h"
@@ -19,6 +20,10 @@
 #include "ppapi/shared_impl/scoped_pp_resource.h"
 #include "ppapi/thunk/ppb_file_io_api.h"
 
+namespace base {
+class TaskRunner;
+}
+
 namespace ppapi {
 
 class TrackedCallback;
@@ -86,18 +91,25 @@ class PPAPI_PROXY_EXPORT FileIOResource
   // callback got a PP_ERROR_ABORTED result. In the case of a write, we could
   // write some data to the file despite the plugin receiving a
   // PP_ERROR_ABORTED instead of a successful result.
+  //
+  // The FileHolder also owns the task runner which the non-blocking operations
+  // on the file run on. Operations on one file run in order, and the file is
+  // closed after the last of them, but different files don't wait for each
+  // other.
   class FileHolder : public base::RefCountedThreadSafe<FileHolder> {
    public:
     explicit FileHolder(PP_FileHandle file_handle);
     base::File* file() {
       return &file_;
     }
+    base::TaskRunner* task_runner() const { return task_runner_.get(); }
     static bool IsValid(
         const scoped_refptr<FileIOResource::FileHolder>& handle);
    private:
     friend class base::RefCountedThreadSafe<FileHolder>;
     ~FileHolder();
     base::File file_;
+    scoped_refptr<base::TaskRunner> task_runner_;
   };
 
   scoped_refptr<FileHolder> file_holder() {
@@ -124,17 +136,26 @@ class PPAPI_PROXY_EXPORT FileIOResource
     base::File::Info file_info_;
   };
 
-  // Class to perform file read operations across multiple threads.
+  // Class to perform file read operations across multiple threads. If it's
+  // given the plugin's buffer, the data is read straight into it; otherwise
+  // it's read into a buffer of the op's own, which the caller copies out.
   class ReadOp : public base::RefCountedThreadSafe<ReadOp> {
    public:
     ReadOp(scoped_refptr<FileHolder> file_holder,
            int64_t offset,
-           int32_t bytes_to_read);
+           int32_t bytes_to_read,
+           char* plugin_buffer);
 
     // Reads the file. Called on the file thread (non-blocking) or the plugin
     // thread (blocking). This should not be called when we hold the proxy lock.
     int32_t DoWork();
 
+    // Stops the op from writing to the plugin's buffer, which the plugin may
+    // free once its callback is aborted. If the read is under way, this waits
+    // for the chunk being read to finish.
+    void Cancel();
+
+    bool reads_in_place() const { return reads_in_place_; }
     char* buffer() const { return buffer_.get(); }
 
    private:
@@ -144,7 +165,13 @@ class PPAPI_PROXY_EXPORT FileIOResource
     scoped_refptr<FileHolder> file_holder_;
     int64_t offset_;
     int32_t bytes_to_read_;
+    const bool reads_in_place_;
     scoped_ptr<char[]> buffer_;
+
+    // Held while reading a chunk into |plugin_buffer_|, which is cleared on
+    // Cancel().
+    base::Lock lock_;
+    char* plugin_buffer_;
   };
 
   // Class to perform file write operations across multiple threads.
@@ -180,8 +207,11 @@ class PPAPI_PROXY_EXPORT FileIOResource
                                        scoped_refptr<TrackedCallback> callback,
                                        int64_t granted);
 
+  // |plugin_buffer| is the plugin's own buffer for Read(), and NULL for
+  // ReadToArray(), whose output is only allocated once the size is known.
   int32_t ReadValidated(int64_t offset,
                         int32_t bytes_to_read,
+                        char* plugin_buffer,
                         const PP_ArrayOutput& array_output,
                         scoped_refptr<TrackedCallback> callback);
   int32_t WriteValidated(int64_t offset,
@@ -0,0 +1,237 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <string>
+#include <vector>
+
+#include "base/bind.h"
+#include "base/files/file.h"
+#include "base/files/file_path.h"
+#include "base/files/file_util.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/memory/scoped_vector.h"
+#include "base/process/process_handle.h"
+#include "base/run_loop.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/test/perf_time_logger.h"
+#include "ipc/ipc_platform_file.h"
+#include "ppapi/c/pp_errors.h"
+#include "ppapi/c/ppb_file_io.h"
+#include "ppapi/c/ppb_file_ref.h"
+#include "ppapi/c/ppb_file_system.h"
+#include "ppapi/proxy/locking_resource_releaser.h"
+#include "ppapi/proxy/plugin_message_filter.h"
+#include "ppapi/proxy/ppapi_messages.h"
+#include "ppapi/proxy/ppapi_proxy_test.h"
+#include "ppapi/proxy/serialized_handle.h"
+#include "ppapi/thunk/thunk.h"
+
+namespace ppapi {
+namespace proxy {
+namespace {
+
+const int kFileSize = 16 * 1024 * 1024;
+const int32_t kReadSize = 256 * 1024;
+const int kConcurrentReaders = 4;
+
+void OpenCallback(void* user_data, int32_t result) {
+  *static_cast<int32_t*>(user_data) = result;
+}
+
+// Reads a whole file with non-blocking reads, one after the other, like a
+// plugin streaming the file would.
+class Reader {
+ public:
+  Reader(const PPB_FileIO_1_1* file_io_iface,
+         PP_Resource file_io,
+         const base::Closure& done)
+      : file_io_iface_(file_io_iface),
+        file_io_(file_io),
+        done_(done),
+        buffer_(kReadSize),
+        offset_(0),
+        result_(PP_OK) {}
+
+  void Start() { ReadNext(); }
+
+  int64_t bytes_read() const { return offset_; }
+  int32_t result() const { return result_; }
+
+ private:
+  void ReadNext() {
+    int32_t result = file_io_iface_->Read(
+        file_io_, offset_, &buffer_[0], kReadSize,
+        PP_MakeCompletionCallback(&Reader::OnRead, this));
+    if (result != PP_OK_COMPLETIONPENDING)
+      OnRead(this, result);
+  }
+
+  static void OnRead(void* user_data, int32_t result) {
+    Reader* reader = static_cast<Reader*>(user_data);
+    if (result > 0) {
+      reader->offset_ += result;
+      reader->ReadNext();
+      return;
+    }
+    reader->result_ = result;
+    reader->done_.Run();
+  }
+
+  const PPB_FileIO_1_1* file_io_iface_;
+  PP_Resource file_io_;
+  base::Closure done_;
+  std::vector<char> buffer_;
+  int64_t offset_;
+  int32_t result_;
+
+  DISALLOW_COPY_AND_ASSIGN(Reader);
+};
+
+class FileIOResourcePerfTest : public PluginProxyTest {
+ public:
+  FileIOResourcePerfTest()
+      : file_system_iface_(thunk::GetPPB_FileSystem_1_0_Thunk()),
+        file_ref_iface_(thunk::GetPPB_FileRef_1_1_Thunk()),
+        file_io_iface_(thunk::GetPPB_FileIO_1_1_Thunk()),
+        readers_left_(0) {}
+
+  void SetUp() override {
+    PluginProxyTest::SetUp();
+    ASSERT_TRUE(temp_dir_.CreateUniqueTempDir());
+    std::string contents(kFileSize, 'a');
+    for (int i = 0; i < kConcurrentReaders; ++i) {
+      base::FilePath path =
+          temp_dir_.path().AppendASCII("file" + base::IntToString(i));
+      ASSERT_EQ(kFileSize,
+                base::WriteFile(path, contents.data(), contents.size()));
+      paths_.push_back(path);
+    }
+  }
+
+ protected:
+  // Reads the first |count| files at the same time, each on a FileIO of its
+  // own, and returns once all of them are read.
+  void ReadFiles(int count, const std::string& trace) {
+    LockingResourceReleaser file_system(file_system_iface_->Create(
+        pp_instance(), PP_FILESYSTEMTYPE_LOCALTEMPORARY));
+    OpenFileSystem(file_system.get());
+
+    ScopedVector<LockingResourceReleaser> file_refs;
+    ScopedVector<LockingResourceReleaser> file_ios;
+    ScopedVector<Reader> readers;
+    base::RunLoop run_loop;
+    for (int i = 0; i < count; ++i) {
+      file_refs.push_back(new LockingResourceReleaser(
+          file_ref_iface_->Create(file_system.get(), "/file")));
+      file_ios.push_back(
+          new LockingResourceReleaser(file_io_iface_->Create(pp_instance())));
+      OpenFile(file_ios.back()->get(), file_refs.back()->get(), paths_[i]);
+      readers.push_back(new Reader(
+          file_io_iface_, file_ios.back()->get(),
+          base::Bind(&FileIOResourcePerfTest::OnReaderDone,
+                     base::Unretained(this), run_loop.QuitClosure())));
+    }
+
+    readers_left_ = count;
+    base::PerfTimeLogger logger(trace.c_str());
+    for (int i = 0; i < count; ++i)
+      readers[i]->Start();
+    run_loop.Run();
+    logger.Done();
+
+    for (int i = 0; i < count; ++i) {
+      EXPECT_EQ(PP_OK, readers[i]->result());
+      EXPECT_EQ(kFileSize, readers[i]->bytes_read());
+    }
+  }
+
+ private:
+  void OnReaderDone(const base::Closure& quit_closure) {
+    if (--readers_left_ == 0)
+      quit_closure.Run();
+  }
+
+  void SendReply(const ResourceMessageCallParams& params,
+                 int32_t result,
+                 const IPC::Message& nested_message) {
+    ResourceMessageReplyParams reply_params(params.pp_resource(),
+                                            params.sequence());
+    reply_params.set_result(result);
+    PluginMessageFilter::DispatchResourceReplyForTest(reply_params,
+                                                      nested_message);
+  }
+
+  void OpenFileSystem(PP_Resource file_system) {
+    int32_t result = PP_ERROR_FAILED;
+    ASSERT_EQ(PP_OK_COMPLETIONPENDING,
+              file_system_iface_->Open(
+                  file_system, kFileSize,
+                  PP_MakeCompletionCallback(&OpenCallback, &result)));
+    ResourceMessageTestSink::ResourceCallVector open_messages =
+        sink().GetAllResourceCallsMatching(PpapiHostMsg_FileSystem_Open::ID);
+    ASSERT_EQ(2U, open_messages.size());
+    sink().ClearMessages();
+    SendReply(open_messages[0].first, PP_OK,
+              PpapiPluginMsg_FileSystem_OpenReply());
+    SendReply(open_messages[1].first, PP_OK,
+              PpapiPluginMsg_FileSystem_OpenReply());
+    ASSERT_EQ(PP_OK, result);
+  }
+
+  // Opens |file_io|, playing the host which hands out the file at |path|.
+  void OpenFile(PP_Resource file_io,
+                PP_Resource file_ref,
+                const base::FilePath& path) {
+    int32_t result = PP_ERROR_FAILED;
+    ASSERT_EQ(PP_OK_COMPLETIONPENDING,
+              file_io_iface_->Open(
+                  file_io, file_ref, PP_FILEOPENFLAG_READ,
+                  PP_MakeCompletionCallback(&OpenCallback, &result)));
+    ResourceMessageCallParams params;
+    IPC::Message msg;
+    ASSERT_TRUE(sink().GetFirstResourceCallMatching(
+        PpapiHostMsg_FileIO_Open::ID, &params, &msg));
+    sink().ClearMessages();
+
+    base::File file(path, base::File::FLAG_OPEN | base::File::FLAG_READ);
+    ASSERT_TRUE(file.IsValid());
+    SerializedHandle handle;
+    handle.set_file_handle(
+        IPC::GetFileHandleForProcess(file.TakePlatformFile(),
+                                     base::GetCurrentProcessHandle(), true),
+        PP_FILEOPENFLAG_READ, file_io);
+    ResourceMessageReplyParams reply_params(params.pp_resource(),
+                                            params.sequence());
+    reply_params.set_result(PP_OK);
+    reply_params.AppendHandle(handle);
+    PluginMessageFilter::DispatchResourceReplyForTest(
+        reply_params,
+        PpapiPluginMsg_FileIO_OpenReply(0 /* quota_file_system */,
+                                        0 /* max_written_offset */));
+    ASSERT_EQ(PP_OK, result);
+  }
+
+  const PPB_FileSystem_1_0* file_system_iface_;
+  const PPB_FileRef_1_1* file_ref_iface_;
+  const PPB_FileIO_1_1* file_io_iface_;
+  base::ScopedTempDir temp_dir_;
+  std::vector<base::FilePath> paths_;
+  int readers_left_;
+};
+
+}  // namespace
+
+// Tests the performance of streaming a file through non-blocking reads.
+TEST_F(FileIOResourcePerfTest, SingleReader) {
+  ReadFiles(1, "FileIOResourcePerfTest.SingleReader");
+}
+
+// Tests the performance of streaming several files at the same time. Reads of
+// different files shouldn't wait for each other.
+TEST_F(FileIOResourcePerfTest, ConcurrentReaders) {
+  ReadFiles(kConcurrentReaders, "FileIOResourcePerfTest.ConcurrentReaders");
+}
+
+}  // namespace proxy
+}  // namespace ppapi
@@ -7,6 +7,7 @@
 #include "base/location.h"
 #include "base/single_thread_task_runner.h"
 #include "base/task_runner.h"
+#include "base/threading/sequenced_worker_pool.h"
 #include "base/threading/thread.h"
 #include "ipc/ipc_message.h"
 #include "ipc/ipc_sender.h"
@@ -24,6 +25,13 @@
 namespace ppapi {
 namespace proxy {
 
+namespace {
+
+// The most file operations the plugin runs at the same time.
+const size_t kMaxFileIOThreads = 4;
+
+}  // namespace
+
 // It performs necessary locking/unlocking of the proxy lock, and forwards all
 // messages to the underlying sender.
 class PluginGlobals::BrowserSender : public IPC::Sender {
@@ -61,6 +69,8 @@ PluginGlobals::PluginGlobals(
       plugin_proxy_delegate_(NULL),
       callback_tracker_(new CallbackTracker),
       ipc_task_runner_(ipc_task_runner),
+      file_io_pool_(new base::SequencedWorkerPool(kMaxFileIOThreads,
+                                                  "Plugin::FileIO")),
       resource_reply_thread_registrar_(
           new ResourceReplyThreadRegistrar(GetMainThreadMessageLoop())),
       udp_socket_filter_(new UDPSocketFilter()),
@@ -106,6 +116,9 @@ PluginGlobals::~PluginGlobals() {
     DCHECK(!loop_for_main_thread_.get() || loop_for_main_thread_->HasOneRef());
     loop_for_main_thread_ = NULL;
   }
+  // Let the operations which are under way finish, and close the files.
+  if (file_io_pool_.get())
+    file_io_pool_->Shutdown();
   plugin_globals_ = NULL;
 }
 
@@ -185,6 +198,15 @@ base::TaskRunner* PluginGlobals::GetFileTaskRunner() {
   return file_thread_->task_runner().get();
 }
 
+scoped_refptr<base::TaskRunner> PluginGlobals::CreateFileIOTaskRunner() {
+  // Plugin globals created for a test thread share the file thread.
+  if (!file_io_pool_.get())
+    return PpapiGlobals::CreateFileIOTaskRunner();
+  return file_io_pool_->GetSequencedTaskRunnerWithShutdownBehavior(
+      file_io_pool_->GetSequenceToken(),
+      base::SequencedWorkerPool::BLOCK_SHUTDOWN);
+}
+
 void PluginGlobals::MarkPluginIsActive() {
   if (!plugin_recently_active_) {
     plugin_recently_active_ = true;
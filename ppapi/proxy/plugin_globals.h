@@ -19,6 +19,7 @@
 #include "ppapi/shared_impl/ppapi_globals.h"
 
 namespace base {
+class SequencedWorkerPool;
 class Thread;
 }
 namespace IPC {
@@ -76,6 +77,7 @@ class PPAPI_PROXY_EXPORT PluginGlobals : public PpapiGlobals {
                               const std::string& value) override;
   MessageLoopShared* GetCurrentMessageLoop() override;
   base::TaskRunner* GetFileTaskRunner() override;
+  scoped_refptr<base::TaskRunner> CreateFileIOTaskRunner() override;
   void MarkPluginIsActive() override;
 
   // Returns the channel for sending to the browser.
@@ -190,6 +192,11 @@ class PPAPI_PROXY_EXPORT PluginGlobals : public PpapiGlobals {
   // lazily, since it might not be needed.
   scoped_ptr<base::Thread> file_thread_;
 
+  // Threads for the operations on files opened through PPB_FileIO. Each file
+  // gets a sequence of its own, so that operations on different files don't
+  // wait for each other. Threads are only started once there is work to do.
+  scoped_refptr<base::SequencedWorkerPool> file_io_pool_;
+
   scoped_refptr<ResourceReplyThreadRegistrar> resource_reply_thread_registrar_;
 
   scoped_refptr<UDPSocketFilter> udp_socket_filter_;
@@ -698,6 +698,11 @@ IPC_SYNC_MESSAGE_ROUTED2_1(PpapiMsg_PPPInputEvent_HandleFilteredInputEvent,
                            PP_Instance /* instance */,
                            ppapi::InputEventData /* data */,
                            PP_Bool /* result */)
+// Filtered input events which the host doesn't wait on. The plugin answers
+// each of them with PpapiHostMsg_PPPInputEvent_FilteredInputEventAck.
+IPC_MESSAGE_ROUTED2(PpapiMsg_PPPInputEvent_HandleFilteredInputEventAsync,
+                    PP_Instance /* instance */,
+                    ppapi::InputEventData /* data */)
 
 // PPP_Instance.
 IPC_SYNC_MESSAGE_ROUTED3_1(PpapiMsg_PPPInstance_DidCreate,
@@ -1098,6 +1103,12 @@ IPC_MESSAGE_ROUTED4(PpapiHostMsg_PPBInstance_UpdateSurroundingText,
                     uint32_t /* caret */,
                     uint32_t /* anchor */)
 
+// PPP_InputEvent.
+IPC_MESSAGE_ROUTED3(PpapiHostMsg_PPPInputEvent_FilteredInputEventAck,
+                    PP_Instance /* instance */,
+                    PP_InputEvent_Type /* type */,
+                    PP_Bool /* handled */)
+
 // PPB_Var.
 IPC_SYNC_MESSAGE_ROUTED1_0(PpapiHostMsg_PPBVar_AddRefObject,
                            int64 /* object_id */)
@@ -1810,18 +1821,32 @@ IPC_MESSAGE_CONTROL2(PpapiHostMsg_UDPSocket_SetOption,
 IPC_MESSAGE_CONTROL0(PpapiPluginMsg_UDPSocket_SetOptionReply)
 IPC_MESSAGE_CONTROL1(PpapiHostMsg_UDPSocket_Bind,
                      PP_NetAddress_Private /* net_addr */)
+// On success, the reply may carry two shared memory handles for
+// ppapi::UDPPacketRing: the receive ring at index 0 and the send ring at
+// index 1. Without them, packets are passed in PushRecvResult and SendTo
+// messages.
 IPC_MESSAGE_CONTROL1(PpapiPluginMsg_UDPSocket_BindReply,
                      PP_NetAddress_Private /* bound_addr */)
 IPC_MESSAGE_CONTROL3(PpapiPluginMsg_UDPSocket_PushRecvResult,
                      int32_t /* result */,
                      std::string /* data */,
                      PP_NetAddress_Private /* remote_addr */)
+// Sent when the plugin has consumed a received packet. When the receive ring
+// is in use, it's only sent when the browser is waiting for space in it.
 IPC_MESSAGE_CONTROL0(PpapiHostMsg_UDPSocket_RecvSlotAvailable)
+// Tells the plugin that the receive ring has packets for it.
+IPC_MESSAGE_CONTROL0(PpapiPluginMsg_UDPSocket_RecvRingDoorbell)
 IPC_MESSAGE_CONTROL2(PpapiHostMsg_UDPSocket_SendTo,
                      std::string /* data */,
                      PP_NetAddress_Private /* net_addr */)
 IPC_MESSAGE_CONTROL1(PpapiPluginMsg_UDPSocket_SendToReply,
                      int32_t /* bytes_written */)
+// Tells the browser that the send ring has packets for it.
+IPC_MESSAGE_CONTROL0(PpapiHostMsg_UDPSocket_SendRingDoorbell)
+// Tells the plugin that the browser has made space in the send ring, or that
+// sending a packet from the ring failed with |result|.
+IPC_MESSAGE_CONTROL1(PpapiPluginMsg_UDPSocket_SendRingSpaceAvailable,
+                     int32_t /* result */)
 IPC_MESSAGE_CONTROL0(PpapiHostMsg_UDPSocket_Close)
 IPC_MESSAGE_CONTROL1(PpapiHostMsg_UDPSocket_JoinGroup,
                      PP_NetAddress_Private /* net_addr */)
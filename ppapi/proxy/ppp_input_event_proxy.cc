@@ -20,6 +20,38 @@ namespace proxy {
 
 namespace {
 
+// Filtered events of these types are delivered without waiting for the
+// plugin, since they come in streams where the answer rarely changes. Wheel
+// events are always waited on: answering one with the result for the last
+// would scroll the page under a plugin that meant to consume it, or the
+// other way round.
+bool IsAsyncFilteredEventType(PP_InputEvent_Type type) {
+  return type == PP_INPUTEVENT_TYPE_MOUSEMOVE;
+}
+
+// Merges |data| into |queued|, which the plugin hasn't seen yet, if the plugin
+// can't tell the difference between getting the two events and getting the
+// merged one. Returns false if they can't be merged.
+bool CoalesceFilteredEvent(InputEventData* queued, const InputEventData& data) {
+  if (queued->event_type != data.event_type ||
+      queued->event_modifiers != data.event_modifiers)
+    return false;
+
+  switch (data.event_type) {
+    case PP_INPUTEVENT_TYPE_MOUSEMOVE:
+      if (queued->mouse_button != data.mouse_button)
+        return false;
+      queued->mouse_position = data.mouse_position;
+      queued->mouse_movement.x += data.mouse_movement.x;
+      queued->mouse_movement.y += data.mouse_movement.y;
+      break;
+    default:
+      return false;
+  }
+  queued->event_time_stamp = data.event_time_stamp;
+  return true;
+}
+
 #if !defined(OS_NACL)
 PP_Bool HandleInputEvent(PP_Instance instance, PP_Resource input_event) {
   EnterResourceNoLock<PPB_InputEvent_API> enter(input_event, false);
@@ -34,16 +66,9 @@ PP_Bool HandleInputEvent(PP_Instance instance, PP_Resource input_event) {
     return PP_FALSE;
   }
 
-  // Need to send different messages depending on whether filtering is needed.
-  PP_Bool result = PP_FALSE;
-  if (data.is_filtered) {
-    dispatcher->Send(new PpapiMsg_PPPInputEvent_HandleFilteredInputEvent(
-        API_ID_PPP_INPUT_EVENT, instance, data, &result));
-  } else {
-    dispatcher->Send(new PpapiMsg_PPPInputEvent_HandleInputEvent(
-        API_ID_PPP_INPUT_EVENT, instance, data));
-  }
-  return result;
+  PPP_InputEvent_Proxy* proxy = static_cast<PPP_InputEvent_Proxy*>(
+      dispatcher->GetInterfaceProxy(API_ID_PPP_INPUT_EVENT));
+  return proxy->HandleInputEvent(instance, data);
 }
 
 static const PPP_InputEvent input_event_interface = {
@@ -56,6 +81,13 @@ static const PPP_InputEvent input_event_interface = {};
 
 }  // namespace
 
+PPP_InputEvent_Proxy::FilteredEventQueue::FilteredEventQueue()
+    : events_in_flight(0) {
+}
+
+PPP_InputEvent_Proxy::FilteredEventQueue::~FilteredEventQueue() {
+}
+
 PPP_InputEvent_Proxy::PPP_InputEvent_Proxy(Dispatcher* dispatcher)
     : InterfaceProxy(dispatcher),
       ppp_input_event_impl_(NULL) {
@@ -73,21 +105,104 @@ const PPP_InputEvent* PPP_InputEvent_Proxy::GetProxyInterface() {
   return &input_event_interface;
 }
 
-bool PPP_InputEvent_Proxy::OnMessageReceived(const IPC::Message& msg) {
-  if (!dispatcher()->IsPlugin())
-    return false;
+PP_Bool PPP_InputEvent_Proxy::HandleInputEvent(PP_Instance instance,
+                                               const InputEventData& data) {
+  DCHECK(!dispatcher()->IsPlugin());
+  FilteredEventQueue* queue = NULL;
+  std::map<PP_Instance, FilteredEventQueue>::iterator found =
+      filtered_event_queues_.find(instance);
+  if (found != filtered_event_queues_.end())
+    queue = &found->second;
+
+  if (data.is_filtered && IsAsyncFilteredEventType(data.event_type) &&
+      queue) {
+    std::map<PP_InputEvent_Type, PP_Bool>::const_iterator last_result =
+        queue->last_results.find(data.event_type);
+    if (last_result != queue->last_results.end()) {
+      // Only one event is in flight at a time, so that the ones behind it can
+      // be coalesced until the plugin is ready for them.
+      if (queue->events_in_flight == 0) {
+        SendFilteredEventAsync(instance, data, queue);
+      } else if (queue->events.empty() ||
+                 !CoalesceFilteredEvent(&queue->events.back(), data)) {
+        queue->events.push_back(data);
+      }
+      return last_result->second;
+    }
+  }
+
+  if (queue)
+    FlushFilteredEvents(instance, queue);
+
+  if (!data.is_filtered) {
+    dispatcher()->Send(new PpapiMsg_PPPInputEvent_HandleInputEvent(
+        API_ID_PPP_INPUT_EVENT, instance, data));
+    return PP_FALSE;
+  }
+
+  PP_Bool result = PP_FALSE;
+  dispatcher()->Send(new PpapiMsg_PPPInputEvent_HandleFilteredInputEvent(
+      API_ID_PPP_INPUT_EVENT, instance, data, &result));
+
+  // Like the first move of a touch, the first mouse move is waited on, so
+  // that there is an answer for the ones after it.
+  if (IsAsyncFilteredEventType(data.event_type))
+    filtered_event_queues_[instance].last_results[data.event_type] = result;
+  return result;
+}
 
+void PPP_InputEvent_Proxy::InstanceDestroyed(PP_Instance instance) {
+  filtered_event_queues_.erase(instance);
+}
+
+size_t PPP_InputEvent_Proxy::GetPendingFilteredEventCountForTesting(
+    PP_Instance instance) const {
+  std::map<PP_Instance, FilteredEventQueue>::const_iterator found =
+      filtered_event_queues_.find(instance);
+  if (found == filtered_event_queues_.end())
+    return 0;
+  return found->second.events_in_flight + found->second.events.size();
+}
+
+bool PPP_InputEvent_Proxy::OnMessageReceived(const IPC::Message& msg) {
   bool handled = true;
+  if (!dispatcher()->IsPlugin()) {
+    IPC_BEGIN_MESSAGE_MAP(PPP_InputEvent_Proxy, msg)
+      IPC_MESSAGE_HANDLER(PpapiHostMsg_PPPInputEvent_FilteredInputEventAck,
+                          OnHostMsgFilteredInputEventAck)
+      IPC_MESSAGE_UNHANDLED(handled = false)
+    IPC_END_MESSAGE_MAP()
+    return handled;
+  }
+
   IPC_BEGIN_MESSAGE_MAP(PPP_InputEvent_Proxy, msg)
     IPC_MESSAGE_HANDLER(PpapiMsg_PPPInputEvent_HandleInputEvent,
                         OnMsgHandleInputEvent)
     IPC_MESSAGE_HANDLER(PpapiMsg_PPPInputEvent_HandleFilteredInputEvent,
                         OnMsgHandleFilteredInputEvent)
+    IPC_MESSAGE_HANDLER(PpapiMsg_PPPInputEvent_HandleFilteredInputEventAsync,
+                        OnMsgHandleFilteredInputEventAsync)
     IPC_MESSAGE_UNHANDLED(handled = false)
   IPC_END_MESSAGE_MAP()
   return handled;
 }
 
+void PPP_InputEvent_Proxy::FlushFilteredEvents(PP_Instance instance,
+                                               FilteredEventQueue* queue) {
+  while (!queue->events.empty()) {
+    SendFilteredEventAsync(instance, queue->events.front(), queue);
+    queue->events.pop_front();
+  }
+}
+
+void PPP_InputEvent_Proxy::SendFilteredEventAsync(PP_Instance instance,
+                                                  const InputEventData& data,
+                                                  FilteredEventQueue* queue) {
+  queue->events_in_flight++;
+  dispatcher()->Send(new PpapiMsg_PPPInputEvent_HandleFilteredInputEventAsync(
+      API_ID_PPP_INPUT_EVENT, instance, data));
+}
+
 void PPP_InputEvent_Proxy::OnMsgHandleInputEvent(PP_Instance instance,
                                                  const InputEventData& data) {
   scoped_refptr<PPB_InputEvent_Shared> resource(new PPB_InputEvent_Shared(
@@ -108,5 +223,35 @@ void PPP_InputEvent_Proxy::OnMsgHandleFilteredInputEvent(
                               resource->pp_resource());
 }
 
+void PPP_InputEvent_Proxy::OnMsgHandleFilteredInputEventAsync(
+    PP_Instance instance,
+    const InputEventData& data) {
+  PP_Bool result = PP_FALSE;
+  OnMsgHandleFilteredInputEvent(instance, data, &result);
+  dispatcher()->Send(new PpapiHostMsg_PPPInputEvent_FilteredInputEventAck(
+      API_ID_PPP_INPUT_EVENT, instance, data.event_type, result));
+}
+
+void PPP_InputEvent_Proxy::OnHostMsgFilteredInputEventAck(
+    PP_Instance instance,
+    PP_InputEvent_Type type,
+    PP_Bool handled) {
+  std::map<PP_Instance, FilteredEventQueue>::iterator found =
+      filtered_event_queues_.find(instance);
+  if (found == filtered_event_queues_.end())
+    return;  // The instance went away while the event was in flight.
+  FilteredEventQueue* queue = &found->second;
+  if (queue->events_in_flight == 0 || !IsAsyncFilteredEventType(type))
+    return;  // The plugin acked an event it wasn't sent.
+
+  queue->events_in_flight--;
+  queue->last_results[type] = handled;
+  if (queue->events_in_flight == 0 && !queue->events.empty()) {
+    InputEventData data = queue->events.front();
+    queue->events.pop_front();
+    SendFilteredEventAsync(instance, data, queue);
+  }
+}
+
 }  // namespace proxy
 }  // namespace ppapi
@@ -5,14 +5,15 @@
 #ifndef PPAPI_PROXY_PPP_INPUT_EVENT_PROXY_H_
 #define PPAPI_PROXY_PPP_INPUT_EVENT_PROXY_H_
 
+#include <deque>
+#include <map>
+
 #include "ppapi/c/pp_instance.h"
 #include "ppapi/c/ppp_input_event.h"
 #include "ppapi/proxy/interface_proxy.h"
+#include "ppapi/shared_impl/ppb_input_event_shared.h"
 
 namespace ppapi {
-
-struct InputEventData;
-
 namespace proxy {
 
 class PPP_InputEvent_Proxy : public InterfaceProxy {
@@ -22,22 +23,68 @@ class PPP_InputEvent_Proxy : public InterfaceProxy {
 
   static const PPP_InputEvent* GetProxyInterface();
 
+  // Sends |data| to the plugin and returns whether it handled the event.
+  // Only filtered events are waited on, and filtered mouse moves only the
+  // first time: after that they are answered with what the plugin said about
+  // the last one, and are coalesced while the plugin is still busy with an
+  // earlier one. Used in the host only.
+  PP_Bool HandleInputEvent(PP_Instance instance, const InputEventData& data);
+
+  // Drops the events still queued for |instance|. Used in the host only.
+  void InstanceDestroyed(PP_Instance instance);
+
+  // Returns the number of filtered events for |instance| which are in flight
+  // or queued, and haven't been acked by the plugin yet.
+  size_t GetPendingFilteredEventCountForTesting(PP_Instance instance) const;
+
   // InterfaceProxy implementation.
   virtual bool OnMessageReceived(const IPC::Message& msg);
 
  private:
+  // The filtered events which the host doesn't wait on, for one instance.
+  struct FilteredEventQueue {
+    FilteredEventQueue();
+    ~FilteredEventQueue();
+
+    // Events sent to the plugin which haven't been acked yet.
+    int events_in_flight;
+
+    // Events waiting for the ones in flight to be acked. Consecutive events
+    // which can be coalesced take up one entry.
+    std::deque<InputEventData> events;
+
+    // What the plugin said about the last event of each type it acked.
+    std::map<PP_InputEvent_Type, PP_Bool> last_results;
+  };
+
+  // Sends the events queued for |instance| without waiting for acks, so that
+  // an event sent after them doesn't overtake them.
+  void FlushFilteredEvents(PP_Instance instance, FilteredEventQueue* queue);
+  void SendFilteredEventAsync(PP_Instance instance,
+                              const InputEventData& data,
+                              FilteredEventQueue* queue);
+
   // Message handlers.
   void OnMsgHandleInputEvent(PP_Instance instance,
                              const ppapi::InputEventData& data);
   void OnMsgHandleFilteredInputEvent(PP_Instance instance,
                                      const ppapi::InputEventData& data,
                                      PP_Bool* result);
+  void OnMsgHandleFilteredInputEventAsync(PP_Instance instance,
+                                          const ppapi::InputEventData& data);
+  void OnHostMsgFilteredInputEventAck(PP_Instance instance,
+                                      PP_InputEvent_Type type,
+                                      PP_Bool handled);
 
   // When this proxy is in the plugin side, this value caches the interface
   // pointer so we don't have to retrieve it from the dispatcher each time.
   // In the host, this value is always NULL.
   const PPP_InputEvent* ppp_input_event_impl_;
 
+  // In the host, the filtered events which aren't waited on, by instance. In
+  // the plugin, this is always empty.
+  std::map<PP_Instance, FilteredEventQueue> filtered_event_queues_;
+
   DISALLOW_COPY_AND_ASSIGN(PPP_InputEvent_Proxy);
 };
 
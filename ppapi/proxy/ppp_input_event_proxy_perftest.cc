@@ -0,0 +1,96 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/run_loop.h"
+#include "base/test/perf_log.h"
+#include "base/test/perf_time_logger.h"
+#include "base/threading/platform_thread.h"
+#include "base/time/time.h"
+#include "ppapi/c/ppp_input_event.h"
+#include "ppapi/proxy/ppapi_messages.h"
+#include "ppapi/proxy/ppapi_proxy_test.h"
+#include "ppapi/proxy/ppp_input_event_proxy.h"
+#include "ppapi/shared_impl/api_id.h"
+#include "ppapi/shared_impl/ppb_input_event_shared.h"
+
+namespace ppapi {
+namespace proxy {
+namespace {
+
+const int kEventCount = 200;
+
+// How long the plugin takes to handle an event, like a plugin busy drawing.
+const int kPluginDelayMs = 2;
+
+PP_Bool HandleInputEvent(PP_Instance /* instance */,
+                         PP_Resource /* input_event */) {
+  base::PlatformThread::Sleep(
+      base::TimeDelta::FromMilliseconds(kPluginDelayMs));
+  return PP_TRUE;
+}
+
+PPP_InputEvent ppp_input_event_mock = {
+  &HandleInputEvent
+};
+
+InputEventData MakeMouseMove(int32_t x) {
+  InputEventData data;
+  data.is_filtered = true;
+  data.event_type = PP_INPUTEVENT_TYPE_MOUSEMOVE;
+  data.mouse_position = PP_MakePoint(x, 0);
+  data.mouse_movement = PP_MakePoint(1, 0);
+  return data;
+}
+
+// Reports how long the host's main thread is kept busy delivering a stream of
+// filtered mouse moves to a plugin which takes a while to handle each one.
+class PppInputEventPerfTest : public TwoWayTest {
+ public:
+  PppInputEventPerfTest() : TwoWayTest(TwoWayTest::TEST_PPP_INTERFACE) {
+    plugin().RegisterTestInterface(PPP_INPUT_EVENT_INTERFACE,
+                                   &ppp_input_event_mock);
+  }
+
+ protected:
+  PPP_InputEvent_Proxy* proxy() {
+    return static_cast<PPP_InputEvent_Proxy*>(
+        host().host_dispatcher()->GetInterfaceProxy(API_ID_PPP_INPUT_EVENT));
+  }
+};
+
+}  // namespace
+
+// Waits for the plugin on every move, which is what the proxy used to do.
+TEST_F(PppInputEventPerfTest, SyncMouseMoves) {
+  base::PerfTimeLogger logger("PppInputEventPerfTest.SyncMouseMoves");
+  for (int i = 0; i < kEventCount; ++i) {
+    PP_Bool result = PP_FALSE;
+    host().host_dispatcher()->Send(
+        new PpapiMsg_PPPInputEvent_HandleFilteredInputEvent(
+            API_ID_PPP_INPUT_EVENT, pp_instance(), MakeMouseMove(i), &result));
+  }
+  logger.Done();
+}
+
+// Lets the proxy deliver the moves. The host's message loop runs between the
+// moves, so that acks come in the way they would in the renderer.
+TEST_F(PppInputEventPerfTest, MouseMoves) {
+  base::TimeDelta blocked;
+  for (int i = 0; i < kEventCount; ++i) {
+    base::TimeTicks start = base::TimeTicks::Now();
+    proxy()->HandleInputEvent(pp_instance(), MakeMouseMove(i));
+    blocked += base::TimeTicks::Now() - start;
+    base::RunLoop().RunUntilIdle();
+  }
+  base::LogPerfResult("PppInputEventPerfTest.MouseMoves",
+                      blocked.InMillisecondsF(), "ms");
+
+  while (proxy()->GetPendingFilteredEventCountForTesting(pp_instance()) > 0) {
+    base::PlatformThread::Sleep(base::TimeDelta::FromMilliseconds(1));
+    base::RunLoop().RunUntilIdle();
+  }
+}
+
+}  // namespace proxy
+}  // namespace ppapi
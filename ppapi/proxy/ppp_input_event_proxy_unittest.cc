@@ -0,0 +1,206 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <vector>
+
+#include "base/run_loop.h"
+#include "base/synchronization/lock.h"
+#include "base/threading/platform_thread.h"
+#include "base/time/time.h"
+#include "ppapi/c/ppp_input_event.h"
+#include "ppapi/proxy/ppapi_proxy_test.h"
+#include "ppapi/proxy/ppp_input_event_proxy.h"
+#include "ppapi/shared_impl/api_id.h"
+#include "ppapi/shared_impl/ppb_input_event_shared.h"
+#include "ppapi/shared_impl/proxy_lock.h"
+#include "ppapi/thunk/enter.h"
+#include "ppapi/thunk/ppb_input_event_api.h"
+
+namespace ppapi {
+namespace proxy {
+
+namespace {
+
+// How long the mock plugin takes to handle an event, like a busy plugin would.
+const int kPluginDelayMs = 20;
+
+// This is a poor man's mock of PPP_InputEvent using global variables. The
+// events are handled on the plugin thread and checked on the host thread.
+base::Lock received_events_lock;
+std::vector<InputEventData> received_events;
+PP_Bool handled_to_return = PP_FALSE;
+
+PP_Bool HandleInputEvent(PP_Instance instance, PP_Resource input_event) {
+  {
+    ProxyAutoLock lock;
+    thunk::EnterResourceNoLock<thunk::PPB_InputEvent_API> enter(input_event,
+                                                                 false);
+    EXPECT_TRUE(enter.succeeded());
+    if (enter.succeeded()) {
+      base::AutoLock events_lock(received_events_lock);
+      received_events.push_back(enter.object()->GetInputEventData());
+    }
+  }
+  base::PlatformThread::Sleep(
+      base::TimeDelta::FromMilliseconds(kPluginDelayMs));
+  return handled_to_return;
+}
+
+std::vector<InputEventData> GetReceivedEvents() {
+  base::AutoLock lock(received_events_lock);
+  return received_events;
+}
+
+PPP_InputEvent ppp_input_event_mock = {
+  &HandleInputEvent
+};
+
+InputEventData MakeMouseMove(int32_t x, int32_t y, int32_t dx, int32_t dy) {
+  InputEventData data;
+  data.is_filtered = true;
+  data.event_type = PP_INPUTEVENT_TYPE_MOUSEMOVE;
+  data.mouse_position = PP_MakePoint(x, y);
+  data.mouse_movement = PP_MakePoint(dx, dy);
+  return data;
+}
+
+InputEventData MakeWheel(float dy, float ticks) {
+  InputEventData data;
+  data.is_filtered = true;
+  data.event_type = PP_INPUTEVENT_TYPE_WHEEL;
+  data.wheel_delta = PP_MakeFloatPoint(0.0f, dy);
+  data.wheel_ticks = PP_MakeFloatPoint(0.0f, ticks);
+  return data;
+}
+
+class PPP_InputEvent_ProxyTest : public TwoWayTest {
+ public:
+  PPP_InputEvent_ProxyTest()
+      : TwoWayTest(TwoWayTest::TEST_PPP_INTERFACE) {
+    plugin().RegisterTestInterface(PPP_INPUT_EVENT_INTERFACE,
+                                   &ppp_input_event_mock);
+    base::AutoLock lock(received_events_lock);
+    received_events.clear();
+    handled_to_return = PP_FALSE;
+  }
+
+ protected:
+  PPP_InputEvent_Proxy* proxy() {
+    return static_cast<PPP_InputEvent_Proxy*>(
+        host().host_dispatcher()->GetInterfaceProxy(API_ID_PPP_INPUT_EVENT));
+  }
+
+  PP_Bool HandleInputEvent(const InputEventData& data) {
+    return proxy()->HandleInputEvent(pp_instance(), data);
+  }
+
+  size_t GetPendingEventCount() {
+    return proxy()->GetPendingFilteredEventCountForTesting(pp_instance());
+  }
+
+  // Runs the host message loop until the plugin acked all the events which
+  // weren't waited on.
+  void WaitForAcks() {
+    while (GetPendingEventCount() > 0) {
+      base::PlatformThread::Sleep(base::TimeDelta::FromMilliseconds(1));
+      base::RunLoop().RunUntilIdle();
+    }
+  }
+};
+
+}  // namespace
+
+TEST_F(PPP_InputEvent_ProxyTest, MouseMovesAreCoalesced) {
+  // The first move is waited on.
+  handled_to_return = PP_TRUE;
+  EXPECT_EQ(PP_TRUE, HandleInputEvent(MakeMouseMove(1, 1, 1, 1)));
+  EXPECT_EQ(1u, GetReceivedEvents().size());
+  EXPECT_EQ(0u, GetPendingEventCount());
+
+  // The next one is sent right away, and the ones after it wait for it to be
+  // acked, merged into one event.
+  for (int i = 2; i <= 10; ++i)
+    EXPECT_EQ(PP_TRUE, HandleInputEvent(MakeMouseMove(i, i, 1, 1)));
+  EXPECT_EQ(2u, GetPendingEventCount());
+
+  WaitForAcks();
+  std::vector<InputEventData> events = GetReceivedEvents();
+  ASSERT_EQ(3u, events.size());
+  EXPECT_EQ(2, events[1].mouse_position.x);
+  EXPECT_EQ(1, events[1].mouse_movement.x);
+  EXPECT_EQ(10, events[2].mouse_position.x);
+  EXPECT_EQ(10, events[2].mouse_position.y);
+  EXPECT_EQ(8, events[2].mouse_movement.x);
+  EXPECT_EQ(8, events[2].mouse_movement.y);
+}
+
+TEST_F(PPP_InputEvent_ProxyTest, AckAnswersLaterEvents) {
+  handled_to_return = PP_TRUE;
+  EXPECT_EQ(PP_TRUE, HandleInputEvent(MakeMouseMove(1, 1, 1, 1)));
+
+  // Until the plugin acks the move, the answer is the one for the last move.
+  handled_to_return = PP_FALSE;
+  EXPECT_EQ(PP_TRUE, HandleInputEvent(MakeMouseMove(2, 2, 1, 1)));
+  WaitForAcks();
+  EXPECT_EQ(PP_FALSE, HandleInputEvent(MakeMouseMove(3, 3, 1, 1)));
+  WaitForAcks();
+  EXPECT_EQ(3u, GetReceivedEvents().size());
+}
+
+TEST_F(PPP_InputEvent_ProxyTest, WheelEventsAreWaitedOn) {
+  // Every wheel event gets the plugin's own answer, which decides whether
+  // the page scrolls.
+  handled_to_return = PP_TRUE;
+  EXPECT_EQ(PP_TRUE, HandleInputEvent(MakeWheel(10.0f, 1.0f)));
+  handled_to_return = PP_FALSE;
+  EXPECT_EQ(PP_FALSE, HandleInputEvent(MakeWheel(10.0f, 1.0f)));
+  EXPECT_EQ(0u, GetPendingEventCount());
+
+  // Nor are they merged.
+  std::vector<InputEventData> events = GetReceivedEvents();
+  ASSERT_EQ(2u, events.size());
+  EXPECT_EQ(10.0f, events[1].wheel_delta.y);
+  EXPECT_EQ(1.0f, events[1].wheel_ticks.y);
+}
+
+TEST_F(PPP_InputEvent_ProxyTest, QueuedEventsGoFirst) {
+  HandleInputEvent(MakeMouseMove(1, 1, 1, 1));
+  HandleInputEvent(MakeMouseMove(2, 2, 1, 1));
+  HandleInputEvent(MakeMouseMove(3, 3, 1, 1));
+  EXPECT_EQ(2u, GetPendingEventCount());
+
+  // A click is waited on, and doesn't overtake the moves before it.
+  InputEventData mouse_down;
+  mouse_down.is_filtered = true;
+  mouse_down.event_type = PP_INPUTEVENT_TYPE_MOUSEDOWN;
+  mouse_down.mouse_button = PP_INPUTEVENT_MOUSEBUTTON_LEFT;
+  handled_to_return = PP_TRUE;
+  EXPECT_EQ(PP_TRUE, HandleInputEvent(mouse_down));
+
+  std::vector<InputEventData> events = GetReceivedEvents();
+  ASSERT_EQ(4u, events.size());
+  EXPECT_EQ(3, events[2].mouse_position.x);
+  EXPECT_EQ(PP_INPUTEVENT_TYPE_MOUSEDOWN, events[3].event_type);
+  WaitForAcks();
+}
+
+TEST_F(PPP_InputEvent_ProxyTest, InstanceDestroyed) {
+  HandleInputEvent(MakeMouseMove(1, 1, 1, 1));
+  HandleInputEvent(MakeMouseMove(2, 2, 1, 1));
+  HandleInputEvent(MakeMouseMove(3, 3, 1, 1));
+  EXPECT_EQ(2u, GetPendingEventCount());
+
+  // The queued move is dropped, and the next move is waited on again. The ack
+  // for the move in flight is ignored.
+  proxy()->InstanceDestroyed(pp_instance());
+  EXPECT_EQ(0u, GetPendingEventCount());
+  HandleInputEvent(MakeMouseMove(4, 4, 1, 1));
+  std::vector<InputEventData> events = GetReceivedEvents();
+  ASSERT_EQ(3u, events.size());
+  EXPECT_EQ(4, events[2].mouse_position.x);
+  EXPECT_EQ(0u, GetPendingEventCount());
+}
+
+}  // namespace proxy
+}  // namespace ppapi
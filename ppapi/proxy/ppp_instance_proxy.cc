@@ -17,6 +17,7 @@
 #include "ppapi/proxy/plugin_proxy_delegate.h"
 #include "ppapi/proxy/plugin_resource_tracker.h"
 #include "ppapi/proxy/ppapi_messages.h"
+#include "ppapi/proxy/ppp_input_event_proxy.h"
 #include "ppapi/proxy/url_loader_resource.h"
 #include "ppapi/shared_impl/ppapi_globals.h"
 #include "ppapi/shared_impl/ppb_view_shared.h"
@@ -58,7 +59,11 @@ PP_Bool DidCreate(PP_Instance instance,
 }
 
 void DidDestroy(PP_Instance instance) {
-  HostDispatcher::GetForInstance(instance)->Send(
+  HostDispatcher* dispatcher = HostDispatcher::GetForInstance(instance);
+  static_cast<PPP_InputEvent_Proxy*>(
+      dispatcher->GetInterfaceProxy(API_ID_PPP_INPUT_EVENT))
+      ->InstanceDestroyed(instance);
+  dispatcher->Send(
       new PpapiMsg_PPPInstance_DidDestroy(API_ID_PPP_INSTANCE, instance));
 }
 
@@ -25,6 +25,23 @@ const size_t UDPSocketFilter::kPluginReceiveBufferSlots = 32u;
 
 namespace {
 
+// Creates the PP_NetAddress resource returned through |output_addr|, if the
+// plugin asked for one.
+int32_t SetRecvFromAddress(PP_Instance pp_instance,
+                           const PP_NetAddress_Private& addr,
+                           PP_Resource* output_addr) {
+  ProxyLock::AssertAcquired();
+  if (!output_addr)
+    return PP_OK;
+
+  thunk::EnterResourceCreationNoLock enter(pp_instance);
+  if (!enter.succeeded())
+    return PP_ERROR_FAILED;
+  *output_addr = enter.functions()->CreateNetAddressFromNetAddressPrivate(
+      pp_instance, addr);
+  return PP_OK;
+}
+
 int32_t SetRecvFromOutput(PP_Instance pp_instance,
                           const scoped_ptr<std::string>& data,
                           const PP_NetAddress_Private& addr,
@@ -36,15 +53,8 @@ int32_t SetRecvFromOutput(PP_Instance pp_instance,
   DCHECK_GE(num_bytes, static_cast<int32_t>(data->size()));
 
   int32_t result = browser_result;
-  if (result == PP_OK && output_addr) {
-    thunk::EnterResourceCreationNoLock enter(pp_instance);
-    if (enter.succeeded()) {
-      *output_addr = enter.functions()->CreateNetAddressFromNetAddressPrivate(
-          pp_instance, addr);
-    } else {
-      result = PP_ERROR_FAILED;
-    }
-  }
+  if (result == PP_OK)
+    result = SetRecvFromAddress(pp_instance, addr, output_addr);
 
   if (result == PP_OK && !data->empty())
     memcpy(output_buffer, data->c_str(), data->size());
@@ -95,6 +105,15 @@ int32_t UDPSocketFilter::RequestData(
   return queue_ptr->RequestData(num_bytes, buffer, addr, callback);
 }
 
+void UDPSocketFilter::SetRecvRing(PP_Resource resource,
+                                  scoped_ptr<UDPPacketRing> ring) {
+  ProxyLock::AssertAcquired();
+  base::AutoLock acquire(lock_);
+  RecvQueue* queue_ptr = queues_.get(resource);
+  DCHECK(queue_ptr);
+  queue_ptr->set_recv_ring(ring.Pass());
+}
+
 bool UDPSocketFilter::OnResourceReplyReceived(
     const ResourceMessageReplyParams& params,
     const IPC::Message& nested_msg) {
@@ -102,6 +121,9 @@ bool UDPSocketFilter::OnResourceReplyReceived(
   PPAPI_BEGIN_MESSAGE_MAP(UDPSocketFilter, nested_msg)
     PPAPI_DISPATCH_PLUGIN_RESOURCE_CALL(PpapiPluginMsg_UDPSocket_PushRecvResult,
                                         OnPluginMsgPushRecvResult)
+    PPAPI_DISPATCH_PLUGIN_RESOURCE_CALL_0(
+        PpapiPluginMsg_UDPSocket_RecvRingDoorbell,
+        OnPluginMsgRecvRingDoorbell)
     PPAPI_DISPATCH_PLUGIN_RESOURCE_CALL_UNHANDLED(handled = false)
   PPAPI_END_MESSAGE_MAP()
   return handled;
@@ -130,6 +152,15 @@ void UDPSocketFilter::OnPluginMsgPushRecvResult(
   }
 }
 
+void UDPSocketFilter::OnPluginMsgRecvRingDoorbell(
+    const ResourceMessageReplyParams& params) {
+  DCHECK(PluginGlobals::Get()->ipc_task_runner()->RunsTasksOnCurrentThread());
+  base::AutoLock acquire(lock_);
+  RecvQueue* queue_ptr = queues_.get(params.pp_resource());
+  if (queue_ptr)
+    queue_ptr->RecvRingDoorbellOnIOThread();
+}
+
 UDPSocketFilter::RecvQueue::RecvQueue(
     PP_Instance pp_instance,
     bool private_api,
@@ -200,6 +231,61 @@ void UDPSocketFilter::RecvQueue::DataReceivedOnIOThread(
       ConvertNetworkAPIErrorForCompatibility(result, private_api_));
 }
 
+void UDPSocketFilter::RecvQueue::RecvRingDoorbellOnIOThread() {
+  DCHECK(PluginGlobals::Get()->ipc_task_runner()->RunsTasksOnCurrentThread());
+  // The doorbell may have been rung for a packet that RequestData() already
+  // read, or before the ring was handed to us.
+  if (!recv_ring_ || !TrackedCallback::IsPending(recvfrom_callback_) ||
+      !read_buffer_) {
+    return;
+  }
+
+  int32_t result = PP_OK;
+  uint32_t size = 0;
+  switch (recv_ring_->Peek(&size)) {
+    case UDPPacketRing::STATUS_EMPTY:
+      return;
+    case UDPPacketRing::STATUS_OK:
+      if (size > static_cast<uint32_t>(bytes_to_read_))
+        result = PP_ERROR_MESSAGE_TOO_BIG;
+      break;
+    case UDPPacketRing::STATUS_TOO_BIG:
+    case UDPPacketRing::STATUS_CORRUPT:
+      result = PP_ERROR_FAILED;
+      break;
+  }
+
+  if (result == PP_OK) {
+    // As in DataReceivedOnIOThread(), the output params are written by a
+    // completion task that runs with the ProxyLock.
+    scoped_ptr<std::string> data(new std::string(size, '\0'));
+    PP_NetAddress_Private addr;
+    bool wake_producer = false;
+    if (recv_ring_->Pop(&(*data)[0], size, &result, &addr, &size,
+                        &wake_producer) != UDPPacketRing::STATUS_OK) {
+      result = PP_ERROR_FAILED;
+    } else if (result == PP_OK) {
+      recvfrom_callback_->set_completion_task(base::Bind(
+          &SetRecvFromOutput, pp_instance_, base::Passed(data.Pass()), addr,
+          base::Unretained(read_buffer_), bytes_to_read_,
+          base::Unretained(recvfrom_addr_resource_)));
+      last_recvfrom_addr_ = addr;
+    }
+    if (wake_producer) {
+      PpapiGlobals::Get()->GetMainThreadMessageLoop()->PostTask(
+          FROM_HERE,
+          RunWhileLocked(slot_available_callback_));
+    }
+  }
+
+  read_buffer_ = NULL;
+  bytes_to_read_ = -1;
+  recvfrom_addr_resource_ = NULL;
+
+  recvfrom_callback_->Run(
+      ConvertNetworkAPIErrorForCompatibility(result, private_api_));
+}
+
 int32_t UDPSocketFilter::RecvQueue::RequestData(
     int32_t num_bytes,
     char* buffer_out,
@@ -211,12 +297,11 @@ int32_t UDPSocketFilter::RecvQueue::RequestData(
   if (TrackedCallback::IsPending(recvfrom_callback_))
     return PP_ERROR_INPROGRESS;
 
+  if (recv_ring_)
+    return RequestDataFromRing(num_bytes, buffer_out, addr_out, callback);
+
   if (recv_buffers_.empty()) {
-    read_buffer_ = buffer_out;
-    bytes_to_read_ = std::min(num_bytes, UDPSocketFilter::kMaxReadSize);
-    recvfrom_addr_resource_ = addr_out;
-    recvfrom_callback_ = callback;
-    return PP_OK_COMPLETIONPENDING;
+    return WaitForData(num_bytes, buffer_out, addr_out, callback);
   } else {
     RecvBuffer& front = recv_buffers_.front();
 
@@ -236,6 +321,52 @@ int32_t UDPSocketFilter::RecvQueue::RequestData(
   }
 }
 
+int32_t UDPSocketFilter::RecvQueue::RequestDataFromRing(
+    int32_t num_bytes,
+    char* buffer_out,
+    PP_Resource* addr_out,
+    const scoped_refptr<TrackedCallback>& callback) {
+  int32_t result = PP_OK;
+  PP_NetAddress_Private addr;
+  uint32_t size = 0;
+  bool wake_producer = false;
+  switch (recv_ring_->Pop(
+      buffer_out,
+      static_cast<uint32_t>(std::min(num_bytes, UDPSocketFilter::kMaxReadSize)),
+      &result, &addr, &size, &wake_producer)) {
+    case UDPPacketRing::STATUS_OK:
+      break;
+    case UDPPacketRing::STATUS_EMPTY:
+      return WaitForData(num_bytes, buffer_out, addr_out, callback);
+    case UDPPacketRing::STATUS_TOO_BIG:
+      return PP_ERROR_MESSAGE_TOO_BIG;
+    case UDPPacketRing::STATUS_CORRUPT:
+      return PP_ERROR_FAILED;
+  }
+
+  if (wake_producer)
+    slot_available_callback_.Run();
+  if (result == PP_OK)
+    result = SetRecvFromAddress(pp_instance_, addr, addr_out);
+  if (result != PP_OK)
+    return ConvertNetworkAPIErrorForCompatibility(result, private_api_);
+
+  last_recvfrom_addr_ = addr;
+  return static_cast<int32_t>(size);
+}
+
+int32_t UDPSocketFilter::RecvQueue::WaitForData(
+    int32_t num_bytes,
+    char* buffer_out,
+    PP_Resource* addr_out,
+    const scoped_refptr<TrackedCallback>& callback) {
+  read_buffer_ = buffer_out;
+  bytes_to_read_ = std::min(num_bytes, UDPSocketFilter::kMaxReadSize);
+  recvfrom_addr_resource_ = addr_out;
+  recvfrom_callback_ = callback;
+  return PP_OK_COMPLETIONPENDING;
+}
+
 PP_NetAddress_Private UDPSocketFilter::RecvQueue::GetLastAddrPrivate() const {
   CHECK(private_api_);
   return last_recvfrom_addr_;
@@ -18,6 +18,7 @@
 #include "ppapi/proxy/ppapi_proxy_export.h"
 #include "ppapi/proxy/resource_message_filter.h"
 #include "ppapi/shared_impl/tracked_callback.h"
+#include "ppapi/shared_impl/udp_packet_ring.h"
 
 namespace ppapi {
 namespace proxy {
@@ -48,6 +49,10 @@ class PPAPI_PROXY_EXPORT UDPSocketFilter : public ResourceMessageFilter {
                       char* buffer,
                       PP_Resource* addr,
                       const scoped_refptr<TrackedCallback>& callback);
+  // Makes |resource| read received packets from |ring| instead of waiting for
+  // PushRecvResult messages. In that mode, the "slot_available_callback" is
+  // only invoked when the browser is waiting for space in the ring.
+  void SetRecvRing(PP_Resource resource, scoped_ptr<UDPPacketRing> ring);
 
   // ResourceMessageFilter implementation.
   bool OnResourceReplyReceived(const ResourceMessageReplyParams& reply_params,
@@ -83,6 +88,10 @@ class PPAPI_PROXY_EXPORT UDPSocketFilter : public ResourceMessageFilter {
     void DataReceivedOnIOThread(int32_t result,
                                 const std::string& d,
                                 const PP_NetAddress_Private& addr);
+    // Called on the IO thread when the browser has put packets in
+    // |recv_ring_|. Completes the pending RecvFrom(), if there is one.
+    // The ppapi::ProxyLock should *not* be held, and won't be acquired.
+    void RecvRingDoorbellOnIOThread();
     // Called on whatever thread the plugin chooses. Must already hold the
     // PpapiProxyLock. Returns a code from pp_errors.h, or a positive number.
     //
@@ -95,13 +104,31 @@ class PPAPI_PROXY_EXPORT UDPSocketFilter : public ResourceMessageFilter {
                         const scoped_refptr<TrackedCallback>& callback);
     PP_NetAddress_Private GetLastAddrPrivate() const;
 
+    void set_recv_ring(scoped_ptr<UDPPacketRing> ring) {
+      recv_ring_ = ring.Pass();
+    }
+
    private:
+    // RequestData() for when |recv_ring_| is in use. Copies the packet
+    // straight from the ring into |buffer_out| if one is waiting.
+    int32_t RequestDataFromRing(int32_t num_bytes,
+                                char* buffer_out,
+                                PP_Resource* addr_out,
+                                const scoped_refptr<TrackedCallback>& callback);
+    // Registers |callback| to be completed when data arrives.
+    int32_t WaitForData(int32_t num_bytes,
+                        char* buffer_out,
+                        PP_Resource* addr_out,
+                        const scoped_refptr<TrackedCallback>& callback);
+
     struct RecvBuffer {
       int32_t result;
       std::string data;
       PP_NetAddress_Private addr;
     };
     std::queue<RecvBuffer> recv_buffers_;
+    // Received packets shared with the browser, if it provided them.
+    scoped_ptr<UDPPacketRing> recv_ring_;
 
     PP_Instance pp_instance_;
     scoped_refptr<ppapi::TrackedCallback> recvfrom_callback_;
@@ -121,6 +148,7 @@ class PPAPI_PROXY_EXPORT UDPSocketFilter : public ResourceMessageFilter {
                                  int32_t result,
                                  const std::string& data,
                                  const PP_NetAddress_Private& addr);
+  void OnPluginMsgRecvRingDoorbell(const ResourceMessageReplyParams& params);
 
   // lock_ protects queues_.
   //
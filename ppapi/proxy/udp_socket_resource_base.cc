@@ -4,11 +4,14 @@
 
 #include "ppapi/proxy/udp_socket_resource_base.h"
 
+#include <algorithm>
 #include <cstring>
 
 #include "base/logging.h"
+#include "base/memory/shared_memory.h"
 #include "ppapi/c/pp_bool.h"
 #include "ppapi/c/pp_errors.h"
+#include "ppapi/proxy/dispatch_reply_message.h"
 #include "ppapi/proxy/error_conversion.h"
 #include "ppapi/proxy/plugin_globals.h"
 #include "ppapi/proxy/ppapi_messages.h"
@@ -36,8 +39,23 @@ void PostAbortIfNecessary(const scoped_refptr<TrackedCallback>& callback) {
     callback->PostAbort();
 }
 
+std::string GetAddressKey(const PP_NetAddress_Private& addr) {
+  return std::string(addr.data,
+                     std::min(static_cast<size_t>(addr.size), sizeof(addr.data)));
+}
+
 }  // namespace
 
+UDPSocketResourceBase::PendingRingSend::PendingRingSend(
+    const std::string& data,
+    const PP_NetAddress_Private& addr,
+    const scoped_refptr<TrackedCallback>& callback)
+    : data(data), addr(addr), callback(callback) {
+}
+
+UDPSocketResourceBase::PendingRingSend::~PendingRingSend() {
+}
+
 UDPSocketResourceBase::UDPSocketResourceBase(Connection connection,
                                              PP_Instance instance,
                                              bool private_api)
@@ -47,7 +65,8 @@ UDPSocketResourceBase::UDPSocketResourceBase(Connection connection,
       bound_(false),
       closed_(false),
       recv_filter_(PluginGlobals::Get()->udp_socket_filter()),
-      bound_addr_() {
+      bound_addr_(),
+      send_ring_error_(PP_OK) {
   recv_filter_->AddUDPResource(
       pp_instance(), pp_resource(), private_api,
       base::Bind(&UDPSocketResourceBase::SlotBecameAvailable, pp_resource()));
@@ -61,6 +80,21 @@ UDPSocketResourceBase::~UDPSocketResourceBase() {
   CloseImpl();
 }
 
+void UDPSocketResourceBase::OnReplyReceived(
+    const ResourceMessageReplyParams& params,
+    const IPC::Message& msg) {
+  if (params.sequence()) {
+    PluginResource::OnReplyReceived(params, msg);
+    return;
+  }
+  PPAPI_BEGIN_MESSAGE_MAP(UDPSocketResourceBase, msg)
+    PPAPI_DISPATCH_PLUGIN_RESOURCE_CALL(
+        PpapiPluginMsg_UDPSocket_SendRingSpaceAvailable,
+        OnPluginMsgSendRingSpaceAvailable)
+    PPAPI_DISPATCH_PLUGIN_RESOURCE_CALL_UNHANDLED(NOTREACHED())
+  PPAPI_END_MESSAGE_MAP()
+}
+
 int32_t UDPSocketResourceBase::SetOptionImpl(
     PP_UDPSocket_Option name,
     const PP_Var& value,
@@ -193,12 +227,31 @@ int32_t UDPSocketResourceBase::SendToImpl(
     return PP_ERROR_BADARGUMENT;
   if (!bound_)
     return PP_ERROR_FAILED;
-  if (sendto_callbacks_.size() == kPluginSendBufferSlots)
-    return PP_ERROR_INPROGRESS;
 
   if (num_bytes > kMaxWriteSize)
     num_bytes = kMaxWriteSize;
 
+  if (send_ring_ && CanSendThroughRing(*addr)) {
+    if (send_ring_error_ != PP_OK) {
+      int32_t result = send_ring_error_;
+      send_ring_error_ = PP_OK;
+      return ConvertNetworkAPIErrorForCompatibility(result, private_api_);
+    }
+    // Keep packets in order behind the ones already waiting for space.
+    if (pending_ring_sends_.empty() &&
+        PushToSendRing(buffer, num_bytes, *addr)) {
+      return num_bytes;
+    }
+    if (pending_ring_sends_.size() == kPluginSendBufferSlots)
+      return PP_ERROR_INPROGRESS;
+    pending_ring_sends_.push(
+        PendingRingSend(std::string(buffer, num_bytes), *addr, callback));
+    return PP_OK_COMPLETIONPENDING;
+  }
+
+  if (sendto_callbacks_.size() == kPluginSendBufferSlots)
+    return PP_ERROR_INPROGRESS;
+
   sendto_callbacks_.push(callback);
 
   // Send the request, the browser will call us back via SendToReply.
@@ -206,7 +259,7 @@ int32_t UDPSocketResourceBase::SendToImpl(
       BROWSER,
       PpapiHostMsg_UDPSocket_SendTo(std::string(buffer, num_bytes), *addr),
       base::Bind(&UDPSocketResourceBase::OnPluginMsgSendToReply,
-                 base::Unretained(this)),
+                 base::Unretained(this), *addr),
       callback);
   return PP_OK_COMPLETIONPENDING;
 }
@@ -226,6 +279,11 @@ void UDPSocketResourceBase::CloseImpl() {
     sendto_callbacks_.pop();
     PostAbortIfNecessary(callback);
   }
+  while (!pending_ring_sends_.empty()) {
+    PostAbortIfNecessary(pending_ring_sends_.front().callback);
+    pending_ring_sends_.pop();
+  }
+  send_ring_.reset();
   recv_filter_->RemoveUDPResource(pp_resource());
 }
 
@@ -276,13 +334,16 @@ void UDPSocketResourceBase::OnPluginMsgBindReply(
   if (!TrackedCallback::IsPending(bind_callback_) || closed_)
     return;
 
-  if (params.result() == PP_OK)
+  if (params.result() == PP_OK) {
     bound_ = true;
+    InitRings(params);
+  }
   bound_addr_ = bound_addr;
   RunCallback(bind_callback_, params.result(), private_api_);
 }
 
 void UDPSocketResourceBase::OnPluginMsgSendToReply(
+    const PP_NetAddress_Private& addr,
     const ResourceMessageReplyParams& params,
     int32_t bytes_written) {
   // This can be empty if the socket was closed, but there are still tasks
@@ -292,6 +353,10 @@ void UDPSocketResourceBase::OnPluginMsgSendToReply(
 
   scoped_refptr<TrackedCallback> callback = sendto_callbacks_.front();
   sendto_callbacks_.pop();
+  // The browser has checked that we may send to |addr|, so later packets to it
+  // can go through the ring.
+  if (params.result() == PP_OK && send_ring_)
+    ring_destinations_.insert(GetAddressKey(addr));
   if (!TrackedCallback::IsPending(callback))
     return;
 
@@ -301,6 +366,77 @@ void UDPSocketResourceBase::OnPluginMsgSendToReply(
     RunCallback(callback, params.result(), private_api_);
 }
 
+void UDPSocketResourceBase::OnPluginMsgSendRingSpaceAvailable(
+    const ResourceMessageReplyParams& params,
+    int32_t result) {
+  if (!send_ring_)
+    return;
+  if (result != PP_OK && send_ring_error_ == PP_OK)
+    send_ring_error_ = result;
+
+  while (!pending_ring_sends_.empty()) {
+    PendingRingSend& send = pending_ring_sends_.front();
+    if (send_ring_error_ == PP_OK &&
+        !PushToSendRing(send.data.data(), static_cast<int32_t>(send.data.size()),
+                        send.addr)) {
+      // Still full; the browser will tell us when there's space again.
+      return;
+    }
+    scoped_refptr<TrackedCallback> callback = send.callback;
+    int32_t bytes_written = static_cast<int32_t>(send.data.size());
+    pending_ring_sends_.pop();
+    if (!TrackedCallback::IsPending(callback))
+      continue;
+    if (send_ring_error_ != PP_OK) {
+      int32_t error = send_ring_error_;
+      send_ring_error_ = PP_OK;
+      RunCallback(callback, error, private_api_);
+    } else {
+      RunCallback(callback, bytes_written, private_api_);
+    }
+  }
+}
+
+void UDPSocketResourceBase::InitRings(
+    const ResourceMessageReplyParams& params) {
+  // Old browsers, and browsers which failed to set up the rings, don't send
+  // any handles; in that case every packet goes through IPC.
+  base::SharedMemoryHandle recv_handle;
+  base::SharedMemoryHandle send_handle;
+  if (!params.TakeSharedMemoryHandleAtIndex(0, &recv_handle) ||
+      !params.TakeSharedMemoryHandleAtIndex(1, &send_handle)) {
+    return;
+  }
+
+  scoped_ptr<UDPPacketRing> recv_ring(new UDPPacketRing);
+  scoped_ptr<UDPPacketRing> send_ring(new UDPPacketRing);
+  if (!recv_ring->Init(
+          make_scoped_ptr(new base::SharedMemory(recv_handle, false)), false) ||
+      !send_ring->Init(
+          make_scoped_ptr(new base::SharedMemory(send_handle, false)), false)) {
+    return;
+  }
+  recv_filter_->SetRecvRing(pp_resource(), recv_ring.Pass());
+  send_ring_ = send_ring.Pass();
+}
+
+bool UDPSocketResourceBase::CanSendThroughRing(
+    const PP_NetAddress_Private& addr) const {
+  return ring_destinations_.count(GetAddressKey(addr)) > 0;
+}
+
+bool UDPSocketResourceBase::PushToSendRing(const char* buffer,
+                                           int32_t num_bytes,
+                                           const PP_NetAddress_Private& addr) {
+  DCHECK(send_ring_);
+  bool wake_consumer = false;
+  if (!send_ring_->Push(PP_OK, addr, buffer, num_bytes, &wake_consumer))
+    return false;
+  if (wake_consumer)
+    Post(BROWSER, PpapiHostMsg_UDPSocket_SendRingDoorbell());
+  return true;
+}
+
 // static
 void UDPSocketResourceBase::SlotBecameAvailable(PP_Resource resource) {
   ProxyLock::AssertAcquired();
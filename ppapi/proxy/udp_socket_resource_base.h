@@ -6,16 +6,20 @@
 #define PPAPI_PROXY_UDP_SOCKET_RESOURCE_BASE_H_
 
 #include <queue>
+#include <set>
+#include <string>
 
 #include "base/basictypes.h"
 #include "base/compiler_specific.h"
 #include "base/memory/ref_counted.h"
+#include "base/memory/scoped_ptr.h"
 #include "ppapi/c/ppb_udp_socket.h"
 #include "ppapi/c/private/ppb_net_address_private.h"
 #include "ppapi/proxy/plugin_resource.h"
 #include "ppapi/proxy/ppapi_proxy_export.h"
 #include "ppapi/proxy/udp_socket_filter.h"
 #include "ppapi/shared_impl/tracked_callback.h"
+#include "ppapi/shared_impl/udp_packet_ring.h"
 
 namespace ppapi {
 namespace proxy {
@@ -55,6 +59,10 @@ class PPAPI_PROXY_EXPORT UDPSocketResourceBase : public PluginResource {
                         bool private_api);
   virtual ~UDPSocketResourceBase();
 
+  // PluginResource implementation.
+  void OnReplyReceived(const ResourceMessageReplyParams& params,
+                       const IPC::Message& msg) override;
+
   int32_t SetOptionImpl(PP_UDPSocket_Option name,
                         const PP_Var& value,
                         bool check_bind_state,
@@ -79,13 +87,41 @@ class PPAPI_PROXY_EXPORT UDPSocketResourceBase : public PluginResource {
                          scoped_refptr<TrackedCallback> callback);
 
  private:
+  // A packet waiting for space in |send_ring_|.
+  struct PendingRingSend {
+    PendingRingSend(const std::string& data,
+                    const PP_NetAddress_Private& addr,
+                    const scoped_refptr<TrackedCallback>& callback);
+    ~PendingRingSend();
+
+    std::string data;
+    PP_NetAddress_Private addr;
+    scoped_refptr<TrackedCallback> callback;
+  };
+
   // IPC message handlers.
   void OnPluginMsgGeneralReply(scoped_refptr<TrackedCallback> callback,
                                const ResourceMessageReplyParams& params);
   void OnPluginMsgBindReply(const ResourceMessageReplyParams& params,
                             const PP_NetAddress_Private& bound_addr);
-  void OnPluginMsgSendToReply(const ResourceMessageReplyParams& params,
+  void OnPluginMsgSendToReply(const PP_NetAddress_Private& addr,
+                              const ResourceMessageReplyParams& params,
                               int32_t bytes_written);
+  void OnPluginMsgSendRingSpaceAvailable(
+      const ResourceMessageReplyParams& params,
+      int32_t result);
+
+  // Sets up the packet rings the browser sent with the bind reply, if any.
+  void InitRings(const ResourceMessageReplyParams& params);
+
+  // Returns true if a packet to |addr| may be sent through |send_ring_|.
+  bool CanSendThroughRing(const PP_NetAddress_Private& addr) const;
+
+  // Appends a packet to |send_ring_|, ringing the browser's doorbell if it's
+  // idle. Returns false if the ring is full.
+  bool PushToSendRing(const char* buffer,
+                      int32_t num_bytes,
+                      const PP_NetAddress_Private& addr);
 
   static void SlotBecameAvailable(PP_Resource resource);
   static void SlotBecameAvailableWithLock(PP_Resource resource);
@@ -106,6 +142,18 @@ class PPAPI_PROXY_EXPORT UDPSocketResourceBase : public PluginResource {
 
   std::queue<scoped_refptr<TrackedCallback>> sendto_callbacks_;
 
+  // Packets to the addresses in |ring_destinations_| are put in |send_ring_|
+  // instead of being sent in a SendTo message each. An address is added once
+  // the browser has accepted a SendTo message for it, since that's where
+  // permissions are checked. The browser rejects ring packets to other
+  // addresses.
+  scoped_ptr<UDPPacketRing> send_ring_;
+  std::set<std::string> ring_destinations_;
+  std::queue<PendingRingSend> pending_ring_sends_;
+  // The first error the browser reported for a packet from |send_ring_|. It
+  // is returned by the next SendTo().
+  int32_t send_ring_error_;
+
   DISALLOW_COPY_AND_ASSIGN(UDPSocketResourceBase);
 };
 
@@ -7,6 +7,7 @@
 #include "base/lazy_instance.h"  // For testing purposes only.
 #include "base/logging.h"
 #include "base/single_thread_task_runner.h"
+#include "base/task_runner.h"
 #include "base/thread_task_runner_handle.h"
 #include "base/threading/thread_local.h"  // For testing purposes only.
 
@@ -68,6 +69,10 @@ bool PpapiGlobals::IsPluginGlobals() const { return false; }
 
 void PpapiGlobals::MarkPluginIsActive() {}
 
+scoped_refptr<base::TaskRunner> PpapiGlobals::CreateFileIOTaskRunner() {
+  return GetFileTaskRunner();
+}
+
 // static
 PpapiGlobals* PpapiGlobals::GetThreadLocalPointer() {
   return tls_ppapi_globals_for_test.Pointer()->Get();
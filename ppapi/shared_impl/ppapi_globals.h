@@ -117,6 +117,11 @@ class PPAPI_SHARED_EXPORT PpapiGlobals {
   // in-process plugins.
   virtual base::TaskRunner* GetFileTaskRunner() = 0;
 
+  // Returns a task runner for the blocking operations on a single file. Tasks
+  // posted to it run in order, but may run in parallel with the tasks for
+  // other files. By default every file shares GetFileTaskRunner().
+  virtual scoped_refptr<base::TaskRunner> CreateFileIOTaskRunner();
+
   // Returns the command line for the process.
   virtual std::string GetCmdLine() = 0;
 
@@ -24,7 +24,8 @@ struct PPAPI_SHARED_EXPORT InputEventData {
   ~InputEventData();
 
   // Internal-only value. Set to true when this input event is filtered, that
-  // is, should be delivered synchronously. This is used by the proxy.
+  // is, the host needs to know whether the plugin handled it. This is used by
+  // the proxy.
   bool is_filtered;
 
   PP_InputEvent_Type event_type;
@@ -0,0 +1,241 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ppapi/shared_impl/udp_packet_ring.h"
+
+#include <cstring>
+
+#include "base/logging.h"
+
+namespace ppapi {
+
+namespace {
+
+// Size of the data area of each ring. It must be a power of two, and large
+// enough to hold a record of kMaxPacketSize wherever the write position is.
+const uint32_t kDataSize = 512 * 1024;
+
+// Records start at multiples of this.
+const uint32_t kRecordAlignment = 8;
+
+// Where the data area starts, leaving the shared indices on their own cache
+// line.
+const size_t kDataOffset = 64;
+
+// Written in place of a record's size when the record didn't fit between the
+// write position and the end of the data area, and was written at the start
+// instead.
+const uint32_t kWrapMarker = 0xffffffff;
+
+}  // namespace
+
+const uint32_t UDPPacketRing::kMaxPacketSize = 128 * 1024;
+
+struct UDPPacketRing::Header {
+  base::subtle::Atomic32 write_index;
+  base::subtle::Atomic32 read_index;
+  base::subtle::Atomic32 consumer_waiting;
+  base::subtle::Atomic32 producer_waiting;
+};
+
+struct UDPPacketRing::RecordHeader {
+  uint32_t size;
+  int32_t result;
+  PP_NetAddress_Private addr;
+};
+
+// static
+size_t UDPPacketRing::GetSharedMemorySize() {
+  COMPILE_ASSERT(sizeof(Header) <= kDataOffset, header_too_big);
+  COMPILE_ASSERT((kDataSize & (kDataSize - 1)) == 0,
+                 data_size_must_be_a_power_of_two);
+  return kDataOffset + kDataSize;
+}
+
+// static
+uint32_t UDPPacketRing::GetRecordSize(uint32_t payload_size) {
+  uint32_t size = sizeof(RecordHeader) + payload_size;
+  return (size + kRecordAlignment - 1) & ~(kRecordAlignment - 1);
+}
+
+UDPPacketRing::UDPPacketRing()
+    : header_(NULL), write_index_(0), read_index_(0), corrupt_(false) {
+  DCHECK_LE(2 * GetRecordSize(kMaxPacketSize), kDataSize);
+}
+
+UDPPacketRing::~UDPPacketRing() {
+}
+
+bool UDPPacketRing::Init(scoped_ptr<base::SharedMemory> shm, bool initialize) {
+  DCHECK(shm);
+  if (!shm->memory() && !shm->Map(GetSharedMemorySize()))
+    return false;
+  if (shm->mapped_size() < GetSharedMemorySize())
+    return false;
+
+  shm_ = shm.Pass();
+  header_ = reinterpret_cast<Header*>(shm_->memory());
+  if (initialize) {
+    memset(header_, 0, sizeof(*header_));
+    // The consumer starts out idle, so the first packet rings the doorbell.
+    base::subtle::Release_Store(&header_->consumer_waiting, 1);
+  }
+  write_index_ = static_cast<uint32_t>(
+      base::subtle::Acquire_Load(&header_->write_index));
+  read_index_ = static_cast<uint32_t>(
+      base::subtle::Acquire_Load(&header_->read_index));
+  corrupt_ = false;
+  return true;
+}
+
+bool UDPPacketRing::Push(int32_t result,
+                         const PP_NetAddress_Private& addr,
+                         const char* payload,
+                         uint32_t size,
+                         bool* wake_consumer) {
+  DCHECK(header_);
+  *wake_consumer = false;
+  if (size > kMaxPacketSize) {
+    NOTREACHED();
+    return false;
+  }
+
+  uint32_t record_size = GetRecordSize(size);
+  uint32_t pos = write_index_ & (kDataSize - 1);
+  uint32_t tail = kDataSize - pos;
+  uint32_t needed = record_size <= tail ? record_size : tail + record_size;
+
+  // A read index the consumer published more than a ring ago is bogus; treat
+  // the ring as full so a misbehaving consumer only stalls itself.
+  uint32_t used = write_index_ - static_cast<uint32_t>(
+                                     base::subtle::Acquire_Load(
+                                         &header_->read_index));
+  if (used > kDataSize || kDataSize - used < needed) {
+    base::subtle::NoBarrier_Store(&header_->producer_waiting, 1);
+    base::subtle::MemoryBarrier();
+    // The consumer may have made room before it saw the flag.
+    used = write_index_ - static_cast<uint32_t>(
+                              base::subtle::Acquire_Load(&header_->read_index));
+    if (used > kDataSize || kDataSize - used < needed)
+      return false;
+  }
+
+  if (record_size > tail) {
+    memcpy(data() + pos, &kWrapMarker, sizeof(kWrapMarker));
+    write_index_ += tail;
+    pos = 0;
+  }
+
+  RecordHeader record;
+  record.size = size;
+  record.result = result;
+  record.addr = addr;
+  memcpy(data() + pos, &record, sizeof(record));
+  if (size)
+    memcpy(data() + pos + sizeof(record), payload, size);
+  write_index_ += record_size;
+
+  base::subtle::Release_Store(
+      &header_->write_index, static_cast<base::subtle::Atomic32>(write_index_));
+  base::subtle::MemoryBarrier();
+  if (base::subtle::NoBarrier_AtomicExchange(&header_->consumer_waiting, 0))
+    *wake_consumer = true;
+  return true;
+}
+
+UDPPacketRing::Status UDPPacketRing::Peek(uint32_t* size) {
+  RecordHeader record;
+  Status status = ReadRecordHeader(&record);
+  if (status == STATUS_OK)
+    *size = record.size;
+  return status;
+}
+
+UDPPacketRing::Status UDPPacketRing::Pop(char* buffer,
+                                         uint32_t buffer_size,
+                                         int32_t* result,
+                                         PP_NetAddress_Private* addr,
+                                         uint32_t* size,
+                                         bool* wake_producer) {
+  *wake_producer = false;
+  RecordHeader record;
+  Status status = ReadRecordHeader(&record);
+  if (status != STATUS_OK)
+    return status;
+  if (record.size > buffer_size)
+    return STATUS_TOO_BIG;
+
+  uint32_t pos = read_index_ & (kDataSize - 1);
+  if (record.size)
+    memcpy(buffer, data() + pos + sizeof(record), record.size);
+  *result = record.result;
+  *addr = record.addr;
+  *size = record.size;
+  read_index_ += GetRecordSize(record.size);
+
+  base::subtle::Release_Store(
+      &header_->read_index, static_cast<base::subtle::Atomic32>(read_index_));
+  base::subtle::MemoryBarrier();
+  if (base::subtle::NoBarrier_AtomicExchange(&header_->producer_waiting, 0))
+    *wake_producer = true;
+  return STATUS_OK;
+}
+
+char* UDPPacketRing::data() {
+  return static_cast<char*>(shm_->memory()) + kDataOffset;
+}
+
+UDPPacketRing::Status UDPPacketRing::ReadRecordHeader(RecordHeader* record) {
+  DCHECK(header_);
+  if (corrupt_)
+    return STATUS_CORRUPT;
+
+  for (;;) {
+    uint32_t used =
+        static_cast<uint32_t>(base::subtle::Acquire_Load(
+            &header_->write_index)) - read_index_;
+    if (!used) {
+      // About to go idle: ask for a doorbell, then look again in case a packet
+      // was published before the producer could see the request.
+      base::subtle::NoBarrier_Store(&header_->consumer_waiting, 1);
+      base::subtle::MemoryBarrier();
+      used = static_cast<uint32_t>(base::subtle::Acquire_Load(
+                 &header_->write_index)) - read_index_;
+      if (!used)
+        return STATUS_EMPTY;
+    }
+
+    uint32_t pos = read_index_ & (kDataSize - 1);
+    uint32_t tail = kDataSize - pos;
+    if (used > kDataSize || used % kRecordAlignment)
+      break;
+
+    // The producer may change the record while we read it, so read each field
+    // once and only use the validated copy.
+    uint32_t size;
+    memcpy(&size, data() + pos, sizeof(size));
+    if (size == kWrapMarker) {
+      if (tail >= used)
+        break;
+      read_index_ += tail;
+      continue;
+    }
+
+    if (size > kMaxPacketSize)
+      break;
+    uint32_t record_size = GetRecordSize(size);
+    if (record_size > tail || record_size > used)
+      break;
+
+    memcpy(record, data() + pos, sizeof(*record));
+    record->size = size;
+    return STATUS_OK;
+  }
+
+  LOG(ERROR) << "Invalid record in UDP packet ring.";
+  corrupt_ = true;
+  return STATUS_CORRUPT;
+}
+
+}  // namespace ppapi
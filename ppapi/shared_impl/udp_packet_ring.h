@@ -0,0 +1,118 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef PPAPI_SHARED_IMPL_UDP_PACKET_RING_H_
+#define PPAPI_SHARED_IMPL_UDP_PACKET_RING_H_
+
+#include "base/atomicops.h"
+#include "base/basictypes.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/memory/shared_memory.h"
+#include "ppapi/c/pp_stdint.h"
+#include "ppapi/c/private/ppb_net_address_private.h"
+#include "ppapi/shared_impl/ppapi_shared_export.h"
+
+namespace ppapi {
+
+// A single-producer, single-consumer queue of UDP datagrams in a block of
+// shared memory, used by PPB_UDPSocket to move packets between the plugin and
+// the browser without one IPC message per packet.
+//
+// Each side keeps its own copy of the index it advances, and only publishes it
+// to shared memory, so the other process can't make it read or write outside
+// of the ring. The consumer validates every record it reads.
+//
+// IPC messages are only needed to wake the other side up:
+//  1. The consumer finds the ring empty and marks itself as waiting.
+//  2. The producer's next Push() reports that the consumer must be woken up,
+//     and the producer sends a "doorbell" message.
+//  3. The consumer drains the ring until it is empty again.
+// The producer waits for free space in the same way: a Push() which doesn't
+// fit marks the producer as waiting, and the Pop() which makes room reports
+// that the producer must be woken up.
+class PPAPI_SHARED_EXPORT UDPPacketRing {
+ public:
+  enum Status {
+    STATUS_OK,
+    // There's no packet to read.
+    STATUS_EMPTY,
+    // The oldest packet doesn't fit into the given buffer. It's left in the
+    // ring.
+    STATUS_TOO_BIG,
+    // The ring holds something that isn't a valid packet. The ring can't be
+    // used anymore.
+    STATUS_CORRUPT,
+  };
+
+  // The largest datagram a ring can carry.
+  static const uint32_t kMaxPacketSize;
+
+  // Returns the number of bytes of shared memory needed for one ring.
+  static size_t GetSharedMemorySize();
+
+  UDPPacketRing();
+  ~UDPPacketRing();
+
+  // Maps |shm|, which must be at least GetSharedMemorySize() bytes. The side
+  // which created the memory passes |initialize| as true to reset the ring.
+  bool Init(scoped_ptr<base::SharedMemory> shm, bool initialize);
+
+  base::SharedMemory* shm() { return shm_.get(); }
+
+  // Producer side. Appends a packet with the given |result| (a pp_errors.h
+  // code, or PP_OK for a datagram), address and |payload|. Returns false if the
+  // packet doesn't fit; the caller should retry after the consumer has woken
+  // it up. |wake_consumer| is set to true if the consumer must be sent a
+  // doorbell message.
+  bool Push(int32_t result,
+            const PP_NetAddress_Private& addr,
+            const char* payload,
+            uint32_t size,
+            bool* wake_consumer);
+
+  // Consumer side. Returns the size of the oldest packet through |size|,
+  // without removing it.
+  Status Peek(uint32_t* size);
+
+  // Consumer side. Removes the oldest packet, copying its payload into
+  // |buffer|. |wake_producer| is set to true if the producer must be told that
+  // space is available.
+  Status Pop(char* buffer,
+             uint32_t buffer_size,
+             int32_t* result,
+             PP_NetAddress_Private* addr,
+             uint32_t* size,
+             bool* wake_producer);
+
+ private:
+  struct Header;
+  struct RecordHeader;
+
+  // Returns the space taken by a record carrying |payload_size| bytes.
+  static uint32_t GetRecordSize(uint32_t payload_size);
+
+  // Returns the ring's data area.
+  char* data();
+
+  // Consumer side. Skips wrap markers and validates the record at
+  // |read_index_|, returning its header through |record|.
+  Status ReadRecordHeader(RecordHeader* record);
+
+  scoped_ptr<base::SharedMemory> shm_;
+  Header* header_;
+
+  // The indices this side advances, as free-running byte counts. These are
+  // the only copies trusted by this side.
+  uint32_t write_index_;
+  uint32_t read_index_;
+
+  // True once a corrupt record has been found.
+  bool corrupt_;
+
+  DISALLOW_COPY_AND_ASSIGN(UDPPacketRing);
+};
+
+}  // namespace ppapi
+
+#endif  // PPAPI_SHARED_IMPL_UDP_PACKET_RING_H_
@@ -0,0 +1,256 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "base/memory/scoped_ptr.h"
+#include "base/memory/shared_memory.h"
+#include "base/process/process_handle.h"
+#include "ppapi/c/pp_errors.h"
+#include "ppapi/shared_impl/udp_packet_ring.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace ppapi {
+
+namespace {
+
+// Sets up a producer and a consumer sharing one ring, as the plugin and the
+// browser would.
+void CreateRingPair(UDPPacketRing* producer, UDPPacketRing* consumer) {
+  scoped_ptr<base::SharedMemory> shm(new base::SharedMemory);
+  ASSERT_TRUE(
+      shm->CreateAndMapAnonymous(UDPPacketRing::GetSharedMemorySize()));
+  base::SharedMemoryHandle handle;
+  ASSERT_TRUE(shm->ShareToProcess(base::GetCurrentProcessHandle(), &handle));
+  ASSERT_TRUE(producer->Init(shm.Pass(), true));
+  ASSERT_TRUE(consumer->Init(
+      make_scoped_ptr(new base::SharedMemory(handle, false)), false));
+}
+
+PP_NetAddress_Private MakeAddress(char tag) {
+  PP_NetAddress_Private addr = {};
+  addr.size = 4;
+  addr.data[0] = tag;
+  return addr;
+}
+
+// Stands in for the browser: whenever its doorbell rings, it drains the
+// plugin's send ring and echoes each packet into the plugin's receive ring.
+class LoopbackSocketHost {
+ public:
+  LoopbackSocketHost(UDPPacketRing* send_ring, UDPPacketRing* recv_ring)
+      : send_ring_(send_ring),
+        recv_ring_(recv_ring),
+        recv_doorbells_(0),
+        send_space_notifications_(0),
+        buffer_(UDPPacketRing::kMaxPacketSize) {}
+
+  // Returns the number of packets echoed.
+  int OnSendDoorbell() {
+    int echoed = 0;
+    int32_t result;
+    PP_NetAddress_Private addr;
+    uint32_t size;
+    bool wake_producer;
+    while (send_ring_->Pop(&buffer_[0], buffer_.size(), &result, &addr, &size,
+                           &wake_producer) == UDPPacketRing::STATUS_OK) {
+      if (wake_producer)
+        ++send_space_notifications_;
+      bool wake_consumer;
+      if (!recv_ring_->Push(result, addr, &buffer_[0], size, &wake_consumer))
+        break;
+      if (wake_consumer)
+        ++recv_doorbells_;
+      ++echoed;
+    }
+    return echoed;
+  }
+
+  int recv_doorbells() const { return recv_doorbells_; }
+  int send_space_notifications() const { return send_space_notifications_; }
+
+ private:
+  UDPPacketRing* send_ring_;
+  UDPPacketRing* recv_ring_;
+  int recv_doorbells_;
+  int send_space_notifications_;
+  std::vector<char> buffer_;
+};
+
+}  // namespace
+
+TEST(UDPPacketRingTest, PushAndPop) {
+  UDPPacketRing producer;
+  UDPPacketRing consumer;
+  CreateRingPair(&producer, &consumer);
+
+  uint32_t size = 0;
+  EXPECT_EQ(UDPPacketRing::STATUS_EMPTY, consumer.Peek(&size));
+
+  // The consumer is idle, so the first packet rings the doorbell and the
+  // second one doesn't.
+  const std::string kFirst("first");
+  const std::string kSecond("second packet");
+  bool wake_consumer = false;
+  EXPECT_TRUE(producer.Push(PP_OK, MakeAddress('a'), kFirst.data(),
+                            kFirst.size(), &wake_consumer));
+  EXPECT_TRUE(wake_consumer);
+  EXPECT_TRUE(producer.Push(PP_OK, MakeAddress('b'), kSecond.data(),
+                            kSecond.size(), &wake_consumer));
+  EXPECT_FALSE(wake_consumer);
+  EXPECT_TRUE(producer.Push(PP_ERROR_FAILED, MakeAddress('c'), NULL, 0,
+                            &wake_consumer));
+  EXPECT_FALSE(wake_consumer);
+
+  char buffer[64];
+  int32_t result;
+  PP_NetAddress_Private addr;
+  bool wake_producer;
+  ASSERT_EQ(UDPPacketRing::STATUS_OK, consumer.Peek(&size));
+  EXPECT_EQ(kFirst.size(), size);
+  // A buffer that's too small leaves the packet in the ring.
+  EXPECT_EQ(UDPPacketRing::STATUS_TOO_BIG,
+            consumer.Pop(buffer, 2, &result, &addr, &size, &wake_producer));
+  ASSERT_EQ(UDPPacketRing::STATUS_OK,
+            consumer.Pop(buffer, sizeof(buffer), &result, &addr, &size,
+                         &wake_producer));
+  EXPECT_EQ(PP_OK, result);
+  EXPECT_EQ('a', addr.data[0]);
+  EXPECT_EQ(kFirst, std::string(buffer, size));
+  EXPECT_FALSE(wake_producer);
+
+  ASSERT_EQ(UDPPacketRing::STATUS_OK,
+            consumer.Pop(buffer, sizeof(buffer), &result, &addr, &size,
+                         &wake_producer));
+  EXPECT_EQ('b', addr.data[0]);
+  EXPECT_EQ(kSecond, std::string(buffer, size));
+
+  ASSERT_EQ(UDPPacketRing::STATUS_OK,
+            consumer.Pop(buffer, sizeof(buffer), &result, &addr, &size,
+                         &wake_producer));
+  EXPECT_EQ(PP_ERROR_FAILED, result);
+  EXPECT_EQ(0u, size);
+
+  // Having drained the ring, the consumer asks to be woken up again.
+  EXPECT_EQ(UDPPacketRing::STATUS_EMPTY, consumer.Peek(&size));
+  EXPECT_TRUE(producer.Push(PP_OK, MakeAddress('d'), kFirst.data(),
+                            kFirst.size(), &wake_consumer));
+  EXPECT_TRUE(wake_consumer);
+}
+
+TEST(UDPPacketRingTest, FullRingWakesProducer) {
+  UDPPacketRing producer;
+  UDPPacketRing consumer;
+  CreateRingPair(&producer, &consumer);
+
+  std::vector<char> packet(UDPPacketRing::kMaxPacketSize, 'x');
+  bool wake_consumer;
+  int pushed = 0;
+  while (producer.Push(PP_OK, MakeAddress('a'), &packet[0], packet.size(),
+                       &wake_consumer)) {
+    ++pushed;
+  }
+  ASSERT_GT(pushed, 0);
+
+  std::vector<char> buffer(UDPPacketRing::kMaxPacketSize);
+  int32_t result;
+  PP_NetAddress_Private addr;
+  uint32_t size;
+  bool wake_producer = false;
+  ASSERT_EQ(UDPPacketRing::STATUS_OK,
+            consumer.Pop(&buffer[0], buffer.size(), &result, &addr, &size,
+                         &wake_producer));
+  EXPECT_TRUE(wake_producer);
+  EXPECT_TRUE(producer.Push(PP_OK, MakeAddress('a'), &packet[0], packet.size(),
+                            &wake_consumer));
+}
+
+TEST(UDPPacketRingTest, WrapsAround) {
+  UDPPacketRing producer;
+  UDPPacketRing consumer;
+  CreateRingPair(&producer, &consumer);
+
+  // Odd sizes make records straddle the end of the ring at varying offsets.
+  std::vector<char> buffer(UDPPacketRing::kMaxPacketSize);
+  for (uint32_t i = 0; i < 200; ++i) {
+    std::string packet(1000 + i * 997 % 60000, static_cast<char>(i));
+    bool wake_consumer;
+    ASSERT_TRUE(producer.Push(PP_OK, MakeAddress('a'), packet.data(),
+                              packet.size(), &wake_consumer));
+
+    int32_t result;
+    PP_NetAddress_Private addr;
+    uint32_t size;
+    bool wake_producer;
+    ASSERT_EQ(UDPPacketRing::STATUS_OK,
+              consumer.Pop(&buffer[0], buffer.size(), &result, &addr, &size,
+                           &wake_producer));
+    EXPECT_EQ(packet, std::string(&buffer[0], size));
+  }
+}
+
+TEST(UDPPacketRingTest, CorruptRecord) {
+  UDPPacketRing producer;
+  UDPPacketRing consumer;
+  CreateRingPair(&producer, &consumer);
+
+  const std::string kPacket("packet");
+  bool wake_consumer;
+  ASSERT_TRUE(producer.Push(PP_OK, MakeAddress('a'), kPacket.data(),
+                            kPacket.size(), &wake_consumer));
+
+  // Scribble over the size of the first record, at the start of the data
+  // area, as a compromised producer could.
+  uint32_t bogus_size = UDPPacketRing::kMaxPacketSize + 1;
+  memcpy(static_cast<char*>(producer.shm()->memory()) + 64, &bogus_size,
+         sizeof(bogus_size));
+
+  uint32_t size;
+  EXPECT_EQ(UDPPacketRing::STATUS_CORRUPT, consumer.Peek(&size));
+  // Once corrupt, the ring stays unusable.
+  EXPECT_EQ(UDPPacketRing::STATUS_CORRUPT, consumer.Peek(&size));
+}
+
+TEST(UDPPacketRingTest, LoopbackSocketHost) {
+  UDPPacketRing plugin_send_ring;
+  UDPPacketRing host_send_ring;
+  UDPPacketRing host_recv_ring;
+  UDPPacketRing plugin_recv_ring;
+  CreateRingPair(&plugin_send_ring, &host_send_ring);
+  CreateRingPair(&host_recv_ring, &plugin_recv_ring);
+  LoopbackSocketHost host(&host_send_ring, &host_recv_ring);
+
+  // A burst of small packets costs a single doorbell in each direction.
+  const int kPackets = 1000;
+  int send_doorbells = 0;
+  for (int i = 0; i < kPackets; ++i) {
+    std::string packet(16, static_cast<char>(i));
+    bool wake_consumer;
+    ASSERT_TRUE(plugin_send_ring.Push(PP_OK, MakeAddress('a'), packet.data(),
+                                      packet.size(), &wake_consumer));
+    if (wake_consumer)
+      ++send_doorbells;
+  }
+  EXPECT_EQ(1, send_doorbells);
+  EXPECT_EQ(kPackets, host.OnSendDoorbell());
+  EXPECT_EQ(1, host.recv_doorbells());
+  EXPECT_EQ(0, host.send_space_notifications());
+
+  char buffer[16];
+  int32_t result;
+  PP_NetAddress_Private addr;
+  uint32_t size;
+  bool wake_producer;
+  for (int i = 0; i < kPackets; ++i) {
+    ASSERT_EQ(UDPPacketRing::STATUS_OK,
+              plugin_recv_ring.Pop(buffer, sizeof(buffer), &result, &addr,
+                                   &size, &wake_producer));
+    EXPECT_EQ(std::string(16, static_cast<char>(i)), std::string(buffer, size));
+  }
+  EXPECT_EQ(UDPPacketRing::STATUS_EMPTY, plugin_recv_ring.Peek(&size));
+}
+
+}  // namespace ppapi